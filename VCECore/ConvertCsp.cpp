@@ -26,39 +26,164 @@
 // ------------------------------------------------------------------------------------------
 
 #include <cstdint>
+#include <cmath>
 #include <vector>
-#include <tchar.h>
-#include "ConvertCSP.h"
+#include <algorithm>
+#include "qsv_osdep.h"
+#include "ConvertCsp.h"
+#include "cpu_info.h"
 
 void convert_yuy2_to_nv12(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_stream_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_stream_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_stream_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_stream_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 
 void convert_yuy2_to_nv12_i(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_i_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yuy2_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_i_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_i_stream_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_i_stream_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_i_stream_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_i_stream_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuy2_to_nv12_i_stream_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+void convert_nv12_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_nv12_to_nv12_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_nv12_to_nv12_stream_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_nv12_to_nv12_stream_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 
 void convert_yv12_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_to_nv12_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_to_nv12_stream_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_to_nv12_stream_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_to_nv12_stream_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_to_nv12_stream_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 
 void convert_uv_yv12_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_uv_yv12_to_nv12_avx(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_uv_yv12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_uv_yv12_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 
 void convert_yv12_16_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_16_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_14_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_14_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_12_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_10_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_10_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_09_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 void convert_yv12_09_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+void convert_yv12_16_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_i_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_nv12_i_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_i_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_nv12_i_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_i_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_nv12_i_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_i_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_nv12_i_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_i_bayer_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_nv12_i_errdiff_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+void convert_yv12_16_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_16_to_p010_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_14_to_p010_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_12_to_p010_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_10_to_p010_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yv12_09_to_p010_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+void convert_yuv444_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_16_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_16_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_16_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_16_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_14_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_14_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_14_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_14_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_12_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_12_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_12_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_10_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_10_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_10_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_10_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_09_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_09_to_nv12_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_09_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_09_to_nv12_i_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+void convert_yuv444_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_to_yuv444_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_high_to_yuv444_high_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_yuv444_high_to_yuv444_high_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+void convert_bgra_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgra_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgra_to_nv12_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgra_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr24_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr24_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr24_to_nv12_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr24_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr48_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr48_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr48_to_nv12_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+void convert_bgr48_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 
 //適当。
 #pragma warning (push)
@@ -77,7 +202,7 @@ void convert_yuy2_to_nv12(void **dst_array, const void **src_array, int width, i
     for (int y = 0; y < y_fin; y += 2) {
         uint8_t *dstY = dstYFrame +   dst_y_pitch_byte * y;
         uint8_t *dstC = dstCFrame + ((dst_y_pitch_byte * y) >> 1);
-        uint8_t *srcP = srcFrame  +   src_y_pitch_byte * (y + crop_up) + crop_left;
+        uint8_t *srcP = srcFrame  +   src_y_pitch_byte * (y + crop_up) + crop_left * 2;
         const int x_fin = width - crop_right - crop_left;
         for (int x = 0; x < x_fin; x += 2, dstY += 2, dstC += 2, srcP += 4) {
             dstY[0*dst_y_pitch_byte  + 0] = srcP[0*src_y_pitch_byte + 0];
@@ -105,7 +230,7 @@ void convert_yuy2_to_nv12_i(void **dst_array, const void **src_array, int width,
     for (int y = 0; y < y_fin; y += 4) {
         uint8_t *dstY = dstYFrame +   dst_y_pitch_byte * y;
         uint8_t *dstC = dstCFrame + ((dst_y_pitch_byte * y) >> 1);
-        uint8_t *srcP = srcFrame  +   src_y_pitch_byte * (y + crop_up);
+        uint8_t *srcP = srcFrame  +   src_y_pitch_byte * (y + crop_up) + crop_left * 2;
         const int x_fin = width - crop_right - crop_left;
         for (int x = 0; x < x_fin; x += 2, dstY += 2, dstC += 2, srcP += 4) {
             dstY[0*dst_y_pitch_byte   + 0] = srcP[0*src_y_pitch_byte + 0];
@@ -118,8 +243,8 @@ void convert_yuy2_to_nv12_i(void **dst_array, const void **src_array, int width,
             dstY[3*dst_y_pitch_byte   + 1] = srcP[3*src_y_pitch_byte + 2];
             dstC[0*dst_y_pitch_byte/2 + 0] =(srcP[0*src_y_pitch_byte + 1] * 3 + srcP[2*src_y_pitch_byte + 1] * 1 + 2)>>2;
             dstC[0*dst_y_pitch_byte/2 + 1] =(srcP[0*src_y_pitch_byte + 3] * 3 + srcP[2*src_y_pitch_byte + 3] * 1 + 2)>>2;
-            dstC[1*dst_y_pitch_byte/2 + 0] =(srcP[1*src_y_pitch_byte + 1] * 1 + srcP[3*src_y_pitch_byte + 1] * 3 + 2)>>2;
-            dstC[1*dst_y_pitch_byte/2 + 1] =(srcP[1*src_y_pitch_byte + 3] * 1 + srcP[3*src_y_pitch_byte + 3] * 3 + 2)>>2;
+            dstC[1*dst_y_pitch_byte   + 0] =(srcP[1*src_y_pitch_byte + 1] * 1 + srcP[3*src_y_pitch_byte + 1] * 3 + 2)>>2;
+            dstC[1*dst_y_pitch_byte   + 1] =(srcP[1*src_y_pitch_byte + 3] * 1 + srcP[3*src_y_pitch_byte + 3] * 3 + 2)>>2;
         }
     }
 }
@@ -135,33 +260,105 @@ enum {
     SSE42 = 0x0010, //使用していない
     AVX   = 0x0020,
     AVX2  = 0x0040,
+    AVX512F  = 0x0080,
+    AVX512BW = 0x0100,
+    AVX512VL = 0x0200,
 };
 
 static const ConvertCSP funcList[] = {
-    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_avx2,     convert_yuy2_to_nv12_i_avx2   }, AVX2|AVX },
-    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_avx,      convert_yuy2_to_nv12_i_avx    }, AVX },
-    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_sse2,     convert_yuy2_to_nv12_i_ssse3  }, SSSE3|SSE2 },
-    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_sse2,     convert_yuy2_to_nv12_i_sse2   }, SSE2 },
-    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12,          convert_yuy2_to_nv12          }, NONE },
+    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_avx512,   convert_yuy2_to_nv12_i_avx512 }, AVX512BW|AVX512F|AVX2|AVX, VCE_DITHER_NONE, { convert_yuy2_to_nv12_stream_avx512, convert_yuy2_to_nv12_i_stream_avx512 } },
+    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_avx2,     convert_yuy2_to_nv12_i_avx2   }, AVX2|AVX, VCE_DITHER_NONE, { convert_yuy2_to_nv12_stream_avx2, convert_yuy2_to_nv12_i_stream_avx2 } },
+    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_avx,      convert_yuy2_to_nv12_i_avx    }, AVX, VCE_DITHER_NONE, { convert_yuy2_to_nv12_stream_avx, convert_yuy2_to_nv12_i_stream_avx } },
+    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_sse2,     convert_yuy2_to_nv12_i_ssse3  }, SSSE3|SSE2, VCE_DITHER_NONE, { convert_yuy2_to_nv12_stream_sse2, convert_yuy2_to_nv12_i_stream_ssse3 } },
+    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12_sse2,     convert_yuy2_to_nv12_i_sse2   }, SSE2, VCE_DITHER_NONE, { convert_yuy2_to_nv12_stream_sse2, convert_yuy2_to_nv12_i_stream_sse2 } },
+    { VCE_CSP_YUY2, VCE_CSP_NV12, false, { convert_yuy2_to_nv12,          convert_yuy2_to_nv12_i        }, NONE },
+    { VCE_CSP_NV12, VCE_CSP_NV12, false, { convert_nv12_to_nv12_avx,      convert_nv12_to_nv12_avx      }, AVX, VCE_DITHER_NONE, { convert_nv12_to_nv12_stream_avx, convert_nv12_to_nv12_stream_avx } },
+    { VCE_CSP_NV12, VCE_CSP_NV12, false, { convert_nv12_to_nv12_sse2,     convert_nv12_to_nv12_sse2     }, SSE2, VCE_DITHER_NONE, { convert_nv12_to_nv12_stream_sse2, convert_nv12_to_nv12_stream_sse2 } },
 #if !(VCE_AUO && defined(NDEBUG))
-    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_avx2,     convert_yv12_to_nv12_avx2     }, AVX2|AVX },
-    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_avx,      convert_yv12_to_nv12_avx      }, AVX },
-    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_sse2,     convert_yv12_to_nv12_sse2     }, SSE2 },
+    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_avx512,   convert_yv12_to_nv12_avx512   }, AVX512BW|AVX512F|AVX2|AVX, VCE_DITHER_NONE, { convert_yv12_to_nv12_stream_avx512, convert_yv12_to_nv12_stream_avx512 } },
+    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_avx2,     convert_yv12_to_nv12_avx2     }, AVX2|AVX, VCE_DITHER_NONE, { convert_yv12_to_nv12_stream_avx2, convert_yv12_to_nv12_stream_avx2 } },
+    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_avx,      convert_yv12_to_nv12_avx      }, AVX, VCE_DITHER_NONE, { convert_yv12_to_nv12_stream_avx, convert_yv12_to_nv12_stream_avx } },
+    { VCE_CSP_YV12, VCE_CSP_NV12, false, { convert_yv12_to_nv12_sse2,     convert_yv12_to_nv12_sse2     }, SSE2, VCE_DITHER_NONE, { convert_yv12_to_nv12_stream_sse2, convert_yv12_to_nv12_stream_sse2 } },
 #endif
+    { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_bayer_avx2,  convert_yv12_16_to_nv12_i_bayer_avx2 }, AVX2|AVX, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_bayer_sse2,  convert_yv12_16_to_nv12_i_bayer_sse2 }, SSE2, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_errdiff_avx2, convert_yv12_16_to_nv12_i_errdiff_avx2}, AVX2|AVX, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_errdiff_sse2, convert_yv12_16_to_nv12_i_errdiff_sse2}, SSE2, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_avx512,      convert_yv12_16_to_nv12_avx512 }, AVX512BW|AVX512F|AVX2|AVX },
     { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_avx2,        convert_yv12_16_to_nv12_avx2 }, AVX2|AVX },
     { VCE_CSP_YV12_16,   VCE_CSP_NV12,      false,{ convert_yv12_16_to_nv12_sse2,        convert_yv12_16_to_nv12_sse2 }, SSE2 },
+    { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_bayer_avx2,  convert_yv12_14_to_nv12_i_bayer_avx2 }, AVX2|AVX, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_bayer_sse2,  convert_yv12_14_to_nv12_i_bayer_sse2 }, SSE2, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_errdiff_avx2, convert_yv12_14_to_nv12_i_errdiff_avx2}, AVX2|AVX, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_errdiff_sse2, convert_yv12_14_to_nv12_i_errdiff_sse2}, SSE2, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_avx512,      convert_yv12_14_to_nv12_avx512 }, AVX512BW|AVX512F|AVX2|AVX },
     { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_avx2,        convert_yv12_14_to_nv12_avx2 }, AVX2|AVX },
     { VCE_CSP_YV12_14,   VCE_CSP_NV12,      false,{ convert_yv12_14_to_nv12_sse2,        convert_yv12_14_to_nv12_sse2 }, SSE2 },
+    { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_bayer_avx2,  convert_yv12_12_to_nv12_i_bayer_avx2 }, AVX2|AVX, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_bayer_sse2,  convert_yv12_12_to_nv12_i_bayer_sse2 }, SSE2, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_errdiff_avx2, convert_yv12_12_to_nv12_i_errdiff_avx2}, AVX2|AVX, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_errdiff_sse2, convert_yv12_12_to_nv12_i_errdiff_sse2}, SSE2, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_avx512,      convert_yv12_12_to_nv12_avx512 }, AVX512BW|AVX512F|AVX2|AVX },
     { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_avx2,        convert_yv12_12_to_nv12_avx2 }, AVX2|AVX },
     { VCE_CSP_YV12_12,   VCE_CSP_NV12,      false,{ convert_yv12_12_to_nv12_sse2,        convert_yv12_12_to_nv12_sse2 }, SSE2 },
+    { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_bayer_avx2,  convert_yv12_10_to_nv12_i_bayer_avx2 }, AVX2|AVX, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_bayer_sse2,  convert_yv12_10_to_nv12_i_bayer_sse2 }, SSE2, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_errdiff_avx2, convert_yv12_10_to_nv12_i_errdiff_avx2}, AVX2|AVX, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_errdiff_sse2, convert_yv12_10_to_nv12_i_errdiff_sse2}, SSE2, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_avx512,      convert_yv12_10_to_nv12_avx512 }, AVX512BW|AVX512F|AVX2|AVX },
     { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_avx2,        convert_yv12_10_to_nv12_avx2 }, AVX2|AVX },
     { VCE_CSP_YV12_10,   VCE_CSP_NV12,      false,{ convert_yv12_10_to_nv12_sse2,        convert_yv12_10_to_nv12_sse2 }, SSE2 },
+    { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_bayer_avx2,  convert_yv12_09_to_nv12_i_bayer_avx2 }, AVX2|AVX, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_bayer_sse2,  convert_yv12_09_to_nv12_i_bayer_sse2 }, SSE2, VCE_DITHER_ORDERED },
+    { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_errdiff_avx2, convert_yv12_09_to_nv12_i_errdiff_avx2}, AVX2|AVX, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_errdiff_sse2, convert_yv12_09_to_nv12_i_errdiff_sse2}, SSE2, VCE_DITHER_ERROR_DIFFUSION },
+    { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_avx512,      convert_yv12_09_to_nv12_avx512 }, AVX512BW|AVX512F|AVX2|AVX },
     { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_avx2,        convert_yv12_09_to_nv12_avx2 }, AVX2|AVX },
     { VCE_CSP_YV12_09,   VCE_CSP_NV12,      false,{ convert_yv12_09_to_nv12_sse2,        convert_yv12_09_to_nv12_sse2 }, SSE2 },
-    { VCE_CSP_NA, VCE_CSP_NA, 0, false, 0x0, 0 },
+    { VCE_CSP_YV12_16,   VCE_CSP_P010,      false,{ convert_yv12_16_to_p010_avx2,        convert_yv12_16_to_p010_avx2 }, AVX2|AVX },
+    { VCE_CSP_YV12_16,   VCE_CSP_P010,      false,{ convert_yv12_16_to_p010_sse2,        convert_yv12_16_to_p010_sse2 }, SSE2 },
+    { VCE_CSP_YV12_14,   VCE_CSP_P010,      false,{ convert_yv12_14_to_p010_avx2,        convert_yv12_14_to_p010_avx2 }, AVX2|AVX },
+    { VCE_CSP_YV12_14,   VCE_CSP_P010,      false,{ convert_yv12_14_to_p010_sse2,        convert_yv12_14_to_p010_sse2 }, SSE2 },
+    { VCE_CSP_YV12_12,   VCE_CSP_P010,      false,{ convert_yv12_12_to_p010_avx2,        convert_yv12_12_to_p010_avx2 }, AVX2|AVX },
+    { VCE_CSP_YV12_12,   VCE_CSP_P010,      false,{ convert_yv12_12_to_p010_sse2,        convert_yv12_12_to_p010_sse2 }, SSE2 },
+    { VCE_CSP_YV12_10,   VCE_CSP_P010,      false,{ convert_yv12_10_to_p010_avx2,        convert_yv12_10_to_p010_avx2 }, AVX2|AVX },
+    { VCE_CSP_YV12_10,   VCE_CSP_P010,      false,{ convert_yv12_10_to_p010_sse2,        convert_yv12_10_to_p010_sse2 }, SSE2 },
+    { VCE_CSP_YV12_09,   VCE_CSP_P010,      false,{ convert_yv12_09_to_p010_avx2,        convert_yv12_09_to_p010_avx2 }, AVX2|AVX },
+    { VCE_CSP_YV12_09,   VCE_CSP_P010,      false,{ convert_yv12_09_to_p010_sse2,        convert_yv12_09_to_p010_sse2 }, SSE2 },
+    { VCE_CSP_YUV444,    VCE_CSP_NV12,      false,{ convert_yuv444_to_nv12_avx2,         convert_yuv444_to_nv12_i_avx2      }, AVX2|AVX },
+    { VCE_CSP_YUV444,    VCE_CSP_NV12,      false,{ convert_yuv444_to_nv12_sse2,         convert_yuv444_to_nv12_i_sse2      }, SSE2 },
+    { VCE_CSP_YUV444_16, VCE_CSP_NV12,      false,{ convert_yuv444_16_to_nv12_avx2,      convert_yuv444_16_to_nv12_i_avx2   }, AVX2|AVX },
+    { VCE_CSP_YUV444_16, VCE_CSP_NV12,      false,{ convert_yuv444_16_to_nv12_sse2,      convert_yuv444_16_to_nv12_i_sse2   }, SSE2 },
+    { VCE_CSP_YUV444_14, VCE_CSP_NV12,      false,{ convert_yuv444_14_to_nv12_avx2,      convert_yuv444_14_to_nv12_i_avx2   }, AVX2|AVX },
+    { VCE_CSP_YUV444_14, VCE_CSP_NV12,      false,{ convert_yuv444_14_to_nv12_sse2,      convert_yuv444_14_to_nv12_i_sse2   }, SSE2 },
+    { VCE_CSP_YUV444_12, VCE_CSP_NV12,      false,{ convert_yuv444_12_to_nv12_avx2,      convert_yuv444_12_to_nv12_i_avx2   }, AVX2|AVX },
+    { VCE_CSP_YUV444_12, VCE_CSP_NV12,      false,{ convert_yuv444_12_to_nv12_sse2,      convert_yuv444_12_to_nv12_i_sse2   }, SSE2 },
+    { VCE_CSP_YUV444_10, VCE_CSP_NV12,      false,{ convert_yuv444_10_to_nv12_avx2,      convert_yuv444_10_to_nv12_i_avx2   }, AVX2|AVX },
+    { VCE_CSP_YUV444_10, VCE_CSP_NV12,      false,{ convert_yuv444_10_to_nv12_sse2,      convert_yuv444_10_to_nv12_i_sse2   }, SSE2 },
+    { VCE_CSP_YUV444_09, VCE_CSP_NV12,      false,{ convert_yuv444_09_to_nv12_avx2,      convert_yuv444_09_to_nv12_i_avx2   }, AVX2|AVX },
+    { VCE_CSP_YUV444_09, VCE_CSP_NV12,      false,{ convert_yuv444_09_to_nv12_sse2,      convert_yuv444_09_to_nv12_i_sse2   }, SSE2 },
+    { VCE_CSP_YUV444,    VCE_CSP_YUV444,    false,{ convert_yuv444_to_yuv444_avx2,       convert_yuv444_to_yuv444_avx2      }, AVX2|AVX },
+    { VCE_CSP_YUV444,    VCE_CSP_YUV444,    false,{ convert_yuv444_to_yuv444_sse2,       convert_yuv444_to_yuv444_sse2      }, SSE2 },
+    { VCE_CSP_YUV444_16, VCE_CSP_YUV444_16, false,{ convert_yuv444_high_to_yuv444_high_avx2, convert_yuv444_high_to_yuv444_high_avx2}, AVX2|AVX },
+    { VCE_CSP_YUV444_16, VCE_CSP_YUV444_16, false,{ convert_yuv444_high_to_yuv444_high_sse2, convert_yuv444_high_to_yuv444_high_sse2}, SSE2 },
+    { VCE_CSP_YUV444_14, VCE_CSP_YUV444_14, false,{ convert_yuv444_high_to_yuv444_high_avx2, convert_yuv444_high_to_yuv444_high_avx2}, AVX2|AVX },
+    { VCE_CSP_YUV444_14, VCE_CSP_YUV444_14, false,{ convert_yuv444_high_to_yuv444_high_sse2, convert_yuv444_high_to_yuv444_high_sse2}, SSE2 },
+    { VCE_CSP_YUV444_12, VCE_CSP_YUV444_12, false,{ convert_yuv444_high_to_yuv444_high_avx2, convert_yuv444_high_to_yuv444_high_avx2}, AVX2|AVX },
+    { VCE_CSP_YUV444_12, VCE_CSP_YUV444_12, false,{ convert_yuv444_high_to_yuv444_high_sse2, convert_yuv444_high_to_yuv444_high_sse2}, SSE2 },
+    { VCE_CSP_YUV444_10, VCE_CSP_YUV444_10, false,{ convert_yuv444_high_to_yuv444_high_avx2, convert_yuv444_high_to_yuv444_high_avx2}, AVX2|AVX },
+    { VCE_CSP_YUV444_10, VCE_CSP_YUV444_10, false,{ convert_yuv444_high_to_yuv444_high_sse2, convert_yuv444_high_to_yuv444_high_sse2}, SSE2 },
+    { VCE_CSP_YUV444_09, VCE_CSP_YUV444_09, false,{ convert_yuv444_high_to_yuv444_high_avx2, convert_yuv444_high_to_yuv444_high_avx2}, AVX2|AVX },
+    { VCE_CSP_YUV444_09, VCE_CSP_YUV444_09, false,{ convert_yuv444_high_to_yuv444_high_sse2, convert_yuv444_high_to_yuv444_high_sse2}, SSE2 },
+    { VCE_CSP_BGRA,     VCE_CSP_NV12,      false,{ convert_bgra_to_nv12_avx2,           convert_bgra_to_nv12_i_avx2          }, AVX2|AVX },
+    { VCE_CSP_BGRA,     VCE_CSP_NV12,      false,{ convert_bgra_to_nv12_ssse3,          convert_bgra_to_nv12_i_ssse3         }, SSSE3|SSE2 },
+    { VCE_CSP_BGR24,    VCE_CSP_NV12,      false,{ convert_bgr24_to_nv12_avx2,          convert_bgr24_to_nv12_i_avx2         }, AVX2|AVX },
+    { VCE_CSP_BGR24,    VCE_CSP_NV12,      false,{ convert_bgr24_to_nv12_ssse3,         convert_bgr24_to_nv12_i_ssse3        }, SSSE3|SSE2 },
+    { VCE_CSP_BGR48,    VCE_CSP_NV12,      false,{ convert_bgr48_to_nv12_avx2,          convert_bgr48_to_nv12_i_avx2         }, AVX2|AVX },
+    { VCE_CSP_BGR48,    VCE_CSP_NV12,      false,{ convert_bgr48_to_nv12_ssse3,         convert_bgr48_to_nv12_i_ssse3        }, SSSE3|SSE2 },
+    { VCE_CSP_NA, VCE_CSP_NA, false, { nullptr, nullptr }, 0x0 },
 };
 
-static uint32_t vce_get_availableSIMD() {
+static unsigned int get_availableSIMD_cpuid() {
     int CPUInfo[4];
     __cpuid(CPUInfo, 1);
     uint32_t simd = NONE;
@@ -181,14 +378,100 @@ static uint32_t vce_get_availableSIMD() {
         if ((XGETBV & 0x06) == 0x06)
             simd |= AVX;
     }
-    __cpuid(CPUInfo, 7);
+    __cpuidex(CPUInfo, 7, 0);
     if ((simd & AVX) && (CPUInfo[1] & 0x00000020))
         simd |= AVX2;
+    //AVX512はOSがopmask/ZMMレジスタの状態を保存する場合のみ使用可能
+    if ((simd & AVX) && ((XGETBV & 0xE6) == 0xE6)) {
+        if (CPUInfo[1] & 0x00010000)
+            simd |= AVX512F;
+        if ((simd & AVX512F) && (CPUInfo[1] & 0x40000000))
+            simd |= AVX512BW;
+        if ((simd & AVX512F) && (CPUInfo[1] & 0x80000000))
+            simd |= AVX512VL;
+    }
     return simd;
 }
 
-const ConvertCSP* get_convert_csp_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only) {
-    uint32_t availableSIMD = vce_get_availableSIMD();
+unsigned int vce_get_availableSIMD() {
+    static const unsigned int availableSIMD = get_availableSIMD_cpuid();
+    return availableSIMD;
+}
+
+static VCE_CONVERT_KERNEL g_convertKernel = VCE_CONVERT_KERNEL_AUTO;
+
+void set_convert_csp_kernel(VCE_CONVERT_KERNEL kernel) {
+    g_convertKernel = kernel;
+}
+
+VCE_CONVERT_KERNEL get_convert_csp_kernel() {
+    return g_convertKernel;
+}
+
+//RGB入力の変換係数 (初期値はBT.709, limited range)
+static int g_rgbCoef[12] = {
+     2991, 10064, 1016,  16,
+    -1649, -5547, 7196, 128,
+     7196, -6536, -660, 128,
+};
+
+void set_convert_csp_rgb_matrix(int colormatrix, bool fullrange) {
+    double kr = 0.2126, kb = 0.0722; //bt709
+    switch (colormatrix) {
+    case 4:  kr = 0.30;   kb = 0.11;   break; //fcc
+    case 5:
+    case 6:  kr = 0.299;  kb = 0.114;  break; //bt470bg, smpte170m
+    case 7:  kr = 0.212;  kb = 0.087;  break; //smpte240m
+    case 9:
+    case 10: kr = 0.2627; kb = 0.0593; break; //bt2020nc, bt2020c
+    default: break;
+    }
+    const double y_range  = (fullrange) ? 1.0 : 219.0 / 255.0;
+    const double uv_range = (fullrange) ? 1.0 : 224.0 / 255.0;
+    auto to_fixed = [](double value) { return (int)std::floor(value * (1 << 14) + 0.5); };
+    //白がちょうど235(255)に、無彩色の色差がちょうど128になるよう、丸め誤差はGの係数で吸収する
+    int coef[12];
+    coef[0]  = to_fixed(kr * y_range);
+    coef[2]  = to_fixed(kb * y_range);
+    coef[1]  = to_fixed(y_range) - coef[0] - coef[2];
+    coef[3]  = (fullrange) ? 0 : 16;
+    coef[4]  = to_fixed(-0.5 * kr / (1.0 - kb) * uv_range);
+    coef[6]  = to_fixed(0.5 * uv_range);
+    coef[5]  = -coef[4] - coef[6];
+    coef[7]  = 128;
+    coef[8]  = to_fixed(0.5 * uv_range);
+    coef[10] = to_fixed(-0.5 * kb / (1.0 - kr) * uv_range);
+    coef[9]  = -coef[8] - coef[10];
+    coef[11] = 128;
+    std::copy(coef, coef + _countof(coef), g_rgbCoef);
+}
+
+const int *get_convert_csp_rgb_coef() {
+    return g_rgbCoef;
+}
+
+//g_convertKernelで制限されたSIMDを除いたマスク
+static unsigned int convert_kernel_simd_mask(VCE_CONVERT_KERNEL kernel) {
+    unsigned int mask = 0xffffffff;
+    //指定したものより上位のSIMDもすべて除くため、意図的にbreakしない
+    switch (kernel) {
+    case VCE_CONVERT_KERNEL_C:      mask &= ~(SSE2);
+    case VCE_CONVERT_KERNEL_SSE2:   mask &= ~(SSE3 | SSSE3 | SSE41 | SSE42);
+    case VCE_CONVERT_KERNEL_SSSE3:  mask &= ~(AVX);
+    case VCE_CONVERT_KERNEL_AVX:    mask &= ~(AVX2);
+    case VCE_CONVERT_KERNEL_AVX2:   mask &= ~(AVX512F | AVX512BW | AVX512VL);
+    default:
+        break;
+    }
+    return mask;
+}
+
+const ConvertCSP *get_convert_csp_list() {
+    return funcList;
+}
+
+//bLastがtrueなら、条件に合うもののうちもっとも優先度の低いものを返す
+static const ConvertCSP *find_convert_csp_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only, VCE_DITHER dither, uint32_t availableSIMD, bool bLast) {
     const ConvertCSP *convert = nullptr;
     for (int i = 0; i < _countof(funcList); i++) {
         if (csp_from != funcList[i].csp_from)
@@ -200,17 +483,90 @@ const ConvertCSP* get_convert_csp_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv
         if (uv_only != funcList[i].uv_only)
             continue;
         
+        //ディザ付きの関数はディザなしの関数より前に並べてある
+        if (funcList[i].dither != VCE_DITHER_NONE && funcList[i].dither != dither)
+            continue;
+
         if (funcList[i].simd != (availableSIMD & funcList[i].simd))
             continue;
 
+        //ディザ付きの関数が見つかっていれば、ディザなしの関数は対象外
+        if (convert && convert->dither != funcList[i].dither)
+            break;
+
         convert = &funcList[i];
-        break;
+        if (!bLast)
+            break;
+    }
+    return convert;
+}
+
+const ConvertCSP* get_convert_csp_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only, VCE_DITHER dither) {
+    const uint32_t availableSIMD = vce_get_availableSIMD();
+    const ConvertCSP *convert = find_convert_csp_func(csp_from, csp_to, uv_only, dither, availableSIMD & convert_kernel_simd_mask(g_convertKernel), false);
+    //SIMDを制限した結果使用可能な関数がない場合は、もっとも低いSIMDの関数を使用する
+    if (convert == nullptr) {
+        convert = find_convert_csp_func(csp_from, csp_to, uv_only, dither, availableSIMD, true);
     }
     return convert;
 }
 
+//最後のレベルのキャッシュ1つ分の容量 (取得できなければ8MBとする)
+static size_t get_last_level_cache_size() {
+    cpu_info_t cpu_info = { 0 };
+    if (get_cpu_info(&cpu_info) && cpu_info.max_cache_level > 0) {
+        const cache_info_t *cache = &cpu_info.caches[cpu_info.max_cache_level-1];
+        if (cache->count > 0 && cache->size > 0) {
+            return cache->size / cache->count;
+        }
+    }
+    return 8 * 1024 * 1024;
+}
+
+bool convert_csp_use_stream(const ConvertCSP *convert, int interlaced, void **dst, int dst_y_pitch_byte, int dst_height) {
+    static const size_t streamThreshold = get_last_level_cache_size();
+    if (convert->func_stream[!!interlaced] == nullptr) {
+        return false;
+    }
+    //streamの関数はどのSIMDでも出力先が64byteにアラインされていることを前提とする
+    if ((((size_t)dst[0] | (size_t)dst[1] | (size_t)dst_y_pitch_byte) & 63) != 0) {
+        return false;
+    }
+    //出力がキャッシュに収まる場合は、後段で読み出す際にキャッシュに残っているほうが有利
+    const size_t dst_frame_size = (size_t)dst_y_pitch_byte * dst_height * 3 / 2;
+    return dst_frame_size > streamThreshold;
+}
+
+void convert_csp_band(const ConvertCSP *convert, int interlaced, int band, int band_count,
+    void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop, bool use_stream) {
+    //帯の分割単位 (インタレの場合は各フィールドの色差を2ラインずつ処理するので4ライン単位)
+    const int y_unit = (interlaced) ? 4 : 2;
+    const int y_total = height - crop[1] - crop[3];
+    const int unit_count = (y_total + y_unit - 1) / y_unit;
+    const int y_start = (std::min)(y_total, unit_count * band / band_count * y_unit);
+    const int y_end   = (std::min)(y_total, unit_count * (band + 1) / band_count * y_unit);
+    if (y_start >= y_end) {
+        return;
+    }
+    //cropの上下を調整して、担当する帯のみを変換させる
+    int crop_band[4] = { crop[0], crop[1] + y_start, crop[2], height - crop[1] - y_end };
+    //出力の色差の縦方向の間引き (yuv444出力なら間引きなし)
+    const int dst_uv_y_shift = (VCE_CSP_YUV444 <= convert->csp_to && convert->csp_to <= VCE_CSP_YUV444_16) ? 0 : 1;
+    void *dst_band[3] = {
+        (uint8_t *)dst[0] + dst_y_pitch_byte * y_start,
+        (uint8_t *)dst[1] + dst_y_pitch_byte * (y_start >> dst_uv_y_shift),
+        (dst_uv_y_shift) ? nullptr : (uint8_t *)dst[2] + dst_y_pitch_byte * y_start,
+    };
+    //dst[0]からdst_heightを使って色差の位置を計算する関数(yuy2など)のため、dst_heightも補正する
+    const int dst_height_band = dst_height - y_start + (y_start >> 1);
+    const funcConvertCSP func = (use_stream) ? convert->func_stream[!!interlaced] : convert->func[!!interlaced];
+    func(dst_band, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height_band, crop_band);
+}
+
 const TCHAR *get_simd_str(unsigned int simd) {
-    static std::vector<std::pair<uint32_t, TCHAR*>> simd_str_list = {
+    static std::vector<std::pair<uint32_t, const TCHAR*>> simd_str_list = {
+        { AVX512BW, _T("AVX512BW") },
+        { AVX512F,  _T("AVX512F")  },
         { AVX2,  _T("AVX2")   },
         { AVX,   _T("AVX")    },
         { SSE42, _T("SSE4.2") },
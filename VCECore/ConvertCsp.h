@@ -28,6 +28,8 @@
 #ifndef _CONVERT_CSP_H_
 #define _CONVERT_CSP_H_
 
+#include "qsv_osdep.h"
+
 typedef void (*funcConvertCSP) (void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 
 enum VCE_CSP {
@@ -46,6 +48,10 @@ enum VCE_CSP {
     VCE_CSP_YUV444_12,
     VCE_CSP_YUV444_14,
     VCE_CSP_YUV444_16,
+    VCE_CSP_P010,
+    VCE_CSP_BGRA,  //B, G, R, Aの順に8bitずつ
+    VCE_CSP_BGR24, //B, G, Rの順に8bitずつ
+    VCE_CSP_BGR48, //B, G, Rの順に16bitずつ
 };
 
 static const TCHAR *VCE_CSP_NAMES[] = {
@@ -63,17 +69,78 @@ static const TCHAR *VCE_CSP_NAMES[] = {
     _T("yuv444 (10bit)"),
     _T("yuv444 (12bit)"),
     _T("yuv444 (14bit)"),
-    _T("yuv444 (16bit)")
+    _T("yuv444 (16bit)"),
+    _T("p010"),
+    _T("bgra"),
+    _T("bgr24"),
+    _T("bgr48 (16bit)")
+};
+
+//高ビット深度から8bitへの変換時のディザ
+enum VCE_DITHER {
+    VCE_DITHER_NONE = 0,        //切り捨て
+    VCE_DITHER_ORDERED,         //Bayer 8x8の組織的ディザ
+    VCE_DITHER_ERROR_DIFFUSION, //縦方向のみの誤差拡散 (高速版)
 };
 
+//リサイズの方法
+enum VCE_RESIZE_ALGO {
+    VCE_RESIZE_AMF = 0,  //AMFのVideoConverterでリサイズ (GPU)
+    VCE_RESIZE_BILINEAR, //以下はCPUで色空間変換と同時にリサイズ
+    VCE_RESIZE_BICUBIC,
+    VCE_RESIZE_LANCZOS3,
+};
+
+//変換関数の選択方法
+enum VCE_CONVERT_KERNEL {
+    VCE_CONVERT_KERNEL_AUTO = 0, //初回使用時に使用可能な関数を計測し、最速のものを選ぶ
+    VCE_CONVERT_KERNEL_FIRST,    //使用可能な関数のうち、funcListでもっとも前にあるもの
+    VCE_CONVERT_KERNEL_AVX512,   //以下は使用するSIMDを指定したものまでに制限する (A/Bテスト用)
+    VCE_CONVERT_KERNEL_AVX2,
+    VCE_CONVERT_KERNEL_AVX,
+    VCE_CONVERT_KERNEL_SSSE3,
+    VCE_CONVERT_KERNEL_SSE2,
+    VCE_CONVERT_KERNEL_C,
+};
+
+//変換関数は入力の各プレーンの末尾からこのバイト数まで読み込む場合があるので、入力のバッファはこの分の余裕をとって確保する
+static const int CONVERT_CSP_SRC_PADDING = 64;
+
 typedef struct ConvertCSP {
     VCE_CSP csp_from, csp_to;
     bool uv_only;
     funcConvertCSP func[2];
     unsigned int simd;
+    VCE_DITHER dither;
+    funcConvertCSP func_stream[2]; //出力先が64byteにアラインされている場合に使用できる、streamで書き込む版 (なければnullptr)
 } ConvertCSP;
 
-const ConvertCSP *get_convert_csp_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only);
+//ditherを指定した場合、対応する関数がなければディザなしの関数を返す
+const ConvertCSP *get_convert_csp_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only, VCE_DITHER dither = VCE_DITHER_NONE);
 const TCHAR *get_simd_str(unsigned int simd);
+//実行中のCPUで使用可能なSIMDを返す (cpuidは初回のみ実行する)
+unsigned int vce_get_availableSIMD();
+//get_convert_csp_funcでの変換関数の選択方法を設定する (プロセス全体で共通)
+void set_convert_csp_kernel(VCE_CONVERT_KERNEL kernel);
+VCE_CONVERT_KERNEL get_convert_csp_kernel();
+//登録されている変換関数の一覧を返す (優先順に並んでおり、csp_fromがVCE_CSP_NAのものが終端)
+const ConvertCSP *get_convert_csp_list();
+
+//RGB入力の変換関数で使用する行列と範囲を設定する (プロセス全体で共通)
+//colormatrixはlist_colormatrixの値で、対応しないものはBT.709として扱う
+void set_convert_csp_rgb_matrix(int colormatrix, bool fullrange);
+//RGB入力の変換関数が使用する係数 (R, G, Bの係数は14bit固定小数点)
+//{ Y(R, G, B, オフセット), U(R, G, B, オフセット), V(R, G, B, オフセット) }
+const int *get_convert_csp_rgb_coef();
+
+//フレームを水平方向にband_count個の帯に分割したうちの、band番目の帯のみを変換する
+//帯の境界はプログレッシブなら2ライン、インタレなら4ライン単位でとる
+//use_streamがtrueならfunc_streamを使用する
+void convert_csp_band(const ConvertCSP *convert, int interlaced, int band, int band_count,
+    void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop, bool use_stream = false);
+
+//出力先がアラインされており、出力のフレームサイズが最後のレベルのキャッシュより大きい場合に
+//キャッシュを汚さないようstreamで書き込む関数(func_stream[interlaced])を使用すべきかを返す
+bool convert_csp_use_stream(const ConvertCSP *convert, int interlaced, void **dst, int dst_y_pitch_byte, int dst_height);
 
 #endif //_CONVERT_CSP_H_
@@ -25,7 +25,9 @@
 //
 // ------------------------------------------------------------------------------------------
 #include <stdint.h>
+#include <vector>
 #include <immintrin.h>
+#include "qsv_osdep.h"
 
 #if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
 static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
@@ -104,16 +106,21 @@ static __forceinline void separate_low_up(__m256i& x0_return_lower, __m256i& x1_
     x1_return_upper = _mm256_packus_epi16(x4, x5);
 }
 
+//use_streamなら出力先は32byteにアラインされていること
+#define _mm256_stream_switch_si256(ptr, ymm) ((use_stream) ? _mm256_stream_si256((ptr), (ymm)) : _mm256_storeu_si256((ptr), (ymm)))
+
 #pragma warning (push)
 #pragma warning (disable: 4100)
-void convert_yuy2_to_nv12_avx2(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+#pragma warning (disable: 4127)
+template<bool use_stream>
+static void __forceinline convert_yuy2_to_nv12_avx2_base(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
     const int crop_right  = crop[2];
     const int crop_bottom = crop[3];
     void *dst = dst_array[0];
     const void *src = src_array[0];
-    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left;
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left * 2; //yuy2は1画素2byte
     uint8_t *dstYLine = (uint8_t *)dst;
     uint8_t *dstCLine = dstYLine + dst_y_pitch_byte * dst_height;
     const int y_fin = height - crop_bottom - crop_up;
@@ -130,7 +137,7 @@ void convert_yuy2_to_nv12_avx2(void **dst_array, const void **src_array, int wid
             separate_low_up(y0, y1);
             y3 = y1;
 
-            _mm256_stream_si256((__m256i *)(dstYLine + x), y0);
+            _mm256_stream_switch_si256((__m256i *)(dstYLine + x), y0);
             //-----------1行目終了---------------
 
             //-----------2行目---------------
@@ -139,20 +146,31 @@ void convert_yuy2_to_nv12_avx2(void **dst_array, const void **src_array, int wid
 
             separate_low_up(y0, y1);
 
-            _mm256_stream_si256((__m256i *)(dstYLine + dst_y_pitch_byte + x), y0);
+            _mm256_stream_switch_si256((__m256i *)(dstYLine + dst_y_pitch_byte + x), y0);
             //-----------2行目終了---------------
 
             y1 = _mm256_avg_epu8(y1, y3);  //VUVUVUVUVUVUVUVU
-            _mm256_stream_si256((__m256i *)(dstCLine + x), y1);
+            _mm256_stream_switch_si256((__m256i *)(dstCLine + x), y1);
         }
         srcLine  += src_y_pitch_byte << 1;
         dstYLine += dst_y_pitch_byte << 1;
         dstCLine += dst_y_pitch_byte;
     }
+    if (use_stream) {
+        _mm_sfence();
+    }
     _mm256_zeroupper();
 }
 #pragma warning (push)
 
+void convert_yuy2_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_avx2_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuy2_to_nv12_stream_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_avx2_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
 static __forceinline __m256i yuv422_to_420_i_interpolate(__m256i y_up, __m256i y_down, int i) {
     __m256i y0, y1;
     y0 = _mm256_unpacklo_epi8(y_down, y_up);
@@ -167,14 +185,15 @@ static __forceinline __m256i yuv422_to_420_i_interpolate(__m256i y_up, __m256i y
     return y0;
 }
 
-void convert_yuy2_to_nv12_i_avx2(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+template<bool use_stream>
+static void __forceinline convert_yuy2_to_nv12_i_avx2_base(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
     const int crop_right  = crop[2];
     const int crop_bottom = crop[3];
     void *dst = dst_array[0];
     const void *src = src_array[0];
-    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left;
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left * 2; //yuy2は1画素2byte
     uint8_t *dstYLine = (uint8_t *)dst;
     uint8_t *dstCLine = dstYLine + dst_y_pitch_byte * dst_height;
     const int y_fin = height - crop_bottom - crop_up;
@@ -192,7 +211,7 @@ void convert_yuy2_to_nv12_i_avx2(void **dst_array, const void **src_array, int w
                 separate_low_up(y0, y1);
                 y3 = y1;
 
-                _mm256_stream_si256((__m256i *)(dstYLine + x), y0);
+                _mm256_stream_switch_si256((__m256i *)(dstYLine + x), y0);
                 //-----------1+i行目終了---------------
 
                 //-----------3+i行目---------------
@@ -201,11 +220,11 @@ void convert_yuy2_to_nv12_i_avx2(void **dst_array, const void **src_array, int w
 
                 separate_low_up(y0, y1);
 
-                _mm256_stream_si256((__m256i *)(dstYLine + (dst_y_pitch_byte<<1) + x), y0);
+                _mm256_stream_switch_si256((__m256i *)(dstYLine + (dst_y_pitch_byte<<1) + x), y0);
                 //-----------3+i行目終了---------------
                 y0 = yuv422_to_420_i_interpolate(y3, y1, i);
 
-                _mm256_stream_si256((__m256i *)(dstCLine + x), y0);
+                _mm256_stream_switch_si256((__m256i *)(dstCLine + x), y0);
             }
             srcLine  += src_y_pitch_byte;
             dstYLine += dst_y_pitch_byte;
@@ -214,12 +233,23 @@ void convert_yuy2_to_nv12_i_avx2(void **dst_array, const void **src_array, int w
         srcLine  += src_y_pitch_byte << 1;
         dstYLine += dst_y_pitch_byte << 1;
     }
+    if (use_stream) {
+        _mm_sfence();
+    }
     _mm256_zeroupper();
 }
 
+void convert_yuy2_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_i_avx2_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuy2_to_nv12_i_stream_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_i_avx2_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
 #pragma warning (push)
 #pragma warning (disable: 4127)
-template<bool uv_only>
+template<bool uv_only, bool use_stream>
 static void __forceinline convert_yv12_to_nv12_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
@@ -232,7 +262,7 @@ static void __forceinline convert_yv12_to_nv12_avx2_base(void **dst, const void
         const int y_fin = height - crop_bottom;
         const int y_width = width - crop_right - crop_left;
         for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
-            avx2_memcpy<false>(dstLine, srcYLine, y_width);
+            avx2_memcpy<use_stream>(dstLine, srcYLine, y_width);
         }
     }
     //UV成分のコピー
@@ -256,45 +286,132 @@ static void __forceinline convert_yv12_to_nv12_avx2_base(void **dst, const void
             y2 = _mm256_unpackhi_epi8(y0, y1);
             y0 = _mm256_unpacklo_epi8(y0, y1);
 
-            _mm256_storeu_si256((__m256i *)(dst_ptr +  0), y0);
-            _mm256_storeu_si256((__m256i *)(dst_ptr + 32), y2);
+            _mm256_stream_switch_si256((__m256i *)(dst_ptr +  0), y0);
+            _mm256_stream_switch_si256((__m256i *)(dst_ptr + 32), y2);
         }
     }
+    if (use_stream) {
+        _mm_sfence();
+    }
     _mm256_zeroupper();
 }
 #pragma warning (pop)
 
 void convert_yv12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
-    convert_yv12_to_nv12_avx2_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+    convert_yv12_to_nv12_avx2_base<false, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_to_nv12_stream_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_to_nv12_avx2_base<false, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
 }
 
 void convert_uv_yv12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
-    convert_yv12_to_nv12_avx2_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+    convert_yv12_to_nv12_avx2_base<true, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
 }
 
-template<int in_bit_depth, bool uv_only>
+//8x8のBayer行列 (0-63)
+static const _declspec(align(16)) uint16_t Array_BAYER8x8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+//y行目のディザのオフセット (0 - (1<<shift)-1) を8画素x2レーン分返す
+static __forceinline __m256i dither_bayer8x8_offset(int y, int shift) {
+    __m256i y0 = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)Array_BAYER8x8[y & 7]));
+    return _mm256_srli_epi16(_mm256_slli_epi16(y0, shift), 6);
+}
+
+//y行目のディザのパターンの行
+//インタレの場合は各フィールドがそれぞれBayer行列の全行を使うようにし、第2フィールドは4ラインずらす
+static __forceinline int dither_bayer_row(int y, bool interlaced) {
+    return (interlaced) ? (y >> 1) + ((y & 1) << 2) : y;
+}
+
+//誤差拡散用の誤差バッファを初期化する
+//各列が異なる位相から始まるよう、Bayer行列のオフセットを初期値とする
+static void dither_error_buffer_init(uint16_t *err, int count, int y, int shift) {
+    for (int x = 0; x < count; x++) {
+        err[x] = (uint16_t)((Array_BAYER8x8[y & 7][x & 7] << shift) >> 6);
+    }
+}
+
+//誤差拡散用の誤差バッファを取得する
+//フレーム・帯ごとに確保しないよう、スレッドごとに保持して使いまわす (内容は呼び出し側で初期化すること)
+static uint16_t *dither_error_buffer_get(size_t count) {
+    static thread_local std::vector<uint16_t> err_buf;
+    if (err_buf.size() < count) {
+        err_buf.resize(count, 0);
+    }
+    return err_buf.data();
+}
+
+//dither : 0 ... なし(切り捨て), 1 ... Bayer 8x8, 2 ... 誤差拡散 (VCE_DITHERの値)
+//誤差拡散は、量子化誤差を直下の画素に持ち越す縦方向のみの拡散で、ライン内は並列に処理できる
+//interlacedなら、ディザのパターンと誤差の持ち越しをフィールドごとに行う
+template<int in_bit_depth, bool uv_only, int dither = 0, bool interlaced = false>
 static void convert_yv12_high_to_nv12_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    static_assert(0 <= dither && dither <= 2, "invalid dither mode.");
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
     const int crop_right  = crop[2];
     const int crop_bottom = crop[3];
     const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int shift = in_bit_depth - 8;
+    const __m256i yMaskError = _mm256_set1_epi16((short)((1 << shift) - 1));
+    //ディザを加えた値が入力のビット深度の最大値を超えないようにする (16bitの場合はadds_epu16で飽和する)
+    const __m256i yMaxValue = _mm256_set1_epi16((short)((1 << in_bit_depth) - 1));
+    //Y, U, Vの1ライン分 (ループは32画素単位で幅を超えて処理するので余裕をとる)
+    const int err_field_size = ((width + 32) & ~31) * 2;
+    //インタレの場合はフィールドごとに持つ
+    uint16_t *err_buf = (dither == 2) ? dither_error_buffer_get(err_field_size * ((interlaced) ? 2 : 1)) : nullptr;
     //Y成分のコピー
     if (!uv_only) {
         uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
         uint8_t *dstLine  = (uint8_t *)dst[0];
         const int y_fin = height - crop_bottom;
         const int y_width = width - crop_right - crop_left;
+        if (dither == 2) {
+            dither_error_buffer_init(err_buf, y_width, crop_up, shift);
+            if (interlaced) {
+                dither_error_buffer_init(err_buf + err_field_size, y_width, crop_up + 1, shift);
+            }
+        }
         for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
             uint8_t *dst_ptr = dstLine;
             uint16_t *src_ptr = srcYLine;
             uint16_t *src_ptr_fin = src_ptr + y_width;
+            uint16_t *err_ptr = err_buf + ((dither == 2 && interlaced && (y & 1)) ? err_field_size : 0);
+            const __m256i yOffset = (dither == 1) ? dither_bayer8x8_offset(dither_bayer_row(y, interlaced), shift) : _mm256_setzero_si256();
             __m256i y0, y1;
-            for (; src_ptr < src_ptr_fin; dst_ptr += 32, src_ptr += 32) {
+            for (; src_ptr < src_ptr_fin; dst_ptr += 32, src_ptr += 32, err_ptr += 32) {
                 y0 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 16), (const __m128i *)(src_ptr +  0));
                 y1 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 24), (const __m128i *)(src_ptr +  8));
 
+                if (dither == 1) {
+                    y0 = _mm256_adds_epu16(y0, yOffset);
+                    y1 = _mm256_adds_epu16(y1, yOffset);
+                    if (in_bit_depth < 16) {
+                        y0 = _mm256_min_epi16(y0, yMaxValue);
+                        y1 = _mm256_min_epi16(y1, yMaxValue);
+                    }
+                } else if (dither == 2) {
+                    y0 = _mm256_adds_epu16(y0, _mm256_loadu2_m128i((const __m128i *)(err_ptr + 16), (const __m128i *)(err_ptr +  0)));
+                    y1 = _mm256_adds_epu16(y1, _mm256_loadu2_m128i((const __m128i *)(err_ptr + 24), (const __m128i *)(err_ptr +  8)));
+                    if (in_bit_depth < 16) {
+                        y0 = _mm256_min_epi16(y0, yMaxValue);
+                        y1 = _mm256_min_epi16(y1, yMaxValue);
+                    }
+                    _mm256_storeu2_m128i((__m128i *)(err_ptr + 16), (__m128i *)(err_ptr +  0), _mm256_and_si256(y0, yMaskError));
+                    _mm256_storeu2_m128i((__m128i *)(err_ptr + 24), (__m128i *)(err_ptr +  8), _mm256_and_si256(y1, yMaskError));
+                }
+
                 y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
                 y1 = _mm256_srli_epi16(y1, in_bit_depth - 8);
 
@@ -310,17 +427,49 @@ static void convert_yv12_high_to_nv12_avx2_base(void **dst, const void **src, in
     uint16_t *srcVLine = (uint16_t *)src[2] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
     uint8_t *dstLine  = (uint8_t *)dst[1];
     const int uv_fin = (height - crop_bottom) >> 1;
+    //インタレの場合、色差のラインも1ラインごとに交互のフィールドとなる
+    uint16_t *err_uv[2] = { err_buf, err_buf + ((dither == 2 && interlaced) ? err_field_size : 0) };
+    if (dither == 2) {
+        const int uv_width = (width - crop_right - crop_left) >> 1;
+        for (int i = 0; i < ((interlaced) ? 2 : 1); i++) {
+            dither_error_buffer_init(err_uv[i],                         uv_width, (crop_up >> 1) + i,     shift);
+            dither_error_buffer_init(err_uv[i] + (err_field_size >> 1), uv_width, (crop_up >> 1) + i + 4, shift);
+        }
+    }
     for (int y = crop_up >> 1; y < uv_fin; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
         const int x_fin = width - crop_right;
         uint16_t *src_u_ptr = srcULine;
         uint16_t *src_v_ptr = srcVLine;
+        uint16_t *err_u_ptr = err_uv[(interlaced) ? (y & 1) : 0];
+        uint16_t *err_v_ptr = err_u_ptr + (err_field_size >> 1);
         uint8_t *dst_ptr = dstLine;
-        uint8_t *dst_ptr_fin = dst_ptr + x_fin;
+        uint8_t *dst_ptr_fin = dst_ptr + x_fin - crop_left;
+        //U, Vで同じパターンにならないよう、Vは4ラインずらす
+        const __m256i yOffsetU = (dither == 1) ? dither_bayer8x8_offset(dither_bayer_row(y, interlaced),     shift) : _mm256_setzero_si256();
+        const __m256i yOffsetV = (dither == 1) ? dither_bayer8x8_offset(dither_bayer_row(y, interlaced) + 4, shift) : _mm256_setzero_si256();
         __m256i y0, y1;
-        for (; dst_ptr < dst_ptr_fin; src_u_ptr += 16, src_v_ptr += 16, dst_ptr += 32) {
+        for (; dst_ptr < dst_ptr_fin; src_u_ptr += 16, src_v_ptr += 16, err_u_ptr += 16, err_v_ptr += 16, dst_ptr += 32) {
             y0 = _mm256_loadu_si256((const __m256i *)src_u_ptr);
             y1 = _mm256_loadu_si256((const __m256i *)src_v_ptr);
 
+            if (dither == 1) {
+                y0 = _mm256_adds_epu16(y0, yOffsetU);
+                y1 = _mm256_adds_epu16(y1, yOffsetV);
+                if (in_bit_depth < 16) {
+                    y0 = _mm256_min_epi16(y0, yMaxValue);
+                    y1 = _mm256_min_epi16(y1, yMaxValue);
+                }
+            } else if (dither == 2) {
+                y0 = _mm256_adds_epu16(y0, _mm256_loadu_si256((const __m256i *)err_u_ptr));
+                y1 = _mm256_adds_epu16(y1, _mm256_loadu_si256((const __m256i *)err_v_ptr));
+                if (in_bit_depth < 16) {
+                    y0 = _mm256_min_epi16(y0, yMaxValue);
+                    y1 = _mm256_min_epi16(y1, yMaxValue);
+                }
+                _mm256_storeu_si256((__m256i *)err_u_ptr, _mm256_and_si256(y0, yMaskError));
+                _mm256_storeu_si256((__m256i *)err_v_ptr, _mm256_and_si256(y1, yMaskError));
+            }
+
             y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
             y1 = _mm256_slli_epi16(y1, 16 - in_bit_depth);
             const __m256i xMaskHighByte = _mm256_slli_epi16(_mm256_cmpeq_epi8(_mm256_setzero_si256(), _mm256_setzero_si256()), 8);
@@ -352,3 +501,551 @@ void convert_yv12_10_to_nv12_avx2(void **dst, const void **src, int width, int s
 void convert_yv12_09_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     convert_yv12_high_to_nv12_avx2_base<9, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
 }
+
+void convert_yv12_16_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<16, false, 1>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_16_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<16, false, 1, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_16_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<16, false, 2>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_16_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<16, false, 2, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_14_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<14, false, 1>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_14_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<14, false, 1, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_14_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<14, false, 2>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_14_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<14, false, 2, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_12_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<12, false, 1>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_12_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<12, false, 1, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_12_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<12, false, 2>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_12_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<12, false, 2, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_10_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<10, false, 1>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_10_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<10, false, 1, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_10_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<10, false, 2>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_10_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<10, false, 2, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_09_to_nv12_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<9, false, 1>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_09_to_nv12_i_bayer_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<9, false, 1, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_09_to_nv12_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<9, false, 2>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_09_to_nv12_i_errdiff_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx2_base<9, false, 2, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+template<int in_bit_depth, bool uv_only>
+static void convert_yv12_high_to_p010_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    //Y成分のコピー
+    if (!uv_only) {
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
+        uint16_t *dstLine  = (uint16_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+            uint16_t *dst_ptr = dstLine;
+            uint16_t *src_ptr = srcYLine;
+            uint16_t *src_ptr_fin = src_ptr + y_width;
+            __m256i y0, y1;
+            for (; src_ptr < src_ptr_fin; dst_ptr += 32, src_ptr += 32) {
+                y0 = _mm256_loadu_si256((const __m256i *)(src_ptr +  0));
+                y1 = _mm256_loadu_si256((const __m256i *)(src_ptr + 16));
+
+                y0 = _mm256_slli_epi16(y0, 16 - in_bit_depth);
+                y1 = _mm256_slli_epi16(y1, 16 - in_bit_depth);
+
+                _mm256_storeu_si256((__m256i *)(dst_ptr +  0), y0);
+                _mm256_storeu_si256((__m256i *)(dst_ptr + 16), y1);
+            }
+        }
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
+    uint16_t *srcVLine = (uint16_t *)src[2] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
+    uint16_t *dstLine  = (uint16_t *)dst[1];
+    const int uv_fin = (height - crop_bottom) >> 1;
+    for (int y = crop_up >> 1; y < uv_fin; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch) {
+        const int x_fin = width - crop_right - crop_left;
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint16_t *dst_ptr = dstLine;
+        uint16_t *dst_ptr_fin = dst_ptr + x_fin;
+        __m256i y0, y1, y2;
+        for (; dst_ptr < dst_ptr_fin; src_u_ptr += 16, src_v_ptr += 16, dst_ptr += 32) {
+            y0 = _mm256_loadu_si256((const __m256i *)src_u_ptr);
+            y1 = _mm256_loadu_si256((const __m256i *)src_v_ptr);
+
+            y0 = _mm256_slli_epi16(y0, 16 - in_bit_depth);
+            y1 = _mm256_slli_epi16(y1, 16 - in_bit_depth);
+
+            y0 = _mm256_permute4x64_epi64(y0, _MM_SHUFFLE(3,1,2,0));
+            y1 = _mm256_permute4x64_epi64(y1, _MM_SHUFFLE(3,1,2,0));
+
+            y2 = _mm256_unpackhi_epi16(y0, y1);
+            y0 = _mm256_unpacklo_epi16(y0, y1);
+
+            _mm256_storeu_si256((__m256i *)(dst_ptr +  0), y0);
+            _mm256_storeu_si256((__m256i *)(dst_ptr + 16), y2);
+        }
+    }
+    _mm256_zeroupper();
+}
+
+void convert_yv12_16_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_p010_avx2_base<16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_14_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_p010_avx2_base<14, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_12_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_p010_avx2_base<12, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_10_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_p010_avx2_base<10, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_09_to_p010_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_p010_avx2_base<9, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+//yuv444の色差を32画素分読み込み、偶数画素と奇数画素に分離する (各16bit x 16)
+template<int in_bit_depth>
+static __forceinline void load_yuv444_uv_separate(__m256i& y0_return_even, __m256i& y1_return_odd, const uint8_t *src_ptr) {
+    if (in_bit_depth > 8) {
+        //後段のフィルタ計算が16bitでオーバーフローしないよう、11bitまで落としておく
+        const int pre_shift = (in_bit_depth > 11) ? in_bit_depth - 11 : 0;
+        const __m256i yMaskLowWord = _mm256_srli_epi32(_mm256_cmpeq_epi8(_mm256_setzero_si256(), _mm256_setzero_si256()), 16);
+        __m256i y0 = _mm256_loadu_si256((const __m256i *)(src_ptr +  0));
+        __m256i y1 = _mm256_loadu_si256((const __m256i *)(src_ptr + 32));
+        y0 = _mm256_srli_epi16(y0, pre_shift);
+        y1 = _mm256_srli_epi16(y1, pre_shift);
+        y0_return_even = _mm256_packs_epi32(_mm256_and_si256(y0, yMaskLowWord), _mm256_and_si256(y1, yMaskLowWord));
+        y1_return_odd  = _mm256_packs_epi32(_mm256_srli_epi32(y0, 16), _mm256_srli_epi32(y1, 16));
+        y0_return_even = _mm256_permute4x64_epi64(y0_return_even, _MM_SHUFFLE(3,1,2,0));
+        y1_return_odd  = _mm256_permute4x64_epi64(y1_return_odd,  _MM_SHUFFLE(3,1,2,0));
+    } else {
+        const __m256i yMaskLowByte = _mm256_srli_epi16(_mm256_cmpeq_epi8(_mm256_setzero_si256(), _mm256_setzero_si256()), 8);
+        __m256i y0 = _mm256_loadu_si256((const __m256i *)src_ptr);
+        y0_return_even = _mm256_and_si256(y0, yMaskLowByte);
+        y1_return_odd  = _mm256_srli_epi16(y0, 8);
+    }
+}
+
+//水平方向の[1,2,1]フィルタ (色差位置は左寄せ)
+//yOddPrevには直前のブロックの奇数画素を渡し、次のブロック用に今回の奇数画素が返る
+static __forceinline __m256i yuv444_to_420_h_filter(__m256i yEven, __m256i yOdd, __m256i& yOddPrev) {
+    __m256i y0 = _mm256_alignr256_epi8(yOdd, yOddPrev, 30);
+    yOddPrev = yOdd;
+    return _mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(yEven, 1), yOdd), y0);
+}
+
+//yuv444の1ライン分の水平フィルタの状態
+template<int in_bit_depth>
+struct yuv444_h_filter_line {
+    const uint8_t *ptr;
+    __m256i yOddPrev;
+
+    __forceinline void init(const uint8_t *src_ptr) {
+        __m256i yEven, yOdd;
+        ptr = src_ptr;
+        load_yuv444_uv_separate<in_bit_depth>(yEven, yOdd, ptr);
+        //左端は先頭の画素で補う
+        yOddPrev = _mm256_slli256_si256(yEven, 30);
+    }
+    __forceinline __m256i next() {
+        __m256i yEven, yOdd;
+        load_yuv444_uv_separate<in_bit_depth>(yEven, yOdd, ptr);
+        ptr += (in_bit_depth > 8) ? 64 : 32;
+        return yuv444_to_420_h_filter(yEven, yOdd, yOddPrev);
+    }
+};
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+template<int in_bit_depth, bool interlaced>
+static void convert_yuv444_to_nv12_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    static_assert(8 <= in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 8-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_pixel_byte = (in_bit_depth > 8) ? 2 : 1;
+    //Y成分のコピー
+    if (in_bit_depth > 8) {
+        const int src_y_pitch = src_y_pitch_byte >> 1;
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
+        uint8_t *dstLine  = (uint8_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+            uint8_t *dst_ptr = dstLine;
+            uint16_t *src_ptr = srcYLine;
+            uint16_t *src_ptr_fin = src_ptr + y_width;
+            __m256i y0, y1;
+            for (; src_ptr < src_ptr_fin; dst_ptr += 32, src_ptr += 32) {
+                y0 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 16), (const __m128i *)(src_ptr +  0));
+                y1 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 24), (const __m128i *)(src_ptr +  8));
+
+                y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
+                y1 = _mm256_srli_epi16(y1, in_bit_depth - 8);
+
+                y0 = _mm256_packus_epi16(y0, y1);
+
+                _mm256_storeu_si256((__m256i *)(dst_ptr + 0), y0);
+            }
+        }
+    } else {
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * crop_up + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx2_memcpy<false>(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分の縮小
+    //プログレッシブでは2ラインの平均、インタレではフィールドごとに3:1の重みで補間する
+    const int eff_bit_depth = (in_bit_depth > 11) ? 11 : in_bit_depth;
+    const int uv_shift = ((interlaced) ? 4 : 3) + eff_bit_depth - 8;
+    const __m256i yRound = _mm256_set1_epi16((short)(1 << (uv_shift - 1)));
+    uint8_t *srcULine = (uint8_t *)src[1] + src_uv_pitch_byte * crop_up + crop_left * src_pixel_byte;
+    uint8_t *srcVLine = (uint8_t *)src[2] + src_uv_pitch_byte * crop_up + crop_left * src_pixel_byte;
+    uint8_t *dstLine = (uint8_t *)dst[1];
+    const int y_fin = height - crop_bottom - crop_up;
+    const int x_fin = width - crop_right - crop_left;
+    for (int y = 0; y < y_fin; y += 2, dstLine += dst_y_pitch_byte) {
+        //使用する2ライン (インタレの場合、奇数フィールドは1ライン前から)
+        const int line0 = (interlaced && (y & 2)) ? y - 1 : y;
+        const int line1 = (interlaced) ? line0 + 2 : line0 + 1;
+        yuv444_h_filter_line<in_bit_depth> u0, u1, v0, v1;
+        u0.init(srcULine + src_uv_pitch_byte * line0);
+        u1.init(srcULine + src_uv_pitch_byte * line1);
+        v0.init(srcVLine + src_uv_pitch_byte * line0);
+        v1.init(srcVLine + src_uv_pitch_byte * line1);
+        uint8_t *dst_ptr = dstLine;
+        __m256i y0, y1, y2, y3;
+        for (int x = 0; x < x_fin; x += 32, dst_ptr += 32) {
+            y0 = u0.next();
+            y1 = u1.next();
+            y2 = v0.next();
+            y3 = v1.next();
+            if (interlaced) {
+                //近いほうのラインに3倍の重み
+                if (y & 2) {
+                    y1 = _mm256_add_epi16(y1, _mm256_slli_epi16(y1, 1));
+                    y3 = _mm256_add_epi16(y3, _mm256_slli_epi16(y3, 1));
+                } else {
+                    y0 = _mm256_add_epi16(y0, _mm256_slli_epi16(y0, 1));
+                    y2 = _mm256_add_epi16(y2, _mm256_slli_epi16(y2, 1));
+                }
+            }
+            y0 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(y0, y1), yRound), uv_shift);
+            y2 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(y2, y3), yRound), uv_shift);
+
+            //入力が最大値付近では丸めで256になるので、飽和させてからU, Vを交互に並べる
+            y0 = _mm256_packus_epi16(y0, y2);
+            y0 = _mm256_unpacklo_epi8(y0, _mm256_srli_si256(y0, 8));
+
+            _mm256_storeu_si256((__m256i *)dst_ptr, y0);
+        }
+    }
+    _mm256_zeroupper();
+}
+
+template<int pixel_byte>
+static void convert_yuv444_to_yuv444_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int y_fin = height - crop_bottom;
+    const int line_byte = (width - crop_right - crop_left) * pixel_byte;
+    for (int i = 0; i < 3; i++) {
+        const int src_pitch_byte = (i) ? src_uv_pitch_byte : src_y_pitch_byte;
+        uint8_t *srcLine = (uint8_t *)src[i] + src_pitch_byte * crop_up + crop_left * pixel_byte;
+        uint8_t *dstLine = (uint8_t *)dst[i];
+        for (int y = crop_up; y < y_fin; y++, srcLine += src_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx2_memcpy<false>(dstLine, srcLine, line_byte);
+        }
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yuv444_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_16_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_16_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_14_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<14, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_14_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<14, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_12_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<12, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_12_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<12, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_10_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<10, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_10_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<10, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_09_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<9, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_09_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<9, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_yuv444_avx2_base<1>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuv444_high_to_yuv444_high_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuv444_to_yuv444_avx2_base<2>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+//RGB入力の変換関数が使用する係数 (ConvertCsp.cpp)
+const int *get_convert_csp_rgb_coef();
+
+#pragma warning (push)
+#pragma warning (disable: 4127)
+//16画素分のRGBを読み込み、16bitずつのR, G, Bに分離する (下位128bitに前半8画素、上位128bitに後半8画素)
+//pixel_byteは4ならBGRA、3ならBGR24、6ならBGR48で、BGR48は12bitにして返す
+template<int pixel_byte>
+static void __forceinline load_rgb_16px_avx2(const uint8_t *ptr, __m256i& yR, __m256i& yG, __m256i& yB) {
+    if (pixel_byte == 6) {
+        //2画素ずつ、B0 B1 G0 G1 R0 R1 (16bit)に並べ替える
+        const __m256i yShuffle = _mm256_setr_epi8(0, 1, 6, 7, 2, 3, 8, 9, 4, 5, 10, 11, -1, -1, -1, -1, 0, 1, 6, 7, 2, 3, 8, 9, 4, 5, 10, 11, -1, -1, -1, -1);
+        __m256i y0 = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i *)(ptr + 48), (const __m128i *)(ptr +  0)), yShuffle);
+        __m256i y1 = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i *)(ptr + 60), (const __m128i *)(ptr + 12)), yShuffle);
+        __m256i y2 = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i *)(ptr + 72), (const __m128i *)(ptr + 24)), yShuffle);
+        __m256i y3 = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i *)(ptr + 84), (const __m128i *)(ptr + 36)), yShuffle);
+        __m256i y4 = _mm256_unpacklo_epi32(y0, y1); //B0-3 G0-3
+        __m256i y5 = _mm256_unpacklo_epi32(y2, y3); //B4-7 G4-7
+        y0 = _mm256_unpackhi_epi32(y0, y1); //R0-3
+        y2 = _mm256_unpackhi_epi32(y2, y3); //R4-7
+        yB = _mm256_srli_epi16(_mm256_unpacklo_epi64(y4, y5), 4);
+        yG = _mm256_srli_epi16(_mm256_unpackhi_epi64(y4, y5), 4);
+        yR = _mm256_srli_epi16(_mm256_unpacklo_epi64(y0, y2), 4);
+    } else {
+        //4画素ずつ、B0-3 G0-3 R0-3 (8bit)に並べ替える
+        const __m256i yShuffle = (pixel_byte == 4)
+            ? _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, -1, -1, -1, -1, 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, -1, -1, -1, -1)
+            : _mm256_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1, 0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+        __m256i y0 = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i *)(ptr + pixel_byte *  8), (const __m128i *)(ptr)),                  yShuffle);
+        __m256i y1 = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i *)(ptr + pixel_byte * 12), (const __m128i *)(ptr + pixel_byte * 4)), yShuffle);
+        __m256i y2 = _mm256_unpacklo_epi32(y0, y1); //B0-7 G0-7
+        y0 = _mm256_unpackhi_epi32(y0, y1); //R0-7
+        yB = _mm256_unpacklo_epi8(y2, _mm256_setzero_si256());
+        yG = _mm256_unpackhi_epi8(y2, _mm256_setzero_si256());
+        yR = _mm256_unpacklo_epi8(y0, _mm256_setzero_si256());
+    }
+}
+
+//(a, b)の係数を16bitずつ並べる
+static __m256i __forceinline rgb_coef_pair_avx2(int a, int b) {
+    return _mm256_set1_epi32((int)(((uint32_t)b << 16) | ((uint32_t)a & 0xffff)));
+}
+
+//16画素分のR, G, Bから、16画素分のY(またはU, V)を計算する
+//yCoefRGは(R, G)の係数、yCoefBは(B, 0)の係数、yOffsetは丸めを含むオフセット
+template<int shift>
+static __m256i __forceinline rgb_to_yuv_16px_avx2(__m256i yR, __m256i yG, __m256i yB, __m256i yCoefRG, __m256i yCoefB, __m256i yOffset) {
+    __m256i y0 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(yR, yG), yCoefRG), _mm256_madd_epi16(_mm256_unpacklo_epi16(yB, _mm256_setzero_si256()), yCoefB));
+    __m256i y1 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(yR, yG), yCoefRG), _mm256_madd_epi16(_mm256_unpackhi_epi16(yB, _mm256_setzero_si256()), yCoefB));
+    y0 = _mm256_srai_epi32(_mm256_add_epi32(y0, yOffset), shift);
+    y1 = _mm256_srai_epi32(_mm256_add_epi32(y1, yOffset), shift);
+    return _mm256_packs_epi32(y0, y1);
+}
+
+//色差用に縦2ラインの和をとる
+//インタレでは同じフィールドの2ラインから、近いほうのライン(第1フィールドは上、第2フィールドは下)を3倍に重み付けする
+template<bool interlaced>
+static __m256i __forceinline rgb_line_sum_avx2(__m256i y0, __m256i y1, int i) {
+    if (interlaced) {
+        __m256i y2 = (i) ? y1 : y0;
+        return _mm256_add_epi16(_mm256_add_epi16(y0, y1), _mm256_add_epi16(y2, y2));
+    }
+    return _mm256_add_epi16(y0, y1);
+}
+
+//縦の和をとった32画素分から、横2画素ずつの和16個を返す
+static __m256i __forceinline rgb_pair_sum_avx2(__m256i y0, __m256i y1) {
+    const __m256i yOne = _mm256_set1_epi16(1);
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_madd_epi16(y0, yOne), _mm256_madd_epi16(y1, yOne)), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+//RGBからNV12へ、行列と範囲の変換、色差の2x2の平均を1パスで行う
+template<int pixel_byte, bool interlaced>
+static void convert_rgb_to_nv12_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int in_bit_depth = (pixel_byte == 6) ? 12 : 8;
+    const int y_shift  = 14 + in_bit_depth - 8;
+    const int uv_shift = y_shift + ((interlaced) ? 3 : 2); //色差は4画素(インタレでは重みの和が8)の和から計算する
+    const int *coef = get_convert_csp_rgb_coef();
+    const __m256i yCoefYRG = rgb_coef_pair_avx2(coef[0], coef[1]);
+    const __m256i yCoefYB  = rgb_coef_pair_avx2(coef[2], 0);
+    const __m256i yCoefURG = rgb_coef_pair_avx2(coef[4], coef[5]);
+    const __m256i yCoefUB  = rgb_coef_pair_avx2(coef[6], 0);
+    const __m256i yCoefVRG = rgb_coef_pair_avx2(coef[8], coef[9]);
+    const __m256i yCoefVB  = rgb_coef_pair_avx2(coef[10], 0);
+    const __m256i yOffsetY = _mm256_set1_epi32((coef[3]  << y_shift)  + (1 << (y_shift  - 1)));
+    const __m256i yOffsetU = _mm256_set1_epi32((coef[7]  << uv_shift) + (1 << (uv_shift - 1)));
+    const __m256i yOffsetV = _mm256_set1_epi32((coef[11] << uv_shift) + (1 << (uv_shift - 1)));
+    //プログレッシブなら隣接する2ライン、インタレなら同じフィールドの2ライン(i, i+2)から色差を作る
+    const int line_step = (interlaced) ? 2 : 1;
+    const int y_step = line_step * 2;
+    const uint8_t *srcLine = (const uint8_t *)src[0] + src_y_pitch_byte * crop_up + crop_left * pixel_byte;
+    uint8_t *dstYLine = (uint8_t *)dst[0];
+    uint8_t *dstCLine = (uint8_t *)dst[1];
+    const int y_fin = height - crop_bottom - crop_up;
+    const int x_fin = width - crop_right - crop_left;
+    for (int y = 0; y < y_fin; y += y_step) {
+        for (int i = 0; i < line_step; i++) {
+            const uint8_t *p0 = srcLine + src_y_pitch_byte * i;
+            const uint8_t *p1 = p0 + src_y_pitch_byte * line_step;
+            uint8_t *dstY0 = dstYLine + dst_y_pitch_byte * i;
+            uint8_t *dstY1 = dstY0 + dst_y_pitch_byte * line_step;
+            uint8_t *dstC = dstCLine + dst_y_pitch_byte * i;
+            for (int ix = 0; ix < x_fin; ix += 32) {
+                //右端の32画素に満たない部分は、入力の範囲外を読まないよう直前の画素と重ねて処理する
+                const int x = (ix + 32 > x_fin && x_fin >= 32) ? x_fin - 32 : ix;
+                __m256i yR[2][2], yG[2][2], yB[2][2]; //[ライン][前半/後半の16画素]
+                load_rgb_16px_avx2<pixel_byte>(p0 + (x +  0) * pixel_byte, yR[0][0], yG[0][0], yB[0][0]);
+                load_rgb_16px_avx2<pixel_byte>(p0 + (x + 16) * pixel_byte, yR[0][1], yG[0][1], yB[0][1]);
+                load_rgb_16px_avx2<pixel_byte>(p1 + (x +  0) * pixel_byte, yR[1][0], yG[1][0], yB[1][0]);
+                load_rgb_16px_avx2<pixel_byte>(p1 + (x + 16) * pixel_byte, yR[1][1], yG[1][1], yB[1][1]);
+
+                __m256i y0, y1;
+                y0 = rgb_to_yuv_16px_avx2<y_shift>(yR[0][0], yG[0][0], yB[0][0], yCoefYRG, yCoefYB, yOffsetY);
+                y1 = rgb_to_yuv_16px_avx2<y_shift>(yR[0][1], yG[0][1], yB[0][1], yCoefYRG, yCoefYB, yOffsetY);
+                _mm256_storeu_si256((__m256i *)(dstY0 + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y1), _MM_SHUFFLE(3, 1, 2, 0)));
+                y0 = rgb_to_yuv_16px_avx2<y_shift>(yR[1][0], yG[1][0], yB[1][0], yCoefYRG, yCoefYB, yOffsetY);
+                y1 = rgb_to_yuv_16px_avx2<y_shift>(yR[1][1], yG[1][1], yB[1][1], yCoefYRG, yCoefYB, yOffsetY);
+                _mm256_storeu_si256((__m256i *)(dstY1 + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y1), _MM_SHUFFLE(3, 1, 2, 0)));
+
+                const __m256i yRs = rgb_pair_sum_avx2(rgb_line_sum_avx2<interlaced>(yR[0][0], yR[1][0], i), rgb_line_sum_avx2<interlaced>(yR[0][1], yR[1][1], i));
+                const __m256i yGs = rgb_pair_sum_avx2(rgb_line_sum_avx2<interlaced>(yG[0][0], yG[1][0], i), rgb_line_sum_avx2<interlaced>(yG[0][1], yG[1][1], i));
+                const __m256i yBs = rgb_pair_sum_avx2(rgb_line_sum_avx2<interlaced>(yB[0][0], yB[1][0], i), rgb_line_sum_avx2<interlaced>(yB[0][1], yB[1][1], i));
+                y0 = rgb_to_yuv_16px_avx2<uv_shift>(yRs, yGs, yBs, yCoefURG, yCoefUB, yOffsetU);
+                y1 = rgb_to_yuv_16px_avx2<uv_shift>(yRs, yGs, yBs, yCoefVRG, yCoefVB, yOffsetV);
+                _mm256_storeu_si256((__m256i *)(dstC + x), _mm256_packus_epi16(_mm256_unpacklo_epi16(y0, y1), _mm256_unpackhi_epi16(y0, y1)));
+            }
+        }
+        srcLine  += src_y_pitch_byte * y_step;
+        dstYLine += dst_y_pitch_byte * y_step;
+        dstCLine += dst_y_pitch_byte * line_step;
+    }
+}
+#pragma warning (pop)
+
+void convert_bgra_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_avx2_base<4, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgra_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_avx2_base<4, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr24_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_avx2_base<3, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr24_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_avx2_base<3, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr48_to_nv12_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_avx2_base<6, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr48_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_avx2_base<6, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
@@ -0,0 +1,396 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <immintrin.h>
+#include "qsv_osdep.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
+#endif
+
+//nバイト分のマスク (n >= 64なら全ビット)
+static __forceinline __mmask64 mask64(int n) {
+    return (n >= 64) ? (__mmask64)-1 : ((n <= 0) ? (__mmask64)0 : (__mmask64)((1ULL << n) - 1));
+}
+
+//nワード分のマスク (n >= 32なら全ビット)
+static __forceinline __mmask32 mask32(int n) {
+    return (n >= 32) ? (__mmask32)-1 : ((n <= 0) ? (__mmask32)0 : (__mmask32)((1U << n) - 1));
+}
+
+template<bool use_stream>
+static __forceinline void _mm512_store_switch_si512(void *ptr, __m512i z) {
+    if (use_stream) {
+        _mm512_stream_si512((__m512i *)ptr, z);
+    } else {
+        _mm512_storeu_si512(ptr, z);
+    }
+}
+
+//末尾はマスク付きのロード/ストアで処理するので、sizeを超えて書き込むことはない
+template<bool use_stream>
+static void __forceinline avx512_memcpy(uint8_t *dst, const uint8_t *src, int size) {
+    uint8_t *dst_fin = dst + size;
+    if (size >= 256) {
+        const int start_align_diff = (int)((size_t)dst & 63);
+        if (start_align_diff) {
+            _mm512_storeu_si512(dst, _mm512_loadu_si512(src));
+            dst += 64 - start_align_diff;
+            src += 64 - start_align_diff;
+        }
+        __m512i z0, z1, z2, z3;
+        for (; dst + 256 <= dst_fin; dst += 256, src += 256) {
+            z0 = _mm512_loadu_si512(src +   0);
+            z1 = _mm512_loadu_si512(src +  64);
+            z2 = _mm512_loadu_si512(src + 128);
+            z3 = _mm512_loadu_si512(src + 192);
+            _mm512_store_switch_si512<use_stream>(dst +   0, z0);
+            _mm512_store_switch_si512<use_stream>(dst +  64, z1);
+            _mm512_store_switch_si512<use_stream>(dst + 128, z2);
+            _mm512_store_switch_si512<use_stream>(dst + 192, z3);
+        }
+    }
+    for (; dst < dst_fin; dst += 64, src += 64) {
+        const __mmask64 mask = mask64((int)(dst_fin - dst));
+        _mm512_mask_storeu_epi8(dst, mask, _mm512_maskz_loadu_epi8(mask, src));
+    }
+}
+
+//packus_epi16等で128bitレーンごとに交互に並んだ結果を元の順序に戻す
+#define zIDX_PACK_FIX _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0)
+
+static const _declspec(align(64)) uint8_t Array_INTERLACE_WEIGHT[2][64] = {
+    {1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3,
+     1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3},
+    {3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1,
+     3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1}
+};
+#define zC_INTERLACE_WEIGHT(i) _mm512_load_si512((const __m512i *)Array_INTERLACE_WEIGHT[i])
+
+//yuy2 64画素分(128byte)を読み込み、輝度と色差に分離する
+static __forceinline void load_yuy2_separate(__m512i& z0_return_y, __m512i& z1_return_c, const uint8_t *p, __mmask64 mask0, __mmask64 mask1) {
+    const __m512i zMaskLowByte = _mm512_set1_epi16(0x00ff);
+    __m512i z0 = _mm512_maskz_loadu_epi8(mask0, p +  0);
+    __m512i z1 = _mm512_maskz_loadu_epi8(mask1, p + 64);
+    __m512i z4 = _mm512_srli_epi16(z0, 8);
+    __m512i z5 = _mm512_srli_epi16(z1, 8);
+    z0 = _mm512_and_si512(z0, zMaskLowByte);
+    z1 = _mm512_and_si512(z1, zMaskLowByte);
+    z0_return_y = _mm512_permutexvar_epi64(zIDX_PACK_FIX, _mm512_packus_epi16(z0, z1));
+    z1_return_c = _mm512_permutexvar_epi64(zIDX_PACK_FIX, _mm512_packus_epi16(z4, z5));
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+template<bool use_stream>
+static void __forceinline convert_yuy2_to_nv12_avx512_base(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    void *dst = dst_array[0];
+    const void *src = src_array[0];
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left * 2; //yuy2は1画素2byte
+    uint8_t *dstYLine = (uint8_t *)dst;
+    uint8_t *dstCLine = dstYLine + dst_y_pitch_byte * dst_height;
+    const int y_fin = height - crop_bottom - crop_up;
+    const int x_fin = width - crop_right - crop_left;
+    const int x_fin_main = x_fin & ~63;
+    for (int y = 0; y < y_fin; y += 2) {
+        uint8_t *p = srcLine;
+        uint8_t *pw = p + src_y_pitch_byte;
+        __m512i z0, z1, z2, z3;
+        int x = 0;
+        for (; x < x_fin_main; x += 64, p += 128, pw += 128) {
+            load_yuy2_separate(z0, z1, p,  (__mmask64)-1, (__mmask64)-1);
+            load_yuy2_separate(z2, z3, pw, (__mmask64)-1, (__mmask64)-1);
+            _mm512_store_switch_si512<use_stream>(dstYLine + x, z0);
+            _mm512_store_switch_si512<use_stream>(dstYLine + dst_y_pitch_byte + x, z2);
+            _mm512_store_switch_si512<use_stream>(dstCLine + x, _mm512_avg_epu8(z1, z3));
+        }
+        if (x < x_fin) {
+            const int rem = x_fin - x;
+            const __mmask64 mask0 = mask64(rem * 2);
+            const __mmask64 mask1 = mask64(rem * 2 - 64);
+            const __mmask64 mask_dst = mask64(rem);
+            load_yuy2_separate(z0, z1, p,  mask0, mask1);
+            load_yuy2_separate(z2, z3, pw, mask0, mask1);
+            _mm512_mask_storeu_epi8(dstYLine + x, mask_dst, z0);
+            _mm512_mask_storeu_epi8(dstYLine + dst_y_pitch_byte + x, mask_dst, z2);
+            _mm512_mask_storeu_epi8(dstCLine + x, mask_dst, _mm512_avg_epu8(z1, z3));
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+        dstCLine += dst_y_pitch_byte;
+    }
+    if (use_stream) {
+        _mm_sfence();
+    }
+    _mm256_zeroupper();
+}
+
+void convert_yuy2_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_avx512_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+//出力先は64byteにアラインされていること
+void convert_yuy2_to_nv12_stream_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_avx512_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+static __forceinline __m512i yuv422_to_420_i_interpolate(__m512i z_up, __m512i z_down, int i) {
+    __m512i z0, z1;
+    z0 = _mm512_unpacklo_epi8(z_down, z_up);
+    z1 = _mm512_unpackhi_epi8(z_down, z_up);
+    z0 = _mm512_maddubs_epi16(z0, zC_INTERLACE_WEIGHT(i));
+    z1 = _mm512_maddubs_epi16(z1, zC_INTERLACE_WEIGHT(i));
+    z0 = _mm512_add_epi16(z0, _mm512_set1_epi16(2));
+    z1 = _mm512_add_epi16(z1, _mm512_set1_epi16(2));
+    z0 = _mm512_srai_epi16(z0, 2);
+    z1 = _mm512_srai_epi16(z1, 2);
+    z0 = _mm512_packus_epi16(z0, z1);
+    return z0;
+}
+
+template<bool use_stream>
+static void __forceinline convert_yuy2_to_nv12_i_avx512_base(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    void *dst = dst_array[0];
+    const void *src = src_array[0];
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left * 2; //yuy2は1画素2byte
+    uint8_t *dstYLine = (uint8_t *)dst;
+    uint8_t *dstCLine = dstYLine + dst_y_pitch_byte * dst_height;
+    const int y_fin = height - crop_bottom - crop_up;
+    const int x_fin = width - crop_right - crop_left;
+    const int x_fin_main = x_fin & ~63;
+    for (int y = 0; y < y_fin; y += 4) {
+        for (int i = 0; i < 2; i++) {
+            uint8_t *p = srcLine;
+            uint8_t *pw = p + (src_y_pitch_byte<<1);
+            __m512i z0, z1, z2, z3;
+            int x = 0;
+            for (; x < x_fin_main; x += 64, p += 128, pw += 128) {
+                //1+i行目と3+i行目
+                load_yuy2_separate(z0, z1, p,  (__mmask64)-1, (__mmask64)-1);
+                load_yuy2_separate(z2, z3, pw, (__mmask64)-1, (__mmask64)-1);
+                _mm512_store_switch_si512<use_stream>(dstYLine + x, z0);
+                _mm512_store_switch_si512<use_stream>(dstYLine + (dst_y_pitch_byte<<1) + x, z2);
+                _mm512_store_switch_si512<use_stream>(dstCLine + x, yuv422_to_420_i_interpolate(z1, z3, i));
+            }
+            if (x < x_fin) {
+                const int rem = x_fin - x;
+                const __mmask64 mask0 = mask64(rem * 2);
+                const __mmask64 mask1 = mask64(rem * 2 - 64);
+                const __mmask64 mask_dst = mask64(rem);
+                load_yuy2_separate(z0, z1, p,  mask0, mask1);
+                load_yuy2_separate(z2, z3, pw, mask0, mask1);
+                _mm512_mask_storeu_epi8(dstYLine + x, mask_dst, z0);
+                _mm512_mask_storeu_epi8(dstYLine + (dst_y_pitch_byte<<1) + x, mask_dst, z2);
+                _mm512_mask_storeu_epi8(dstCLine + x, mask_dst, yuv422_to_420_i_interpolate(z1, z3, i));
+            }
+            srcLine  += src_y_pitch_byte;
+            dstYLine += dst_y_pitch_byte;
+            dstCLine += dst_y_pitch_byte;
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+    }
+    if (use_stream) {
+        _mm_sfence();
+    }
+    _mm256_zeroupper();
+}
+
+void convert_yuy2_to_nv12_i_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_i_avx512_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuy2_to_nv12_i_stream_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yuy2_to_nv12_i_avx512_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+//u, vをそれぞれ64byte分読み込み、uvuv...の128byteにして書き込む
+template<bool use_stream>
+static __forceinline void store_uv_interleave(uint8_t *dst_ptr, __m512i z0, __m512i z1, int rem) {
+    const __m512i z2 = _mm512_unpacklo_epi8(z0, z1);
+    const __m512i z3 = _mm512_unpackhi_epi8(z0, z1);
+    z0 = _mm512_permutex2var_epi64(z2, _mm512_set_epi64(11, 10, 3, 2,  9,  8, 1, 0), z3);
+    z1 = _mm512_permutex2var_epi64(z2, _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), z3);
+    if (use_stream && rem >= 128) {
+        _mm512_stream_si512((__m512i *)(dst_ptr +  0), z0);
+        _mm512_stream_si512((__m512i *)(dst_ptr + 64), z1);
+    } else {
+        _mm512_mask_storeu_epi8(dst_ptr +  0, mask64(rem), z0);
+        _mm512_mask_storeu_epi8(dst_ptr + 64, mask64(rem - 64), z1);
+    }
+}
+
+template<bool uv_only, bool use_stream>
+static void __forceinline convert_yv12_to_nv12_avx512_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    //Y成分のコピー
+    if (!uv_only) {
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * crop_up + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx512_memcpy<use_stream>(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分のコピー
+    uint8_t *srcULine = (uint8_t *)src[1] + (((src_uv_pitch_byte * crop_up) + crop_left) >> 1);
+    uint8_t *srcVLine = (uint8_t *)src[2] + (((src_uv_pitch_byte * crop_up) + crop_left) >> 1);
+    uint8_t *dstLine = (uint8_t *)dst[1];
+    const int uv_fin = (height - crop_bottom) >> 1;
+    const int uv_width = width - crop_right - crop_left;
+    for (int y = crop_up >> 1; y < uv_fin; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        uint8_t *src_u_ptr = srcULine;
+        uint8_t *src_v_ptr = srcVLine;
+        uint8_t *dst_ptr = dstLine;
+        __m512i z0, z1;
+        for (int x = 0; x < uv_width; x += 128, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 128) {
+            const int rem = uv_width - x;
+            const __mmask64 mask_src = mask64((rem + 1) >> 1);
+            z0 = _mm512_maskz_loadu_epi8(mask_src, src_u_ptr);
+            z1 = _mm512_maskz_loadu_epi8(mask_src, src_v_ptr);
+            store_uv_interleave<use_stream>(dst_ptr, z0, z1, rem);
+        }
+    }
+    if (use_stream) {
+        _mm_sfence();
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yv12_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_to_nv12_avx512_base<false, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_to_nv12_stream_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_to_nv12_avx512_base<false, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_uv_yv12_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_to_nv12_avx512_base<true, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+template<int in_bit_depth, bool uv_only>
+static void convert_yv12_high_to_nv12_avx512_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    //Y成分のコピー
+    if (!uv_only) {
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
+        uint8_t *dstLine  = (uint8_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+            uint8_t *dst_ptr = dstLine;
+            uint16_t *src_ptr = srcYLine;
+            __m512i z0, z1;
+            for (int x = 0; x < y_width; x += 64, dst_ptr += 64, src_ptr += 64) {
+                const int rem = y_width - x;
+                z0 = _mm512_maskz_loadu_epi16(mask32(rem),      src_ptr +  0);
+                z1 = _mm512_maskz_loadu_epi16(mask32(rem - 32), src_ptr + 32);
+
+                z0 = _mm512_srli_epi16(z0, in_bit_depth - 8);
+                z1 = _mm512_srli_epi16(z1, in_bit_depth - 8);
+
+                z0 = _mm512_permutexvar_epi64(zIDX_PACK_FIX, _mm512_packus_epi16(z0, z1));
+
+                _mm512_mask_storeu_epi8(dst_ptr, mask64(rem), z0);
+            }
+        }
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
+    uint16_t *srcVLine = (uint16_t *)src[2] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
+    uint8_t *dstLine  = (uint8_t *)dst[1];
+    const int uv_fin = (height - crop_bottom) >> 1;
+    const int uv_width = width - crop_right - crop_left;
+    const __m512i zMaskHighByte = _mm512_set1_epi16((short)0xff00);
+    for (int y = crop_up >> 1; y < uv_fin; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint8_t *dst_ptr = dstLine;
+        __m512i z0, z1;
+        for (int x = 0; x < uv_width; x += 64, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 64) {
+            const int rem = uv_width - x;
+            const __mmask32 mask_src = mask32((rem + 1) >> 1);
+            z0 = _mm512_maskz_loadu_epi16(mask_src, src_u_ptr);
+            z1 = _mm512_maskz_loadu_epi16(mask_src, src_v_ptr);
+
+            z0 = _mm512_srli_epi16(z0, in_bit_depth - 8);
+            z1 = _mm512_slli_epi16(z1, 16 - in_bit_depth);
+            z1 = _mm512_and_si512(z1, zMaskHighByte);
+
+            z0 = _mm512_or_si512(z0, z1);
+
+            _mm512_mask_storeu_epi8(dst_ptr, mask64(rem), z0);
+        }
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yv12_16_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx512_base<16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_14_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx512_base<14, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_12_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx512_base<12, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_10_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx512_base<10, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yv12_09_to_nv12_avx512(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_yv12_high_to_nv12_avx512_base<9, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
@@ -0,0 +1,764 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <random>
+#include "qsv_osdep.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <csignal>
+#include <csetjmp>
+#include <sys/mman.h>
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+#include "ConvertCsp.h"
+#include "ConvertCspBench.h"
+#include "ConvertCspRef.h"
+#include "cpu_info.h"
+
+//1条件あたりの計測時間の目安
+static const double BENCH_MIN_SEC = 0.02;
+static const int BENCH_MIN_LOOP = 3;
+static const int BENCH_MAX_LOOP = 100;
+
+static const int BENCH_MAX_WIDTH  = 3840;
+static const int BENCH_MAX_HEIGHT = 2160;
+
+static bool csp_is_high_bit(VCE_CSP csp) {
+    return (VCE_CSP_YV12_09 <= csp && csp <= VCE_CSP_YV12_16)
+        || (VCE_CSP_YUV444_09 <= csp && csp <= VCE_CSP_YUV444_16)
+        || csp == VCE_CSP_P010;
+}
+
+static bool csp_is_yuv444(VCE_CSP csp) {
+    return VCE_CSP_YUV444 <= csp && csp <= VCE_CSP_YUV444_16;
+}
+
+//yuy2, RGBなどのパックドな形式の1画素あたりのバイト数 (プレーナーな形式なら0)
+static int csp_packed_pixel_byte(VCE_CSP csp) {
+    switch (csp) {
+    case VCE_CSP_YUY2:  return 2;
+    case VCE_CSP_BGRA:  return 4;
+    case VCE_CSP_BGR24: return 3;
+    case VCE_CSP_BGR48: return 6;
+    default:            return 0;
+    }
+}
+
+//1画素あたりのバイト数 (uv_onlyなら色差のみ)
+static double csp_frame_byte_per_pixel(VCE_CSP csp, bool uv_only) {
+    const double pixel_byte = (csp_is_high_bit(csp)) ? 2.0 : 1.0;
+    if (csp_packed_pixel_byte(csp)) {
+        return (double)csp_packed_pixel_byte(csp);
+    }
+    const double luma = (uv_only) ? 0.0 : pixel_byte;
+    return luma + ((csp_is_yuv444(csp)) ? pixel_byte * 2.0 : pixel_byte * 0.5);
+}
+
+struct ConvertCspBenchResult {
+    const ConvertCSP *convert;
+    const ConvertCSP *base; //基準の実装(ConvertCspRef.h)がない場合に基準とした関数 (基準の実装を使用した場合はnullptr)
+    int width, height;
+    int layout;
+    int interlaced;
+    double ns_per_frame;
+    double gb_per_sec;
+    double base_ns_per_frame;
+    double speedup;
+};
+
+//計測条件: 0 ... pitchを64byteにアラインしcropなし, 1 ... pitchをずらしcropあり
+static const int BENCH_LAYOUT_COUNT = 2;
+static const TCHAR *BENCH_LAYOUT_NAME[BENCH_LAYOUT_COUNT] = { _T("aligned"), _T("crop") };
+
+//convertの変換条件で、funcの速度を計測する
+static double convert_csp_bench_run(const ConvertCSP *convert, funcConvertCSP func, int width, int height, int layout, uint8_t *src_buf, uint8_t *dst_buf,
+    int min_loop = BENCH_MIN_LOOP, double min_sec = BENCH_MIN_SEC) {
+    const int src_pixel_byte = (csp_is_high_bit(convert->csp_from)) ? 2 : 1;
+    const int dst_pixel_byte = (csp_is_high_bit(convert->csp_to)) ? 2 : 1;
+    int crop[4] = { 0 };
+    const int src_packed_pixel_byte = csp_packed_pixel_byte(convert->csp_from);
+    int src_pitch = ALIGN(width * ((src_packed_pixel_byte) ? src_packed_pixel_byte : src_pixel_byte), 64);
+    if (layout == 1) {
+        crop[0] = 8, crop[1] = 4, crop[2] = 8, crop[3] = 4;
+        src_pitch += 32;
+    }
+    const int src_uv_pitch = (src_packed_pixel_byte) ? 0 : ((csp_is_yuv444(convert->csp_from) || convert->csp_from == VCE_CSP_NV12) ? src_pitch : src_pitch >> 1);
+    const void *src[3] = {
+        src_buf,
+        src_buf + src_pitch * height,
+        src_buf + src_pitch * height + src_uv_pitch * ((csp_is_yuv444(convert->csp_from)) ? height : height >> 1),
+    };
+    const int dst_width  = width  - crop[0] - crop[2];
+    const int dst_height = height - crop[1] - crop[3];
+    const int dst_pitch = ALIGN(dst_width * dst_pixel_byte, 256);
+    void *dst[3] = {
+        dst_buf,
+        dst_buf + dst_pitch * dst_height,
+        dst_buf + dst_pitch * dst_height * 2,
+    };
+    //1回目はページフォルトなどを含むので計測しない
+    func(dst, src, width, src_pitch, src_uv_pitch, dst_pitch, height, dst_height, crop);
+    double best_ns = 1e30;
+    double total_sec = 0.0;
+    for (int i = 0; i < BENCH_MAX_LOOP && (i < min_loop || total_sec < min_sec); i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        func(dst, src, width, src_pitch, src_uv_pitch, dst_pitch, height, dst_height, crop);
+        auto fin = std::chrono::high_resolution_clock::now();
+        const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(fin - start).count();
+        best_ns = (std::min)(best_ns, ns);
+        total_sec += ns * 1e-9;
+    }
+    return best_ns;
+}
+
+static tstring convert_csp_name(const ConvertCSP *convert) {
+    static const TCHAR *DITHER_NAME[] = { _T(""), _T(" bayer"), _T(" errdiff") };
+    return strsprintf(_T("%s->%s%s%s"), VCE_CSP_NAMES[convert->csp_from], VCE_CSP_NAMES[convert->csp_to],
+        (convert->uv_only) ? _T(" (uv)") : _T(""), DITHER_NAME[convert->dither]);
+}
+
+static tstring convert_csp_simd_name(const ConvertCSP *convert) {
+    return (convert->simd) ? get_simd_str(convert->simd) : _T("C");
+}
+
+tstring convert_csp_benchmark(bool bJson) {
+    static const std::pair<int, int> BENCH_SIZE[] = {
+        { 1280,  720 },
+        { 1920, 1080 },
+        { BENCH_MAX_WIDTH, BENCH_MAX_HEIGHT },
+    };
+    const unsigned int availableSIMD = vce_get_availableSIMD();
+    const ConvertCSP *list = get_convert_csp_list();
+
+    //yuv444 16bitの3プレーン(bgr48と同じ) + pitchのずれ分が最大
+    const size_t src_size = (size_t)(ALIGN(BENCH_MAX_WIDTH * 2, 64) + 32) * BENCH_MAX_HEIGHT * 3 + 4096;
+    const size_t dst_size = (size_t)ALIGN(BENCH_MAX_WIDTH * 2, 256) * BENCH_MAX_HEIGHT * 3 + 4096;
+    unique_ptr<uint8_t, aligned_malloc_deleter> src_buf((uint8_t *)_aligned_malloc(src_size, 64));
+    unique_ptr<uint8_t, aligned_malloc_deleter> dst_buf((uint8_t *)_aligned_malloc(dst_size, 64));
+    if (!src_buf || !dst_buf) {
+        return _T("failed to allocate memory for benchmark.\n");
+    }
+    //高ビット深度の入力でもはみ出さないよう、9bitに収まる値で埋める
+    uint16_t *src_ptr16 = (uint16_t *)src_buf.get();
+    for (size_t i = 0; i < src_size / sizeof(uint16_t); i++) {
+        src_ptr16[i] = (uint16_t)(rand() & 0x1ff);
+    }
+    memset(dst_buf.get(), 0, dst_size);
+
+    std::vector<ConvertCspBenchResult> results;
+    //基準の実装の計測結果 (同じ基準の実装を使う関数が複数あるので、条件ごとに1回だけ計測する)
+    std::map<std::tuple<funcConvertCSP, int, int, int>, double> ref_ns_per_frame;
+    for (int i = 0; list[i].csp_from != VCE_CSP_NA; i++) {
+        const ConvertCSP *convert = &list[i];
+        if (convert->simd != (availableSIMD & convert->simd)) {
+            continue;
+        }
+        //基準の実装(ConvertCspRef.h)のない変換(uv_only)では、同じ変換を行う関数のうち、もっとも優先度の低いもの(C版など)を基準とする
+        const ConvertCSP *base = convert;
+        for (int j = i + 1; list[j].csp_from != VCE_CSP_NA; j++) {
+            if (list[j].csp_from == convert->csp_from && list[j].csp_to == convert->csp_to
+                && list[j].uv_only == convert->uv_only && list[j].dither == convert->dither
+                && list[j].simd == (availableSIMD & list[j].simd)) {
+                base = &list[j];
+            }
+        }
+        for (const auto& size : BENCH_SIZE) {
+            for (int layout = 0; layout < BENCH_LAYOUT_COUNT; layout++) {
+                //インタレ用の関数がプログレッシブと同じなら計測を省略する
+                for (int interlaced = 0; interlaced < ((convert->func[1] != convert->func[0]) ? 2 : 1); interlaced++) {
+                    ConvertCspBenchResult result = { 0 };
+                    result.convert = convert;
+                    result.base = base;
+                    result.width = size.first;
+                    result.height = size.second;
+                    result.layout = layout;
+                    result.interlaced = interlaced;
+                    result.ns_per_frame = convert_csp_bench_run(convert, convert->func[interlaced], size.first, size.second, layout, src_buf.get(), dst_buf.get());
+                    const funcConvertCSP ref_func = get_convert_csp_ref_func(convert, interlaced);
+                    if (ref_func) {
+                        const auto key = std::make_tuple(ref_func, size.first, size.second, layout);
+                        if (ref_ns_per_frame.count(key) == 0) {
+                            ref_ns_per_frame[key] = convert_csp_bench_run(convert, ref_func, size.first, size.second, layout, src_buf.get(), dst_buf.get());
+                        }
+                        result.base = nullptr;
+                        result.base_ns_per_frame = ref_ns_per_frame[key];
+                    }
+                    const int crop_pixels = (layout == 1) ? 16 : 0;
+                    const double pixels = (double)(size.first - crop_pixels) * (size.second - (crop_pixels >> 1));
+                    const double bytes = pixels * (csp_frame_byte_per_pixel(convert->csp_from, convert->uv_only) + csp_frame_byte_per_pixel(convert->csp_to, convert->uv_only));
+                    result.gb_per_sec = bytes / result.ns_per_frame;
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+    //基準の実装(なければ基準の関数)の結果から速度比を求める
+    for (auto& result : results) {
+        if (result.base == nullptr) {
+            result.speedup = result.base_ns_per_frame / result.ns_per_frame;
+            continue;
+        }
+        auto base_result = std::find_if(results.begin(), results.end(), [&result](const ConvertCspBenchResult& r) {
+            return r.convert == result.base && r.width == result.width && r.height == result.height
+                && r.layout == result.layout && r.interlaced == (std::min)(result.interlaced, (r.convert->func[1] != r.convert->func[0]) ? 1 : 0);
+        });
+        result.speedup = (base_result != results.end()) ? base_result->ns_per_frame / result.ns_per_frame : 0.0;
+    }
+
+    TCHAR cpu_info[256] = { 0 };
+    getCPUInfo(cpu_info);
+    tstring str;
+    if (bJson) {
+        str += _T("{\n");
+        str += strsprintf(_T("  \"cpu\": \"%s\",\n"), cpu_info);
+        str += strsprintf(_T("  \"simd\": \"%s\",\n"), get_simd_str(availableSIMD));
+        str += _T("  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& r = results[i];
+            str += strsprintf(_T("    { \"from\": \"%s\", \"to\": \"%s\", \"uv_only\": %s, \"dither\": %d, \"simd\": \"%s\", \"base_simd\": \"%s\", ")
+                _T("\"width\": %d, \"height\": %d, \"layout\": \"%s\", \"interlaced\": %s, ")
+                _T("\"ns_per_frame\": %.0f, \"gb_per_sec\": %.3f, \"speedup\": %.3f }%s\n"),
+                VCE_CSP_NAMES[r.convert->csp_from], VCE_CSP_NAMES[r.convert->csp_to], (r.convert->uv_only) ? _T("true") : _T("false"),
+                (int)r.convert->dither, convert_csp_simd_name(r.convert).c_str(), (r.base) ? convert_csp_simd_name(r.base).c_str() : _T("ref"),
+                r.width, r.height, BENCH_LAYOUT_NAME[r.layout], (r.interlaced) ? _T("true") : _T("false"),
+                r.ns_per_frame, r.gb_per_sec, r.speedup, (i + 1 < results.size()) ? _T(",") : _T(""));
+        }
+        str += _T("  ]\n");
+        str += _T("}\n");
+    } else {
+        str += strsprintf(_T("%s\n"), cpu_info);
+        str += strsprintf(_T("%-36s %-8s %-10s %-7s %-2s %10s %8s %8s\n"),
+            _T("convert"), _T("simd"), _T("size"), _T("layout"), _T(""), _T("us/frame"), _T("GB/s"), _T("vs ref"));
+        for (const auto& r : results) {
+            str += strsprintf(_T("%-36s %-8s %4dx%-5d %-7s %-2s %10.1f %8.2f %7.2fx\n"),
+                convert_csp_name(r.convert).c_str(), convert_csp_simd_name(r.convert).c_str(),
+                r.width, r.height, BENCH_LAYOUT_NAME[r.layout], (r.interlaced) ? _T("i") : _T("p"),
+                r.ns_per_frame * 1e-3, r.gb_per_sec, r.speedup);
+        }
+    }
+    return str;
+}
+
+//自動選択の計測時の条件 (実際の幅 x TUNE_HEIGHTラインで計測する)
+static const int TUNE_HEIGHT = 64;
+static const int TUNE_MIN_LOOP = 5;
+static const double TUNE_MIN_SEC = 0.002;
+
+//幅の区分 (キャッシュに乗るかどうかで最速の関数が変わるため)
+static int convert_csp_width_class(int width) {
+    if (width <= 1280) return 0;
+    if (width <= 1920) return 1;
+    if (width <= 2560) return 2;
+    return 3;
+}
+
+struct ConvertCspTuneEntry {
+    VCE_CSP csp_from, csp_to;
+    bool uv_only;
+    VCE_DITHER dither;
+    int width_class;
+    unsigned int simd[2];   //プログレッシブ/インタレそれぞれで最速だった関数のsimd
+    ConvertCSP convert;     //それぞれの最速の関数を組み合わせたもの
+};
+
+static std::mutex g_tuneMtx;
+static std::list<ConvertCspTuneEntry> g_tuneList; //返したポインタが無効にならないようlistで保持する
+static tstring g_tuneProfile;
+static bool g_tuneProfileLoaded = false;
+
+//同じ変換を行う関数のうち、simdが一致し、使用可能なもの
+static const ConvertCSP *convert_csp_find_simd(const ConvertCSP *convert, unsigned int simd) {
+    const unsigned int availableSIMD = vce_get_availableSIMD();
+    const ConvertCSP *list = get_convert_csp_list();
+    for (int i = 0; list[i].csp_from != VCE_CSP_NA; i++) {
+        if (list[i].csp_from == convert->csp_from && list[i].csp_to == convert->csp_to
+            && list[i].uv_only == convert->uv_only && list[i].dither == convert->dither
+            && list[i].simd == simd && list[i].simd == (availableSIMD & list[i].simd)) {
+            return &list[i];
+        }
+    }
+    return nullptr;
+}
+
+static void convert_csp_tune_set(ConvertCspTuneEntry& entry, const ConvertCSP *winner[2]) {
+    entry.simd[0] = winner[0]->simd;
+    entry.simd[1] = winner[1]->simd;
+    //インタレ側はstream版も含めてインタレの計測で最速だった関数のものを使用する
+    //(stream版がない場合はnullptrのままとし、convert_csp_use_streamでプログレッシブ/インタレごとに判定する)
+    entry.convert = *winner[0];
+    entry.convert.func[1] = winner[1]->func[1];
+    entry.convert.func_stream[1] = winner[1]->func_stream[1];
+}
+
+//プロファイルは1行目にCPU名、以降は1行に1つの計測結果を記録する
+//cpu=<CPU名>
+//<csp_from> <csp_to> <uv_only> <dither> <width_class> <simd(p)> <simd(i)>
+static void convert_csp_profile_load() {
+    g_tuneProfileLoaded = true;
+    FILE *fp = nullptr;
+    if (g_tuneProfile.length() == 0 || _tfopen_s(&fp, g_tuneProfile.c_str(), _T("r")) || fp == nullptr) {
+        return;
+    }
+    TCHAR cpu_info[256] = { 0 };
+    getCPUInfo(cpu_info);
+    const tstring cpu_line = tstring(_T("cpu=")) + cpu_info;
+    TCHAR line[1024] = { 0 };
+    //別のCPUで計測したプロファイルは使用しない
+    if (_fgetts(line, _countof(line), fp) && cpu_line == tstring(line).substr(0, tstring(line).find_last_not_of(_T("\r\n")) + 1)) {
+        while (_fgetts(line, _countof(line), fp)) {
+            int csp_from = 0, csp_to = 0, uv_only = 0, dither = 0, width_class = 0;
+            unsigned int simd[2] = { 0 };
+            if (7 != _stscanf_s(line, _T("%d %d %d %d %d %x %x"), &csp_from, &csp_to, &uv_only, &dither, &width_class, &simd[0], &simd[1])) {
+                continue;
+            }
+            ConvertCSP key = { (VCE_CSP)csp_from, (VCE_CSP)csp_to, uv_only != 0, { nullptr, nullptr }, 0, (VCE_DITHER)dither, { nullptr, nullptr } };
+            const ConvertCSP *winner[2] = { convert_csp_find_simd(&key, simd[0]), convert_csp_find_simd(&key, simd[1]) };
+            if (winner[0] == nullptr || winner[1] == nullptr) {
+                continue;
+            }
+            ConvertCspTuneEntry entry;
+            entry.csp_from = key.csp_from;
+            entry.csp_to = key.csp_to;
+            entry.uv_only = key.uv_only;
+            entry.dither = key.dither;
+            entry.width_class = width_class;
+            convert_csp_tune_set(entry, winner);
+            g_tuneList.push_back(entry);
+        }
+    }
+    fclose(fp);
+}
+
+static void convert_csp_profile_save() {
+    FILE *fp = nullptr;
+    if (g_tuneProfile.length() == 0 || _tfopen_s(&fp, g_tuneProfile.c_str(), _T("w")) || fp == nullptr) {
+        return;
+    }
+    TCHAR cpu_info[256] = { 0 };
+    getCPUInfo(cpu_info);
+    _ftprintf(fp, _T("cpu=%s\n"), cpu_info);
+    for (const auto& entry : g_tuneList) {
+        _ftprintf(fp, _T("%d %d %d %d %d %x %x\n"), (int)entry.csp_from, (int)entry.csp_to, (entry.uv_only) ? 1 : 0,
+            (int)entry.dither, entry.width_class, entry.simd[0], entry.simd[1]);
+    }
+    fclose(fp);
+}
+
+void set_convert_csp_profile(const TCHAR *path) {
+    std::lock_guard<std::mutex> lock(g_tuneMtx);
+    g_tuneProfile = (path) ? path : _T("");
+    g_tuneProfileLoaded = false;
+    g_tuneList.clear();
+}
+
+const ConvertCSP *convert_csp_tune(const ConvertCSP *convert, int width, int height) {
+    if (convert == nullptr || width <= 0 || height <= 0) {
+        return convert;
+    }
+    std::lock_guard<std::mutex> lock(g_tuneMtx);
+    if (!g_tuneProfileLoaded) {
+        convert_csp_profile_load();
+    }
+    const int width_class = convert_csp_width_class(width);
+    for (const auto& entry : g_tuneList) {
+        if (entry.csp_from == convert->csp_from && entry.csp_to == convert->csp_to
+            && entry.uv_only == convert->uv_only && entry.dither == convert->dither
+            && entry.width_class == width_class) {
+            return &entry.convert;
+        }
+    }
+
+    //同じ変換を行う使用可能な関数を列挙する
+    const unsigned int availableSIMD = vce_get_availableSIMD();
+    const ConvertCSP *list = get_convert_csp_list();
+    std::vector<const ConvertCSP *> candidates;
+    for (int i = 0; list[i].csp_from != VCE_CSP_NA; i++) {
+        if (list[i].csp_from == convert->csp_from && list[i].csp_to == convert->csp_to
+            && list[i].uv_only == convert->uv_only && list[i].dither == convert->dither
+            && list[i].simd == (availableSIMD & list[i].simd)) {
+            candidates.push_back(&list[i]);
+        }
+    }
+    //インタレ用の関数を持つ候補があれば、インタレ用にプログレッシブの関数を登録している候補はインタレの計測の対象外とする
+    const bool has_interlaced_func = std::any_of(candidates.begin(), candidates.end(), [](const ConvertCSP *candidate) {
+        return candidate->func[1] != candidate->func[0];
+    });
+    const ConvertCSP *winner[2] = { convert, convert };
+    if (candidates.size() > 1) {
+        const int tune_height = (std::min)(height, TUNE_HEIGHT) & ~3;
+        const size_t src_size = (size_t)(ALIGN(width * 2, 64) + 32) * tune_height * 3 + 4096;
+        const size_t dst_size = (size_t)ALIGN(width * 2, 256) * tune_height * 3 + 4096;
+        unique_ptr<uint8_t, aligned_malloc_deleter> src_buf((uint8_t *)_aligned_malloc(src_size, 64));
+        unique_ptr<uint8_t, aligned_malloc_deleter> dst_buf((uint8_t *)_aligned_malloc(dst_size, 64));
+        if (tune_height > 0 && src_buf && dst_buf) {
+            //高ビット深度の入力でもはみ出さない値で埋める
+            memset(src_buf.get(), 0x01, src_size);
+            memset(dst_buf.get(), 0, dst_size);
+            for (int interlaced = 0; interlaced < 2; interlaced++) {
+                double best_ns = 1e30;
+                for (const auto& candidate : candidates) {
+                    if (interlaced && has_interlaced_func && candidate->func[1] == candidate->func[0]) {
+                        continue;
+                    }
+                    const double ns = convert_csp_bench_run(candidate, candidate->func[interlaced], width, tune_height, 0, src_buf.get(), dst_buf.get(), TUNE_MIN_LOOP, TUNE_MIN_SEC);
+                    if (ns < best_ns) {
+                        best_ns = ns;
+                        winner[interlaced] = candidate;
+                    }
+                }
+            }
+        }
+    }
+    ConvertCspTuneEntry entry;
+    entry.csp_from = convert->csp_from;
+    entry.csp_to = convert->csp_to;
+    entry.uv_only = convert->uv_only;
+    entry.dither = convert->dither;
+    entry.width_class = width_class;
+    convert_csp_tune_set(entry, winner);
+    g_tuneList.push_back(entry);
+    convert_csp_profile_save();
+    return &g_tuneList.back().convert;
+}
+
+//適合性チェックの条件 (幅は32の倍数でないものを含むよう2の倍数でランダムに選ぶ)
+//SIMDの1回の処理幅より狭いフレームは対象としないので、出力の幅はCHECK_MIN_WIDTH以上とする
+static const int CHECK_MIN_WIDTH  = 64;
+static const int CHECK_MAX_WIDTH  = 600;
+static const int CHECK_MAX_HEIGHT = 72;
+static const int CHECK_MAX_CROP   = 32;
+static const uint32_t CHECK_SEED  = 0x56434531;
+
+//入力の各画素の有効ビット数
+static int csp_bit_depth(VCE_CSP csp) {
+    switch (csp) {
+    case VCE_CSP_YV12_09: case VCE_CSP_YUV444_09: return 9;
+    case VCE_CSP_YV12_10: case VCE_CSP_YUV444_10: return 10;
+    case VCE_CSP_YV12_12: case VCE_CSP_YUV444_12: return 12;
+    case VCE_CSP_YV12_14: case VCE_CSP_YUV444_14: return 14;
+    case VCE_CSP_YV12_16: case VCE_CSP_YUV444_16:
+    case VCE_CSP_P010:    case VCE_CSP_BGR48:     return 16;
+    default: return 8;
+    }
+}
+
+//直後にアクセスできないページを置いたバッファ
+//確保したサイズをalign単位に切り上げた領域の直後がガードページになるので、それを超える読み書きで例外が発生する
+class ConvertCspGuardBuf {
+public:
+    ConvertCspGuardBuf() : m_alloc(nullptr), m_alloc_size(0), m_ptr(nullptr) {};
+    ~ConvertCspGuardBuf() {
+        clear();
+    }
+    uint8_t *alloc(size_t size, size_t align) {
+        clear();
+#if defined(_WIN32) || defined(_WIN64)
+        SYSTEM_INFO si = { 0 };
+        GetSystemInfo(&si);
+        const size_t page_size = si.dwPageSize;
+#else
+        const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+        const size_t data_size = ALIGN(size, align);
+        const size_t alloc_size = ALIGN(data_size, page_size) + page_size;
+        uint8_t *guard = nullptr;
+#if defined(_WIN32) || defined(_WIN64)
+        m_alloc = (uint8_t *)VirtualAlloc(nullptr, alloc_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (m_alloc == nullptr) {
+            return nullptr;
+        }
+        guard = m_alloc + alloc_size - page_size;
+        DWORD oldProtect = 0;
+        if (!VirtualProtect(guard, page_size, PAGE_NOACCESS, &oldProtect)) {
+            clear();
+            return nullptr;
+        }
+#else
+        void *ptr = mmap(nullptr, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return nullptr;
+        }
+        m_alloc = (uint8_t *)ptr;
+        m_alloc_size = alloc_size;
+        guard = m_alloc + alloc_size - page_size;
+        if (mprotect(guard, page_size, PROT_NONE)) {
+            clear();
+            return nullptr;
+        }
+#endif
+        m_ptr = guard - data_size;
+        return m_ptr;
+    }
+    void clear() {
+        if (m_alloc) {
+#if defined(_WIN32) || defined(_WIN64)
+            VirtualFree(m_alloc, 0, MEM_RELEASE);
+#else
+            munmap(m_alloc, m_alloc_size);
+#endif
+        }
+        m_alloc = nullptr;
+        m_alloc_size = 0;
+        m_ptr = nullptr;
+    }
+    uint8_t *ptr() const {
+        return m_ptr;
+    }
+private:
+    ConvertCspGuardBuf(const ConvertCspGuardBuf&) = delete;
+    ConvertCspGuardBuf& operator=(const ConvertCspGuardBuf&) = delete;
+    uint8_t *m_alloc;
+    size_t m_alloc_size;
+    uint8_t *m_ptr;
+};
+
+#if defined(_WIN32) || defined(_WIN64)
+//ガードページへのアクセスで例外が発生した場合はfalseを返す
+//__tryを使うため、この関数内ではデストラクタを持つオブジェクトを使用しないこと
+static bool convert_csp_check_run(funcConvertCSP func, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    __try {
+        func(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+    } __except (GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+        return false;
+    }
+    return true;
+}
+#else
+static sigjmp_buf g_check_jmp;
+
+static void convert_csp_check_sigsegv(int) {
+    siglongjmp(g_check_jmp, 1);
+}
+
+//ガードページへのアクセスでSIGSEGVが発生した場合はfalseを返す
+//siglongjmpで戻るため、この関数内ではデストラクタを持つオブジェクトを使用しないこと
+static bool convert_csp_check_run(funcConvertCSP func, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    struct sigaction sa, sa_old_segv, sa_old_bus;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = convert_csp_check_sigsegv;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &sa_old_segv);
+    sigaction(SIGBUS, &sa, &sa_old_bus);
+    volatile bool ret = true;
+    if (sigsetjmp(g_check_jmp, 1) == 0) {
+        func(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+    } else {
+        ret = false;
+    }
+    sigaction(SIGSEGV, &sa_old_segv, nullptr);
+    sigaction(SIGBUS, &sa_old_bus, nullptr);
+    return ret;
+}
+#endif //#if defined(_WIN32) || defined(_WIN64)
+
+//1回分の条件
+struct ConvertCspCheckLayout {
+    int width, height;
+    int src_pitch, src_uv_pitch;
+    int dst_pitch;
+    int crop[4];
+};
+
+static ConvertCspCheckLayout convert_csp_check_layout(const ConvertCSP *convert, int interlaced, std::mt19937& mt) {
+    const int src_packed_pixel_byte = csp_packed_pixel_byte(convert->csp_from);
+    const int src_pixel_byte = (src_packed_pixel_byte) ? src_packed_pixel_byte : ((csp_is_high_bit(convert->csp_from)) ? 2 : 1);
+    const int dst_pixel_byte = (csp_is_high_bit(convert->csp_to)) ? 2 : 1;
+    //インタレではフィールドごとに処理するので、縦方向は4の倍数とする
+    const int h_mul = (interlaced) ? 4 : 2;
+    ConvertCspCheckLayout layout = { 0 };
+    layout.crop[0] = (mt() % (CHECK_MAX_CROP / 2)) * 2;
+    layout.crop[2] = (mt() % (CHECK_MAX_CROP / 2)) * 2;
+    layout.crop[1] = (mt() % 3) * h_mul;
+    layout.crop[3] = (mt() % 3) * h_mul;
+    layout.width  = (int)(mt() % ((CHECK_MAX_WIDTH - CHECK_MIN_WIDTH) / 2 + 1)) * 2 + CHECK_MIN_WIDTH + layout.crop[0] + layout.crop[2];
+    layout.height = ((int)(mt() % (CHECK_MAX_HEIGHT / h_mul)) + 1) * h_mul + layout.crop[1] + layout.crop[3];
+    //入力のpitchは16byte単位でずらす、出力はstreamで書き込む版も使えるよう64byte単位とする
+    layout.src_pitch = ALIGN(layout.width * src_pixel_byte, 16) + (int)(mt() % 4) * 16;
+    layout.src_uv_pitch = (src_packed_pixel_byte) ? 0 : ((csp_is_yuv444(convert->csp_from) || convert->csp_from == VCE_CSP_NV12) ? layout.src_pitch : layout.src_pitch >> 1);
+    layout.dst_pitch = ALIGN((layout.width - layout.crop[0] - layout.crop[2]) * dst_pixel_byte, 64) + (int)(mt() % 3) * 64;
+    return layout;
+}
+
+struct ConvertCspCheckResult {
+    const ConvertCSP *convert;
+    int tests;
+    bool progressive_only; //インタレ用の関数がプログレッシブと同じもので、インタレの確認を省略した
+    tstring error; //空なら問題なし
+};
+
+int convert_csp_check(tstring& str, int iterations) {
+    const unsigned int availableSIMD = vce_get_availableSIMD();
+    const ConvertCSP *list = get_convert_csp_list();
+    iterations = (std::max)(iterations, 1);
+
+    std::vector<ConvertCspCheckResult> results;
+    for (int i = 0; list[i].csp_from != VCE_CSP_NA; i++) {
+        const ConvertCSP *convert = &list[i];
+        if (convert->simd != (availableSIMD & convert->simd)) {
+            continue;
+        }
+        //SIMDを使用しない基準の実装(ConvertCspRef.cpp)と比較する
+        const funcConvertCSP ref_func[2] = { get_convert_csp_ref_func(convert, 0), get_convert_csp_ref_func(convert, 1) };
+        ConvertCspCheckResult result;
+        result.convert = convert;
+        result.tests = 0;
+        //インタレ用の関数がプログレッシブと同じものを登録している場合、インタレ用の処理が異なる変換ではインタレの確認は行わない
+        result.progressive_only = convert->func[1] == convert->func[0] && ref_func[1] != ref_func[0];
+        if (ref_func[0] == nullptr || ref_func[1] == nullptr) {
+            result.error = _T("no reference function.");
+        }
+
+        //関数ごとに同じ乱数列を使い、失敗した条件を再現しやすくする
+        std::mt19937 mt(CHECK_SEED);
+        const bool src_packed = csp_packed_pixel_byte(convert->csp_from) != 0;
+        const bool src_yuv444 = csp_is_yuv444(convert->csp_from);
+        const int src_plane_count = (src_packed) ? 1 : ((convert->csp_from == VCE_CSP_NV12) ? 2 : 3);
+        const bool dst_yuv444 = csp_is_yuv444(convert->csp_to);
+        const int dst_plane_count = (dst_yuv444) ? 3 : 2;
+        const int dst_pixel_byte = (csp_is_high_bit(convert->csp_to)) ? 2 : 1;
+        const uint16_t src_mask = (uint16_t)((1 << csp_bit_depth(convert->csp_from)) - 1);
+        ConvertCspGuardBuf src_buf[3], ref_buf, dst_buf;
+        for (int it = 0; it < iterations && result.error.length() == 0; it++) {
+            for (int interlaced = 0; interlaced < 2 && result.error.length() == 0; interlaced++) {
+                const auto layout = convert_csp_check_layout(convert, interlaced, mt);
+                if (interlaced && result.progressive_only) {
+                    continue;
+                }
+                const int dst_width  = layout.width  - layout.crop[0] - layout.crop[2];
+                const int dst_height = layout.height - layout.crop[1] - layout.crop[3];
+                const void *src[3] = { 0 };
+                void *ref[3] = { 0 };
+                void *dst[3] = { 0 };
+                int dst_plane_height[3] = { 0 };
+                bool alloc_error = false;
+                for (int iplane = 0; iplane < src_plane_count; iplane++) {
+                    const int pitch = (iplane) ? layout.src_uv_pitch : layout.src_pitch;
+                    const int rows = (iplane && !src_yuv444) ? layout.height >> 1 : layout.height;
+                    const size_t size = (size_t)pitch * rows;
+                    //入力は変換関数が読み込む可能性のある分だけ余裕をとる
+                    uint8_t *ptr = src_buf[iplane].alloc(size + CONVERT_CSP_SRC_PADDING, 16);
+                    if (ptr == nullptr) {
+                        alloc_error = true;
+                        break;
+                    }
+                    //初回は全画素を最大値として、丸めや飽和の処理を確認する
+                    const bool fill_max = (it == 0);
+                    if (src_mask > 0xff) {
+                        for (size_t k = 0; k < size / sizeof(uint16_t); k++) {
+                            ((uint16_t *)ptr)[k] = (uint16_t)(((fill_max) ? 0xffff : mt()) & src_mask);
+                        }
+                    } else {
+                        for (size_t k = 0; k < size; k++) {
+                            ptr[k] = (uint8_t)((fill_max) ? 0xff : mt());
+                        }
+                    }
+                    src[iplane] = ptr;
+                }
+                //出力は各プレーンが連続している前提の関数があるので、1つのバッファにまとめて確保する
+                size_t dst_size = 0;
+                for (int iplane = 0; iplane < dst_plane_count; iplane++) {
+                    dst_plane_height[iplane] = (iplane && !dst_yuv444) ? dst_height >> 1 : dst_height;
+                    dst_size += (size_t)layout.dst_pitch * dst_plane_height[iplane];
+                }
+                if (!alloc_error) {
+                    uint8_t *ptr_ref = ref_buf.alloc(dst_size, 64);
+                    uint8_t *ptr_dst = dst_buf.alloc(dst_size, 64);
+                    alloc_error = (ptr_ref == nullptr || ptr_dst == nullptr);
+                    for (int iplane = 0; iplane < dst_plane_count && !alloc_error; iplane++) {
+                        ref[iplane] = ptr_ref;
+                        dst[iplane] = ptr_dst;
+                        ptr_ref += (size_t)layout.dst_pitch * dst_plane_height[iplane];
+                        ptr_dst += (size_t)layout.dst_pitch * dst_plane_height[iplane];
+                    }
+                }
+                if (alloc_error) {
+                    result.error = _T("failed to allocate memory.");
+                    break;
+                }
+                const tstring layout_str = strsprintf(_T("%s, %dx%d, pitch %d/%d->%d, crop %d,%d,%d,%d"),
+                    (interlaced) ? _T("i") : _T("p"), layout.width, layout.height, layout.src_pitch, layout.src_uv_pitch, layout.dst_pitch,
+                    layout.crop[0], layout.crop[1], layout.crop[2], layout.crop[3]);
+                memset(ref[0], 0x5A, dst_size);
+                int crop[4];
+                memcpy(crop, layout.crop, sizeof(crop));
+                if (!convert_csp_check_run(ref_func[interlaced], ref, src, layout.width, layout.src_pitch, layout.src_uv_pitch, layout.dst_pitch, layout.height, dst_height, crop)) {
+                    result.error = strsprintf(_T("out of bounds access in reference function (%s)."), layout_str.c_str());
+                    break;
+                }
+                //streamで書き込む版があればそれも確認する
+                const funcConvertCSP funcs[2] = { convert->func[interlaced], convert->func_stream[interlaced] };
+                for (int ifunc = 0; ifunc < _countof(funcs) && funcs[ifunc] && result.error.length() == 0; ifunc++) {
+                    //書き込まれなかった画素を検出できるよう、基準と異なる値で埋めておく
+                    memset(dst[0], 0xA5 + ifunc, dst_size);
+                    memcpy(crop, layout.crop, sizeof(crop));
+                    result.tests++;
+                    if (!convert_csp_check_run(funcs[ifunc], dst, src, layout.width, layout.src_pitch, layout.src_uv_pitch, layout.dst_pitch, layout.height, dst_height, crop)) {
+                        result.error = strsprintf(_T("out of bounds access%s (%s)."), (ifunc) ? _T(" in stream function") : _T(""), layout_str.c_str());
+                        break;
+                    }
+                    //出力の有効な範囲のみを比較する (pitchの余白への書き込みは許容する)
+                    for (int iplane = (convert->uv_only) ? 1 : 0; iplane < dst_plane_count && result.error.length() == 0; iplane++) {
+                        const int line_byte = dst_width * dst_pixel_byte;
+                        for (int y = 0; y < dst_plane_height[iplane]; y++) {
+                            const uint8_t *ptr_ref = (const uint8_t *)ref[iplane] + (size_t)layout.dst_pitch * y;
+                            const uint8_t *ptr_dst = (const uint8_t *)dst[iplane] + (size_t)layout.dst_pitch * y;
+                            if (memcmp(ptr_ref, ptr_dst, line_byte) != 0) {
+                                const int x = (int)(std::mismatch(ptr_ref, ptr_ref + line_byte, ptr_dst).first - ptr_ref);
+                                result.error = strsprintf(_T("mismatch%s at plane %d, x=%d, y=%d (%s)."),
+                                    (ifunc) ? _T(" in stream function") : _T(""), iplane, x / dst_pixel_byte, y, layout_str.c_str());
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        results.push_back(result);
+    }
+
+    TCHAR cpu_info[256] = { 0 };
+    getCPUInfo(cpu_info);
+    str = strsprintf(_T("%s\n"), cpu_info);
+    str += strsprintf(_T("%-36s %-8s %6s  %s\n"), _T("convert"), _T("simd"), _T("tests"), _T("result"));
+    int failed = 0;
+    for (const auto& r : results) {
+        str += strsprintf(_T("%-36s %-8s %6d  %s\n"),
+            convert_csp_name(r.convert).c_str(), convert_csp_simd_name(r.convert).c_str(),
+            r.tests, (r.error.length()) ? r.error.c_str() : ((r.progressive_only) ? _T("ok (progressive only)") : _T("ok")));
+        failed += (r.error.length()) ? 1 : 0;
+    }
+    str += strsprintf(_T("%d functions checked, %d failed.\n"), (int)results.size(), failed);
+    return failed;
+}
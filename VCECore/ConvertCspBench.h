@@ -0,0 +1,54 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#ifndef _CONVERT_CSP_BENCH_H_
+#define _CONVERT_CSP_BENCH_H_
+
+#include "VCEUtil.h"
+#include "ConvertCsp.h"
+
+//funcListに登録されている変換関数のうち、実行中のCPUで使用可能なものをすべて
+//720p/1080p/2160p、pitch・cropの異なる条件、プログレッシブ/インタレの各関数について計測する
+//各関数と同じ変換を行うSIMDを使用しない基準の実装(ConvertCspRef.h)を基準とした速度比も算出する
+//(基準の実装のないuv_onlyの変換では、同じ変換を行うもっとも低いSIMDの関数を基準とする)
+//bJsonがtrueならJSON形式、falseなら表形式の文字列で結果を返す
+tstring convert_csp_benchmark(bool bJson);
+
+//funcListに登録されている変換関数のうち、実行中のCPUで使用可能なものをすべて、SIMDを使用しない基準の実装(ConvertCspRef.h)と
+//ランダムな幅・高さ・pitch・cropの条件で比較し、結果がビット単位で一致するかを確認する
+//入力・出力の各プレーンの直後にはガードページを置き、範囲外へのアクセスも検出する
+//結果をstrに格納し、問題のあった関数の数を返す
+int convert_csp_check(tstring& str, int iterations);
+
+//convertと同じ変換を行う使用可能な関数を、実際の幅のフレームの一部を使ってプログレッシブ/インタレそれぞれについて計測し、
+//最速の関数を組み合わせたものを返す (結果は変換の種類と幅の区分ごとにプロセス内で保持する)
+const ConvertCSP *convert_csp_tune(const ConvertCSP *convert, int width, int height);
+
+//計測結果を保存するプロファイルのパスを設定する (CPU名が一致する場合のみ読み込んで使用する)
+void set_convert_csp_profile(const TCHAR *path);
+
+#endif //_CONVERT_CSP_BENCH_H_
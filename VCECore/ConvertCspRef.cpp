@@ -0,0 +1,445 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "ConvertCsp.h"
+#include "ConvertCspRef.h"
+
+#ifdef _MSC_VER
+#pragma warning (push)
+#pragma warning (disable: 4100) //引数は関数ポインタの型に合わせているので、使用しないものがある
+#pragma warning (disable: 4127) //条件式が定数です
+#endif //#ifdef _MSC_VER
+
+//8x8のBayer行列 (0-63)
+static const uint16_t REF_BAYER8x8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+//Bayer行列のrow行目、x列目のディザのオフセット (0 - (1<<shift)-1)
+static inline int ref_bayer_offset(int row, int x, int shift) {
+    return (REF_BAYER8x8[row & 7][x & 7] << shift) >> 6;
+}
+
+//y行目に使うBayer行列の行
+//インタレの場合は各フィールドがそれぞれBayer行列の全行を使うようにし、第2フィールドは4ラインずらす
+static inline int ref_bayer_row(int y, bool interlaced) {
+    return (interlaced) ? (y >> 1) + ((y & 1) << 2) : y;
+}
+
+//4:2:0の色差のcy行目を作る、入力の2ラインとその重み
+//プログレッシブは隣接する2ラインの平均、インタレは同じフィールドの2ラインから近いほうのラインを3倍に重み付けする
+struct RefChromaLines {
+    int line[2];
+    int weight[2];
+    int shift; //重みの和のビット数
+};
+
+static RefChromaLines ref_chroma_lines(int cy, bool interlaced) {
+    RefChromaLines lines;
+    if (interlaced) {
+        const int field = cy & 1;
+        lines.line[0] = (cy >> 1) * 4 + field;
+        lines.line[1] = lines.line[0] + 2;
+        lines.weight[0] = (field) ? 1 : 3;
+        lines.weight[1] = (field) ? 3 : 1;
+        lines.shift = 2;
+    } else {
+        lines.line[0] = cy * 2;
+        lines.line[1] = cy * 2 + 1;
+        lines.weight[0] = 1;
+        lines.weight[1] = 1;
+        lines.shift = 1;
+    }
+    return lines;
+}
+
+static inline const uint8_t *ref_line(const void *plane, int pitch_byte, int y) {
+    return (const uint8_t *)plane + (size_t)pitch_byte * y;
+}
+
+static inline uint8_t *ref_line(void *plane, int pitch_byte, int y) {
+    return (uint8_t *)plane + (size_t)pitch_byte * y;
+}
+
+static inline uint8_t ref_clamp_u8(int value) {
+    return (uint8_t)(std::max)(0, (std::min)(value, 255));
+}
+
+//1ラインあたりline_byteのプレーンをコピーする
+static void ref_copy_plane(void *dst, int dst_pitch_byte, const void *src, int src_pitch_byte, int line_byte, int lines) {
+    for (int y = 0; y < lines; y++) {
+        const uint8_t *src_ptr = ref_line(src, src_pitch_byte, y);
+        uint8_t *dst_ptr = ref_line(dst, dst_pitch_byte, y);
+        for (int x = 0; x < line_byte; x++) {
+            dst_ptr[x] = src_ptr[x];
+        }
+    }
+}
+
+//yuy2 -> nv12 (色差はdst[0]からdst_heightの位置に出力する)
+template<bool interlaced>
+static void convert_yuy2_to_nv12_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int out_width  = width  - crop[0] - crop[2];
+    const int out_height = height - crop[1] - crop[3];
+    //yuy2は1画素あたり2byte
+    const uint8_t *srcFrame = ref_line(src[0], src_y_pitch_byte, crop[1]) + crop[0] * 2;
+    uint8_t *dstC = ref_line(dst[0], dst_y_pitch_byte, dst_height);
+    for (int y = 0; y < out_height; y++) {
+        const uint8_t *src_ptr = ref_line(srcFrame, src_y_pitch_byte, y);
+        uint8_t *dst_ptr = ref_line(dst[0], dst_y_pitch_byte, y);
+        for (int x = 0; x < out_width; x++) {
+            dst_ptr[x] = src_ptr[x * 2];
+        }
+    }
+    for (int cy = 0; cy < (out_height >> 1); cy++) {
+        const auto lines = ref_chroma_lines(cy, interlaced);
+        const uint8_t *src0 = ref_line(srcFrame, src_y_pitch_byte, lines.line[0]);
+        const uint8_t *src1 = ref_line(srcFrame, src_y_pitch_byte, lines.line[1]);
+        uint8_t *dst_ptr = ref_line(dstC, dst_y_pitch_byte, cy);
+        //U, Vは2画素ごとに4byteのうち1byte目と3byte目
+        for (int x = 0; x < out_width; x++) {
+            const int i = (x >> 1) * 4 + (x & 1) * 2 + 1;
+            dst_ptr[x] = (uint8_t)((src0[i] * lines.weight[0] + src1[i] * lines.weight[1] + (1 << (lines.shift - 1))) >> lines.shift);
+        }
+    }
+}
+
+static void convert_nv12_to_nv12_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int out_width = width - crop[0] - crop[2];
+    const int uv_start = crop[1] >> 1;
+    const int uv_fin = (height - crop[3]) >> 1;
+    ref_copy_plane(dst[0], dst_y_pitch_byte, ref_line(src[0], src_y_pitch_byte, crop[1]) + crop[0], src_y_pitch_byte, out_width, height - crop[1] - crop[3]);
+    ref_copy_plane(dst[1], dst_y_pitch_byte, ref_line(src[1], src_uv_pitch_byte, uv_start) + crop[0], src_uv_pitch_byte, out_width, uv_fin - uv_start);
+}
+
+static void convert_yv12_to_nv12_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int out_width = width - crop[0] - crop[2];
+    const int uv_start = crop[1] >> 1;
+    const int uv_fin = (height - crop[3]) >> 1;
+    ref_copy_plane(dst[0], dst_y_pitch_byte, ref_line(src[0], src_y_pitch_byte, crop[1]) + crop[0], src_y_pitch_byte, out_width, height - crop[1] - crop[3]);
+    for (int cy = uv_start; cy < uv_fin; cy++) {
+        const uint8_t *src_u = ref_line(src[1], src_uv_pitch_byte, cy) + (crop[0] >> 1);
+        const uint8_t *src_v = ref_line(src[2], src_uv_pitch_byte, cy) + (crop[0] >> 1);
+        uint8_t *dst_ptr = ref_line(dst[1], dst_y_pitch_byte, cy - uv_start);
+        for (int x = 0; x < (out_width >> 1); x++) {
+            dst_ptr[x * 2 + 0] = src_u[x];
+            dst_ptr[x * 2 + 1] = src_v[x];
+        }
+    }
+}
+
+//高ビット深度のyv12 -> nv12
+//ディザはBayer 8x8、または量子化誤差を直下の画素に持ち越す縦方向のみの誤差拡散で、
+//誤差の初期値は各列が異なる位相から始まるようBayer行列のオフセットとする
+//interlacedなら、ディザのパターンと誤差の持ち越しをフィールドごとに行う
+template<int in_bit_depth, VCE_DITHER dither, bool interlaced>
+static void convert_yv12_high_to_nv12_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int shift = in_bit_depth - 8;
+    const int max_value = (1 << in_bit_depth) - 1;
+    const int error_mask = (1 << shift) - 1;
+    const int field_count = (interlaced) ? 2 : 1;
+    const int out_width = width - crop[0] - crop[2];
+    const int uv_width = out_width >> 1;
+    const int uv_start = crop[1] >> 1;
+    const int uv_fin = (height - crop[3]) >> 1;
+    //ディザを加えた値を8bitにする (誤差拡散ならerrorを更新する)
+    auto quantize = [=](int value, int offset, int *error) {
+        if (dither == VCE_DITHER_ORDERED) {
+            value = (std::min)(value + offset, max_value);
+        } else if (dither == VCE_DITHER_ERROR_DIFFUSION) {
+            value = (std::min)(value + *error, max_value);
+            *error = value & error_mask;
+        }
+        return (uint8_t)(std::min)(value >> shift, 255);
+    };
+    std::vector<int> err_y[2], err_u[2], err_v[2];
+    for (int i = 0; i < field_count && dither == VCE_DITHER_ERROR_DIFFUSION; i++) {
+        err_y[i].resize(out_width);
+        err_u[i].resize(uv_width);
+        err_v[i].resize(uv_width);
+        for (int x = 0; x < out_width; x++) {
+            err_y[i][x] = ref_bayer_offset(crop[1] + i, x, shift);
+        }
+        for (int x = 0; x < uv_width; x++) {
+            err_u[i][x] = ref_bayer_offset(uv_start + i,     x, shift);
+            err_v[i][x] = ref_bayer_offset(uv_start + i + 4, x, shift);
+        }
+    }
+    int dummy_error = 0;
+    for (int y = crop[1]; y < height - crop[3]; y++) {
+        const uint16_t *src_ptr = (const uint16_t *)ref_line(src[0], src_y_pitch_byte, y) + crop[0];
+        uint8_t *dst_ptr = ref_line(dst[0], dst_y_pitch_byte, y - crop[1]);
+        const int field = (interlaced) ? (y & 1) : 0;
+        const int row = ref_bayer_row(y, interlaced);
+        for (int x = 0; x < out_width; x++) {
+            int *error = (dither == VCE_DITHER_ERROR_DIFFUSION) ? &err_y[field][x] : &dummy_error;
+            dst_ptr[x] = quantize(src_ptr[x], ref_bayer_offset(row, x, shift), error);
+        }
+    }
+    for (int cy = uv_start; cy < uv_fin; cy++) {
+        const uint16_t *src_u = (const uint16_t *)ref_line(src[1], src_uv_pitch_byte, cy) + (crop[0] >> 1);
+        const uint16_t *src_v = (const uint16_t *)ref_line(src[2], src_uv_pitch_byte, cy) + (crop[0] >> 1);
+        uint8_t *dst_ptr = ref_line(dst[1], dst_y_pitch_byte, cy - uv_start);
+        const int field = (interlaced) ? (cy & 1) : 0;
+        //U, Vで同じパターンにならないよう、Vは4ラインずらす
+        const int row = ref_bayer_row(cy, interlaced);
+        for (int x = 0; x < uv_width; x++) {
+            int *error_u = (dither == VCE_DITHER_ERROR_DIFFUSION) ? &err_u[field][x] : &dummy_error;
+            int *error_v = (dither == VCE_DITHER_ERROR_DIFFUSION) ? &err_v[field][x] : &dummy_error;
+            dst_ptr[x * 2 + 0] = quantize(src_u[x], ref_bayer_offset(row,     x, shift), error_u);
+            dst_ptr[x * 2 + 1] = quantize(src_v[x], ref_bayer_offset(row + 4, x, shift), error_v);
+        }
+    }
+}
+
+//高ビット深度のyv12 -> 上位ビット詰めの16bit (P010)
+template<int in_bit_depth>
+static void convert_yv12_high_to_p010_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int shift = 16 - in_bit_depth;
+    const int out_width = width - crop[0] - crop[2];
+    const int uv_start = crop[1] >> 1;
+    const int uv_fin = (height - crop[3]) >> 1;
+    for (int y = crop[1]; y < height - crop[3]; y++) {
+        const uint16_t *src_ptr = (const uint16_t *)ref_line(src[0], src_y_pitch_byte, y) + crop[0];
+        uint16_t *dst_ptr = (uint16_t *)ref_line(dst[0], dst_y_pitch_byte, y - crop[1]);
+        for (int x = 0; x < out_width; x++) {
+            dst_ptr[x] = (uint16_t)(src_ptr[x] << shift);
+        }
+    }
+    for (int cy = uv_start; cy < uv_fin; cy++) {
+        const uint16_t *src_u = (const uint16_t *)ref_line(src[1], src_uv_pitch_byte, cy) + (crop[0] >> 1);
+        const uint16_t *src_v = (const uint16_t *)ref_line(src[2], src_uv_pitch_byte, cy) + (crop[0] >> 1);
+        uint16_t *dst_ptr = (uint16_t *)ref_line(dst[1], dst_y_pitch_byte, cy - uv_start);
+        for (int x = 0; x < (out_width >> 1); x++) {
+            dst_ptr[x * 2 + 0] = (uint16_t)(src_u[x] << shift);
+            dst_ptr[x * 2 + 1] = (uint16_t)(src_v[x] << shift);
+        }
+    }
+}
+
+template<int in_bit_depth>
+static inline int ref_pixel(const uint8_t *line, int x) {
+    return (in_bit_depth > 8) ? ((const uint16_t *)line)[x] : line[x];
+}
+
+//yuv444 -> nv12
+//色差は水平方向に[1,2,1]のフィルタ(色差位置は左寄せ、左端は先頭の画素で補う)をかけてから縦方向に縮小する
+//12bit以上の入力は、SIMD版と同じく11bitに落としてからフィルタをかける
+template<int in_bit_depth, bool interlaced>
+static void convert_yuv444_to_nv12_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int src_pixel_byte = (in_bit_depth > 8) ? 2 : 1;
+    const int pre_shift = (in_bit_depth > 11) ? in_bit_depth - 11 : 0;
+    const int eff_bit_depth = in_bit_depth - pre_shift;
+    const int out_width  = width  - crop[0] - crop[2];
+    const int out_height = height - crop[1] - crop[3];
+    for (int y = 0; y < out_height; y++) {
+        const uint8_t *src_ptr = ref_line(src[0], src_y_pitch_byte, crop[1] + y) + crop[0] * src_pixel_byte;
+        uint8_t *dst_ptr = ref_line(dst[0], dst_y_pitch_byte, y);
+        for (int x = 0; x < out_width; x++) {
+            dst_ptr[x] = ref_clamp_u8(ref_pixel<in_bit_depth>(src_ptr, x) >> (in_bit_depth - 8));
+        }
+    }
+    auto h_filter = [=](const uint8_t *line, int cx) {
+        const int left = (cx) ? ref_pixel<in_bit_depth>(line, cx * 2 - 1) : ref_pixel<in_bit_depth>(line, 0);
+        return ((ref_pixel<in_bit_depth>(line, cx * 2) >> pre_shift) << 1)
+            + (ref_pixel<in_bit_depth>(line, cx * 2 + 1) >> pre_shift)
+            + (left >> pre_shift);
+    };
+    for (int cy = 0; cy < (out_height >> 1); cy++) {
+        const auto lines = ref_chroma_lines(cy, interlaced);
+        //水平フィルタの重みの和(4)と縦方向の重みの和、入力のビット深度の分を落とす
+        const int uv_shift = lines.shift + 2 + eff_bit_depth - 8;
+        uint8_t *dst_ptr = ref_line(dst[1], dst_y_pitch_byte, cy);
+        for (int iplane = 0; iplane < 2; iplane++) {
+            const uint8_t *src0 = ref_line(src[1 + iplane], src_uv_pitch_byte, crop[1] + lines.line[0]) + crop[0] * src_pixel_byte;
+            const uint8_t *src1 = ref_line(src[1 + iplane], src_uv_pitch_byte, crop[1] + lines.line[1]) + crop[0] * src_pixel_byte;
+            for (int cx = 0; cx < (out_width >> 1); cx++) {
+                const int sum = h_filter(src0, cx) * lines.weight[0] + h_filter(src1, cx) * lines.weight[1];
+                dst_ptr[cx * 2 + iplane] = ref_clamp_u8((sum + (1 << (uv_shift - 1))) >> uv_shift);
+            }
+        }
+    }
+}
+
+template<int pixel_byte>
+static void convert_yuv444_to_yuv444_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int line_byte = (width - crop[0] - crop[2]) * pixel_byte;
+    for (int i = 0; i < 3; i++) {
+        const int src_pitch_byte = (i) ? src_uv_pitch_byte : src_y_pitch_byte;
+        ref_copy_plane(dst[i], dst_y_pitch_byte, ref_line(src[i], src_pitch_byte, crop[1]) + crop[0] * pixel_byte, src_pitch_byte, line_byte, height - crop[1] - crop[3]);
+    }
+}
+
+//x番目の画素のR, G, Bを読み込む (BGR48は12bitにする)
+template<int pixel_byte>
+static inline void ref_rgb_pixel(const uint8_t *line, int x, int rgb[3]) {
+    if (pixel_byte == 6) {
+        const uint16_t *ptr = (const uint16_t *)line + x * 3;
+        rgb[0] = ptr[2] >> 4;
+        rgb[1] = ptr[1] >> 4;
+        rgb[2] = ptr[0] >> 4;
+    } else {
+        const uint8_t *ptr = line + x * pixel_byte;
+        rgb[0] = ptr[2];
+        rgb[1] = ptr[1];
+        rgb[2] = ptr[0];
+    }
+}
+
+//coef[0-2]をR, G, Bの係数、coef[3]をオフセットとして、shiftビットの固定小数点から変換する
+static inline uint8_t ref_rgb_to_yuv(const int rgb[3], const int *coef, int shift) {
+    const int value = coef[0] * rgb[0] + coef[1] * rgb[1] + coef[2] * rgb[2] + (coef[3] << shift) + (1 << (shift - 1));
+    return ref_clamp_u8(value >> shift);
+}
+
+//RGB -> nv12 (色差は2x2の画素の重み付き平均から計算する)
+template<int pixel_byte, bool interlaced>
+static void convert_rgb_to_nv12_ref(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int in_bit_depth = (pixel_byte == 6) ? 12 : 8;
+    const int y_shift = 14 + in_bit_depth - 8;
+    const int *coef = get_convert_csp_rgb_coef();
+    const int out_width  = width  - crop[0] - crop[2];
+    const int out_height = height - crop[1] - crop[3];
+    const uint8_t *srcFrame = ref_line(src[0], src_y_pitch_byte, crop[1]) + crop[0] * pixel_byte;
+    for (int y = 0; y < out_height; y++) {
+        const uint8_t *src_ptr = ref_line(srcFrame, src_y_pitch_byte, y);
+        uint8_t *dst_ptr = ref_line(dst[0], dst_y_pitch_byte, y);
+        for (int x = 0; x < out_width; x++) {
+            int rgb[3];
+            ref_rgb_pixel<pixel_byte>(src_ptr, x, rgb);
+            dst_ptr[x] = ref_rgb_to_yuv(rgb, coef, y_shift);
+        }
+    }
+    for (int cy = 0; cy < (out_height >> 1); cy++) {
+        const auto lines = ref_chroma_lines(cy, interlaced);
+        //横2画素の和の分も落とす
+        const int uv_shift = y_shift + lines.shift + 1;
+        const uint8_t *src0 = ref_line(srcFrame, src_y_pitch_byte, lines.line[0]);
+        const uint8_t *src1 = ref_line(srcFrame, src_y_pitch_byte, lines.line[1]);
+        uint8_t *dst_ptr = ref_line(dst[1], dst_y_pitch_byte, cy);
+        for (int cx = 0; cx < (out_width >> 1); cx++) {
+            int sum[3] = { 0 };
+            for (int x = cx * 2; x < cx * 2 + 2; x++) {
+                int rgb0[3], rgb1[3];
+                ref_rgb_pixel<pixel_byte>(src0, x, rgb0);
+                ref_rgb_pixel<pixel_byte>(src1, x, rgb1);
+                for (int i = 0; i < 3; i++) {
+                    sum[i] += rgb0[i] * lines.weight[0] + rgb1[i] * lines.weight[1];
+                }
+            }
+            dst_ptr[cx * 2 + 0] = ref_rgb_to_yuv(sum, coef + 4, uv_shift);
+            dst_ptr[cx * 2 + 1] = ref_rgb_to_yuv(sum, coef + 8, uv_shift);
+        }
+    }
+}
+
+template<int in_bit_depth>
+static funcConvertCSP get_yv12_high_ref_func(VCE_CSP csp_to, VCE_DITHER dither, bool interlaced) {
+    if (csp_to == VCE_CSP_P010) {
+        return convert_yv12_high_to_p010_ref<in_bit_depth>;
+    }
+    if (csp_to != VCE_CSP_NV12) {
+        return nullptr;
+    }
+    switch (dither) {
+    case VCE_DITHER_ORDERED:
+        return (interlaced) ? convert_yv12_high_to_nv12_ref<in_bit_depth, VCE_DITHER_ORDERED, true>
+                            : convert_yv12_high_to_nv12_ref<in_bit_depth, VCE_DITHER_ORDERED, false>;
+    case VCE_DITHER_ERROR_DIFFUSION:
+        return (interlaced) ? convert_yv12_high_to_nv12_ref<in_bit_depth, VCE_DITHER_ERROR_DIFFUSION, true>
+                            : convert_yv12_high_to_nv12_ref<in_bit_depth, VCE_DITHER_ERROR_DIFFUSION, false>;
+    default:
+        //ディザなしはインタレでも同じ
+        return convert_yv12_high_to_nv12_ref<in_bit_depth, VCE_DITHER_NONE, false>;
+    }
+}
+
+template<int in_bit_depth>
+static funcConvertCSP get_yuv444_ref_func(VCE_CSP csp_from, VCE_CSP csp_to, bool interlaced) {
+    if (csp_to == csp_from) {
+        return convert_yuv444_to_yuv444_ref<(in_bit_depth > 8) ? 2 : 1>;
+    }
+    if (csp_to != VCE_CSP_NV12) {
+        return nullptr;
+    }
+    return (interlaced) ? convert_yuv444_to_nv12_ref<in_bit_depth, true> : convert_yuv444_to_nv12_ref<in_bit_depth, false>;
+}
+
+template<int pixel_byte>
+static funcConvertCSP get_rgb_ref_func(VCE_CSP csp_to, bool interlaced) {
+    if (csp_to != VCE_CSP_NV12) {
+        return nullptr;
+    }
+    return (interlaced) ? convert_rgb_to_nv12_ref<pixel_byte, true> : convert_rgb_to_nv12_ref<pixel_byte, false>;
+}
+
+funcConvertCSP get_convert_csp_ref_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only, VCE_DITHER dither, int interlaced) {
+    //uv_onlyの変換関数は登録されていない
+    if (uv_only) {
+        return nullptr;
+    }
+    const bool bInterlaced = interlaced != 0;
+    switch (csp_from) {
+    case VCE_CSP_YUY2:
+        if (csp_to != VCE_CSP_NV12) return nullptr;
+        return (bInterlaced) ? convert_yuy2_to_nv12_ref<true> : convert_yuy2_to_nv12_ref<false>;
+    case VCE_CSP_NV12:
+        return (csp_to == VCE_CSP_NV12) ? convert_nv12_to_nv12_ref : nullptr;
+    case VCE_CSP_YV12:
+        return (csp_to == VCE_CSP_NV12) ? convert_yv12_to_nv12_ref : nullptr;
+    case VCE_CSP_YV12_09:    return get_yv12_high_ref_func<9>(csp_to, dither, bInterlaced);
+    case VCE_CSP_YV12_10:    return get_yv12_high_ref_func<10>(csp_to, dither, bInterlaced);
+    case VCE_CSP_YV12_12:    return get_yv12_high_ref_func<12>(csp_to, dither, bInterlaced);
+    case VCE_CSP_YV12_14:    return get_yv12_high_ref_func<14>(csp_to, dither, bInterlaced);
+    case VCE_CSP_YV12_16:    return get_yv12_high_ref_func<16>(csp_to, dither, bInterlaced);
+    case VCE_CSP_YUV444:     return get_yuv444_ref_func<8>(csp_from, csp_to, bInterlaced);
+    case VCE_CSP_YUV444_09:  return get_yuv444_ref_func<9>(csp_from, csp_to, bInterlaced);
+    case VCE_CSP_YUV444_10:  return get_yuv444_ref_func<10>(csp_from, csp_to, bInterlaced);
+    case VCE_CSP_YUV444_12:  return get_yuv444_ref_func<12>(csp_from, csp_to, bInterlaced);
+    case VCE_CSP_YUV444_14:  return get_yuv444_ref_func<14>(csp_from, csp_to, bInterlaced);
+    case VCE_CSP_YUV444_16:  return get_yuv444_ref_func<16>(csp_from, csp_to, bInterlaced);
+    case VCE_CSP_BGRA:       return get_rgb_ref_func<4>(csp_to, bInterlaced);
+    case VCE_CSP_BGR24:      return get_rgb_ref_func<3>(csp_to, bInterlaced);
+    case VCE_CSP_BGR48:      return get_rgb_ref_func<6>(csp_to, bInterlaced);
+    default:
+        return nullptr;
+    }
+}
+
+#ifdef _MSC_VER
+#pragma warning (pop)
+#endif //#ifdef _MSC_VER
@@ -0,0 +1,46 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+
+#ifndef _CONVERT_CSP_REF_H_
+#define _CONVERT_CSP_REF_H_
+
+#include "ConvertCsp.h"
+
+//SIMDを使用せず1画素ずつ計算する、変換関数の基準となる実装
+//funcListの関数と同じ入出力の仕様で、結果がビット単位で一致する
+//convert_csp_checkでの正しさの確認と、convert_csp_benchmarkでの速度比の基準に使用する
+
+//(csp_from, csp_to, uv_only, dither, interlaced)の組み合わせに対応する基準の関数を返す (対応するものがなければnullptr)
+funcConvertCSP get_convert_csp_ref_func(VCE_CSP csp_from, VCE_CSP csp_to, bool uv_only, VCE_DITHER dither, int interlaced);
+
+//convertと同じ変換を行う基準の関数を返す
+static inline funcConvertCSP get_convert_csp_ref_func(const ConvertCSP *convert, int interlaced) {
+    return get_convert_csp_ref_func(convert->csp_from, convert->csp_to, convert->uv_only, convert->dither, interlaced);
+}
+
+#endif //_CONVERT_CSP_REF_H_
@@ -0,0 +1,327 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <emmintrin.h>
+#include "ConvertCspResize.h"
+
+//出力をこのライン数ずつ処理する (入力を変換したバッファがキャッシュに収まる程度にする)
+static const int RESIZE_STRIP_LINES = 16;
+
+static double resize_filter_radius(VCE_RESIZE_ALGO algo) {
+    switch (algo) {
+    case VCE_RESIZE_LANCZOS3: return 3.0;
+    case VCE_RESIZE_BICUBIC:  return 2.0;
+    case VCE_RESIZE_BILINEAR:
+    default:                  return 1.0;
+    }
+}
+
+static double resize_filter_weight(VCE_RESIZE_ALGO algo, double x) {
+    x = std::abs(x);
+    switch (algo) {
+    case VCE_RESIZE_LANCZOS3:
+        if (x < 1e-8) {
+            return 1.0;
+        } else if (x < 3.0) {
+            const double pi = 3.14159265358979323846;
+            return 3.0 * std::sin(pi * x) * std::sin(pi * x / 3.0) / (pi * pi * x * x);
+        }
+        return 0.0;
+    case VCE_RESIZE_BICUBIC: {
+        //Catmull-Rom (a = -0.5)
+        const double a = -0.5;
+        if (x < 1.0) {
+            return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+        } else if (x < 2.0) {
+            return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+        }
+        return 0.0;
+    }
+    case VCE_RESIZE_BILINEAR:
+    default:
+        return (x < 1.0) ? 1.0 - x : 0.0;
+    }
+}
+
+void resize_table_create(ResizeTable *table, VCE_RESIZE_ALGO algo, int src_size, int dst_size, double shift, int tap_align) {
+    const double scale = src_size / (double)dst_size;
+    //縮小時はフィルタの幅を広げて、エイリアシングを抑える
+    const double filter_scale = (std::max)(1.0, scale);
+    const double support = resize_filter_radius(algo) * filter_scale;
+    const int filter_taps = (int)std::ceil(support) * 2;
+    const int taps = (filter_taps + tap_align - 1) / tap_align * tap_align;
+    table->taps = taps;
+    table->start.resize(dst_size);
+    table->coef.assign((size_t)dst_size * taps, 0);
+    std::vector<double> weight(taps);
+    for (int i = 0; i < dst_size; i++) {
+        const double center = (i + 0.5) * scale - 0.5 + shift;
+        const int first = (int)std::floor(center - support) + 1;
+        const int start = clamp(first, 0, (std::max)(0, src_size - taps));
+        std::fill(weight.begin(), weight.end(), 0.0);
+        double weight_sum = 0.0;
+        for (int k = 0; k < filter_taps; k++) {
+            const double w = resize_filter_weight(algo, (first + k - center) / filter_scale);
+            //画面外を参照する分は端の画素に畳み込む
+            const int pos = clamp(first + k, 0, src_size - 1);
+            weight[pos - start] += w;
+            weight_sum += w;
+        }
+        //合計が1<<RESIZE_COEF_BITSになるよう正規化し、丸め誤差は絶対値最大の係数で吸収する
+        int16_t *coef = &table->coef[(size_t)i * taps];
+        int coef_sum = 0;
+        int max_idx = 0;
+        for (int k = 0; k < taps; k++) {
+            coef[k] = (int16_t)std::lround(weight[k] / weight_sum * (1 << RESIZE_COEF_BITS));
+            coef_sum += coef[k];
+            if (std::abs(weight[k]) > std::abs(weight[max_idx])) {
+                max_idx = k;
+            }
+        }
+        coef[max_idx] = (int16_t)(coef[max_idx] + (1 << RESIZE_COEF_BITS) - coef_sum);
+        table->start[i] = start;
+    }
+}
+
+void resize_v_line_sse2(int16_t **dst, const uint8_t **src, const int16_t *coef, int taps, int width_byte, bool uv_deinterleave) {
+    const __m128i xRound = _mm_set1_epi32(1 << (RESIZE_COEF_BITS - RESIZE_TMP_BITS - 1));
+    const __m128i xZero = _mm_setzero_si128();
+    for (int x = 0; x < width_byte; x += 16) {
+        __m128i y0 = xRound, y1 = xRound, y2 = xRound, y3 = xRound;
+        for (int k = 0; k < taps; k += 2) {
+            //2ライン分の画素と係数を交互に並べ、pmaddwdで2ライン分をまとめて処理する
+            const __m128i xCoef = _mm_set1_epi32((int)((uint32_t)(uint16_t)coef[k] | ((uint32_t)(uint16_t)coef[k+1] << 16)));
+            __m128i x0 = _mm_loadu_si128((const __m128i *)(src[k+0] + x));
+            __m128i x1 = _mm_loadu_si128((const __m128i *)(src[k+1] + x));
+            __m128i x0Lo = _mm_unpacklo_epi8(x0, xZero);
+            __m128i x0Hi = _mm_unpackhi_epi8(x0, xZero);
+            __m128i x1Lo = _mm_unpacklo_epi8(x1, xZero);
+            __m128i x1Hi = _mm_unpackhi_epi8(x1, xZero);
+            y0 = _mm_add_epi32(y0, _mm_madd_epi16(_mm_unpacklo_epi16(x0Lo, x1Lo), xCoef));
+            y1 = _mm_add_epi32(y1, _mm_madd_epi16(_mm_unpackhi_epi16(x0Lo, x1Lo), xCoef));
+            y2 = _mm_add_epi32(y2, _mm_madd_epi16(_mm_unpacklo_epi16(x0Hi, x1Hi), xCoef));
+            y3 = _mm_add_epi32(y3, _mm_madd_epi16(_mm_unpackhi_epi16(x0Hi, x1Hi), xCoef));
+        }
+        y0 = _mm_srai_epi32(y0, RESIZE_COEF_BITS - RESIZE_TMP_BITS);
+        y1 = _mm_srai_epi32(y1, RESIZE_COEF_BITS - RESIZE_TMP_BITS);
+        y2 = _mm_srai_epi32(y2, RESIZE_COEF_BITS - RESIZE_TMP_BITS);
+        y3 = _mm_srai_epi32(y3, RESIZE_COEF_BITS - RESIZE_TMP_BITS);
+        __m128i z0 = _mm_packs_epi32(y0, y1);
+        __m128i z1 = _mm_packs_epi32(y2, y3);
+        if (uv_deinterleave) {
+            //32bitごとに下位16bitがU、上位16bitがV
+            __m128i zU = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(z0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(z1, 16), 16));
+            __m128i zV = _mm_packs_epi32(_mm_srai_epi32(z0, 16), _mm_srai_epi32(z1, 16));
+            _mm_storeu_si128((__m128i *)(dst[0] + (x >> 1)), zU);
+            _mm_storeu_si128((__m128i *)(dst[1] + (x >> 1)), zV);
+        } else {
+            _mm_storeu_si128((__m128i *)(dst[0] + x + 0), z0);
+            _mm_storeu_si128((__m128i *)(dst[0] + x + 8), z1);
+        }
+    }
+}
+
+static __forceinline uint8_t resize_h_1px(const int16_t *src, const int16_t *coef, int taps) {
+    int sum = 1 << (RESIZE_COEF_BITS + RESIZE_TMP_BITS - 1);
+    for (int k = 0; k < taps; k++) {
+        sum += src[k] * coef[k];
+    }
+    sum >>= (RESIZE_COEF_BITS + RESIZE_TMP_BITS);
+    return (uint8_t)clamp(sum, 0, 255);
+}
+
+//出力の8画素分を計算し、int16で返す
+static __forceinline __m128i resize_h_8px_sse2(const int16_t *src, const int *start, const int16_t *coef, int taps) {
+    const __m128i xRound = _mm_set1_epi32(1 << (RESIZE_COEF_BITS + RESIZE_TMP_BITS - 1));
+    __m128i xSum[2];
+    for (int j = 0; j < 2; j++) {
+        __m128i xAcc[4];
+        for (int i = 0; i < 4; i++) {
+            const int16_t *ptr_src = src + start[j * 4 + i];
+            const int16_t *ptr_coef = coef + (j * 4 + i) * taps;
+            __m128i x0 = _mm_setzero_si128();
+            for (int k = 0; k < taps; k += 8) {
+                x0 = _mm_add_epi32(x0, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(ptr_src + k)), _mm_loadu_si128((const __m128i *)(ptr_coef + k))));
+            }
+            xAcc[i] = x0;
+        }
+        //4画素分の部分和をそれぞれ水平加算して、1つのレジスタにまとめる
+        __m128i x0 = _mm_add_epi32(_mm_unpacklo_epi32(xAcc[0], xAcc[1]), _mm_unpackhi_epi32(xAcc[0], xAcc[1]));
+        __m128i x1 = _mm_add_epi32(_mm_unpacklo_epi32(xAcc[2], xAcc[3]), _mm_unpackhi_epi32(xAcc[2], xAcc[3]));
+        x0 = _mm_add_epi32(_mm_unpacklo_epi64(x0, x1), _mm_unpackhi_epi64(x0, x1));
+        xSum[j] = _mm_srai_epi32(_mm_add_epi32(x0, xRound), RESIZE_COEF_BITS + RESIZE_TMP_BITS);
+    }
+    return _mm_packs_epi32(xSum[0], xSum[1]);
+}
+
+void resize_h_line_sse2(uint8_t *dst, const int16_t *src, const int16_t *src_v, const ResizeTable *table, int dst_width) {
+    const int taps = table->taps;
+    const int *start = table->start.data();
+    const int16_t *coef = table->coef.data();
+    int x = 0;
+    for (; x <= dst_width - 8; x += 8) {
+        __m128i x0 = resize_h_8px_sse2(src, start + x, coef + x * taps, taps);
+        if (src_v) {
+            __m128i x1 = resize_h_8px_sse2(src_v, start + x, coef + x * taps, taps);
+            x0 = _mm_packus_epi16(x0, x0);
+            x1 = _mm_packus_epi16(x1, x1);
+            _mm_storeu_si128((__m128i *)(dst + x * 2), _mm_unpacklo_epi8(x0, x1));
+        } else {
+            _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(x0, x0));
+        }
+    }
+    for (; x < dst_width; x++) {
+        if (src_v) {
+            dst[x * 2 + 0] = resize_h_1px(src   + start[x], coef + x * taps, taps);
+            dst[x * 2 + 1] = resize_h_1px(src_v + start[x], coef + x * taps, taps);
+        } else {
+            dst[x] = resize_h_1px(src + start[x], coef + x * taps, taps);
+        }
+    }
+}
+
+ConvertCSPResize::ConvertCSPResize() :
+    ConvertCSPThread(),
+    m_nAlgo(VCE_RESIZE_BILINEAR),
+    m_nSrcWidth(0),
+    m_nSrcHeight(0),
+    m_nDstWidth(0),
+    m_nDstHeight(0),
+    m_tableYH(),
+    m_tableYV(),
+    m_tableCH(),
+    m_tableCV(),
+    m_nStripPitch(0),
+    m_nStripHeight(0),
+    m_nTmpPitch(0),
+    m_buffer() {
+}
+
+ConvertCSPResize::~ConvertCSPResize() {
+    //作業用バッファを解放する前にスレッドを止める
+    close();
+}
+
+int ConvertCSPResize::init(const ConvertCSP *convert, VCE_RESIZE_ALGO algo, int nThreads, int width, int height, int dstWidth, int dstHeight) {
+    m_nAlgo = algo;
+    m_nSrcWidth = width;
+    m_nSrcHeight = height;
+    m_nDstWidth = dstWidth;
+    m_nDstHeight = dstHeight;
+
+    //色差は横方向は左端(輝度の偶数画素と同じ位置)、縦方向は2ラインの中間に配置されているとする
+    //横方向は色差の座標系で中央揃えにした場合とのずれを補正する
+    const double scale_x = width / (double)dstWidth;
+    resize_table_create(&m_tableYH, algo, width,      dstWidth,      0.0,                    8);
+    resize_table_create(&m_tableYV, algo, height,     dstHeight,     0.0,                    2);
+    resize_table_create(&m_tableCH, algo, width >> 1, dstWidth >> 1, 0.25 * (1.0 - scale_x), 8);
+    resize_table_create(&m_tableCV, algo, height >> 1, dstHeight >> 1, 0.0,                  2);
+
+    //1回に変換する入力のライン数の最大値を求めておく
+    m_nStripHeight = 0;
+    for (int y = 0; y < dstHeight; y += 2) {
+        int src_y_start = 0, src_y_end = 0;
+        getSrcRange(y, (std::min)(y + RESIZE_STRIP_LINES, dstHeight), 1, &src_y_start, &src_y_end);
+        m_nStripHeight = (std::max)(m_nStripHeight, src_y_end - src_y_start);
+    }
+    //SIMDで端数を処理する際のはみ出し分を確保しておく
+    m_nStripPitch = ALIGN(width, 64) + 64;
+    m_nTmpPitch = ALIGN(width, 16) + (std::max)(m_tableYH.taps, m_tableCH.taps) + 16;
+
+    const int nThreadCount = ConvertCSPThread::init(convert, nThreads, (std::max)(width, dstWidth), (std::max)(height, dstHeight));
+    m_buffer.clear();
+    m_buffer.resize(nThreadCount);
+    for (auto& buf : m_buffer) {
+        const size_t strip_size = (size_t)m_nStripPitch * (m_nStripHeight * 3 / 2 + 1);
+        const size_t tmp_size = sizeof(int16_t) * m_nTmpPitch * 3;
+        buf.pStrip.reset((uint8_t *)_aligned_malloc(strip_size, 64));
+        buf.pTmp.reset((int16_t *)_aligned_malloc(tmp_size, 64));
+        memset(buf.pStrip.get(), 0, strip_size);
+        memset(buf.pTmp.get(), 0, tmp_size);
+        buf.lines.resize((std::max)(m_tableYV.taps, m_tableCV.taps));
+    }
+    return nThreadCount;
+}
+
+void ConvertCSPResize::getSrcRange(int dst_y_start, int dst_y_end, int interlaced, int *src_y_start, int *src_y_end) const {
+    const int y_unit = (interlaced) ? 4 : 2;
+    const int luma_start   = m_tableYV.start[dst_y_start];
+    const int luma_end     = m_tableYV.start[dst_y_end - 1] + m_tableYV.taps;
+    const int chroma_start = m_tableCV.start[dst_y_start >> 1] * 2;
+    const int chroma_end   = (m_tableCV.start[(dst_y_end >> 1) - 1] + m_tableCV.taps) * 2;
+    *src_y_start = (std::min)(luma_start, chroma_start) / y_unit * y_unit;
+    *src_y_end   = (std::min)(m_nSrcHeight, ((std::max)(luma_end, chroma_end) + y_unit - 1) / y_unit * y_unit);
+}
+
+void ConvertCSPResize::convertBand(int band) {
+    //出力を色差のライン単位(2ライン)で分割する
+    const int unit_count = m_nDstHeight >> 1;
+    const int y_start = unit_count * band / m_nThreads * 2;
+    const int y_end   = unit_count * (band + 1) / m_nThreads * 2;
+    auto& buf = m_buffer[band];
+    uint8_t *ptr_strip_y  = buf.pStrip.get();
+    uint8_t *ptr_strip_uv = ptr_strip_y + m_nStripPitch * m_nStripHeight;
+    int16_t *ptr_tmp[3] = { buf.pTmp.get(), buf.pTmp.get() + m_nTmpPitch, buf.pTmp.get() + m_nTmpPitch * 2 };
+    const int *crop = m_prm.crop;
+    for (int y = y_start; y < y_end; y += RESIZE_STRIP_LINES) {
+        const int y_fin = (std::min)(y + RESIZE_STRIP_LINES, y_end);
+        int src_y_start = 0, src_y_end = 0;
+        getSrcRange(y, y_fin, m_prm.interlaced, &src_y_start, &src_y_end);
+
+        //必要な範囲の入力のみをNV12に変換する
+        int crop_strip[4] = { crop[0], crop[1] + src_y_start, crop[2], m_prm.height - crop[1] - src_y_end };
+        void *dst_strip[3] = { ptr_strip_y, ptr_strip_uv, nullptr };
+        m_pConvert->func[!!m_prm.interlaced](dst_strip, m_prm.src, m_prm.width, m_prm.src_y_pitch_byte, m_prm.src_uv_pitch_byte,
+            m_nStripPitch, m_prm.height, m_nStripHeight, crop_strip);
+
+        //輝度
+        for (int iy = y; iy < y_fin; iy++) {
+            const int taps = m_tableYV.taps;
+            const int start = m_tableYV.start[iy];
+            for (int k = 0; k < taps; k++) {
+                const int sy = clamp(start + k, 0, m_nSrcHeight - 1);
+                buf.lines[k] = ptr_strip_y + (sy - src_y_start) * m_nStripPitch;
+            }
+            resize_v_line_sse2(ptr_tmp, buf.lines.data(), &m_tableYV.coef[iy * taps], taps, m_nSrcWidth, false);
+            resize_h_line_sse2((uint8_t *)m_prm.dst[0] + iy * m_prm.dst_y_pitch_byte, ptr_tmp[0], nullptr, &m_tableYH, m_nDstWidth);
+        }
+        //色差
+        for (int iy = y >> 1; iy < (y_fin >> 1); iy++) {
+            const int taps = m_tableCV.taps;
+            const int start = m_tableCV.start[iy];
+            for (int k = 0; k < taps; k++) {
+                const int sy = clamp(start + k, 0, (m_nSrcHeight >> 1) - 1);
+                buf.lines[k] = ptr_strip_uv + (sy - (src_y_start >> 1)) * m_nStripPitch;
+            }
+            resize_v_line_sse2(ptr_tmp + 1, buf.lines.data(), &m_tableCV.coef[iy * taps], taps, m_nSrcWidth, true);
+            resize_h_line_sse2((uint8_t *)m_prm.dst[1] + iy * m_prm.dst_y_pitch_byte, ptr_tmp[1], ptr_tmp[2], &m_tableCH, m_nDstWidth >> 1);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#ifndef _CONVERT_CSP_RESIZE_H_
+#define _CONVERT_CSP_RESIZE_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "ConvertCspThread.h"
+#include "VCEUtil.h"
+
+//リサイズの係数の固定小数点の精度
+static const int RESIZE_COEF_BITS = 14;
+//縦方向の処理後の中間値の小数部のビット数
+static const int RESIZE_TMP_BITS = 6;
+
+//1方向のリサイズの係数テーブル
+//出力のi番目の画素は、入力のstart[i]からtaps個の画素にcoef[i*taps+k]をかけて足し合わせたもの
+//画面端の外側を参照する分は端の画素に畳み込んであり、tapsへのパディング分の係数は0
+struct ResizeTable {
+    int taps;
+    std::vector<int> start;
+    std::vector<int16_t> coef;
+};
+
+//src_sizeからdst_sizeへリサイズする係数テーブルを作成する
+//shiftは入力側の座標のずれ (色差の配置の補正用)、tapsはtap_alignの倍数に切り上げる
+void resize_table_create(ResizeTable *table, VCE_RESIZE_ALGO algo, int src_size, int dst_size, double shift, int tap_align);
+
+//縦方向のリサイズ: srcの各ラインにcoefをかけて足し合わせ、RESIZE_TMP_BITSの小数部を持つint16で出力する
+//uv_deinterleaveの場合、NV12の色差のラインとして扱い、dst[0]にU、dst[1]にVを分けて出力する
+void resize_v_line_sse2(int16_t **dst, const uint8_t **src, const int16_t *coef, int taps, int width_byte, bool uv_deinterleave);
+//横方向のリサイズ: resize_v_line_sse2の出力から、dst_width画素を出力する
+//srcはtable->taps+8画素分余分に読むことがあるので、そのぶん確保しておくこと
+//src_vがnullptrでなければ、src(U)とsrc_v(V)をNV12の色差としてインタリーブして出力する
+void resize_h_line_sse2(uint8_t *dst, const int16_t *src, const int16_t *src_v, const ResizeTable *table, int dst_width);
+
+//入力の読み込み(crop) -> 色空間変換(NV12) -> リサイズ を一度に行う
+//入力は出力の数ライン分に必要な範囲ずつキャッシュに収まる程度のバッファに変換し、
+//リサイズした結果を直接出力先(AMFのホストメモリのサーフェス)に書き込む
+//フレーム全体の中間バッファを経由しないので、メモリへの書き込みは出力の1回のみとなる
+class ConvertCSPResize : public ConvertCSPThread {
+public:
+    ConvertCSPResize();
+    virtual ~ConvertCSPResize();
+
+    //width, heightはcrop後の入力のサイズ、convert->csp_toはNV12であること
+    int init(const ConvertCSP *convert, VCE_RESIZE_ALGO algo, int nThreads, int width, int height, int dstWidth, int dstHeight);
+protected:
+    virtual void convertBand(int band) override;
+    //出力の[dst_y_start, dst_y_end)のラインに必要な入力のライン[*src_y_start, *src_y_end)を求める
+    void getSrcRange(int dst_y_start, int dst_y_end, int interlaced, int *src_y_start, int *src_y_end) const;
+
+    //帯ごとの作業用バッファ
+    struct ResizeBuffer {
+        std::unique_ptr<uint8_t, aligned_malloc_deleter> pStrip; //入力を変換したNV12
+        std::unique_ptr<int16_t, aligned_malloc_deleter> pTmp;   //縦方向の処理結果 (Y, U, V)
+        std::vector<const uint8_t *> lines;
+    };
+
+    VCE_RESIZE_ALGO m_nAlgo;
+    int m_nSrcWidth;
+    int m_nSrcHeight;
+    int m_nDstWidth;
+    int m_nDstHeight;
+    ResizeTable m_tableYH; //輝度 横方向
+    ResizeTable m_tableYV; //輝度 縦方向
+    ResizeTable m_tableCH; //色差 横方向
+    ResizeTable m_tableCV; //色差 縦方向
+    int m_nStripPitch;
+    int m_nStripHeight;
+    int m_nTmpPitch;
+    std::vector<ResizeBuffer> m_buffer;
+};
+
+#endif //_CONVERT_CSP_RESIZE_H_
@@ -29,6 +29,8 @@
 #define _CONVERT_CSP_H_
 
 #include <cstdint>
+#include <vector>
+#include "qsv_osdep.h"
 #include <emmintrin.h> //イントリンシック命令 SSE2
 #if USE_SSSE3
 #include <tmmintrin.h> //イントリンシック命令 SSSE3
@@ -37,6 +39,7 @@
 #include <smmintrin.h> //イントリンシック命令 SSE4.1
 #endif
 
+template<bool use_stream>
 static void __forceinline memcpy_sse(uint8_t *dst, const uint8_t *src, int size) {
     if (size < 64) {
         for (int i = 0; i < size; i++)
@@ -53,16 +56,18 @@ static void __forceinline memcpy_sse(uint8_t *dst, const uint8_t *src, int size)
         dst += 16 - start_align_diff;
         src += 16 - start_align_diff;
     }
+#define _mm_stream_switch_ps(ptr, xmm) ((use_stream) ? _mm_stream_ps((ptr), (xmm)) : _mm_store_ps((ptr), (xmm)))
     for ( ; dst < dst_aligned_fin; dst += 64, src += 64) {
         x0 = _mm_loadu_ps((float*)(src +  0));
         x1 = _mm_loadu_ps((float*)(src + 16));
         x2 = _mm_loadu_ps((float*)(src + 32));
         x3 = _mm_loadu_ps((float*)(src + 48));
-        _mm_store_ps((float*)(dst +  0), x0);
-        _mm_store_ps((float*)(dst + 16), x1);
-        _mm_store_ps((float*)(dst + 32), x2);
-        _mm_store_ps((float*)(dst + 48), x3);
+        _mm_stream_switch_ps((float*)(dst +  0), x0);
+        _mm_stream_switch_ps((float*)(dst + 16), x1);
+        _mm_stream_switch_ps((float*)(dst + 32), x2);
+        _mm_stream_switch_ps((float*)(dst + 48), x3);
     }
+#undef _mm_stream_switch_ps
     uint8_t *dst_tmp = dst_fin - 64;
     src -= (dst - dst_tmp);
     x0 = _mm_loadu_ps((float*)(src +  0));
@@ -76,6 +81,8 @@ static void __forceinline memcpy_sse(uint8_t *dst, const uint8_t *src, int size)
 }
 
 #define _mm_store_switch_si128(ptr, xmm) ((aligned_store) ? _mm_store_si128(ptr, xmm) : _mm_storeu_si128(ptr, xmm))
+//use_streamなら出力先は16byteにアラインされていること
+#define _mm_stream_switch_si128(ptr, xmm) ((use_stream) ? _mm_stream_si128(ptr, xmm) : _mm_storeu_si128(ptr, xmm))
 
 #if USE_SSSE3
 #define _mm_alignr_epi8_simd(a,b,i) _mm_alignr_epi8(a,b,i)
@@ -131,12 +138,15 @@ static __forceinline void separate_low_up(__m128i& x0_return_lower, __m128i& x1_
     x1_return_upper = _mm_packus_epi16(x4, x5);
 }
 
+#pragma warning (push)
+#pragma warning (disable: 4127)
+template<bool use_stream>
 static void __forceinline convert_yuy2_to_nv12_simd(void *dst, const void *src, int width, int src_y_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
     const int crop_right  = crop[2];
     const int crop_bottom = crop[3];
-    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left;
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left * 2; //yuy2は1画素2byte
     uint8_t *dstYLine = (uint8_t *)dst;
     uint8_t *dstCLine = dstYLine + dst_y_pitch_byte * dst_height;
     const int y_fin = height - crop_bottom - crop_up;
@@ -153,7 +163,7 @@ static void __forceinline convert_yuy2_to_nv12_simd(void *dst, const void *src,
             separate_low_up(x0, x1);
             x3 = x1;
 
-            _mm_stream_si128((__m128i *)(dstYLine + x), x0);
+            _mm_stream_switch_si128((__m128i *)(dstYLine + x), x0);
             //-----------1行目終了---------------
 
             //-----------2行目---------------
@@ -162,16 +172,19 @@ static void __forceinline convert_yuy2_to_nv12_simd(void *dst, const void *src,
             
             separate_low_up(x0, x1);
 
-            _mm_stream_si128((__m128i *)(dstYLine + dst_y_pitch_byte + x), x0);
+            _mm_stream_switch_si128((__m128i *)(dstYLine + dst_y_pitch_byte + x), x0);
             //-----------2行目終了---------------
 
             x1 = _mm_avg_epu8(x1, x3);
-            _mm_stream_si128((__m128i *)(dstCLine + x), x1);
+            _mm_stream_switch_si128((__m128i *)(dstCLine + x), x1);
         }
         srcLine  += src_y_pitch_byte << 1;
         dstYLine += dst_y_pitch_byte << 1;
         dstCLine += dst_y_pitch_byte;
     }
+    if (use_stream) {
+        _mm_sfence();
+    }
 }
 
 static __forceinline __m128i yuv422_to_420_i_interpolate(__m128i y_up, __m128i y_down, int i) {
@@ -202,12 +215,13 @@ static __forceinline __m128i yuv422_to_420_i_interpolate(__m128i y_up, __m128i y
     return x0;
 }
 
+template<bool use_stream>
 static void __forceinline convert_yuy2_to_nv12_i_simd(void *dst, const void *src, int width, int src_y_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
     const int crop_right  = crop[2];
     const int crop_bottom = crop[3];
-    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left;
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * crop_up + crop_left * 2; //yuy2は1画素2byte
     uint8_t *dstYLine = (uint8_t *)dst;
     uint8_t *dstCLine = dstYLine + dst_y_pitch_byte * dst_height;
     const int y_fin = height - crop_bottom - crop_up;
@@ -225,7 +239,7 @@ static void __forceinline convert_yuy2_to_nv12_i_simd(void *dst, const void *src
                 separate_low_up(x0, x1);
                 x3 = x1;
 
-                _mm_stream_si128((__m128i *)(dstYLine + x), x0);
+                _mm_stream_switch_si128((__m128i *)(dstYLine + x), x0);
                 //-----------1+i行目終了---------------
 
                 //-----------3+i行目---------------
@@ -234,11 +248,11 @@ static void __forceinline convert_yuy2_to_nv12_i_simd(void *dst, const void *src
 
                 separate_low_up(x0, x1);
 
-                _mm_stream_si128((__m128i *)(dstYLine + (dst_y_pitch_byte<<1) + x), x0);
+                _mm_stream_switch_si128((__m128i *)(dstYLine + (dst_y_pitch_byte<<1) + x), x0);
                 //-----------3+i行目終了---------------
                 x0 = yuv422_to_420_i_interpolate(x3, x1, i);
 
-                _mm_stream_si128((__m128i *)(dstCLine + x), x0);
+                _mm_stream_switch_si128((__m128i *)(dstCLine + x), x0);
             }
             srcLine  += src_y_pitch_byte;
             dstYLine += dst_y_pitch_byte;
@@ -247,12 +261,16 @@ static void __forceinline convert_yuy2_to_nv12_i_simd(void *dst, const void *src
         srcLine  += src_y_pitch_byte << 1;
         dstYLine += dst_y_pitch_byte << 1;
     }
+    if (use_stream) {
+        _mm_sfence();
+    }
 }
+#pragma warning (pop)
 
 #pragma warning (push)
 #pragma warning (disable: 4100)
 #pragma warning (disable: 4127)
-template<bool uv_only>
+template<bool uv_only, bool use_stream>
 static void __forceinline convert_yv12_to_nv12_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
@@ -265,7 +283,7 @@ static void __forceinline convert_yv12_to_nv12_simd(void **dst, const void **src
         const int y_fin = height - crop_bottom;
         const int y_width = width - crop_right - crop_left;
         for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
-            memcpy_sse(dstLine, srcYLine, y_width);
+            memcpy_sse<use_stream>(dstLine, srcYLine, y_width);
         }
     }
     //UV成分のコピー
@@ -286,36 +304,119 @@ static void __forceinline convert_yv12_to_nv12_simd(void **dst, const void **src
             x2 = _mm_unpackhi_epi8(x0, x1);
             x0 = _mm_unpacklo_epi8(x0, x1);
 
-            _mm_storeu_si128((__m128i *)(dst_ptr +  0), x0);
-            _mm_storeu_si128((__m128i *)(dst_ptr + 16), x2);
+            _mm_stream_switch_si128((__m128i *)(dst_ptr +  0), x0);
+            _mm_stream_switch_si128((__m128i *)(dst_ptr + 16), x2);
         }
     }
+    if (use_stream) {
+        _mm_sfence();
+    }
 }
 #pragma warning (pop)
 
-template<int in_bit_depth, bool uv_only>
+//8x8のBayer行列 (0-63)
+static const _declspec(align(16)) uint16_t Array_BAYER8x8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+//y行目のディザのオフセット (0 - (1<<shift)-1) を8画素分返す
+static __forceinline __m128i dither_bayer8x8_offset(int y, int shift) {
+    __m128i x0 = _mm_load_si128((const __m128i *)Array_BAYER8x8[y & 7]);
+    return _mm_srli_epi16(_mm_slli_epi16(x0, shift), 6);
+}
+
+//y行目のディザのパターンの行
+//インタレの場合は各フィールドがそれぞれBayer行列の全行を使うようにし、第2フィールドは4ラインずらす
+static __forceinline int dither_bayer_row(int y, bool interlaced) {
+    return (interlaced) ? (y >> 1) + ((y & 1) << 2) : y;
+}
+
+//誤差拡散用の誤差バッファを初期化する
+//各列が異なる位相から始まるよう、Bayer行列のオフセットを初期値とする
+static void dither_error_buffer_init(uint16_t *err, int count, int y, int shift) {
+    for (int x = 0; x < count; x++) {
+        err[x] = (uint16_t)((Array_BAYER8x8[y & 7][x & 7] << shift) >> 6);
+    }
+}
+
+//誤差拡散用の誤差バッファを取得する
+//フレーム・帯ごとに確保しないよう、スレッドごとに保持して使いまわす (内容は呼び出し側で初期化すること)
+static uint16_t *dither_error_buffer_get(size_t count) {
+    static thread_local std::vector<uint16_t> err_buf;
+    if (err_buf.size() < count) {
+        err_buf.resize(count, 0);
+    }
+    return err_buf.data();
+}
+
+//dither : 0 ... なし(切り捨て), 1 ... Bayer 8x8, 2 ... 誤差拡散 (VCE_DITHERの値)
+//誤差拡散は、量子化誤差を直下の画素に持ち越す縦方向のみの拡散で、ライン内は並列に処理できる
+//interlacedなら、ディザのパターンと誤差の持ち越しをフィールドごとに行う
+template<int in_bit_depth, bool uv_only, int dither = 0, bool interlaced = false>
 static void convert_yv12_high_to_nv12_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
     static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    static_assert(0 <= dither && dither <= 2, "invalid dither mode.");
     const int crop_left   = crop[0];
     const int crop_up     = crop[1];
     const int crop_right  = crop[2];
     const int crop_bottom = crop[3];
     const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int shift = in_bit_depth - 8;
+    const __m128i xMaskError = _mm_set1_epi16((short)((1 << shift) - 1));
+    //ディザを加えた値が入力のビット深度の最大値を超えないようにする (16bitの場合はadds_epu16で飽和する)
+    const __m128i xMaxValue = _mm_set1_epi16((short)((1 << in_bit_depth) - 1));
+    //Y, U, Vの1ライン分 (ループは16画素単位で幅を超えて処理するので余裕をとる)
+    const int err_field_size = ((width + 16) & ~15) * 2;
+    //インタレの場合はフィールドごとに持つ
+    uint16_t *err_buf = (dither == 2) ? dither_error_buffer_get(err_field_size * ((interlaced) ? 2 : 1)) : nullptr;
     //Y成分のコピー
     if (!uv_only) {
         uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
         uint8_t *dstLine  = (uint8_t *)dst[0];
         const int y_fin = height - crop_bottom;
         const int y_width = width - crop_right - crop_left;
+        if (dither == 2) {
+            dither_error_buffer_init(err_buf, y_width, crop_up, shift);
+            if (interlaced) {
+                dither_error_buffer_init(err_buf + err_field_size, y_width, crop_up + 1, shift);
+            }
+        }
         for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
             uint8_t *dst_ptr = dstLine;
             uint16_t *src_ptr = srcYLine;
             uint16_t *src_ptr_fin = src_ptr + y_width;
+            uint16_t *err_ptr = err_buf + ((dither == 2 && interlaced && (y & 1)) ? err_field_size : 0);
+            const __m128i xOffset = (dither == 1) ? dither_bayer8x8_offset(dither_bayer_row(y, interlaced), shift) : _mm_setzero_si128();
             __m128i x0, x1;
-            for (; src_ptr < src_ptr_fin; dst_ptr += 16, src_ptr += 16) {
+            for (; src_ptr < src_ptr_fin; dst_ptr += 16, src_ptr += 16, err_ptr += 16) {
                 x0 = _mm_loadu_si128((const __m128i *)(src_ptr + 0));
                 x1 = _mm_loadu_si128((const __m128i *)(src_ptr + 8));
 
+                if (dither == 1) {
+                    x0 = _mm_adds_epu16(x0, xOffset);
+                    x1 = _mm_adds_epu16(x1, xOffset);
+                    if (in_bit_depth < 16) {
+                        x0 = _mm_min_epi16(x0, xMaxValue);
+                        x1 = _mm_min_epi16(x1, xMaxValue);
+                    }
+                } else if (dither == 2) {
+                    x0 = _mm_adds_epu16(x0, _mm_loadu_si128((const __m128i *)(err_ptr + 0)));
+                    x1 = _mm_adds_epu16(x1, _mm_loadu_si128((const __m128i *)(err_ptr + 8)));
+                    if (in_bit_depth < 16) {
+                        x0 = _mm_min_epi16(x0, xMaxValue);
+                        x1 = _mm_min_epi16(x1, xMaxValue);
+                    }
+                    _mm_storeu_si128((__m128i *)(err_ptr + 0), _mm_and_si128(x0, xMaskError));
+                    _mm_storeu_si128((__m128i *)(err_ptr + 8), _mm_and_si128(x1, xMaskError));
+                }
+
                 x0 = _mm_srli_epi16(x0, in_bit_depth - 8);
                 x1 = _mm_srli_epi16(x1, in_bit_depth - 8);
 
@@ -331,17 +432,49 @@ static void convert_yv12_high_to_nv12_simd(void **dst, const void **src, int wid
     uint16_t *srcVLine = (uint16_t *)src[2] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
     uint8_t *dstLine  = (uint8_t *)dst[1];
     const int uv_fin = (height - crop_bottom) >> 1;
+    //インタレの場合、色差のラインも1ラインごとに交互のフィールドとなる
+    uint16_t *err_uv[2] = { err_buf, err_buf + ((dither == 2 && interlaced) ? err_field_size : 0) };
+    if (dither == 2) {
+        const int uv_width = (width - crop_right - crop_left) >> 1;
+        for (int i = 0; i < ((interlaced) ? 2 : 1); i++) {
+            dither_error_buffer_init(err_uv[i],                         uv_width, (crop_up >> 1) + i,     shift);
+            dither_error_buffer_init(err_uv[i] + (err_field_size >> 1), uv_width, (crop_up >> 1) + i + 4, shift);
+        }
+    }
     for (int y = crop_up >> 1; y < uv_fin; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
         const int x_fin = width - crop_right;
         uint16_t *src_u_ptr = srcULine;
         uint16_t *src_v_ptr = srcVLine;
+        uint16_t *err_u_ptr = err_uv[(interlaced) ? (y & 1) : 0];
+        uint16_t *err_v_ptr = err_u_ptr + (err_field_size >> 1);
         uint8_t *dst_ptr = dstLine;
-        uint8_t *dst_ptr_fin = dst_ptr + x_fin;
+        uint8_t *dst_ptr_fin = dst_ptr + x_fin - crop_left;
+        //U, Vで同じパターンにならないよう、Vは4ラインずらす
+        const __m128i xOffsetU = (dither == 1) ? dither_bayer8x8_offset(dither_bayer_row(y, interlaced),     shift) : _mm_setzero_si128();
+        const __m128i xOffsetV = (dither == 1) ? dither_bayer8x8_offset(dither_bayer_row(y, interlaced) + 4, shift) : _mm_setzero_si128();
         __m128i x0, x1;
-        for (; dst_ptr < dst_ptr_fin; src_u_ptr += 8, src_v_ptr += 8, dst_ptr += 16) {
+        for (; dst_ptr < dst_ptr_fin; src_u_ptr += 8, src_v_ptr += 8, err_u_ptr += 8, err_v_ptr += 8, dst_ptr += 16) {
             x0 = _mm_loadu_si128((const __m128i *)src_u_ptr);
             x1 = _mm_loadu_si128((const __m128i *)src_v_ptr);
 
+            if (dither == 1) {
+                x0 = _mm_adds_epu16(x0, xOffsetU);
+                x1 = _mm_adds_epu16(x1, xOffsetV);
+                if (in_bit_depth < 16) {
+                    x0 = _mm_min_epi16(x0, xMaxValue);
+                    x1 = _mm_min_epi16(x1, xMaxValue);
+                }
+            } else if (dither == 2) {
+                x0 = _mm_adds_epu16(x0, _mm_loadu_si128((const __m128i *)err_u_ptr));
+                x1 = _mm_adds_epu16(x1, _mm_loadu_si128((const __m128i *)err_v_ptr));
+                if (in_bit_depth < 16) {
+                    x0 = _mm_min_epi16(x0, xMaxValue);
+                    x1 = _mm_min_epi16(x1, xMaxValue);
+                }
+                _mm_storeu_si128((__m128i *)err_u_ptr, _mm_and_si128(x0, xMaskError));
+                _mm_storeu_si128((__m128i *)err_v_ptr, _mm_and_si128(x1, xMaskError));
+            }
+
             x0 = _mm_srli_epi16(x0, in_bit_depth - 8);
             x1 = _mm_slli_epi16(x1, 16 - in_bit_depth);
             const __m128i xMaskHighByte = _mm_slli_epi16(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()), 8);
@@ -354,4 +487,399 @@ static void convert_yv12_high_to_nv12_simd(void **dst, const void **src, int wid
     }
 }
 
+//上位ビット詰めの16bit (P010形式) に変換する
+template<int in_bit_depth, bool uv_only>
+static void convert_yv12_high_to_p010_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    //Y成分のコピー
+    if (!uv_only) {
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
+        uint16_t *dstLine  = (uint16_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+            uint16_t *dst_ptr = dstLine;
+            uint16_t *src_ptr = srcYLine;
+            uint16_t *src_ptr_fin = src_ptr + y_width;
+            __m128i x0, x1;
+            for (; src_ptr < src_ptr_fin; dst_ptr += 16, src_ptr += 16) {
+                x0 = _mm_loadu_si128((const __m128i *)(src_ptr + 0));
+                x1 = _mm_loadu_si128((const __m128i *)(src_ptr + 8));
+
+                x0 = _mm_slli_epi16(x0, 16 - in_bit_depth);
+                x1 = _mm_slli_epi16(x1, 16 - in_bit_depth);
+
+                _mm_storeu_si128((__m128i *)(dst_ptr + 0), x0);
+                _mm_storeu_si128((__m128i *)(dst_ptr + 8), x1);
+            }
+        }
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
+    uint16_t *srcVLine = (uint16_t *)src[2] + (((src_uv_pitch * crop_up) + crop_left) >> 1);
+    uint16_t *dstLine  = (uint16_t *)dst[1];
+    const int uv_fin = (height - crop_bottom) >> 1;
+    for (int y = crop_up >> 1; y < uv_fin; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch) {
+        const int x_fin = width - crop_right - crop_left;
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint16_t *dst_ptr = dstLine;
+        uint16_t *dst_ptr_fin = dst_ptr + x_fin;
+        __m128i x0, x1, x2;
+        for (; dst_ptr < dst_ptr_fin; src_u_ptr += 8, src_v_ptr += 8, dst_ptr += 16) {
+            x0 = _mm_loadu_si128((const __m128i *)src_u_ptr);
+            x1 = _mm_loadu_si128((const __m128i *)src_v_ptr);
+
+            x0 = _mm_slli_epi16(x0, 16 - in_bit_depth);
+            x1 = _mm_slli_epi16(x1, 16 - in_bit_depth);
+
+            x2 = _mm_unpackhi_epi16(x0, x1);
+            x0 = _mm_unpacklo_epi16(x0, x1);
+
+            _mm_storeu_si128((__m128i *)(dst_ptr + 0), x0);
+            _mm_storeu_si128((__m128i *)(dst_ptr + 8), x2);
+        }
+    }
+}
+
+//yuv444の色差を16画素分読み込み、偶数画素と奇数画素に分離する (各16bit x 8)
+template<int in_bit_depth>
+static __forceinline void load_yuv444_uv_separate(__m128i& x0_return_even, __m128i& x1_return_odd, const uint8_t *src_ptr) {
+    if (in_bit_depth > 8) {
+        //後段のフィルタ計算が16bitでオーバーフローしないよう、11bitまで落としておく
+        const int pre_shift = (in_bit_depth > 11) ? in_bit_depth - 11 : 0;
+        const __m128i xMaskLowWord = _mm_srli_epi32(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()), 16);
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(src_ptr +  0));
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(src_ptr + 16));
+        x0 = _mm_srli_epi16(x0, pre_shift);
+        x1 = _mm_srli_epi16(x1, pre_shift);
+        x0_return_even = _mm_packs_epi32(_mm_and_si128(x0, xMaskLowWord), _mm_and_si128(x1, xMaskLowWord));
+        x1_return_odd  = _mm_packs_epi32(_mm_srli_epi32(x0, 16), _mm_srli_epi32(x1, 16));
+    } else {
+        const __m128i xMaskLowByte = _mm_srli_epi16(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()), 8);
+        __m128i x0 = _mm_loadu_si128((const __m128i *)src_ptr);
+        x0_return_even = _mm_and_si128(x0, xMaskLowByte);
+        x1_return_odd  = _mm_srli_epi16(x0, 8);
+    }
+}
+
+//水平方向の[1,2,1]フィルタ (色差位置は左寄せ)
+//xOddPrevには直前のブロックの奇数画素を渡し、次のブロック用に今回の奇数画素が返る
+static __forceinline __m128i yuv444_to_420_h_filter(__m128i xEven, __m128i xOdd, __m128i& xOddPrev) {
+    __m128i x0 = _mm_alignr_epi8_simd(xOdd, xOddPrev, 14);
+    xOddPrev = xOdd;
+    return _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(xEven, 1), xOdd), x0);
+}
+
+//yuv444の1ライン分の水平フィルタの状態
+template<int in_bit_depth>
+struct yuv444_h_filter_line {
+    const uint8_t *ptr;
+    __m128i xOddPrev;
+
+    __forceinline void init(const uint8_t *src_ptr) {
+        __m128i xEven, xOdd;
+        ptr = src_ptr;
+        load_yuv444_uv_separate<in_bit_depth>(xEven, xOdd, ptr);
+        //左端は先頭の画素で補う
+        xOddPrev = _mm_slli_si128(xEven, 14);
+    }
+    __forceinline __m128i next() {
+        __m128i xEven, xOdd;
+        load_yuv444_uv_separate<in_bit_depth>(xEven, xOdd, ptr);
+        ptr += (in_bit_depth > 8) ? 32 : 16;
+        return yuv444_to_420_h_filter(xEven, xOdd, xOddPrev);
+    }
+};
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+template<int in_bit_depth, bool interlaced>
+static void convert_yuv444_to_nv12_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    static_assert(8 <= in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 8-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_pixel_byte = (in_bit_depth > 8) ? 2 : 1;
+    //Y成分のコピー
+    if (in_bit_depth > 8) {
+        const int src_y_pitch = src_y_pitch_byte >> 1;
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * crop_up + crop_left;
+        uint8_t *dstLine  = (uint8_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+            uint8_t *dst_ptr = dstLine;
+            uint16_t *src_ptr = srcYLine;
+            uint16_t *src_ptr_fin = src_ptr + y_width;
+            __m128i x0, x1;
+            for (; src_ptr < src_ptr_fin; dst_ptr += 16, src_ptr += 16) {
+                x0 = _mm_loadu_si128((const __m128i *)(src_ptr + 0));
+                x1 = _mm_loadu_si128((const __m128i *)(src_ptr + 8));
+
+                x0 = _mm_srli_epi16(x0, in_bit_depth - 8);
+                x1 = _mm_srli_epi16(x1, in_bit_depth - 8);
+
+                x0 = _mm_packus_epi16(x0, x1);
+
+                _mm_storeu_si128((__m128i *)(dst_ptr + 0), x0);
+            }
+        }
+    } else {
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * crop_up + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0];
+        const int y_fin = height - crop_bottom;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = crop_up; y < y_fin; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            memcpy_sse<false>(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分の縮小
+    //プログレッシブでは2ラインの平均、インタレではフィールドごとに3:1の重みで補間する
+    const int eff_bit_depth = (in_bit_depth > 11) ? 11 : in_bit_depth;
+    const int uv_shift = ((interlaced) ? 4 : 3) + eff_bit_depth - 8;
+    const __m128i xRound = _mm_set1_epi16((short)(1 << (uv_shift - 1)));
+    uint8_t *srcULine = (uint8_t *)src[1] + src_uv_pitch_byte * crop_up + crop_left * src_pixel_byte;
+    uint8_t *srcVLine = (uint8_t *)src[2] + src_uv_pitch_byte * crop_up + crop_left * src_pixel_byte;
+    uint8_t *dstLine = (uint8_t *)dst[1];
+    const int y_fin = height - crop_bottom - crop_up;
+    const int x_fin = width - crop_right - crop_left;
+    for (int y = 0; y < y_fin; y += 2, dstLine += dst_y_pitch_byte) {
+        //使用する2ライン (インタレの場合、奇数フィールドは1ライン前から)
+        const int line0 = (interlaced && (y & 2)) ? y - 1 : y;
+        const int line1 = (interlaced) ? line0 + 2 : line0 + 1;
+        yuv444_h_filter_line<in_bit_depth> u0, u1, v0, v1;
+        u0.init(srcULine + src_uv_pitch_byte * line0);
+        u1.init(srcULine + src_uv_pitch_byte * line1);
+        v0.init(srcVLine + src_uv_pitch_byte * line0);
+        v1.init(srcVLine + src_uv_pitch_byte * line1);
+        uint8_t *dst_ptr = dstLine;
+        __m128i x0, x1, x2, x3;
+        for (int x = 0; x < x_fin; x += 16, dst_ptr += 16) {
+            x0 = u0.next();
+            x1 = u1.next();
+            x2 = v0.next();
+            x3 = v1.next();
+            if (interlaced) {
+                //近いほうのラインに3倍の重み
+                if (y & 2) {
+                    x1 = _mm_add_epi16(x1, _mm_slli_epi16(x1, 1));
+                    x3 = _mm_add_epi16(x3, _mm_slli_epi16(x3, 1));
+                } else {
+                    x0 = _mm_add_epi16(x0, _mm_slli_epi16(x0, 1));
+                    x2 = _mm_add_epi16(x2, _mm_slli_epi16(x2, 1));
+                }
+            }
+            x0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x0, x1), xRound), uv_shift);
+            x2 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x2, x3), xRound), uv_shift);
+
+            //入力が最大値付近では丸めで256になるので、飽和させてからU, Vを交互に並べる
+            x0 = _mm_packus_epi16(x0, x2);
+            x0 = _mm_unpacklo_epi8(x0, _mm_srli_si128(x0, 8));
+
+            _mm_storeu_si128((__m128i *)dst_ptr, x0);
+        }
+    }
+}
+
+template<int pixel_byte>
+static void convert_yuv444_to_yuv444_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int y_fin = height - crop_bottom;
+    const int line_byte = (width - crop_right - crop_left) * pixel_byte;
+    for (int i = 0; i < 3; i++) {
+        const int src_pitch_byte = (i) ? src_uv_pitch_byte : src_y_pitch_byte;
+        uint8_t *srcLine = (uint8_t *)src[i] + src_pitch_byte * crop_up + crop_left * pixel_byte;
+        uint8_t *dstLine = (uint8_t *)dst[i];
+        for (int y = crop_up; y < y_fin; y++, srcLine += src_pitch_byte, dstLine += dst_y_pitch_byte) {
+            memcpy_sse<false>(dstLine, srcLine, line_byte);
+        }
+    }
+}
+
+//nv12からnv12へのコピー (色差の各ラインのフィールドは変わらないので、インタレでも共通)
+//左右のcropがなくpitchが一致する場合は、プレーンごとにまとめて1回でコピーする
+template<bool use_stream>
+static void convert_nv12_to_nv12_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int line_byte = width - crop_right - crop_left;
+    for (int i = 0; i < 2; i++) {
+        const int src_pitch_byte = (i) ? src_uv_pitch_byte : src_y_pitch_byte;
+        const int y_start = (i) ? crop_up >> 1 : crop_up;
+        const int y_fin = (i) ? (height - crop_bottom) >> 1 : height - crop_bottom;
+        uint8_t *srcLine = (uint8_t *)src[i] + src_pitch_byte * y_start + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[i];
+        if (y_start >= y_fin) {
+            continue;
+        }
+        if (src_pitch_byte == dst_y_pitch_byte && line_byte == width) {
+            //最後のラインのpitchの余白は読まない
+            memcpy_sse<use_stream>(dstLine, srcLine, src_pitch_byte * (y_fin - y_start - 1) + line_byte);
+            continue;
+        }
+        for (int y = y_start; y < y_fin; y++, srcLine += src_pitch_byte, dstLine += dst_y_pitch_byte) {
+            memcpy_sse<use_stream>(dstLine, srcLine, line_byte);
+        }
+    }
+    if (use_stream) {
+        _mm_sfence();
+    }
+}
+#pragma warning (pop)
+
+#if USE_SSSE3
+//RGB入力の変換関数が使用する係数 (ConvertCsp.cpp)
+const int *get_convert_csp_rgb_coef();
+
+#pragma warning (push)
+#pragma warning (disable: 4127) //warning C4127: 条件式が定数です。
+//8画素分のRGBを読み込み、16bitずつのR, G, Bに分離する
+//pixel_byteは4ならBGRA、3ならBGR24、6ならBGR48で、BGR48は12bitにして返す
+template<int pixel_byte>
+static void __forceinline load_rgb_8px(const uint8_t *ptr, __m128i& xR, __m128i& xG, __m128i& xB) {
+    if (pixel_byte == 6) {
+        //2画素ずつ、B0 B1 G0 G1 R0 R1 (16bit)に並べ替える
+        const __m128i xShuffle = _mm_setr_epi8(0, 1, 6, 7, 2, 3, 8, 9, 4, 5, 10, 11, -1, -1, -1, -1);
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ptr +  0)), xShuffle);
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ptr + 12)), xShuffle);
+        __m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ptr + 24)), xShuffle);
+        __m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ptr + 36)), xShuffle);
+        __m128i x4 = _mm_unpacklo_epi32(x0, x1); //B0-3 G0-3
+        __m128i x5 = _mm_unpacklo_epi32(x2, x3); //B4-7 G4-7
+        x0 = _mm_unpackhi_epi32(x0, x1); //R0-3
+        x2 = _mm_unpackhi_epi32(x2, x3); //R4-7
+        xB = _mm_srli_epi16(_mm_unpacklo_epi64(x4, x5), 4);
+        xG = _mm_srli_epi16(_mm_unpackhi_epi64(x4, x5), 4);
+        xR = _mm_srli_epi16(_mm_unpacklo_epi64(x0, x2), 4);
+    } else {
+        //4画素ずつ、B0-3 G0-3 R0-3 (8bit)に並べ替える
+        const __m128i xShuffle = (pixel_byte == 4)
+            ? _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, -1, -1, -1, -1)
+            : _mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ptr)), xShuffle);
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ptr + pixel_byte * 4)), xShuffle);
+        __m128i x2 = _mm_unpacklo_epi32(x0, x1); //B0-7 G0-7
+        x0 = _mm_unpackhi_epi32(x0, x1); //R0-7
+        xB = _mm_unpacklo_epi8(x2, _mm_setzero_si128());
+        xG = _mm_unpackhi_epi8(x2, _mm_setzero_si128());
+        xR = _mm_unpacklo_epi8(x0, _mm_setzero_si128());
+    }
+}
+
+//(a, b)の係数を16bitずつ並べる
+static __m128i __forceinline rgb_coef_pair(int a, int b) {
+    return _mm_set1_epi32((int)(((uint32_t)b << 16) | ((uint32_t)a & 0xffff)));
+}
+
+//8画素分のR, G, Bから、8画素分のY(またはU, V)を計算する
+//xCoefRGは(R, G)の係数、xCoefBは(B, 0)の係数、xOffsetは丸めを含むオフセット
+template<int shift>
+static __m128i __forceinline rgb_to_yuv_8px(__m128i xR, __m128i xG, __m128i xB, __m128i xCoefRG, __m128i xCoefB, __m128i xOffset) {
+    __m128i x0 = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(xR, xG), xCoefRG), _mm_madd_epi16(_mm_unpacklo_epi16(xB, _mm_setzero_si128()), xCoefB));
+    __m128i x1 = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(xR, xG), xCoefRG), _mm_madd_epi16(_mm_unpackhi_epi16(xB, _mm_setzero_si128()), xCoefB));
+    x0 = _mm_srai_epi32(_mm_add_epi32(x0, xOffset), shift);
+    x1 = _mm_srai_epi32(_mm_add_epi32(x1, xOffset), shift);
+    return _mm_packs_epi32(x0, x1);
+}
+
+//色差用に縦2ラインの和をとる
+//インタレでは同じフィールドの2ラインから、近いほうのライン(第1フィールドは上、第2フィールドは下)を3倍に重み付けする
+template<bool interlaced>
+static __m128i __forceinline rgb_line_sum(__m128i x0, __m128i x1, int i) {
+    if (interlaced) {
+        __m128i x2 = (i) ? x1 : x0;
+        return _mm_add_epi16(_mm_add_epi16(x0, x1), _mm_add_epi16(x2, x2));
+    }
+    return _mm_add_epi16(x0, x1);
+}
+
+//縦の和をとった16画素分から、横2画素ずつの和8つを返す
+static __m128i __forceinline rgb_pair_sum(__m128i x0, __m128i x1) {
+    const __m128i xOne = _mm_set1_epi16(1);
+    return _mm_packs_epi32(_mm_madd_epi16(x0, xOne), _mm_madd_epi16(x1, xOne));
+}
+
+//RGBからNV12へ、行列と範囲の変換、色差の2x2の平均を1パスで行う
+template<int pixel_byte, bool interlaced>
+static void convert_rgb_to_nv12_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int in_bit_depth = (pixel_byte == 6) ? 12 : 8;
+    const int y_shift  = 14 + in_bit_depth - 8;
+    const int uv_shift = y_shift + ((interlaced) ? 3 : 2); //色差は4画素(インタレでは重みの和が8)の和から計算する
+    const int *coef = get_convert_csp_rgb_coef();
+    const __m128i xCoefYRG = rgb_coef_pair(coef[0], coef[1]);
+    const __m128i xCoefYB  = rgb_coef_pair(coef[2], 0);
+    const __m128i xCoefURG = rgb_coef_pair(coef[4], coef[5]);
+    const __m128i xCoefUB  = rgb_coef_pair(coef[6], 0);
+    const __m128i xCoefVRG = rgb_coef_pair(coef[8], coef[9]);
+    const __m128i xCoefVB  = rgb_coef_pair(coef[10], 0);
+    const __m128i xOffsetY = _mm_set1_epi32((coef[3]  << y_shift)  + (1 << (y_shift  - 1)));
+    const __m128i xOffsetU = _mm_set1_epi32((coef[7]  << uv_shift) + (1 << (uv_shift - 1)));
+    const __m128i xOffsetV = _mm_set1_epi32((coef[11] << uv_shift) + (1 << (uv_shift - 1)));
+    //プログレッシブなら隣接する2ライン、インタレなら同じフィールドの2ライン(i, i+2)から色差を作る
+    const int line_step = (interlaced) ? 2 : 1;
+    const int y_step = line_step * 2;
+    const uint8_t *srcLine = (const uint8_t *)src[0] + src_y_pitch_byte * crop_up + crop_left * pixel_byte;
+    uint8_t *dstYLine = (uint8_t *)dst[0];
+    uint8_t *dstCLine = (uint8_t *)dst[1];
+    const int y_fin = height - crop_bottom - crop_up;
+    const int x_fin = width - crop_right - crop_left;
+    for (int y = 0; y < y_fin; y += y_step) {
+        for (int i = 0; i < line_step; i++) {
+            const uint8_t *p0 = srcLine + src_y_pitch_byte * i;
+            const uint8_t *p1 = p0 + src_y_pitch_byte * line_step;
+            uint8_t *dstY0 = dstYLine + dst_y_pitch_byte * i;
+            uint8_t *dstY1 = dstY0 + dst_y_pitch_byte * line_step;
+            uint8_t *dstC = dstCLine + dst_y_pitch_byte * i;
+            for (int ix = 0; ix < x_fin; ix += 16) {
+                //右端の16画素に満たない部分は、入力の範囲外を読まないよう直前の画素と重ねて処理する
+                const int x = (ix + 16 > x_fin && x_fin >= 16) ? x_fin - 16 : ix;
+                __m128i xR[2][2], xG[2][2], xB[2][2]; //[ライン][前半/後半の8画素]
+                load_rgb_8px<pixel_byte>(p0 + (x + 0) * pixel_byte, xR[0][0], xG[0][0], xB[0][0]);
+                load_rgb_8px<pixel_byte>(p0 + (x + 8) * pixel_byte, xR[0][1], xG[0][1], xB[0][1]);
+                load_rgb_8px<pixel_byte>(p1 + (x + 0) * pixel_byte, xR[1][0], xG[1][0], xB[1][0]);
+                load_rgb_8px<pixel_byte>(p1 + (x + 8) * pixel_byte, xR[1][1], xG[1][1], xB[1][1]);
+
+                __m128i x0, x1;
+                x0 = rgb_to_yuv_8px<y_shift>(xR[0][0], xG[0][0], xB[0][0], xCoefYRG, xCoefYB, xOffsetY);
+                x1 = rgb_to_yuv_8px<y_shift>(xR[0][1], xG[0][1], xB[0][1], xCoefYRG, xCoefYB, xOffsetY);
+                _mm_storeu_si128((__m128i *)(dstY0 + x), _mm_packus_epi16(x0, x1));
+                x0 = rgb_to_yuv_8px<y_shift>(xR[1][0], xG[1][0], xB[1][0], xCoefYRG, xCoefYB, xOffsetY);
+                x1 = rgb_to_yuv_8px<y_shift>(xR[1][1], xG[1][1], xB[1][1], xCoefYRG, xCoefYB, xOffsetY);
+                _mm_storeu_si128((__m128i *)(dstY1 + x), _mm_packus_epi16(x0, x1));
+
+                const __m128i xRs = rgb_pair_sum(rgb_line_sum<interlaced>(xR[0][0], xR[1][0], i), rgb_line_sum<interlaced>(xR[0][1], xR[1][1], i));
+                const __m128i xGs = rgb_pair_sum(rgb_line_sum<interlaced>(xG[0][0], xG[1][0], i), rgb_line_sum<interlaced>(xG[0][1], xG[1][1], i));
+                const __m128i xBs = rgb_pair_sum(rgb_line_sum<interlaced>(xB[0][0], xB[1][0], i), rgb_line_sum<interlaced>(xB[0][1], xB[1][1], i));
+                x0 = rgb_to_yuv_8px<uv_shift>(xRs, xGs, xBs, xCoefURG, xCoefUB, xOffsetU);
+                x1 = rgb_to_yuv_8px<uv_shift>(xRs, xGs, xBs, xCoefVRG, xCoefVB, xOffsetV);
+                _mm_storeu_si128((__m128i *)(dstC + x), _mm_packus_epi16(_mm_unpacklo_epi16(x0, x1), _mm_unpackhi_epi16(x0, x1)));
+            }
+        }
+        srcLine  += src_y_pitch_byte * y_step;
+        dstYLine += dst_y_pitch_byte * y_step;
+        dstCLine += dst_y_pitch_byte * line_step;
+    }
+}
+#pragma warning (pop)
+#endif //USE_SSSE3
+
 #endif //_CONVERT_CSP_H_
@@ -29,11 +29,39 @@
 #define USE_SSSE3 1
 #define USE_SSE41 0
 
-#include "ConvertCSPSIMD.h"
+#include "ConvertCspSIMD.h"
 
 #pragma warning (push)
 #pragma warning (disable: 4100)
 void convert_yuy2_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
-    return convert_yuy2_to_nv12_i_simd(dst[0], src[0], width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+    return convert_yuy2_to_nv12_i_simd<false>(dst[0], src[0], width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_yuy2_to_nv12_i_stream_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    return convert_yuy2_to_nv12_i_simd<true>(dst[0], src[0], width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgra_to_nv12_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_simd<4, false>(dst, src, width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgra_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_simd<4, true>(dst, src, width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr24_to_nv12_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_simd<3, false>(dst, src, width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr24_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_simd<3, true>(dst, src, width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr48_to_nv12_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_simd<6, false>(dst, src, width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
+void convert_bgr48_to_nv12_i_ssse3(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    convert_rgb_to_nv12_simd<6, true>(dst, src, width, src_y_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
 }
 #pragma warning (pop)
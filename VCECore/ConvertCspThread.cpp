@@ -0,0 +1,146 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "ConvertCspThread.h"
+#include "cpu_info.h"
+
+//この画素数未満のフレームでは、スレッドの起床のコストのほうが大きいので分割しない
+static const int CONVERT_THREAD_MIN_PIXELS = 1280 * 720;
+
+ConvertCSPThread::ConvertCSPThread() :
+    m_pConvert(nullptr),
+    m_nThreads(1),
+    m_prm(),
+    m_bAbort(false),
+    m_thWorker(),
+    m_heStart(),
+    m_heFin() {
+}
+
+ConvertCSPThread::~ConvertCSPThread() {
+    close();
+}
+
+int ConvertCSPThread::init(const ConvertCSP *convert, int nThreads, int width, int height) {
+    close();
+    m_pConvert = convert;
+    if (nThreads == VCE_CONVERT_THREAD_AUTO) {
+        nThreads = 1;
+        cpu_info_t cpu_info;
+        if (width * height >= CONVERT_THREAD_MIN_PIXELS && get_cpu_info(&cpu_info)) {
+            //デコードやエンコーダへの転送の分を残しておく
+            nThreads = (std::max)(1, (std::min)((int)cpu_info.physical_cores / 2, 4));
+        }
+    }
+    //誤差拡散は上のラインの誤差を持ち越すので、帯に分割すると帯の先頭で誤差が初期化され、スレッド数で結果が変わってしまう
+    //出力をスレッド数によらず一定にするため、誤差拡散では分割しない
+    if (convert && convert->dither == VCE_DITHER_ERROR_DIFFUSION) {
+        nThreads = 1;
+    }
+    m_nThreads = (std::max)(1, (std::min)(nThreads, VCE_CONVERT_THREAD_MAX));
+    //呼び出し元のスレッドも帯を1つ担当するので、起動するのはm_nThreads-1個
+    for (int i = 0; i < m_nThreads - 1; i++) {
+        HANDLE heStart = CreateEvent(NULL, FALSE, FALSE, NULL);
+        HANDLE heFin   = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (heStart == NULL || heFin == NULL) {
+            if (heStart) CloseHandle(heStart);
+            if (heFin)   CloseHandle(heFin);
+            break;
+        }
+        m_heStart.push_back(heStart);
+        m_heFin.push_back(heFin);
+    }
+    m_nThreads = (int)m_heStart.size() + 1;
+    for (int i = 0; i < m_nThreads - 1; i++) {
+        m_thWorker.push_back(std::thread(&ConvertCSPThread::threadFunc, this, i));
+    }
+    return m_nThreads;
+}
+
+void ConvertCSPThread::close() {
+    if (m_thWorker.size()) {
+        m_bAbort = true;
+        for (auto heStart : m_heStart) {
+            SetEvent(heStart);
+        }
+        for (auto& th : m_thWorker) {
+            th.join();
+        }
+        m_thWorker.clear();
+    }
+    for (auto he : m_heStart) {
+        CloseHandle(he);
+    }
+    for (auto he : m_heFin) {
+        CloseHandle(he);
+    }
+    m_heStart.clear();
+    m_heFin.clear();
+    m_bAbort = false;
+    m_nThreads = 1;
+}
+
+void ConvertCSPThread::convertBand(int band) {
+    convert_csp_band(m_pConvert, m_prm.interlaced, band, m_nThreads,
+        m_prm.dst, m_prm.src, m_prm.width, m_prm.src_y_pitch_byte, m_prm.src_uv_pitch_byte, m_prm.dst_y_pitch_byte, m_prm.height, m_prm.dst_height, m_prm.crop, m_prm.use_stream);
+}
+
+void ConvertCSPThread::threadFunc(int threadId) {
+    for (;;) {
+        WaitForSingleObject(m_heStart[threadId], INFINITE);
+        if (m_bAbort) {
+            break;
+        }
+        //帯0は呼び出し元のスレッドが担当する
+        convertBand(threadId + 1);
+        SetEvent(m_heFin[threadId]);
+    }
+}
+
+void ConvertCSPThread::run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    m_prm.interlaced = interlaced;
+    m_prm.dst = dst;
+    m_prm.src = src;
+    m_prm.width = width;
+    m_prm.src_y_pitch_byte = src_y_pitch_byte;
+    m_prm.src_uv_pitch_byte = src_uv_pitch_byte;
+    m_prm.dst_y_pitch_byte = dst_y_pitch_byte;
+    m_prm.height = height;
+    m_prm.dst_height = dst_height;
+    m_prm.crop = crop;
+    m_prm.use_stream = convert_csp_use_stream(m_pConvert, interlaced, dst, dst_y_pitch_byte, dst_height);
+    if (m_nThreads <= 1) {
+        convertBand(0);
+        return;
+    }
+    for (auto heStart : m_heStart) {
+        SetEvent(heStart);
+    }
+    convertBand(0);
+    WaitForMultipleObjects((DWORD)m_heFin.size(), m_heFin.data(), TRUE, INFINITE);
+}
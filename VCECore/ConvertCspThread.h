@@ -0,0 +1,89 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#ifndef _CONVERT_CSP_THREAD_H_
+#define _CONVERT_CSP_THREAD_H_
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "qsv_osdep.h"
+#include "ConvertCsp.h"
+
+static const int VCE_CONVERT_THREAD_AUTO = -1;
+static const int VCE_CONVERT_THREAD_MAX = 16;
+
+//色空間変換をフレームを水平方向の帯に分割して並列に行う
+//スレッドは常駐させておき、フレームごとにイベントで起床させる
+class ConvertCSPThread {
+public:
+    ConvertCSPThread();
+    virtual ~ConvertCSPThread();
+
+    //nThreadsで使用するスレッド数を指定する (呼び出し元のスレッドも含む)
+    //VCE_CONVERT_THREAD_AUTOの場合、フレームサイズとCPUのコア数から自動で決定する
+    int init(const ConvertCSP *convert, int nThreads, int width, int height);
+    void close();
+
+    //funcConvertCSPと同じ引数で変換を行う、処理が完了するまで戻らない
+    void run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+
+    int getThreadCount() const {
+        return m_nThreads;
+    }
+    const ConvertCSP *getConvertFunc() const {
+        return m_pConvert;
+    }
+protected:
+    void threadFunc(int threadId);
+    //m_prmのうち、band番目の帯を処理する
+    virtual void convertBand(int band);
+
+    struct ConvertCSPPrm {
+        int interlaced;
+        void **dst;
+        const void **src;
+        int width;
+        int src_y_pitch_byte;
+        int src_uv_pitch_byte;
+        int dst_y_pitch_byte;
+        int height;
+        int dst_height;
+        int *crop;
+        bool use_stream;
+    };
+
+    const ConvertCSP *m_pConvert;
+    int m_nThreads;
+    ConvertCSPPrm m_prm;
+    std::atomic<bool> m_bAbort;
+    std::vector<std::thread> m_thWorker;
+    std::vector<HANDLE> m_heStart; //ワーカースレッドに処理開始を通知する
+    std::vector<HANDLE> m_heFin;   //ワーカースレッドの処理終了を通知する
+};
+
+#endif //_CONVERT_CSP_THREAD_H_
@@ -42,6 +42,7 @@
 #include "VCEParam.h"
 #include "VCEVersion.h"
 #include "VCEInput.h"
+#include "ConvertCspBench.h"
 #include "VCEInputRaw.h"
 #include "VCEInputAvs.h"
 #include "VCEInputVpy.h"
@@ -347,7 +348,23 @@ void VCECore::Terminate() {
     if (m_thStreamSender.joinable()) {
         m_thStreamSender.join();
     }
+    const bool bPipelineEof = GetState() == PipelineStateEof;
     Pipeline::Stop();
+#if ENABLE_AVCODEC_VCE_READER
+    //音声の読み込みスレッドを終了し、Writerへの直接の受け渡しを解除する
+    //正常終了時は、映像の読み込み済みの位置まで音声を読み込んでから終了する
+    for (const auto& reader : m_AudioReaders) {
+        auto pReader = std::dynamic_pointer_cast<CAvcodecReader>(reader);
+        if (pReader != nullptr) {
+            pReader->StopStreamThread(bPipelineEof);
+            pReader->SetStreamPacketSink(nullptr);
+        }
+    }
+    auto pAVCodecReader = std::dynamic_pointer_cast<CAvcodecReader>(m_pFileReader);
+    if (pAVCodecReader != nullptr) {
+        pAVCodecReader->SetStreamPacketSink(nullptr);
+    }
+#endif //ENABLE_AVCODEC_VCE_READER
     PrintMes(VCE_LOG_DEBUG, _T("Pipeline Stopped.\n"));
 
     m_pStreamOut = NULL;
@@ -431,6 +448,13 @@ AMF_RESULT VCECore::initInput(VCEParam *pParams, const VCEInputInfo *pInputInfo)
     if (!m_pEncSatusInfo) {
         m_pEncSatusInfo = std::make_shared<VCEStatus>();
     }
+    if (pParams->pQueueLog) {
+        //キューの統計情報は入出力の初期化時に各キューに設定するので、先に有効にしておく
+        if (AMF_OK != m_pEncSatusInfo->EnableQueueInfo(pParams->pQueueLog)) {
+            PrintMes(VCE_LOG_ERROR, _T("Failed to open queue log file: %s\n"), pParams->pQueueLog);
+            return AMF_FILE_NOT_OPEN;
+        }
+    }
 
     int sourceAudioTrackIdStart = 1;    //トラック番号は1スタート
     int sourceSubtitleTrackIdStart = 1; //トラック番号は1スタート
@@ -469,6 +493,7 @@ AMF_RESULT VCECore::initInput(VCEParam *pParams, const VCEInputInfo *pInputInfo)
     if (pParams->nInputType == VCE_INPUT_Y4M || pParams->nInputType == VCE_INPUT_RAW) {
         rawParam.y4m = pParams->nInputType == VCE_INPUT_Y4M;
         rawParam.srcFile = pParams->pInputFile;
+        rawParam.csp = (VCE_CSP)pParams->nInputCsp;
         m_inputInfo.pPrivateParam = &rawParam;
         m_pFileReader.reset(new VCEInputRaw());
 #if ENABLE_AVISYNTH_READER
@@ -513,7 +538,7 @@ AMF_RESULT VCECore::initInput(VCEParam *pParams, const VCEInputInfo *pInputInfo)
         avcodecReaderPrm.pFramePosListLog = pParams->pFramePosListLog;
         avcodecReaderPrm.nInputThread = (int8_t)pParams->nInputThread;
         avcodecReaderPrm.bAudioIgnoreNoTrackError = (int8_t)pParams->bAudioIgnoreNoTrackError;
-        avcodecReaderPrm.pQueueInfo = nullptr;
+        avcodecReaderPrm.pQueueInfo = m_pEncSatusInfo->GetQueueInfoPtr();
         m_inputInfo.pPrivateParam = &avcodecReaderPrm;
         m_pFileReader.reset(new CAvcodecReader());
         PrintMes(VCE_LOG_DEBUG, _T("Input: avqsv reader selected.\n"));
@@ -522,6 +547,22 @@ AMF_RESULT VCECore::initInput(VCEParam *pParams, const VCEInputInfo *pInputInfo)
         PrintMes(VCE_LOG_ERROR, _T("Unknown reader selected\n"));
         return AMF_NOT_SUPPORTED;
     }
+    //環境変数でも色空間変換の関数を指定できるようにする (コマンドラインでの指定を優先)
+    int nConvertKernel = pParams->nConvertKernel;
+    const TCHAR *pConvertKernelEnv = _tgetenv(_T("VCEENC_CONVERT_KERNEL"));
+    if (nConvertKernel == VCE_CONVERT_KERNEL_AUTO && pConvertKernelEnv != nullptr) {
+        int value = get_value_from_chr(list_convert_kernel, pConvertKernelEnv);
+        if (value == PARSE_ERROR_FLAG) {
+            PrintMes(VCE_LOG_WARN, _T("Unknown value for VCEENC_CONVERT_KERNEL: %s, ignored.\n"), pConvertKernelEnv);
+        } else {
+            nConvertKernel = value;
+        }
+    }
+    set_convert_csp_kernel((VCE_CONVERT_KERNEL)nConvertKernel);
+    set_convert_csp_profile(pParams->pConvertProfile);
+    PrintMes(VCE_LOG_DEBUG, _T("Input: convert kernel %s.\n"), get_chr_from_value(list_convert_kernel, nConvertKernel));
+    m_pFileReader->SetConvertThread(pParams->nConvertThread);
+    m_pFileReader->SetConvertDither((VCE_DITHER)pParams->nConvertDither);
     auto ret = m_pFileReader->init(m_pVCELog, m_pEncSatusInfo, &m_inputInfo, m_pContext);
     if (ret != AMF_OK) {
         PrintMes(VCE_LOG_ERROR, _T("Error: %s\n"), m_pFileReader->getMessage().c_str());
@@ -638,6 +679,11 @@ AMF_RESULT VCECore::checkParam(VCEParam *prm) {
         PrintMes(VCE_LOG_ERROR, _T("crop not available with avvce readder.\n"));
         return AMF_NOT_SUPPORTED;
     }
+    //インタレ時、上のcropが4の倍数でないと色差のフィールドが入れ替わってしまう
+    if (m_inputInfo.crop.up % h_mul != 0) {
+        PrintMes(VCE_LOG_ERROR, _T("crop up must be mod%d (up: %d).\n"), h_mul, m_inputInfo.crop.up);
+        return AMF_FAIL;
+    }
     m_inputInfo.srcWidth -= (m_inputInfo.crop.left + m_inputInfo.crop.right);
     m_inputInfo.srcHeight -= (m_inputInfo.crop.bottom + m_inputInfo.crop.up);
     if (m_inputInfo.srcWidth % 2 != 0) {
@@ -662,6 +708,19 @@ AMF_RESULT VCECore::checkParam(VCEParam *prm) {
         PrintMes(VCE_LOG_ERROR, _T("Invalid output frame size - non mod%d (height: %d).\n"), h_mul, m_inputInfo.dstHeight);
         return AMF_FAIL;
     }
+    if (prm->nResizeAlgo != VCE_RESIZE_AMF) {
+        if (m_inputInfo.dstWidth == m_inputInfo.srcWidth && m_inputInfo.dstHeight == m_inputInfo.srcHeight) {
+            prm->nResizeAlgo = VCE_RESIZE_AMF;
+        } else if (is_interlaced(prm)) {
+            PrintMes(VCE_LOG_WARN, _T("resize on cpu does not support interlaced, resize will be done by converter.\n"));
+            prm->nResizeAlgo = VCE_RESIZE_AMF;
+        } else if (AMF_OK != m_pFileReader->SetResize((VCE_RESIZE_ALGO)prm->nResizeAlgo, m_inputInfo.dstWidth, m_inputInfo.dstHeight)) {
+            PrintMes(VCE_LOG_WARN, _T("resize on cpu is not supported with this input, resize will be done by converter.\n"));
+            prm->nResizeAlgo = VCE_RESIZE_AMF;
+        } else {
+            PrintMes(VCE_LOG_DEBUG, _T("resize on cpu: %s.\n"), get_chr_from_value(list_resize_algo, prm->nResizeAlgo));
+        }
+    }
     if (   m_inputInfo.dstWidth  == m_inputInfo.dstWidth
         && m_inputInfo.dstHeight == m_inputInfo.srcHeight) {
         if (m_inputInfo.AspectRatioW * m_inputInfo.AspectRatioH == 0) {
@@ -700,6 +759,12 @@ AMF_RESULT VCECore::checkParam(VCEParam *prm) {
         prm->vui.fullrange = FALSE;
     }
 #endif
+    //RGB入力の変換に使用する行列と範囲 (行列の指定がなければ解像度から判断する)
+    int nRGBMatrix = prm->vui.colormatrix;
+    if (nRGBMatrix == get_value_from_chr(list_colormatrix, _T("undef")) || nRGBMatrix == COLOR_VALUE_AUTO) {
+        nRGBMatrix = get_value_from_chr(list_colormatrix, (m_inputInfo.srcHeight >= 720) ? _T("bt709") : _T("smpte170m"));
+    }
+    set_convert_csp_rgb_matrix(nRGBMatrix, prm->vui.infoPresent && prm->vui.fullrange);
     if (prm->nBframes > 0 && prm->nCodecId == VCE_CODEC_HEVC) {
         PrintMes(VCE_LOG_WARN, _T("Bframes is not supported with HEVC encoding, disabled.\n"));
         prm->nBframes = 0;
@@ -765,10 +830,9 @@ AMF_RESULT VCECore::initOutput(VCEParam *pParams) {
         writerPrm.nAudioResampler = pParams->nAudioResampler;
         writerPrm.nAudioIgnoreDecodeError = pParams->nAudioIgnoreDecodeError;
         writerPrm.bVideoDtsUnavailable = false;
-        writerPrm.pQueueInfo = nullptr;
+        writerPrm.pQueueInfo = m_pEncSatusInfo->GetQueueInfoPtr();
         writerPrm.nVideoInputFirstKeyPts = 0;
         writerPrm.pVideoInputCodecCtx = nullptr;
-        //writerPrm.pQueueInfo = (m_pPerfMonitor) ? m_pPerfMonitor->GetQueueInfoPtr() : nullptr;
         if (pParams->pMuxOpt) {
             writerPrm.vMuxOpt = *pParams->pMuxOpt;
         }
@@ -1086,7 +1150,10 @@ AMF_RESULT VCECore::initDecoder(VCEParam *prm) {
 #pragma warning(pop)
 
 AMF_RESULT VCECore::initConverter(VCEParam *prm) {
-    if (m_inputInfo.dstWidth == m_inputInfo.srcWidth && m_inputInfo.dstHeight == m_inputInfo.srcHeight && m_inputInfo.format == formatOut) {
+    //CPUでリサイズする場合、リーダーから渡されるフレームはすでに出力サイズになっている
+    const int surfaceWidth  = (prm->nResizeAlgo != VCE_RESIZE_AMF) ? m_inputInfo.dstWidth  : m_inputInfo.srcWidth;
+    const int surfaceHeight = (prm->nResizeAlgo != VCE_RESIZE_AMF) ? m_inputInfo.dstHeight : m_inputInfo.srcHeight;
+    if (m_inputInfo.dstWidth == surfaceWidth && m_inputInfo.dstHeight == surfaceHeight && m_inputInfo.format == formatOut) {
         PrintMes(VCE_LOG_DEBUG, _T("converter not required.\n"));
         return AMF_OK;
     }
@@ -1105,7 +1172,7 @@ AMF_RESULT VCECore::initConverter(VCEParam *prm) {
         wstring_to_tstring(g_AMFFactory.GetTrace()->GetMemoryTypeName(prm->memoryTypeIn)).c_str(),
         wstring_to_tstring(g_AMFFactory.GetTrace()->SurfaceGetFormatName(formatOut)).c_str(),
         m_inputInfo.dstWidth, m_inputInfo.dstHeight);
-    if (AMF_OK != (res = m_pConverter->Init(formatOut, m_inputInfo.srcWidth, m_inputInfo.srcHeight))) {
+    if (AMF_OK != (res = m_pConverter->Init(formatOut, surfaceWidth, surfaceHeight))) {
         PrintMes(VCE_LOG_ERROR, _T("Failed to init converter: %s\n"), AMFRetString(res));
         return res;
     }
@@ -1656,57 +1723,116 @@ AMF_RESULT VCECore::run() {
     m_pEncSatusInfo->SetStart();
     if (m_pFileWriterListAudio.size() > 0) {
 #if ENABLE_AVCODEC_VCE_READER
-        m_thStreamSender = std::thread([this](){
-            //streamのindexから必要なwriteへのポインタを返すテーブルを作成
-            std::map<int, shared_ptr<CAvcodecWriter>> pWriterForAudioStreams;
-            for (auto pWriter : m_pFileWriterListAudio) {
-                auto pAVCodecWriter = std::dynamic_pointer_cast<CAvcodecWriter>(pWriter);
-                if (pAVCodecWriter) {
-                    auto trackIdList = pAVCodecWriter->GetStreamTrackIdList();
-                    for (auto trackID : trackIdList) {
-                        pWriterForAudioStreams[trackID] = pAVCodecWriter;
-                    }
+        //すべてのWriterが複数スレッドからのパケットの追加に対応していれば、
+        //各Readerの読み込みスレッドから直接Writerのキューにパケットを渡す
+        bool bDirectStreamSend = true;
+        std::map<int, shared_ptr<CAvcodecWriter>> pWriterForAudioStreams;
+        //streamのindexから必要なwriteへのポインタを返すテーブルを作成 (従来通りの方法で受け渡す場合も使用する)
+        for (auto pWriter : m_pFileWriterListAudio) {
+            auto pAVCodecWriter = std::dynamic_pointer_cast<CAvcodecWriter>(pWriter);
+            if (pAVCodecWriter == nullptr || !pAVCodecWriter->AcceptsConcurrentPackets()) {
+                bDirectStreamSend = false;
+            }
+            if (pAVCodecWriter) {
+                for (auto trackID : pAVCodecWriter->GetStreamTrackIdList()) {
+                    pWriterForAudioStreams[trackID] = pAVCodecWriter;
                 }
             }
-            AMF_RESULT sts = AMF_OK;
-            PipelineState state = PipelineStateRunning;
-            while ((state = GetState()) == PipelineStateRunning) {
-                auto pAVCodecReader = std::dynamic_pointer_cast<CAvcodecReader>(m_pFileReader);
-                vector<AVPacket> packetList;
-                if (pAVCodecReader != nullptr) {
-                    packetList = pAVCodecReader->GetStreamDataPackets();
+        }
+        auto streamPacketSink = [this, pWriterForAudioStreams](AVPacket *pkts, size_t nCount) {
+            //パケットを各Writerに分配する
+            //Readerからは連続したパケットが同じtrackで来ることが多いので、まとまりごとに書き出す
+            for (size_t i = 0; i < nCount; ) {
+                const int nTrackId = pkts[i].flags >> 16;
+                auto it = pWriterForAudioStreams.find(nTrackId);
+                if (it == pWriterForAudioStreams.end() || it->second == nullptr) {
+                    PrintMes(VCE_LOG_ERROR, _T("Failed to find writer for track %d\n"), nTrackId);
+                    return AMF_INVALID_POINTER;
                 }
-                //音声ファイルリーダーからのトラックを結合する
-                for (const auto& reader : m_AudioReaders) {
-                    auto pReader = std::dynamic_pointer_cast<CAvcodecReader>(reader);
-                    if (pReader != nullptr) {
-                        vector_cat(packetList, pReader->GetStreamDataPackets());
+                size_t j = i + 1;
+                while (j < nCount && pWriterForAudioStreams.find(pkts[j].flags >> 16) == it) {
+                    j++;
+                }
+                AMF_RESULT sts = it->second->WriteNextPackets(pkts + i, j - i);
+                if (sts != AMF_OK) {
+                    return sts;
+                }
+                i = j;
+            }
+            return AMF_OK;
+        };
+        if (bDirectStreamSend) {
+            //入力スレッドを使用している場合など、Readerが対応していなければ従来通りの方法で受け渡す
+            auto pAVCodecReader = std::dynamic_pointer_cast<CAvcodecReader>(m_pFileReader);
+            if (pAVCodecReader != nullptr
+                && AMF_OK != pAVCodecReader->SetStreamPacketSink(streamPacketSink)) {
+                bDirectStreamSend = false;
+            }
+        }
+        if (bDirectStreamSend) {
+            for (const auto& reader : m_AudioReaders) {
+                auto pReader = std::dynamic_pointer_cast<CAvcodecReader>(reader);
+                if (pReader != nullptr) {
+                    if (AMF_OK != (res = pReader->SetStreamPacketSink(streamPacketSink))) {
+                        PrintMes(VCE_LOG_ERROR, _T("failed to set stream packet sink for audio reader: %s\n"), AMFRetString(res));
+                        return res;
+                    }
+                    //映像の読み込み済みフレーム数に合わせて、音声ファイルを読み進める
+                    if (!pReader->IsReadingVideo()
+                        && AMF_OK != (res = pReader->StartStreamThread([this]() { return (int)m_pEncSatusInfo->m_nInputFrames; }, &m_pEncSatusInfo->m_waitInputFrames))) {
+                        PrintMes(VCE_LOG_ERROR, _T("failed to start audio read thread: %s\n"), AMFRetString(res));
+                        return res;
                     }
                 }
-                //パケットを各Writerに分配する
-                for (uint32_t i = 0; i < packetList.size(); i++) {
-                    const int nTrackId = packetList[i].flags >> 16;
-                    if (pWriterForAudioStreams.count(nTrackId)) {
-                        auto pWriter = pWriterForAudioStreams[nTrackId];
-                        if (pWriter == nullptr) {
-                            PrintMes(VCE_LOG_ERROR, _T("Invalid writer found for track %d\n"), nTrackId);
+            }
+        } else {
+            m_thStreamSender = std::thread([this, pWriterForAudioStreams](){
+                AMF_RESULT sts = AMF_OK;
+                PipelineState state = PipelineStateRunning;
+                while ((state = GetState()) == PipelineStateRunning) {
+                    auto pAVCodecReader = std::dynamic_pointer_cast<CAvcodecReader>(m_pFileReader);
+                    vector<AVPacket> packetList;
+                    if (pAVCodecReader != nullptr) {
+                        packetList = pAVCodecReader->GetStreamDataPackets();
+                    }
+                    //音声ファイルリーダーからのトラックを結合する
+                    for (const auto& reader : m_AudioReaders) {
+                        auto pReader = std::dynamic_pointer_cast<CAvcodecReader>(reader);
+                        if (pReader != nullptr) {
+                            vector_cat(packetList, pReader->GetStreamDataPackets());
+                        }
+                    }
+                    //パケットを各Writerに分配する
+                    std::map<shared_ptr<CAvcodecWriter>, vector<AVPacket>> packetsForWriter;
+                    for (uint32_t i = 0; i < packetList.size(); i++) {
+                        const int nTrackId = packetList[i].flags >> 16;
+                        auto it = pWriterForAudioStreams.find(nTrackId);
+                        if (it != pWriterForAudioStreams.end()) {
+                            auto pWriter = it->second;
+                            if (pWriter == nullptr) {
+                                PrintMes(VCE_LOG_ERROR, _T("Invalid writer found for track %d\n"), nTrackId);
+                                return AMF_INVALID_POINTER;
+                            }
+                            packetsForWriter[pWriter].push_back(packetList[i]);
+                        } else {
+                            PrintMes(VCE_LOG_ERROR, _T("Failed to find writer for track %d\n"), nTrackId);
                             return AMF_INVALID_POINTER;
                         }
-                        if (AMF_OK != (sts = pWriter->WriteNextPacket(&packetList[i]))) {
+                    }
+                    //Writerごとにまとめて書き出す
+                    for (auto& writerPackets : packetsForWriter) {
+                        if (AMF_OK != (sts = writerPackets.first->WriteNextPackets(writerPackets.second.data(), writerPackets.second.size()))) {
                             return sts;
                         }
-                    } else {
-                        PrintMes(VCE_LOG_ERROR, _T("Failed to find writer for track %d\n"), nTrackId);
-                        return AMF_INVALID_POINTER;
                     }
+                    amf_sleep(100);
                 }
-                amf_sleep(100);
-            }
-            if (sts != AMF_OK && sts != AMF_EOF) {
+                if (sts != AMF_OK && sts != AMF_EOF) {
 
-            }
-            return GetState() == PipelineStateEof ? AMF_OK : AMF_FAIL;
-        });
+                }
+                return GetState() == PipelineStateEof ? AMF_OK : AMF_FAIL;
+            });
+        }
 #endif //ENABLE_AVCODEC_VCE_READER
     }
     res = Pipeline::Start();
@@ -35,6 +35,7 @@
 #include "VCEParam.h"
 #include "VCEVersion.h"
 #include "VCEInput.h"
+#include "ConvertCspBench.h"
 #include "VCELog.h"
 
 VCEInput::VCEInput() :
@@ -48,6 +49,12 @@ VCEInput::VCEInput() :
     m_strInputInfo(),
     m_pContext(nullptr),
     m_sConvert(nullptr),
+    m_nConvertThread(VCE_CONVERT_THREAD_AUTO),
+    m_nConvertDither(VCE_DITHER_NONE),
+    m_nResizeAlgo(VCE_RESIZE_AMF),
+    m_nResizeWidth(0),
+    m_nResizeHeight(0),
+    m_pConvertThread(),
     m_sTrimParam() {
 
 }
@@ -65,10 +72,48 @@ AMF_RESULT VCEInput::Terminate() {
     m_strInputInfo.clear();
     m_pContext = nullptr;
     m_sConvert = nullptr;
+    m_pConvertThread.reset();
+    m_nResizeAlgo = VCE_RESIZE_AMF;
     memset(&m_sTrimParam, 0, sizeof(m_sTrimParam));
     return AMF_OK;
 }
 
+AMF_RESULT VCEInput::SetResize(VCE_RESIZE_ALGO algo, int dstWidth, int dstHeight) {
+    if (algo != VCE_RESIZE_AMF
+        && (m_sConvert == nullptr || m_sConvert->csp_to != VCE_CSP_NV12 || m_sConvert->uv_only)) {
+        return AMF_NOT_SUPPORTED;
+    }
+    m_nResizeAlgo = algo;
+    m_nResizeWidth = dstWidth;
+    m_nResizeHeight = dstHeight;
+    m_pConvertThread.reset();
+    return AMF_OK;
+}
+
+void VCEInput::convertCsp(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop) {
+    if (!m_pConvertThread || m_pConvertThread->getConvertFunc() != m_sConvert) {
+        const int srcWidth  = width  - crop[0] - crop[2];
+        const int srcHeight = height - crop[1] - crop[3];
+        int nThreads = 0;
+        if (get_convert_csp_kernel() == VCE_CONVERT_KERNEL_AUTO) {
+            //実際の幅で各関数を計測し、最速のものを使用する
+            m_sConvert = convert_csp_tune(m_sConvert, srcWidth, srcHeight);
+        }
+        if (m_nResizeAlgo != VCE_RESIZE_AMF) {
+            auto pConvertResize = new ConvertCSPResize();
+            nThreads = pConvertResize->init(m_sConvert, m_nResizeAlgo, m_nConvertThread, srcWidth, srcHeight, m_nResizeWidth, m_nResizeHeight);
+            m_pConvertThread.reset(pConvertResize);
+            AddMessage(VCE_LOG_DEBUG, _T("resize on cpu: %dx%d -> %dx%d.\n"), srcWidth, srcHeight, m_nResizeWidth, m_nResizeHeight);
+        } else {
+            m_pConvertThread.reset(new ConvertCSPThread());
+            nThreads = m_pConvertThread->init(m_sConvert, m_nConvertThread, srcWidth, srcHeight);
+        }
+        AddMessage(VCE_LOG_DEBUG, _T("convert csp: %s->%s[%s], %d thread(s).\n"),
+            VCE_CSP_NAMES[m_sConvert->csp_from], VCE_CSP_NAMES[m_sConvert->csp_to], get_simd_str(m_sConvert->simd), nThreads);
+    }
+    m_pConvertThread->run(interlaced, dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, crop);
+}
+
 #pragma warning(push)
 #pragma warning(disable: 4100)
 AMF_RESULT VCEInput::SubmitInput(amf::AMFData* pData) {
@@ -40,6 +40,8 @@
 #include "VCELog.h"
 #include "VCEStatus.h"
 #include "ConvertCsp.h"
+#include "ConvertCspThread.h"
+#include "ConvertCspResize.h"
 #pragma warning(pop)
 
 class VCEInput : public PipelineElement {
@@ -99,6 +101,17 @@ public:
     sTrimParam *GetTrimParam() {
         return &m_sTrimParam;
     }
+    //色空間変換に使用するスレッド数を設定する (initより前に呼ぶこと)
+    void SetConvertThread(int nThreads) {
+        m_nConvertThread = nThreads;
+    }
+    //高ビット深度入力を8bitに変換する際のディザを設定する (initより前に呼ぶこと)
+    void SetConvertDither(VCE_DITHER dither) {
+        m_nConvertDither = dither;
+    }
+    //色空間変換と同時にCPUでdstWidth x dstHeightにリサイズする (initより後、最初のQueryOutputより前に呼ぶこと)
+    //NV12以外への変換など、対応していない場合はAMF_NOT_SUPPORTEDを返す
+    AMF_RESULT SetResize(VCE_RESIZE_ALGO algo, int dstWidth, int dstHeight);
     void GetInputCropInfo(sInputCrop *cropInfo) {
         memcpy(cropInfo, &m_sInputCrop, sizeof(m_sInputCrop));
     }
@@ -148,6 +161,16 @@ protected:
         va_end(args);
         AddMessage(log_level, buffer);
     }
+    //m_sConvertで色空間変換を行う
+    //m_nConvertThreadに応じて、フレームを水平方向に分割して並列に処理する
+    void convertCsp(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
+    //QueryOutputで確保するサーフェスのサイズ (CPUでリサイズする場合はリサイズ後のサイズ)
+    int getSurfaceWidth() const {
+        return (m_nResizeAlgo != VCE_RESIZE_AMF) ? m_nResizeWidth : m_inputFrameInfo.srcWidth - m_inputFrameInfo.crop.left - m_inputFrameInfo.crop.right;
+    }
+    int getSurfaceHeight() const {
+        return (m_nResizeAlgo != VCE_RESIZE_AMF) ? m_nResizeHeight : m_inputFrameInfo.srcHeight - m_inputFrameInfo.crop.up - m_inputFrameInfo.crop.bottom;
+    }
     //trim listを参照し、動画の最大フレームインデックスを取得する
     int getVideoTrimMaxFramIdx() {
         if (m_sTrimParam.list.size() == 0) {
@@ -165,5 +188,11 @@ protected:
     tstring m_strInputInfo;
     amf::AMFContextPtr m_pContext;
     const ConvertCSP *m_sConvert;
+    int m_nConvertThread;
+    VCE_DITHER m_nConvertDither;
+    VCE_RESIZE_ALGO m_nResizeAlgo;
+    int m_nResizeWidth;
+    int m_nResizeHeight;
+    unique_ptr<ConvertCSPThread> m_pConvertThread;
     sTrimParam m_sTrimParam;
 };
@@ -124,11 +124,13 @@ AMF_RESULT VCEInputAvs::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> pSta
         { AVS_CS_I420,  VCE_CSP_YV12, VCE_CSP_NV12 },
         { AVS_CS_IYUV,  VCE_CSP_YV12, VCE_CSP_NV12 },
         { AVS_CS_YUY2,  VCE_CSP_YUY2, VCE_CSP_NV12 },
+        { AVS_CS_BGR24, VCE_CSP_BGR24, VCE_CSP_NV12 },
+        { AVS_CS_BGR32, VCE_CSP_BGRA,  VCE_CSP_NV12 },
     };
 
     for (auto csp : valid_csp_list) {
         if (csp.fmtID == m_sAVSinfo->pixel_type) {
-            m_sConvert = get_convert_csp_func(csp.in, csp.out, false);
+            m_sConvert = get_convert_csp_func(csp.in, csp.out, false, m_nConvertDither);
             break;
         }
     }
@@ -186,8 +188,7 @@ AMF_RESULT VCEInputAvs::QueryOutput(amf::AMFData **ppData) {
     AMF_RESULT res = AMF_OK;
     amf::AMFSurfacePtr pSurface;
     res = m_pContext->AllocSurface(amf::AMF_MEMORY_HOST, m_inputFrameInfo.format,
-        m_inputFrameInfo.srcWidth - m_inputFrameInfo.crop.left - m_inputFrameInfo.crop.right,
-        m_inputFrameInfo.srcHeight - m_inputFrameInfo.crop.bottom - m_inputFrameInfo.crop.up,
+        getSurfaceWidth(), getSurfaceHeight(),
         &pSurface);
     if (res != AMF_OK) {
         AddMessage(VCE_LOG_ERROR, _T("AMFContext::AllocSurface(amf::AMF_MEMORY_HOST) failed.\n"));
@@ -203,16 +204,23 @@ AMF_RESULT VCEInputAvs::QueryOutput(amf::AMFData **ppData) {
         return AMF_EOF;
     }
     const void *src_ptr[3] = { avs_get_read_ptr_p(frame, AVS_PLANAR_Y), avs_get_read_ptr_p(frame, AVS_PLANAR_U), avs_get_read_ptr_p(frame, AVS_PLANAR_V) };
+    int src_pitch = avs_get_pitch_p(frame, AVS_PLANAR_Y);
+    if (avs_is_rgb(m_sAVSinfo)) {
+        //AviSynthのRGBは下のラインから格納されているので、最後のラインから負のピッチで読む
+        src_ptr[0] = (const uint8_t *)src_ptr[0] + src_pitch * (m_inputFrameInfo.srcHeight - 1);
+        src_pitch = -src_pitch;
+    }
 
     auto plane = pSurface->GetPlaneAt(0);
     int dst_stride = plane->GetHPitch();
     int dst_height = plane->GetVPitch();
 
-    void *dst_ptr[2];
+    void *dst_ptr[3];
     dst_ptr[0] = (uint8_t *)plane->GetNative();
     dst_ptr[1] = (uint8_t *)dst_ptr[0] + dst_height * dst_stride;
-    m_sConvert->func[is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0](dst_ptr, src_ptr, m_inputFrameInfo.srcWidth, avs_get_pitch_p(frame, AVS_PLANAR_Y), avs_get_pitch_p(frame, AVS_PLANAR_U), dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
-    m_pEncSatusInfo->m_nInputFrames++;
+    dst_ptr[2] = (uint8_t *)dst_ptr[1] + dst_height * dst_stride;
+    convertCsp(is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0, dst_ptr, src_ptr, m_inputFrameInfo.srcWidth, src_pitch, avs_get_pitch_p(frame, AVS_PLANAR_U), dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
+    m_pEncSatusInfo->AddInputFrame();
 
     m_sAvisynth.release_video_frame(frame);
     m_pEncSatusInfo->UpdateDisplay(0);
@@ -75,15 +75,16 @@ AMF_RESULT VCEInputRaw::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> pSta
         }
     }
 
-    //読み込みバッファの確保
-    m_pBuffer.reset((uint8_t *)_aligned_malloc(m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight * 3 / 2, 32));
+    //読み込みバッファの確保 (変換関数が末尾を超えて読み込む分の余裕をとる)
+    m_pBuffer.reset((uint8_t *)_aligned_malloc(m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight * 3 / 2 + CONVERT_CSP_SRC_PADDING, 32));
     if (m_pBuffer.get() == nullptr) {
         AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for input.\n"));
         return AMF_OUT_OF_MEMORY;
     }
 
-    if (nullptr == (m_sConvert = get_convert_csp_func(VCE_CSP_YV12, VCE_CSP_NV12, false))) {
-        AddMessage(VCE_LOG_ERROR, _T("Failed to find converter for yv12 -> nv12.\n"));
+    const VCE_CSP inputCsp = (m_bIsY4m || pRawParam->csp == VCE_CSP_NA) ? VCE_CSP_YV12 : pRawParam->csp;
+    if (nullptr == (m_sConvert = get_convert_csp_func(inputCsp, VCE_CSP_NV12, false))) {
+        AddMessage(VCE_LOG_ERROR, _T("Failed to find converter for %s -> nv12.\n"), VCE_CSP_NAMES[inputCsp]);
         return AMF_NOT_SUPPORTED;
     }
 
@@ -99,7 +100,8 @@ AMF_RESULT VCEInputRaw::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> pSta
             VCE_CSP_NAMES[m_sConvert->csp_from], VCE_CSP_NAMES[m_sConvert->csp_to], get_simd_str(m_sConvert->simd),
             m_inputFrameInfo.srcWidth, m_inputFrameInfo.srcHeight, is_interlaced(m_inputFrameInfo.nPicStruct) ? _T("i") : _T("p"), m_inputFrameInfo.fps.num, m_inputFrameInfo.fps.den);
     } else {
-        mes = _T("raw");
+        mes = strsprintf(_T("raw: %s->%s[%s]"),
+            VCE_CSP_NAMES[m_sConvert->csp_from], VCE_CSP_NAMES[m_sConvert->csp_to], get_simd_str(m_sConvert->simd));
     }
     AddMessage(VCE_LOG_DEBUG, _T("%s\n"), mes.c_str());
     m_strInputInfo += mes;
@@ -122,8 +124,7 @@ AMF_RESULT VCEInputRaw::QueryOutput(amf::AMFData** ppData) {
     AMF_RESULT res = AMF_OK;
     amf::AMFSurfacePtr pSurface;
     res = m_pContext->AllocSurface(amf::AMF_MEMORY_HOST, m_inputFrameInfo.format,
-        m_inputFrameInfo.srcWidth - m_inputFrameInfo.crop.left - m_inputFrameInfo.crop.right,
-        m_inputFrameInfo.srcHeight - m_inputFrameInfo.crop.bottom - m_inputFrameInfo.crop.up,
+        getSurfaceWidth(), getSurfaceHeight(),
         &pSurface);
     if (res != AMF_OK) {
         AddMessage(VCE_LOG_ERROR, _T("AMFContext::AllocSurface(amf::AMF_MEMORY_HOST) failed.\n"));
@@ -142,31 +143,64 @@ AMF_RESULT VCEInputRaw::QueryOutput(amf::AMFData** ppData) {
                 return AMF_EOF;
     }
     
-    size_t frameSize = m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight * 3 / 2;
-    if (frameSize != fread(m_pBuffer.get(), 1, frameSize, m_fp)) {
-        return AMF_EOF;
-    }
-
-    const void *src_ptr[3];
-    src_ptr[0] = m_pBuffer.get();
-    src_ptr[1] = m_pBuffer.get() + m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight;
-    src_ptr[2] = m_pBuffer.get() + m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight * 5 / 4;
-
     auto plane = pSurface->GetPlaneAt(0);
     int dst_stride = plane->GetHPitch();
     int dst_height = plane->GetVPitch();
 
-    void *dst_ptr[2];
+    void *dst_ptr[3];
     dst_ptr[0] = (uint8_t *)plane->GetNative();
     dst_ptr[1] = (uint8_t *)dst_ptr[0] + dst_height * dst_stride;
-    m_sConvert->func[is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0](dst_ptr, src_ptr, m_inputFrameInfo.srcWidth, m_inputFrameInfo.srcWidth, m_inputFrameInfo.srcWidth / 2, dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
-    m_pEncSatusInfo->m_nInputFrames++;
+    dst_ptr[2] = (uint8_t *)dst_ptr[1] + dst_height * dst_stride;
+
+    const bool bNV12 = m_sConvert->csp_from == VCE_CSP_NV12;
+    if (bNV12 && m_nResizeAlgo == VCE_RESIZE_AMF
+        && 0 == (m_inputFrameInfo.crop.left | m_inputFrameInfo.crop.up | m_inputFrameInfo.crop.right | m_inputFrameInfo.crop.bottom)) {
+        //nv12でcropもリサイズもなければ変換は不要なので、surfaceに直接読み込む
+        if (AMF_OK != (res = readFrameToSurface(dst_ptr, dst_stride))) {
+            return res;
+        }
+    } else {
+        size_t frameSize = m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight * 3 / 2;
+        if (frameSize != fread(m_pBuffer.get(), 1, frameSize, m_fp)) {
+            return AMF_EOF;
+        }
+
+        const void *src_ptr[3];
+        src_ptr[0] = m_pBuffer.get();
+        src_ptr[1] = m_pBuffer.get() + m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight;
+        src_ptr[2] = m_pBuffer.get() + m_inputFrameInfo.srcWidth * m_inputFrameInfo.srcHeight * 5 / 4;
+        const int src_uv_pitch = (bNV12) ? m_inputFrameInfo.srcWidth : m_inputFrameInfo.srcWidth / 2;
+        convertCsp(is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0, dst_ptr, src_ptr, m_inputFrameInfo.srcWidth, m_inputFrameInfo.srcWidth, src_uv_pitch, dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
+    }
+    m_pEncSatusInfo->AddInputFrame();
     m_pEncSatusInfo->UpdateDisplay(0);
 
     *ppData = pSurface.Detach();
     return AMF_OK;
 }
 
+AMF_RESULT VCEInputRaw::readFrameToSurface(void **dst, int dst_stride) {
+    const int width = m_inputFrameInfo.srcWidth;
+    for (int i = 0; i < 2; i++) {
+        const int height = (i) ? m_inputFrameInfo.srcHeight >> 1 : m_inputFrameInfo.srcHeight;
+        uint8_t *ptr = (uint8_t *)dst[i];
+        if (dst_stride == width) {
+            //pitchが一致していれば、プレーンごとに1回で読み込む
+            const size_t planeSize = (size_t)width * height;
+            if (planeSize != fread(ptr, 1, planeSize, m_fp)) {
+                return AMF_EOF;
+            }
+        } else {
+            for (int y = 0; y < height; y++, ptr += dst_stride) {
+                if ((size_t)width != fread(ptr, 1, width, m_fp)) {
+                    return AMF_EOF;
+                }
+            }
+        }
+    }
+    return AMF_OK;
+}
+
 int VCEInputRaw::ParseY4MHeader(char *buf, VCEInputInfo *inputInfo) {
     char *p, *q = NULL;
     for (p = buf; (p = strtok_s(p, " ", &q)) != NULL; ) {
@@ -32,6 +32,7 @@
 struct VCEInputRawParam {
     const TCHAR *srcFile;
     bool y4m;
+    VCE_CSP csp; //rawの場合の色空間 (y4mは常にyv12)
 };
 
 class VCEInputRaw : public VCEInput {
@@ -44,6 +45,8 @@ public:
     virtual AMF_RESULT Terminate() override;
 private:
     int VCEInputRaw::ParseY4MHeader(char *buf, VCEInputInfo *inputInfo);
+    //nv12の1フレームをsurfaceに直接読み込む
+    AMF_RESULT readFrameToSurface(void **dst, int dst_stride);
     unique_ptr<uint8_t, aligned_malloc_deleter> m_pBuffer;
     FILE *m_fp;
     bool m_bIsY4m;
@@ -214,12 +214,15 @@ AMF_RESULT VCEInputVpy::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> pSta
     } CSPMap;
 
     static const std::vector<CSPMap> valid_csp_list = {
-        { pfYUV420P8,  VCE_CSP_YV12, VCE_CSP_NV12 },
+        { pfYUV420P8,  VCE_CSP_YV12,    VCE_CSP_NV12 },
+        { pfYUV420P9,  VCE_CSP_YV12_09, VCE_CSP_NV12 },
+        { pfYUV420P10, VCE_CSP_YV12_10, VCE_CSP_NV12 },
+        { pfYUV420P16, VCE_CSP_YV12_16, VCE_CSP_NV12 },
     };
 
     for (auto csp : valid_csp_list) {
         if (csp.fmtID == vsvideoinfo->format->id) {
-            m_sConvert = get_convert_csp_func(csp.in, csp.out, false);
+            m_sConvert = get_convert_csp_func(csp.in, csp.out, false, m_nConvertDither);
             break;
         }
     }
@@ -298,8 +301,7 @@ AMF_RESULT VCEInputVpy::QueryOutput(amf::AMFData** ppData) {
     AMF_RESULT res = AMF_OK;
     amf::AMFSurfacePtr pSurface;
     res = m_pContext->AllocSurface(amf::AMF_MEMORY_HOST, m_inputFrameInfo.format,
-        m_inputFrameInfo.srcWidth - m_inputFrameInfo.crop.left - m_inputFrameInfo.crop.right,
-        m_inputFrameInfo.srcHeight - m_inputFrameInfo.crop.bottom - m_inputFrameInfo.crop.up,
+        getSurfaceWidth(), getSurfaceHeight(),
         &pSurface);
     if (res != AMF_OK) {
         AddMessage(VCE_LOG_ERROR, _T("AMFContext::AllocSurface(amf::AMF_MEMORY_HOST) failed.\n"));
@@ -318,11 +320,12 @@ AMF_RESULT VCEInputVpy::QueryOutput(amf::AMFData** ppData) {
     int dst_stride = plane->GetHPitch();
     int dst_height = plane->GetVPitch();
 
-    void *dst_ptr[2];
+    void *dst_ptr[3];
     dst_ptr[0] = (uint8_t *)plane->GetNative();
     dst_ptr[1] = (uint8_t *)dst_ptr[0] + dst_height * dst_stride;
-    m_sConvert->func[is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0](dst_ptr, src_ptr, m_inputFrameInfo.srcWidth, m_sVSapi->getStride(src_frame, 0), m_sVSapi->getStride(src_frame, 1), dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
-    m_pEncSatusInfo->m_nInputFrames++;
+    dst_ptr[2] = (uint8_t *)dst_ptr[1] + dst_height * dst_stride;
+    convertCsp(is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0, dst_ptr, src_ptr, m_inputFrameInfo.srcWidth, m_sVSapi->getStride(src_frame, 0), m_sVSapi->getStride(src_frame, 1), dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
+    m_pEncSatusInfo->AddInputFrame();
     m_nCopyOfInputFrames = m_pEncSatusInfo->m_nInputFrames;
 
     m_sVSapi->freeFrame(src_frame);
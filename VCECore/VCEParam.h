@@ -32,6 +32,7 @@
 #include "VideoEncoderVCE.h"
 #include "VideoEncoderHEVC.h"
 #include "VCEUtil.h"
+#include "ConvertCsp.h"
 
 typedef AMF_VIDEO_ENCODER_PICTURE_STRUCTURE_ENUM VCE_PICSTRUCT;
 
@@ -318,6 +319,8 @@ const CX_DESC list_colormatrix[] = {
     { _T("YCgCo"),     8  },
     { _T("fcc"),       4  },
     { _T("GBR"),       0  },
+    { _T("bt2020nc"),  9  },
+    { _T("bt2020c"),   10 },
     { NULL, NULL }
 };
 const CX_DESC list_videoformat[] = {
@@ -431,6 +434,39 @@ const CX_DESC list_avsync[] = {
     { NULL, 0 }
 };
 
+const CX_DESC list_dither[] = {
+    { _T("none"),    VCE_DITHER_NONE            },
+    { _T("bayer"),   VCE_DITHER_ORDERED         },
+    { _T("errdiff"), VCE_DITHER_ERROR_DIFFUSION },
+    { NULL, 0 }
+};
+
+const CX_DESC list_resize_algo[] = {
+    { _T("amf"),      VCE_RESIZE_AMF      },
+    { _T("bilinear"), VCE_RESIZE_BILINEAR },
+    { _T("bicubic"),  VCE_RESIZE_BICUBIC  },
+    { _T("lanczos3"), VCE_RESIZE_LANCZOS3 },
+    { NULL, 0 }
+};
+
+const CX_DESC list_convert_kernel[] = {
+    { _T("auto"),   VCE_CONVERT_KERNEL_AUTO   },
+    { _T("first"),  VCE_CONVERT_KERNEL_FIRST  },
+    { _T("avx512"), VCE_CONVERT_KERNEL_AVX512 },
+    { _T("avx2"),   VCE_CONVERT_KERNEL_AVX2   },
+    { _T("avx"),    VCE_CONVERT_KERNEL_AVX    },
+    { _T("ssse3"),  VCE_CONVERT_KERNEL_SSSE3  },
+    { _T("sse2"),   VCE_CONVERT_KERNEL_SSE2   },
+    { _T("c"),      VCE_CONVERT_KERNEL_C      },
+    { NULL, 0 }
+};
+
+const CX_DESC list_input_csp[] = {
+    { _T("yv12"), VCE_CSP_YV12 },
+    { _T("nv12"), VCE_CSP_NV12 },
+    { NULL, 0 }
+};
+
 const CX_DESC list_resampler[] = {
     { _T("swr"),  VCE_RESAMPLER_SWR  },
     { _T("soxr"), VCE_RESAMPLER_SOXR },
@@ -616,11 +652,19 @@ typedef struct {
     float       fSeekSec; //指定された秒数分先頭を飛ばす
 
     int         nOutputBufSizeMB;
+    int         nConvertThread; //色空間変換のスレッド数 (VCE_CONVERT_THREAD_AUTOで自動)
+    int         nConvertDither; //高ビット深度から8bitへの変換時のディザ (VCE_DITHER_xxx)
+    int         nResizeAlgo;    //リサイズの方法 (VCE_RESIZE_xxx)
+    int         nConvertKernel; //色空間変換に使用する関数の選択方法 (VCE_CONVERT_KERNEL_xxx)
+    TCHAR      *pConvertProfile; //色空間変換の関数の計測結果を保存するファイル
+    int         nInputCsp;       //rawで読み込む際の色空間 (VCE_CSP_xxx)
 
     VCEVuiInfo  vui;
 
     int         bVBAQ;
     int         nPreAnalysis;
+
+    TCHAR      *pQueueLog; //キューの統計情報を記録し、このファイルに定期的に出力する
 } VCEParam;
 
 static bool is_interlaced(VCE_PICSTRUCT nInterlaced) {
@@ -52,8 +52,12 @@ VCEStatus::VCEStatus() :
     m_sData({ 0 }),
     m_pVCELog(nullptr),
     m_bStdErrWriteToConsole(true),
-    m_bEncStarted(false) {
-
+    m_bEncStarted(false),
+    m_pQueueInfo(),
+    m_fpQueueLog(),
+    m_bQueueLogJson(false),
+    m_tmLastQueueLog(std::chrono::system_clock::now()) {
+    memset(m_QueueLast, 0, sizeof(m_QueueLast));
 }
 
 VCEStatus::~VCEStatus() {
@@ -73,14 +77,121 @@ AMF_RESULT VCEStatus::init(shared_ptr<VCELog> pLog, VCERational outputFps, int t
 
 void VCEStatus::SetStart() {
     m_tmStart = std::chrono::system_clock::now();
+    m_tmLastQueueLog = m_tmStart;
     GetProcessTime(&m_sStartTime);
 }
 
 void VCEStatus::close() {
     m_pVCELog.reset();
+    m_fpQueueLog.reset();
     memset(&m_sData, 0, sizeof(m_sData));
 }
 
+AMF_RESULT VCEStatus::EnableQueueInfo(const TCHAR *pQueueLog) {
+    //PerfQueueInfoは入出力のスレッドから参照されるので、一度作成したら破棄しない
+    if (!m_pQueueInfo) {
+        m_pQueueInfo.reset(new PerfQueueInfo());
+    }
+    memset(m_QueueLast, 0, sizeof(m_QueueLast));
+    if (pQueueLog) {
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, pQueueLog, _T("w")) || fp == nullptr) {
+            return AMF_FILE_NOT_OPEN;
+        }
+        m_fpQueueLog.reset(fp);
+        m_bQueueLogJson = check_ext(pQueueLog, { ".json" });
+        if (!m_bQueueLogJson) {
+            _ftprintf(fp, _T("time_ms,queue,depth,max_depth,pushed,popped,push_per_sec,pop_per_sec,")
+                _T("push_blocked_count,push_blocked_ms,push_blocked_p50_ms,push_blocked_p99_ms,")
+                _T("pop_blocked_count,pop_blocked_ms,pop_blocked_p50_ms,pop_blocked_p99_ms\n"));
+        }
+    }
+    return AMF_OK;
+}
+
+//前回の出力からの差分を含めて、キューの統計情報を1行ずつ出力する
+//CSVでは1キュー1行、JSON Linesでは1回の出力で1行とする
+void VCEStatus::WriteQueueLog(std::chrono::system_clock::time_point tm) {
+    if (!m_pQueueInfo || !m_fpQueueLog) {
+        return;
+    }
+    const double interval = duration_cast<std::chrono::microseconds>(tm - m_tmLastQueueLog).count() * 1e-6;
+    const int64_t time_ms = duration_cast<std::chrono::milliseconds>(tm - m_tmStart).count();
+    m_tmLastQueueLog = tm;
+    FILE *fp = m_fpQueueLog.get();
+    if (m_bQueueLogJson) {
+        _ftprintf(fp, _T("{ \"time_ms\": %lld, \"queues\": {"), (long long)time_ms);
+    }
+    bool bFirst = true;
+    for (int i = 0; i < PERF_QUEUE_COUNT; i++) {
+        const CQueueStats& stats = m_pQueueInfo->stats[i];
+        PerfQueueSnapshot cur;
+        cur.nPushCount     = stats.nPushCount.load(std::memory_order_relaxed);
+        cur.nPopCount      = stats.nPopCount.load(std::memory_order_relaxed);
+        cur.nPushBlockedUs = stats.nPushBlockedUs.load(std::memory_order_relaxed);
+        cur.nPopBlockedUs  = stats.nPopBlockedUs.load(std::memory_order_relaxed);
+        if (cur.nPushCount == 0 && cur.nPopCount == 0) {
+            continue;
+        }
+        const double push_per_sec = (interval > 0.0) ? (cur.nPushCount - m_QueueLast[i].nPushCount) / interval : 0.0;
+        const double pop_per_sec  = (interval > 0.0) ? (cur.nPopCount  - m_QueueLast[i].nPopCount)  / interval : 0.0;
+        m_QueueLast[i] = cur;
+        if (m_bQueueLogJson) {
+            _ftprintf(fp, _T("%s \"%s\": { \"depth\": %llu, \"max_depth\": %llu, \"pushed\": %llu, \"popped\": %llu, ")
+                _T("\"push_per_sec\": %.1f, \"pop_per_sec\": %.1f, ")
+                _T("\"push_blocked_count\": %llu, \"push_blocked_ms\": %.3f, \"push_blocked_p50_ms\": %.3f, \"push_blocked_p99_ms\": %.3f, ")
+                _T("\"pop_blocked_count\": %llu, \"pop_blocked_ms\": %.3f, \"pop_blocked_p50_ms\": %.3f, \"pop_blocked_p99_ms\": %.3f }"),
+                (bFirst) ? _T("") : _T(","), PERF_QUEUE_NAME[i],
+                (unsigned long long)m_pQueueInfo->usage(i), (unsigned long long)stats.nMaxDepth.load(std::memory_order_relaxed),
+                (unsigned long long)cur.nPushCount, (unsigned long long)cur.nPopCount, push_per_sec, pop_per_sec,
+                (unsigned long long)stats.nPushBlockedCount.load(std::memory_order_relaxed), cur.nPushBlockedUs * 1e-3,
+                stats.push_blocked_percentile_ms(50.0), stats.push_blocked_percentile_ms(99.0),
+                (unsigned long long)stats.nPopBlockedCount.load(std::memory_order_relaxed), cur.nPopBlockedUs * 1e-3,
+                stats.pop_blocked_percentile_ms(50.0), stats.pop_blocked_percentile_ms(99.0));
+        } else {
+            _ftprintf(fp, _T("%lld,%s,%llu,%llu,%llu,%llu,%.1f,%.1f,%llu,%.3f,%.3f,%.3f,%llu,%.3f,%.3f,%.3f\n"),
+                (long long)time_ms, PERF_QUEUE_NAME[i],
+                (unsigned long long)m_pQueueInfo->usage(i), (unsigned long long)stats.nMaxDepth.load(std::memory_order_relaxed),
+                (unsigned long long)cur.nPushCount, (unsigned long long)cur.nPopCount, push_per_sec, pop_per_sec,
+                (unsigned long long)stats.nPushBlockedCount.load(std::memory_order_relaxed), cur.nPushBlockedUs * 1e-3,
+                stats.push_blocked_percentile_ms(50.0), stats.push_blocked_percentile_ms(99.0),
+                (unsigned long long)stats.nPopBlockedCount.load(std::memory_order_relaxed), cur.nPopBlockedUs * 1e-3,
+                stats.pop_blocked_percentile_ms(50.0), stats.pop_blocked_percentile_ms(99.0));
+        }
+        bFirst = false;
+    }
+    if (m_bQueueLogJson) {
+        _ftprintf(fp, _T(" } }\n"));
+    }
+    fflush(fp);
+}
+
+//エンコード終了時にキューの統計情報を表示する
+void VCEStatus::WriteQueueResults() {
+    if (!m_pQueueInfo) {
+        return;
+    }
+    const double time_elapsed = duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - m_tmStart).count() * 1e-6;
+    TCHAR mes[512] = { 0 };
+    _stprintf_s(mes, _T("queue     max depth    items   items/s  push blocked (total/p50/p99 ms)   pop blocked (total/p50/p99 ms)"));
+    WriteLine(mes);
+    for (int i = 0; i < PERF_QUEUE_COUNT; i++) {
+        const CQueueStats& stats = m_pQueueInfo->stats[i];
+        const uint64_t nPopCount = stats.nPopCount.load(std::memory_order_relaxed);
+        if (stats.nPushCount.load(std::memory_order_relaxed) == 0 && nPopCount == 0) {
+            continue;
+        }
+        _stprintf_s(mes, _T("%-8s  %9llu %8llu %9.1f  %10.1f /%8.3f /%8.3f   %10.1f /%8.3f /%8.3f"),
+            PERF_QUEUE_NAME[i],
+            (unsigned long long)stats.nMaxDepth.load(std::memory_order_relaxed),
+            (unsigned long long)nPopCount,
+            (time_elapsed > 0.0) ? nPopCount / time_elapsed : 0.0,
+            stats.nPushBlockedUs.load(std::memory_order_relaxed) * 1e-3, stats.push_blocked_percentile_ms(50.0), stats.push_blocked_percentile_ms(99.0),
+            stats.nPopBlockedUs.load(std::memory_order_relaxed) * 1e-3, stats.pop_blocked_percentile_ms(50.0), stats.pop_blocked_percentile_ms(99.0));
+        WriteLine(mes);
+    }
+}
+
 #pragma warning(push)
 #pragma warning(disable: 4100)
 void VCEStatus::SetOutputData(uint64_t nBytesWritten, uint32_t frameType) {
@@ -118,6 +229,13 @@ void VCEStatus::UpdateDisplay(const TCHAR *mes, int drop_frames, double progress
 #pragma warning(pop)
 
 AMF_RESULT VCEStatus::UpdateDisplay(int drop_frames, double progressPercent) {
+    if (m_fpQueueLog) {
+        //キューの統計情報はログレベルによらず出力する
+        auto tm = std::chrono::system_clock::now();
+        if (duration_cast<std::chrono::milliseconds>(tm - m_tmLastQueueLog).count() >= QUEUE_LOG_INTERVAL) {
+            WriteQueueLog(tm);
+        }
+    }
     if (m_pVCELog != nullptr && m_pVCELog->getLogLevel() > VCE_LOG_INFO) {
         return AMF_OK;
     }
@@ -271,4 +389,9 @@ void VCEStatus::WriteResults() {
     WriteFrameTypeResult(_T("frame type I   "), m_sData.nICount, maxCount, m_sData.nIFrameSize, maxFrameSize);
     WriteFrameTypeResult(_T("frame type P   "), m_sData.nPCount, maxCount, m_sData.nPFrameSize, maxFrameSize);
     WriteFrameTypeResult(_T("frame type B   "), m_sData.nBCount, maxCount, m_sData.nBFrameSize, maxFrameSize);
+
+    if (m_pQueueInfo) {
+        WriteQueueLog(tm_result);
+        WriteQueueResults();
+    }
 }
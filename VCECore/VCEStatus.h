@@ -39,10 +39,12 @@
 #include "VCEParam.h"
 #include "VCELog.h"
 #include "cpu_info.h"
+#include "qsv_queue.h"
 
 using std::chrono::duration_cast;
 
 static const int UPDATE_INTERVAL = 800;
+static const int QUEUE_LOG_INTERVAL = 1000;
 
 enum : uint32_t {
     VCE_FRAMETYPE_UNKNOWN = 0x00,
@@ -52,6 +54,20 @@ enum : uint32_t {
     VCE_FRAMETYPE_B       = 0x08,
 };
 
+enum PerfQueueId {
+    PERF_QUEUE_VID_IN,
+    PERF_QUEUE_AUD_IN,
+    PERF_QUEUE_VID_OUT,
+    PERF_QUEUE_AUD_OUT,
+    PERF_QUEUE_AUD_ENC,
+    PERF_QUEUE_AUD_PROC,
+    PERF_QUEUE_COUNT
+};
+
+static const TCHAR *PERF_QUEUE_NAME[PERF_QUEUE_COUNT] = {
+    _T("vid_in"), _T("aud_in"), _T("vid_out"), _T("aud_out"), _T("aud_enc"), _T("aud_proc")
+};
+
 struct PerfQueueInfo {
     size_t usage_vid_in;
     size_t usage_aud_in;
@@ -59,6 +75,23 @@ struct PerfQueueInfo {
     size_t usage_aud_out;
     size_t usage_aud_enc;
     size_t usage_aud_proc;
+    CQueueStats stats[PERF_QUEUE_COUNT]; //各キューの統計情報 (PerfQueueIdの順)
+
+    PerfQueueInfo() :
+        usage_vid_in(0), usage_aud_in(0), usage_vid_out(0), usage_aud_out(0), usage_aud_enc(0), usage_aud_proc(0), stats() {
+    }
+    size_t usage(int id) const {
+        const size_t usage_list[PERF_QUEUE_COUNT] = { usage_vid_in, usage_aud_in, usage_vid_out, usage_aud_out, usage_aud_enc, usage_aud_proc };
+        return usage_list[id];
+    }
+};
+
+//キューの統計情報の出力時に保持する前回の値
+struct PerfQueueSnapshot {
+    uint64_t nPushCount;
+    uint64_t nPopCount;
+    uint64_t nPushBlockedUs;
+    uint64_t nPopBlockedUs;
 };
 
 typedef struct sEncodeStatusData {
@@ -96,11 +129,27 @@ public:
     virtual void WriteFrameTypeResult(const TCHAR *header, uint32_t count, uint32_t maxCount, uint64_t frameSize, uint64_t maxFrameSize);
     virtual void WriteResults();
     virtual void SetStart();
-    uint32_t m_nInputFrames;
+
+    //キューの統計情報の記録を有効にする
+    //pQueueLogが指定されていれば、統計情報を定期的にファイルに出力する (拡張子が.jsonならJSON Lines、それ以外はCSV)
+    virtual AMF_RESULT EnableQueueInfo(const TCHAR *pQueueLog);
+    //キューの統計情報を格納する構造体へのポインタを返す (無効ならnullptr)
+    PerfQueueInfo *GetQueueInfoPtr() {
+        return m_pQueueInfo.get();
+    }
+    //入力フレーム数を1つ進め、読み込みの進行を待っているスレッドに通知する
+    void AddInputFrame() {
+        m_nInputFrames++;
+        m_waitInputFrames.notify();
+    }
+    std::atomic<uint32_t> m_nInputFrames;
+    CQueueWaiter m_waitInputFrames; //m_nInputFramesが更新されたときに通知する
 protected:
     sEncodeStatusData getStatus() {
         return m_sData;
     }
+    virtual void WriteQueueLog(std::chrono::system_clock::time_point tm);
+    virtual void WriteQueueResults();
 
     std::chrono::system_clock::time_point m_tmStart;
     std::chrono::system_clock::time_point m_tmLastUpdate;
@@ -112,4 +161,9 @@ protected:
     shared_ptr<VCELog> m_pVCELog;
     bool m_bStdErrWriteToConsole;
     bool m_bEncStarted;
+    unique_ptr<PerfQueueInfo> m_pQueueInfo;
+    unique_ptr<FILE, fp_deleter> m_fpQueueLog;
+    bool m_bQueueLogJson;
+    std::chrono::system_clock::time_point m_tmLastQueueLog;
+    PerfQueueSnapshot m_QueueLast[PERF_QUEUE_COUNT];
 };
@@ -25,20 +25,33 @@
 //
 // ------------------------------------------------------------------------------------------
 
-#include <tchar.h>
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <Windows.h>
+#include "qsv_osdep.h"
+#if defined(_WIN32) || defined(_WIN64)
 #include <Shlwapi.h>
 #pragma comment(lib, "shlwapi.lib")
-#include <intrin.h>
+#else
+#include <sys/stat.h>
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
 #include "VCEUtil.h"
-#include "VCEParam.h"
 
+#ifdef _MSC_VER
 #pragma warning (push)
 #pragma warning (disable: 4100)
+#endif //#ifdef _MSC_VER
 unsigned int wstring_to_string(const WCHAR *wstr, std::string& str, DWORD codepage) {
+#if !(defined(_WIN32) || defined(_WIN64))
+    //Windows以外ではcodepageは無視し、現在のロケールで変換する
+    const size_t multibyte_length = wcstombs(nullptr, wstr, 0);
+    if (multibyte_length == (size_t)-1) {
+        str.clear();
+        return 0;
+    }
+    str.resize(multibyte_length + 1, 0);
+    wcstombs(&str[0], wstr, multibyte_length + 1);
+    str.resize(multibyte_length);
+    return (unsigned int)multibyte_length;
+#else
     DWORD flags = (codepage == CP_UTF8) ? 0 : WC_NO_BEST_FIT_CHARS;
     int multibyte_length = WideCharToMultiByte(codepage, flags, wstr, -1, nullptr, 0, nullptr, nullptr);
     str.resize(multibyte_length, 0);
@@ -47,6 +60,7 @@ unsigned int wstring_to_string(const WCHAR *wstr, std::string& str, DWORD codepa
         return 0;
     }
     return multibyte_length;
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 }
 
 std::string wstring_to_string(const WCHAR *wstr, DWORD codepage) {
@@ -87,6 +101,17 @@ std::string tchar_to_string(const tstring& tstr, DWORD codepage) {
 }
 
 unsigned int char_to_wstring(std::wstring& wstr, const char *str, DWORD codepage) {
+#if !(defined(_WIN32) || defined(_WIN64))
+    const size_t widechar_length = mbstowcs(nullptr, str, 0);
+    if (widechar_length == (size_t)-1) {
+        wstr.clear();
+        return 0;
+    }
+    wstr.resize(widechar_length + 1, 0);
+    mbstowcs(&wstr[0], str, widechar_length + 1);
+    wstr.resize(widechar_length);
+    return (unsigned int)widechar_length;
+#else
     int widechar_length = MultiByteToWideChar(codepage, 0, str, -1, nullptr, 0);
     wstr.resize(widechar_length, 0);
     if (0 == MultiByteToWideChar(codepage, 0, str, -1, &wstr[0], (int)wstr.size())) {
@@ -94,6 +119,7 @@ unsigned int char_to_wstring(std::wstring& wstr, const char *str, DWORD codepage
         return 0;
     }
     return widechar_length;
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 }
 
 std::wstring char_to_wstring(const char *str, DWORD codepage) {
@@ -170,23 +196,28 @@ tstring char_to_tstring(const std::string& str, DWORD codepage) {
     return tstr;
 }
 std::string strsprintf(const char* format, ...) {
-    va_list args;
+    va_list args, args_copy;
     va_start(args, format);
+    //長さの計算でargsを消費してしまう環境もあるので、コピーしておく
+    va_copy(args_copy, args);
     const size_t len = _vscprintf(format, args) + 1;
 
     std::vector<char> buffer(len, 0);
-    vsprintf_s(buffer.data(), len, format, args);
+    vsprintf_s(buffer.data(), len, format, args_copy);
+    va_end(args_copy);
     va_end(args);
     std::string retStr = std::string(buffer.data());
     return retStr;
 }
 std::wstring strsprintf(const WCHAR* format, ...) {
-    va_list args;
+    va_list args, args_copy;
     va_start(args, format);
+    va_copy(args_copy, args);
     const size_t len = _vscwprintf(format, args) + 1;
 
     std::vector<WCHAR> buffer(len, 0);
-    vswprintf_s(buffer.data(), len, format, args);
+    vswprintf_s(buffer.data(), len, format, args_copy);
+    va_end(args_copy);
     va_end(args);
     std::wstring retStr = std::wstring(buffer.data());
     return retStr;
@@ -210,7 +241,9 @@ std::wstring str_replace(std::wstring str, const std::wstring& from, const std::
     return std::move(str);
 }
 
+#ifdef _MSC_VER
 #pragma warning (pop)
+#endif //#ifdef _MSC_VER
 
 #if defined(_WIN32) || defined(_WIN64)
 std::vector<std::wstring> split(const std::wstring &str, const std::wstring &delim, bool bTrim) {
@@ -493,6 +526,11 @@ static bool get_gpu_frequency(cl_device_id device_id, uint32_t *gpu_freq) {
 #endif //ENABLE_OPENCL
 
 int vce_print_stderr(int log_level, const TCHAR *mes, HANDLE handle) {
+#if !(defined(_WIN32) || defined(_WIN64))
+    int ret = _ftprintf(stderr, "%s", mes);
+    fflush(stderr);
+    return ret;
+#else
     CONSOLE_SCREEN_BUFFER_INFO csbi = { 0 };
     static const WORD LOG_COLOR[] = {
         FOREGROUND_INTENSITY | FOREGROUND_GREEN | FOREGROUND_BLUE, //水色
@@ -516,6 +554,7 @@ int vce_print_stderr(int log_level, const TCHAR *mes, HANDLE handle) {
         SetConsoleTextAttribute(handle, csbi.wAttributes); //元に戻す
     }
     return ret;
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 }
 
 size_t malloc_degeneracy(void **ptr, size_t nSize, size_t nMinSize) {
@@ -537,6 +576,7 @@ size_t malloc_degeneracy(void **ptr, size_t nSize, size_t nMinSize) {
     return 0;
 }
 
+#if defined(_WIN32) || defined(_WIN64)
 BOOL is_64bit_os() {
     SYSTEM_INFO sinfo = { 0 };
     GetNativeSystemInfo(&sinfo);
@@ -643,6 +683,7 @@ tstring getOSVersion(OSVERSIONINFOEXW *osinfo) {
     }
     return tstring(ptr);
 }
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
 int bitstreamInit(sBitstream *pBitstream, uint32_t nSize) {
     bitstreamClear(pBitstream);
@@ -715,103 +756,3 @@ int bitstreamAppend(sBitstream *pBitstream, const uint8_t *data, uint32_t size)
     }
     return sts;
 }
-
-const TCHAR *CodecIdToStr(uint32_t codecId) {
-    switch (codecId) {
-    case VCE_CODEC_H264:  return _T("H.264/AVC");
-    case VCE_CODEC_HEVC:  return _T("H.265/HEVC");
-    case VCE_CODEC_MPEG2: return _T("MPEG2");
-    case VCE_CODEC_VC1:   return _T("VC-1");
-    case VCE_CODEC_WMV3:  return _T("WMV3");
-    default:              return _T("Unknown");
-    }
-}
-
-const TCHAR *AMFRetString(AMF_RESULT ret) {
-#define AMFRESULT_TO_STR(x) case x: return _T( #x );
-    switch (ret) {
-        AMFRESULT_TO_STR(AMF_OK)
-        AMFRESULT_TO_STR(AMF_FAIL)
-
-        // common errors
-        AMFRESULT_TO_STR(AMF_UNEXPECTED)
-
-        AMFRESULT_TO_STR(AMF_ACCESS_DENIED)
-        AMFRESULT_TO_STR(AMF_INVALID_ARG)
-        AMFRESULT_TO_STR(AMF_OUT_OF_RANGE)
-
-        AMFRESULT_TO_STR(AMF_OUT_OF_MEMORY)
-        AMFRESULT_TO_STR(AMF_INVALID_POINTER)
-
-        AMFRESULT_TO_STR(AMF_NO_INTERFACE)
-        AMFRESULT_TO_STR(AMF_NOT_IMPLEMENTED)
-        AMFRESULT_TO_STR(AMF_NOT_SUPPORTED)
-        AMFRESULT_TO_STR(AMF_NOT_FOUND)
-
-        AMFRESULT_TO_STR(AMF_ALREADY_INITIALIZED)
-        AMFRESULT_TO_STR(AMF_NOT_INITIALIZED)
-
-        AMFRESULT_TO_STR(AMF_INVALID_FORMAT)// invalid data format
-
-        AMFRESULT_TO_STR(AMF_WRONG_STATE)
-        AMFRESULT_TO_STR(AMF_FILE_NOT_OPEN)// cannot open file
-
-                                            // device common codes
-        AMFRESULT_TO_STR(AMF_NO_DEVICE)
-
-        // device directx
-        AMFRESULT_TO_STR(AMF_DIRECTX_FAILED)
-        // device opencl 
-        AMFRESULT_TO_STR(AMF_OPENCL_FAILED)
-        // device opengl 
-        AMFRESULT_TO_STR(AMF_GLX_FAILED)//failed to use GLX
-                                        // device XV 
-        AMFRESULT_TO_STR(AMF_XV_FAILED) //failed to use Xv extension
-                                        // device alsa
-        AMFRESULT_TO_STR(AMF_ALSA_FAILED)//failed to use ALSA
-
-                                            // component common codes
-
-                                            //result codes
-        AMFRESULT_TO_STR(AMF_EOF)
-        AMFRESULT_TO_STR(AMF_REPEAT)
-        AMFRESULT_TO_STR(AMF_INPUT_FULL)//returned by AMFComponent::SubmitInput if input queue is full
-        AMFRESULT_TO_STR(AMF_RESOLUTION_CHANGED)//resolution changed client needs to Drain/Terminate/Init
-        AMFRESULT_TO_STR(AMF_RESOLUTION_UPDATED)//resolution changed in adaptive mode. New ROI will be set on output on newly decoded frames
-
-                                                //error codes
-        AMFRESULT_TO_STR(AMF_INVALID_DATA_TYPE)//invalid data type
-        AMFRESULT_TO_STR(AMF_INVALID_RESOLUTION)//invalid resolution (width or height)
-        AMFRESULT_TO_STR(AMF_CODEC_NOT_SUPPORTED)//codec not supported
-        AMFRESULT_TO_STR(AMF_SURFACE_FORMAT_NOT_SUPPORTED)//surface format not supported
-        AMFRESULT_TO_STR(AMF_SURFACE_MUST_BE_SHARED)//surface should be shared (DX11: (MiscFlags & D3D11_RESOURCE_MISC_SHARED) == 0) DX9: No shared handle found)
-
-                                                    // component video decoder
-        AMFRESULT_TO_STR(AMF_DECODER_NOT_PRESENT)//failed to create the decoder
-        AMFRESULT_TO_STR(AMF_DECODER_SURFACE_ALLOCATION_FAILED)//failed to create the surface for decoding
-        AMFRESULT_TO_STR(AMF_DECODER_NO_FREE_SURFACES)
-
-        // component video encoder
-        AMFRESULT_TO_STR(AMF_ENCODER_NOT_PRESENT)//failed to create the encoder
-
-                                                    // component video processor
-
-                                                    // component video conveter
-
-                                                    // component dem
-        AMFRESULT_TO_STR(AMF_DEM_ERROR)
-        AMFRESULT_TO_STR(AMF_DEM_PROPERTY_READONLY)
-        AMFRESULT_TO_STR(AMF_DEM_REMOTE_DISPLAY_CREATE_FAILED)
-        AMFRESULT_TO_STR(AMF_DEM_START_ENCODING_FAILED)
-        AMFRESULT_TO_STR(AMF_DEM_QUERY_OUTPUT_FAILED)
-
-        // component TAN
-        AMFRESULT_TO_STR(AMF_TAN_CLIPPING_WAS_REQUIRED) // Resulting data was truncated to meet output type's value limits.
-        AMFRESULT_TO_STR(AMF_TAN_UNSUPPORTED_VERSION) // Not supported version requested) solely for TANCreateContext().
-
-        AMFRESULT_TO_STR(AMF_NEED_MORE_INPUT)//returned by AMFComponent::SubmitInput did not produce buffer
-    default:
-        return _T("Unknown");
-    }
-#undef AMFRESULT_TO_STR
-}
@@ -32,12 +32,9 @@
 #include <vector>
 #include <array>
 #include <type_traits>
-#include <tchar.h>
 #include <cstdint>
 #include <memory>
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <Windows.h>
+#include "qsv_osdep.h"
 
 enum VCELogLevel {
     VCE_LOG_TRACE = -3,
@@ -248,8 +245,10 @@ bool check_ext(const TCHAR *filename, const std::vector<const char*>& ext_list);
 
 size_t malloc_degeneracy(void **ptr, size_t nSize, size_t nMinSize);
 
+#if defined(_WIN32) || defined(_WIN64)
 tstring getOSVersion(OSVERSIONINFOEXW *osinfo = nullptr);
 BOOL is_64bit_os();
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
 int getCPUInfo(TCHAR *buffer, size_t nSize);
 int getGPUInfo(const char *VendorName, TCHAR *buffer, unsigned int buffer_size, bool driver_version_only = false);
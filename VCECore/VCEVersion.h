@@ -33,7 +33,12 @@
 
 #define VCE_AMD_APP_SDK "3.0"
 
+//OpenCLはWindowsでのみDLLを動的にロードして使用する
+#if defined(_WIN32) || defined(_WIN64)
 #define ENABLE_OPENCL 1
+#else
+#define ENABLE_OPENCL 0
+#endif
 
 #define ENABLE_AVCODEC_OUT_THREAD 1
 #define ENABLE_AVCODEC_AUDPROCESS_THREAD 0
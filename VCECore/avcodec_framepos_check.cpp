@@ -0,0 +1,354 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+
+#include <vector>
+#include <random>
+#include "avcodec_framepos.h"
+
+//以前の実装: ソートが必要になるたびに、確定していない範囲全体をソートする
+//bStableSortがfalseなら、user-024以前と同じくstd::sortでソートする
+class FramePosListSortRef : public FramePosList {
+public:
+    FramePosListSortRef(bool bStableSort) : FramePosList(), m_bStableSort(bStableSort), m_bEqualPts(false) {
+    }
+    //ソートした範囲に同じptsのフレームがあったか (あればstd::sortでの順序は実装依存となる)
+    bool equalPtsSorted() const {
+        return m_bEqualPts;
+    }
+    void add(const FramePos& pos) {
+        m_list.push(pos);
+        const int nListSize = (int)m_list.size();
+        const int nIndex = nListSize-1;
+        adjustFrameInfo(nIndex);
+        if (m_nFirstKeyframePts == AV_NOPTS_VALUE && (pos.flags & AV_PKT_FLAG_KEY) && nIndex == 0) {
+            m_nFirstKeyframePts = m_list[nIndex].data.pts;
+        }
+        if (m_bInputFin || (m_nStreamPtsStatus && nListSize - m_nNextFixNumIndex > (int)AVVCE_FRAME_MAX_REORDER)) {
+            sortAll(nListSize);
+            setPocAndFix(nListSize);
+        }
+        calcDuration();
+    }
+    void fin(const FramePos& pos, int64_t total_duration) {
+        m_bInputFin = true;
+        if (m_nStreamPtsStatus == AVVCE_PTS_UNKNOWN) {
+            checkPtsStatus();
+        }
+        const int nFrame = (int)m_list.size();
+        sortAll(nFrame);
+        m_nNextFixNumIndex += m_nPAFFRewind;
+        for (int i = m_nNextFixNumIndex; i < nFrame; i++) {
+            adjustDurationAfterSort(m_nNextFixNumIndex);
+            setPoc(i);
+        }
+        m_nNextFixNumIndex = nFrame;
+        add(pos);
+        m_nNextFixNumIndex += m_nPAFFRewind;
+        m_nPAFFRewind = 0;
+        m_nDuration = total_duration;
+        m_nDurationNum = m_nNextFixNumIndex;
+    }
+protected:
+    void sortAll(int nListSize) {
+        CompareFramePos compare;
+        compare.threshold = m_nPtsWrapArroundThreshold;
+        FramePos *pStart = (FramePos *)m_list.get(m_nNextFixNumIndex);
+        FramePos *pEnd = (FramePos *)m_list.get(nListSize);
+        if (m_bStableSort) {
+            std::stable_sort(pStart, pEnd, compare);
+        } else {
+            std::sort(pStart, pEnd, compare);
+        }
+        for (FramePos *ptr = pStart; ptr + 1 < pEnd; ptr++) {
+            m_bEqualPts |= !compare(ptr[0], ptr[1]) && !compare(ptr[1], ptr[0]);
+        }
+        m_nSortedNum = nListSize;
+    }
+    bool m_bStableSort;
+    bool m_bEqualPts;
+};
+
+//確認用のパケット列 (デコード順)
+struct FramePosCorpus {
+    const TCHAR *name;
+    vector<FramePos> packets;
+    double durationHint; //checkPtsStatusに渡すフレーム長のヒント
+};
+
+static const int64_t FRAMEPOS_PTS_WRAP = (int64_t)1 << 33;
+
+//H.264/HEVCのB-pyramid (mpeg2-ts, 90kHz)
+//ptsOffsetを2^33付近にすると、途中でptsがwrap arroundする
+static FramePosCorpus framepos_corpus_pyramid(int nFrames, int64_t ptsOffset, const TCHAR *name) {
+    FramePosCorpus corpus = { name, {}, 0.0 };
+    const int dur = 3003;
+    vector<int> order = { 0 };
+    for (int base = 0; (int)order.size() < nFrames; base += 4) {
+        for (int d : { 4, 2, 1, 3 }) {
+            order.push_back(base + d);
+        }
+    }
+    order.resize(nFrames);
+    for (int i = 0; i < nFrames; i++) {
+        const bool bKey = order[i] % 32 == 0;
+        const int64_t pts = (ptsOffset + (order[i] + 2) * (int64_t)dur) % FRAMEPOS_PTS_WRAP;
+        const int64_t dts = (ptsOffset + i * (int64_t)dur) % FRAMEPOS_PTS_WRAP;
+        corpus.packets.push_back(framePos(pts, dts, dur, 0, AVVCE_POC_INVALID,
+            (bKey) ? AV_PKT_FLAG_KEY : 0, AVVCE_PICSTRUCT_FRAME, 1, (uint8_t)((bKey) ? 1 : (order[i] % 4 == 0) ? 2 : 3)));
+    }
+    return corpus;
+}
+
+//H.264のPAFF (IBBP, フィールドごとのパケットで、2番目のフィールドはpts/dtsが無効)
+static FramePosCorpus framepos_corpus_paff(int nFrames) {
+    FramePosCorpus corpus = { _T("paff"), {}, 0.0 };
+    const int dur = 3600;
+    vector<int> order = { 0 };
+    for (int base = 0; (int)order.size() < nFrames; base += 3) {
+        for (int d : { 3, 1, 2 }) {
+            order.push_back(base + d);
+        }
+    }
+    order.resize(nFrames);
+    for (int i = 0; i < nFrames; i++) {
+        const bool bKey = order[i] % 24 == 0;
+        const int64_t pts = (order[i] + 1) * (int64_t)dur;
+        const int64_t dts = i * (int64_t)dur;
+        corpus.packets.push_back(framePos(pts, dts, dur / 2, 0, AVVCE_POC_INVALID,
+            (bKey) ? AV_PKT_FLAG_KEY : 0, AVVCE_PICSTRUCT_FIELD_TOP, 1, 0));
+        corpus.packets.push_back(framePos(AV_NOPTS_VALUE, AV_NOPTS_VALUE, dur / 2, 0, AVVCE_POC_INVALID,
+            0, AVVCE_PICSTRUCT_FIELD_BOTTOM, 1, 0));
+    }
+    return corpus;
+}
+
+//VC-1 (最初のパケット以外はptsが無効でdurationもなく、dtsからptsを再構築する)
+static FramePosCorpus framepos_corpus_vc1(int nFrames) {
+    FramePosCorpus corpus = { _T("vc1"), {}, 0.0 };
+    const int dur = 417;
+    for (int i = 0; i < nFrames; i++) {
+        const bool bKey = i % 48 == 0;
+        const int64_t dts = 1000 + i * (int64_t)dur;
+        const int64_t pts = (i == 0) ? dts + dur : AV_NOPTS_VALUE;
+        corpus.packets.push_back(framePos(pts, dts, 0, 0, AVVCE_POC_INVALID,
+            (bKey) ? AV_PKT_FLAG_KEY : 0, AVVCE_PICSTRUCT_FRAME, 1, 0));
+    }
+    return corpus;
+}
+
+//VP9 (mkv, 1ms, 30000/1001fps) 表示されないaltrefフレームが、次のフレームと同じpts/dts/durationを持つ
+static FramePosCorpus framepos_corpus_vp9(int nFrames) {
+    FramePosCorpus corpus = { _T("vp9-duplicate"), {}, 1001.0 / 30.0 };
+    for (int i = 0; i < nFrames; i++) {
+        const bool bKey = i % 120 == 0;
+        const int64_t pts = (int64_t)(i * 1001.0 / 30.0 + 0.5);
+        if (i % 8 == 4) {
+            corpus.packets.push_back(framePos(pts, pts, 33, 0, AVVCE_POC_INVALID, 0, AVVCE_PICSTRUCT_FRAME, 1, 0));
+        }
+        corpus.packets.push_back(framePos(pts, pts, 33, 0, AVVCE_POC_INVALID,
+            (bKey) ? AV_PKT_FLAG_KEY : 0, AVVCE_PICSTRUCT_FRAME, 1, 0));
+    }
+    return corpus;
+}
+
+//open GOP (先頭のキーフレームより前に表示されるBフレームから始まる)
+static FramePosCorpus framepos_corpus_opengop(int nFrames) {
+    FramePosCorpus corpus = { _T("open-gop"), {}, 0.0 };
+    const int dur = 3003;
+    //I(2) B(0) B(1) P(5) B(3) B(4) P(8) ...
+    vector<int> order = { 2, 0, 1 };
+    for (int base = 2; (int)order.size() < nFrames; base += 3) {
+        for (int d : { 3, 1, 2 }) {
+            order.push_back(base + d);
+        }
+    }
+    order.resize(nFrames);
+    for (int i = 0; i < nFrames; i++) {
+        const bool bKey = order[i] % 24 == 2;
+        const int64_t pts = 900000 + (order[i] + 1) * (int64_t)dur;
+        const int64_t dts = 900000 + i * (int64_t)dur;
+        corpus.packets.push_back(framePos(pts, dts, dur, 0, AVVCE_POC_INVALID,
+            (bKey) ? AV_PKT_FLAG_KEY : 0, AVVCE_PICSTRUCT_FRAME, 1, 0));
+    }
+    return corpus;
+}
+
+//H.264/HEVCのES (pts/dts/durationがすべて無効で、フレームレートから算出する)
+static FramePosCorpus framepos_corpus_es(int nFrames) {
+    FramePosCorpus corpus = { _T("raw-es"), {}, 1001.0 / 24.0 };
+    for (int i = 0; i < nFrames; i++) {
+        corpus.packets.push_back(framePos(AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0, 0, AVVCE_POC_INVALID,
+            (i % 24 == 0) ? AV_PKT_FLAG_KEY : 0, AVVCE_PICSTRUCT_FRAME, 1, 0));
+    }
+    return corpus;
+}
+
+//mkvなどでptsが丸められ、B-pyramidのptsに±1のゆれがある
+static FramePosCorpus framepos_corpus_jitter(int nFrames) {
+    FramePosCorpus corpus = framepos_corpus_pyramid(nFrames, 0, _T("jitter"));
+    std::mt19937 mt(0x46504c32);
+    for (auto& pos : corpus.packets) {
+        pos.pts = pos.pts / 90 + (int)(mt() % 3) - 1;
+        pos.dts = pos.dts / 90 - 100;
+        pos.duration = 33;
+    }
+    return corpus;
+}
+
+static bool framepos_equal(const FramePos& a, const FramePos& b) {
+    return a.pts == b.pts && a.dts == b.dts
+        && a.duration == b.duration && a.duration2 == b.duration2
+        && a.poc == b.poc && a.flags == b.flags
+        && a.pic_struct == b.pic_struct && a.repeat_pict == b.repeat_pict && a.pict_type == b.pict_type;
+}
+
+//リーダーと同じ手順でパケットを追加する
+//nAnalyzeパケット追加した時点でcheckPtsStatusを行い、bRetryなら再解析 (clearPtsStatusしてさらにnAnalyzeパケット追加) を行う
+template<typename List>
+class FramePosFeeder {
+public:
+    FramePosFeeder(List *pList, const FramePosCorpus *pCorpus, int nAnalyze, bool bRetry) :
+        m_pList(pList), m_pCorpus(pCorpus), m_nAnalyze(nAnalyze), m_bRetry(bRetry), m_nIndex(0) {
+    }
+    //パケットを1つ追加し、終端に達したらfinを行ってfalseを返す
+    bool next() {
+        const auto& packets = m_pCorpus->packets;
+        if (m_nIndex >= packets.size()) {
+            const int nFrameNum = m_pList->frameNum();
+            int64_t finPts = 0;
+            if (nFrameNum) {
+                const FramePos& last = m_pList->list(nFrameNum - 1);
+                finPts = last.pts + last.duration;
+            }
+            m_pList->fin(framePos(finPts, finPts, 0), finPts);
+            return false;
+        }
+        m_pList->add(packets[m_nIndex]);
+        m_nIndex++;
+        if (m_nIndex == (size_t)m_nAnalyze) {
+            m_pList->checkPtsStatus(m_pCorpus->durationHint);
+            if (m_bRetry) {
+                m_pList->clearPtsStatus();
+            }
+        } else if (m_bRetry && m_nIndex == (size_t)m_nAnalyze * 2) {
+            m_pList->checkPtsStatus(m_pCorpus->durationHint);
+        }
+        return true;
+    }
+protected:
+    List *m_pList;
+    const FramePosCorpus *m_pCorpus;
+    int m_nAnalyze;
+    bool m_bRetry;
+    size_t m_nIndex;
+};
+
+//FramePosListとFramePosListSortRefに同じパケット列を入力し、
+//確定したフレームの情報、終了後のフレームリスト・duration、copyの結果が一致するか確認する
+//std::sortと比較する場合に、ソートした範囲に同じptsのフレームがあればpbEqualPtsをtrueにする
+static tstring framepos_check_corpus(const FramePosCorpus& corpus, int nAnalyze, bool bRetry, bool bStableSort, bool *pbEqualPts) {
+    FramePosList list;
+    FramePosListSortRef ref(bStableSort);
+    FramePosFeeder<FramePosList> feeder(&list, &corpus, nAnalyze, bRetry);
+    FramePosFeeder<FramePosListSortRef> feederRef(&ref, &corpus, nAnalyze, bRetry);
+    *pbEqualPts = false;
+    for (int i = 0; ; i++) {
+        const bool bNext = feeder.next();
+        feederRef.next();
+        *pbEqualPts = ref.equalPtsSorted();
+        if (list.frameNum() != ref.frameNum() || list.fixedNum() != ref.fixedNum() || list.orderedFixedNum() != ref.orderedFixedNum()) {
+            return strsprintf(_T("frame count mismatch after packet %d (frames %d/%d, fixed %d/%d)."),
+                i, list.frameNum(), ref.frameNum(), list.fixedNum(), ref.fixedNum());
+        }
+        for (int j = 0; j < list.fixedNum(); j++) {
+            if (!framepos_equal(list.list(j), ref.list(j))) {
+                return strsprintf(_T("fixed frame %d mismatch after packet %d (pts %lld/%lld, poc %d/%d)."),
+                    j, i, (long long)list.list(j).pts, (long long)ref.list(j).pts, list.list(j).poc, ref.list(j).poc);
+            }
+        }
+        if (!bNext) {
+            break;
+        }
+    }
+    if (list.duration() != ref.duration() || list.getStreamPtsStatus() != ref.getStreamPtsStatus() || list.getPicStruct() != ref.getPicStruct()) {
+        return _T("stream info mismatch.");
+    }
+    for (int j = 0; j < list.frameNum(); j++) {
+        if (!framepos_equal(list.list(j), ref.list(j))) {
+            return strsprintf(_T("frame %d mismatch after fin."), j);
+        }
+    }
+    uint32_t lastIndex = 0, lastIndexRef = 0;
+    for (int poc = 0; poc < list.frameNum() + 2; poc++) {
+        const FramePos pos = list.copy(poc, &lastIndex);
+        const FramePos posRef = ref.copy(poc, &lastIndexRef);
+        if (!framepos_equal(pos, posRef) || lastIndex != lastIndexRef) {
+            return strsprintf(_T("copy(%d) mismatch."), poc);
+        }
+    }
+    return _T("");
+}
+
+int framepos_check(tstring& str) {
+    vector<FramePosCorpus> corpusList;
+    for (int nFrames : { 40, 150, 1000 }) {
+        corpusList.push_back(framepos_corpus_pyramid(nFrames, 0, _T("b-pyramid")));
+        corpusList.push_back(framepos_corpus_pyramid(nFrames, FRAMEPOS_PTS_WRAP - 60 * 3003, _T("pts-wrap")));
+        corpusList.push_back(framepos_corpus_paff(nFrames));
+        corpusList.push_back(framepos_corpus_vc1(nFrames));
+        corpusList.push_back(framepos_corpus_vp9(nFrames));
+        corpusList.push_back(framepos_corpus_opengop(nFrames));
+        corpusList.push_back(framepos_corpus_es(nFrames));
+        corpusList.push_back(framepos_corpus_jitter(nFrames));
+    }
+    str = strsprintf(_T("%-14s %7s %7s %-6s %-12s %s\n"), _T("corpus"), _T("packets"), _T("analyze"), _T("retry"), _T("reference"), _T("result"));
+    int checked = 0;
+    int failed = 0;
+    int equalPts = 0;
+    for (const auto& corpus : corpusList) {
+        for (int nAnalyze : { 24, 64 }) {
+            for (int bRetry = 0; bRetry < 2; bRetry++) {
+                for (int bStableSort = 0; bStableSort < 2; bStableSort++) {
+                    bool bEqualPts = false;
+                    const tstring error = framepos_check_corpus(corpus, nAnalyze, bRetry != 0, bStableSort != 0, &bEqualPts);
+                    if (error.length() && !bStableSort && bEqualPts) {
+                        //同じptsのフレームの順序はstd::sortでは実装依存なので、stable_sortとの比較のみで確認する
+                        equalPts++;
+                    } else if (error.length()) {
+                        str += strsprintf(_T("%-14s %7d %7d %-6s %-12s %s\n"), corpus.name, (int)corpus.packets.size(), nAnalyze,
+                            (bRetry) ? _T("yes") : _T("no"), (bStableSort) ? _T("stable_sort") : _T("sort"), error.c_str());
+                        failed++;
+                    }
+                    checked++;
+                }
+            }
+        }
+    }
+    str += strsprintf(_T("%d cases checked, %d failed (%d cases with equal pts compared with stable_sort only).\n"), checked, failed, equalPts);
+    return failed;
+}
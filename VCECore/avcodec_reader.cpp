@@ -51,6 +51,7 @@ static inline void extend_array_size(VideoFrameData *dataset) {
 CAvcodecReader::CAvcodecReader() {
     memset(&m_Demux.format, 0, sizeof(m_Demux.format));
     memset(&m_Demux.video,  0, sizeof(m_Demux.video));
+    m_Demux.thread.pWaitVideoFrames = nullptr;
     m_strReaderName = _T("avvce");
 }
 
@@ -59,6 +60,7 @@ CAvcodecReader::~CAvcodecReader() {
 }
 
 void CAvcodecReader::CloseThread() {
+    StopStreamThread(false);
     m_Demux.thread.bAbortInput = true;
     if (m_Demux.thread.thInput.joinable()) {
         m_Demux.qVideoPkt.set_capacity(SIZE_MAX);
@@ -116,7 +118,9 @@ void CAvcodecReader::Close() {
         av_packet_unref(&m_Demux.qStreamPktL1[i]);
     }
     m_Demux.qStreamPktL1.clear();
-    m_Demux.qStreamPktL2.close([](AVPacket *pkt) { av_packet_unref(pkt); });
+    //qStreamPktL2に残ったパケットは、closeでunique_ptrごと開放される
+    m_Demux.qStreamPktL2.close();
+    m_Demux.qStreamPktL2Pts.clear();
     AddMessage(VCE_LOG_DEBUG, _T("Cleared Stream Packet Buffer.\n"));
 
     CloseFormat(&m_Demux.format);
@@ -281,7 +285,7 @@ AMF_RESULT CAvcodecReader::getFirstFramePosAndFrameRate(const sTrim *pTrimList,
             frameDurationList.clear();
         }
         for (; i_samples < maxCheckFrames && !getSample(&pkt); i_samples++) {
-            m_Demux.qVideoPkt.push(pkt);
+            pushVideoPacketNoThread(&pkt);
             if (bCheckDuration) {
                 int64_t diff = 0;
                 if (pkt.dts != AV_NOPTS_VALUE && m_Demux.frames.list(0).dts != AV_NOPTS_VALUE) {
@@ -1034,7 +1038,7 @@ AMF_RESULT CAvcodecReader::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> p
             };
             auto pixCspConv = CSP_CONV.find(m_Demux.video.pCodecCtx->pix_fmt);
             if (pixCspConv == CSP_CONV.end()
-                || nullptr == (m_sConvert = get_convert_csp_func(pixCspConv->second, VCE_CSP_NV12, false))) {
+                || nullptr == (m_sConvert = get_convert_csp_func(pixCspConv->second, VCE_CSP_NV12, false, m_nConvertDither))) {
                 AddMessage(VCE_LOG_ERROR, _T("invalid colorformat.\n"));
                 return AMF_INVALID_FORMAT;
             }
@@ -1052,7 +1056,7 @@ AMF_RESULT CAvcodecReader::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> p
         m_inputFrameInfo.AspectRatioH = ((bAspectRatioUnknown) ? 0 : aspectRatio.den);
         m_inputFrameInfo.frames       = 0;
         //インタレの可能性があるときは、MFX_PICSTRUCT_UNKNOWNを返すようにする
-        m_inputFrameInfo.nPicStruct   = m_Demux.frames.getPicStruct();
+        m_inputFrameInfo.nPicStruct   = picstruct_avqsv_to_vce(m_Demux.frames.getPicStruct());
 
         const tstring codecStr = (const TCHAR *)((bDecodecVCE) ? CodecIdToStr(m_nInputCodec) : char_to_tstring(avcodec_get_name(m_Demux.video.pCodecCtx->codec_id))).c_str();
         tstring mes = strsprintf(_T("%s: %s, %dx%d, %d/%d fps"), m_strReaderName.c_str(), codecStr.c_str(),
@@ -1065,7 +1069,12 @@ AMF_RESULT CAvcodecReader::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> p
         m_strInputInfo += mes;
 
         //スレッド関連初期化
-        m_Demux.thread.pQueueInfo = nullptr;
+        m_Demux.thread.pQueueInfo = input_prm->pQueueInfo;
+        if (m_Demux.thread.pQueueInfo) {
+            //先読みでのデータの出し入れは統計に含めない
+            m_Demux.qVideoPkt.set_stats(&m_Demux.thread.pQueueInfo->stats[PERF_QUEUE_VID_IN]);
+            m_Demux.qStreamPktL2.set_stats(&m_Demux.thread.pQueueInfo->stats[PERF_QUEUE_AUD_IN]);
+        }
         m_Demux.thread.bAbortInput = false;
         auto nPrmInputThread = input_prm->nInputThread;
         m_Demux.thread.nInputThread = ((nPrmInputThread == VCE_INPUT_THREAD_AUTO) | (m_Demux.video.pCodec != nullptr)) ? 0 : nPrmInputThread;;
@@ -1073,10 +1082,11 @@ AMF_RESULT CAvcodecReader::init(shared_ptr<VCELog> pLog, shared_ptr<VCEStatus> p
         //    m_Demux.thread.nInputThread = 0;
         //}
         if (m_Demux.thread.nInputThread) {
-            m_Demux.thread.thInput = std::thread(&CAvcodecReader::ThreadFuncRead, this);
             //はじめcapacityを無限大にセットしたので、この段階で制限をかける
             //入力をスレッド化しない場合には、自動的に同期が保たれるので、ここでの制限は必要ない
+            //読み込みスレッドはリングの拡張を行わないので、スレッドの開始前に制限する
             m_Demux.qVideoPkt.set_capacity(256);
+            m_Demux.thread.thInput = std::thread(&CAvcodecReader::ThreadFuncRead, this);
         }
     } else {
         //スレッド関連初期化 (スレッドは使用しないが、pQueueInfoはnullにしておく必要がある)
@@ -1140,7 +1150,43 @@ FramePosList *CAvcodecReader::GetFramePosList() {
 int CAvcodecReader::getVideoFrameIdx(int64_t pts, AVRational timebase, int iStart) {
     const int framePosCount = m_Demux.frames.frameNum();
     const AVRational vid_pkt_timebase = (m_Demux.video.pCodecCtx) ? m_Demux.video.pCodecCtx->pkt_timebase : av_inv_q(m_Demux.video.nAvgFramerate);
-    for (int i = (std::max)(0, iStart); i < framePosCount; i++) {
+    int i = (std::max)(0, iStart);
+    //ptsが単調増加となっている確定済みの範囲は、iStartから範囲を倍々に広げたのち二分探索する
+    const int nOrderedNum = m_Demux.frames.orderedFixedNum();
+    if (i < nOrderedNum) {
+        //映像のtimebaseに切り捨てで変換しておけば、映像のptsとは整数の比較でav_compare_tsと同じ結果が得られる
+        const int64_t ptsInVidTimebase = av_rescale_rnd(pts,
+            timebase.num * (int64_t)vid_pkt_timebase.den,
+            vid_pkt_timebase.num * (int64_t)timebase.den, AV_ROUND_DOWN);
+        //pts < demux.videoFramePts[i]となる最初のiを探す
+        int nLow = i;  //[iStart, nLow)はpts >= videoFramePts
+        int nHigh = i; //nHighはpts < videoFramePts (nOrderedNumなら見つかっていない)
+        for (int nStep = 1; ; nStep <<= 1) {
+            nHigh = (std::min)(nLow + nStep, nOrderedNum);
+            if (ptsInVidTimebase < m_Demux.frames.list(nHigh - 1).pts) {
+                nHigh--;
+                break;
+            }
+            nLow = nHigh;
+            if (nHigh >= nOrderedNum) {
+                break;
+            }
+        }
+        while (nLow < nHigh) {
+            const int nMid = nLow + (nHigh - nLow) / 2;
+            if (ptsInVidTimebase < m_Demux.frames.list(nMid).pts) {
+                nHigh = nMid;
+            } else {
+                nLow = nMid + 1;
+            }
+        }
+        if (nLow < nOrderedNum) {
+            return nLow - 1;
+        }
+        i = nOrderedNum;
+    }
+    //それ以降は順に探す
+    for (; i < framePosCount; i++) {
         //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
         if (0 > av_compare_ts(pts, timebase, m_Demux.frames.list(i).pts, vid_pkt_timebase)) {
             return i - 1;
@@ -1322,8 +1368,11 @@ int CAvcodecReader::getSample(AVPacket *pkt, bool bTreatFirstPacketAsKeyframe) {
     }
     //もし選択範囲が手動で決定されていないのなら、音声を最大限取得する
     if (m_sTrimParam.list.size() == 0 || m_sTrimParam.list.back().fin == TRIM_MAX) {
-        for (uint32_t i = 0; i < m_Demux.qStreamPktL2.size(); i++) {
-            videoFinPts = (std::max)(videoFinPts, m_Demux.qStreamPktL2[i].data.pts);
+        //qStreamPktL2の中身は押し込み側から参照できないので、まだ取り出されていないパケット
+        //(押し込んだパケットのうち最後のsize()個) のptsを押し込み側で記録したものから探す
+        const size_t nPtsCount = m_Demux.qStreamPktL2Pts.size();
+        for (size_t i = nPtsCount - (std::min)(m_Demux.qStreamPktL2.size(), nPtsCount); i < nPtsCount; i++) {
+            videoFinPts = (std::max)(videoFinPts, m_Demux.qStreamPktL2Pts[i]);
         }
         for (uint32_t i = 0; i < m_Demux.qStreamPktL1.size(); i++) {
             videoFinPts = (std::max)(videoFinPts, m_Demux.qStreamPktL1[i].pts);
@@ -1360,7 +1409,7 @@ AMF_RESULT CAvcodecReader::GetNextBitstream(amf::AMFData **ppData) {
     if (!m_Demux.thread.thInput.joinable() //入力スレッドがなければ、自分で読み込む
         && m_Demux.qVideoPkt.get_keep_length() > 0) { //keep_length == 0なら読み込みは終了していて、これ以上読み込む必要はない
         if (0 == getSample(&pkt)) {
-            m_Demux.qVideoPkt.push(pkt);
+            pushVideoPacketNoThread(&pkt);
         }
     }
 
@@ -1394,8 +1443,7 @@ AMF_RESULT CAvcodecReader::QueryOutput(amf::AMFData **ppData) {
         //動画のデコードを行う
         amf::AMFSurfacePtr pSurface;
         res = m_pContext->AllocSurface(amf::AMF_MEMORY_HOST, m_inputFrameInfo.format,
-            m_inputFrameInfo.srcWidth - m_inputFrameInfo.crop.left - m_inputFrameInfo.crop.right,
-            m_inputFrameInfo.srcHeight - m_inputFrameInfo.crop.bottom - m_inputFrameInfo.crop.up,
+            getSurfaceWidth(), getSurfaceHeight(),
             &pSurface);
         if (res != AMF_OK) {
             AddMessage(VCE_LOG_ERROR, _T("AMFContext::AllocSurface(amf::AMF_MEMORY_HOST) failed.\n"));
@@ -1408,7 +1456,7 @@ AMF_RESULT CAvcodecReader::QueryOutput(amf::AMFData **ppData) {
             if (!m_Demux.thread.thInput.joinable() //入力スレッドがなければ、自分で読み込む
                 && m_Demux.qVideoPkt.get_keep_length() > 0) { //keep_length == 0なら読み込みは終了していて、これ以上読み込む必要はない
                 if (0 == getSample(&pkt)) {
-                    m_Demux.qVideoPkt.push(pkt);
+                    pushVideoPacketNoThread(&pkt);
                 }
             }
 
@@ -1441,7 +1489,7 @@ AMF_RESULT CAvcodecReader::QueryOutput(amf::AMFData **ppData) {
         dst_array[1] = (uint8_t *)dst_array[0] + dst_stride * dst_height;
         dst_array[2] = (uint8_t *)dst_array[1] + dst_stride * dst_height; //YUV444出力時
 
-        m_sConvert->func[!!m_Demux.video.pFrame->interlaced_frame](dst_array, (const void **)m_Demux.video.pFrame->data, m_inputFrameInfo.srcWidth, m_Demux.video.pFrame->linesize[0], m_Demux.video.pFrame->linesize[1], dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
+        convertCsp(!!m_Demux.video.pFrame->interlaced_frame, dst_array, (const void **)m_Demux.video.pFrame->data, m_inputFrameInfo.srcWidth, m_Demux.video.pFrame->linesize[0], m_Demux.video.pFrame->linesize[1], dst_stride, m_inputFrameInfo.srcHeight, dst_height, m_inputFrameInfo.crop.c);
         if (got_frame) {
             av_frame_unref(m_Demux.video.pFrame);
         }
@@ -1454,7 +1502,7 @@ AMF_RESULT CAvcodecReader::QueryOutput(amf::AMFData **ppData) {
         res = GetNextBitstream(ppData);
     }
     //進捗のみ表示
-    m_pEncSatusInfo->m_nInputFrames++;
+    m_pEncSatusInfo->AddInputFrame();
     double progressPercent = 0.0;
     if (m_Demux.format.pFormatCtx->duration) {
         progressPercent = m_Demux.frames.duration() * (m_Demux.video.pCodecCtx->pkt_timebase.num / (double)m_Demux.video.pCodecCtx->pkt_timebase.den) / (m_Demux.format.pFormatCtx->duration * (1.0 / (double)AV_TIME_BASE)) * 100.0;
@@ -1469,7 +1517,7 @@ AMF_RESULT CAvcodecReader::GetNextBitstreamNoDelete(amf::AMFData **ppData) {
     if (!m_Demux.thread.thInput.joinable() //入力スレッドがなければ、自分で読み込む
         && m_Demux.qVideoPkt.get_keep_length() > 0) { //keep_length == 0なら読み込みは終了していて、これ以上読み込む必要はない
         if (0 == getSample(&pkt)) {
-            m_Demux.qVideoPkt.push(pkt);
+            pushVideoPacketNoThread(&pkt);
         }
     }
 
@@ -1564,6 +1612,8 @@ void CAvcodecReader::CheckAndMoveStreamPacketList() {
     }
     //出力するパケットを選択する
     const AVRational vid_pkt_timebase = (m_Demux.video.pCodecCtx) ? m_Demux.video.pCodecCtx->pkt_timebase : av_inv_q(m_Demux.video.nAvgFramerate);
+    //Writer側に渡すパケットはまとめてキューに追加する
+    vector<AVPacket> packets;
     while (!m_Demux.qStreamPktL1.empty()) {
         auto pkt = m_Demux.qStreamPktL1.front();
         AVDemuxStream *pStream = getPacketStreamData(&pkt);
@@ -1573,12 +1623,112 @@ void CAvcodecReader::CheckAndMoveStreamPacketList() {
         }
         if (checkStreamPacketToAdd(&pkt, pStream)) {
             pkt.flags = (pkt.flags & 0xffff) | (pStream->nTrackId << 16); //flagsの上位16bitには、trackIdへのポインタを格納しておく
-            m_Demux.qStreamPktL2.push(pkt); //Writer側に渡したパケットはWriter側で開放する
+            packets.push_back(pkt); //Writer側に渡したパケットはWriter側で開放する
         } else {
             av_packet_unref(&pkt); //Writer側に渡さないパケットはここで開放する
         }
         m_Demux.qStreamPktL1.pop_front();
     }
+    if (packets.size() > 0) {
+        if (m_StreamPacketSink) {
+            //Writer側に直接渡す
+            if (AMF_OK != m_StreamPacketSink(packets.data(), packets.size())) {
+                AddMessage(VCE_LOG_ERROR, _T("Failed to send stream packets to writer.\n"));
+            }
+        } else {
+            //qStreamPktL2は容量無制限なので、リングが足りなければここで拡張してから押し込む
+            //パケットの所有権はunique_ptrごとキューに移すので、取り出されずに残ったパケットもキューの破棄時に開放される
+            bool bPushed = m_Demux.qStreamPktL2.reserve(m_Demux.qStreamPktL2.size() + packets.size());
+            for (auto& pkt : packets) {
+                std::unique_ptr<AVPacket, av_packet_deleter> pPkt((bPushed) ? av_packet_alloc() : nullptr);
+                if (!pPkt) {
+                    av_packet_unref(&pkt);
+                    bPushed = false;
+                    continue;
+                }
+                av_packet_move_ref(pPkt.get(), &pkt);
+                m_Demux.qStreamPktL2Pts.push_back(pPkt->pts);
+                m_Demux.qStreamPktL2.push(std::move(pPkt));
+            }
+            if (!bPushed) {
+                AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for stream packet queue.\n"));
+            }
+            //取り出し済みのパケットのptsは不要なので捨てる
+            while (m_Demux.qStreamPktL2Pts.size() > m_Demux.qStreamPktL2.size()) {
+                m_Demux.qStreamPktL2Pts.pop_front();
+            }
+        }
+    }
+}
+
+AMF_RESULT CAvcodecReader::SetStreamPacketSink(std::function<AMF_RESULT(AVPacket *pkts, size_t nCount)> sink) {
+    if (m_Demux.thread.thInput.joinable() || m_Demux.thread.thStream.joinable()) {
+        return AMF_NOT_SUPPORTED;
+    }
+    m_StreamPacketSink = sink;
+    if (m_StreamPacketSink) {
+        //すでにキューにあるパケットは先に渡しておく
+        auto packets = PopStreamPacketList(nullptr);
+        if (packets.size() > 0) {
+            return m_StreamPacketSink(packets.data(), packets.size());
+        }
+    }
+    return AMF_OK;
+}
+
+bool CAvcodecReader::IsReadingVideo() const {
+    return m_Demux.video.bReadVideo;
+}
+
+AMF_RESULT CAvcodecReader::StartStreamThread(std::function<int()> getVideoFrames, CQueueWaiter *pWaitVideoFrames) {
+    if (m_Demux.video.bReadVideo || !m_StreamPacketSink) {
+        return AMF_NOT_SUPPORTED;
+    }
+    if (m_Demux.thread.thStream.joinable()) {
+        return AMF_OK;
+    }
+    m_Demux.thread.nStreamThreadState = AVDEMUX_STREAM_THREAD_RUN;
+    m_Demux.thread.pWaitVideoFrames = pWaitVideoFrames;
+    m_Demux.thread.thStream = std::thread(&CAvcodecReader::ThreadFuncStream, this, getVideoFrames, pWaitVideoFrames);
+    AddMessage(VCE_LOG_DEBUG, _T("Started stream read thread.\n"));
+    return AMF_OK;
+}
+
+void CAvcodecReader::StopStreamThread(bool bDrain) {
+    if (m_Demux.thread.thStream.joinable()) {
+        m_Demux.thread.nStreamThreadState = (bDrain) ? AVDEMUX_STREAM_THREAD_DRAIN : AVDEMUX_STREAM_THREAD_ABORT;
+        //映像側の読み込みを待機していれば起床させる
+        if (m_Demux.thread.pWaitVideoFrames) {
+            m_Demux.thread.pWaitVideoFrames->notify();
+        }
+        m_Demux.thread.thStream.join();
+        AddMessage(VCE_LOG_DEBUG, _T("Closed stream read thread.\n"));
+    }
+}
+
+AMF_RESULT CAvcodecReader::ThreadFuncStream(std::function<int()> getVideoFrames, CQueueWaiter *pWaitVideoFrames) {
+    //映像側よりおよそ1秒分先まで読み込んでおく
+    const int nLeadFrames = (std::max)(1, (int)(av_q2d(m_Demux.video.nAvgFramerate) + 0.5));
+    int state = AVDEMUX_STREAM_THREAD_RUN;
+    while (!m_Demux.frames.isEof()
+        && AVDEMUX_STREAM_THREAD_ABORT != (state = m_Demux.thread.nStreamThreadState)) {
+        const int nVideoFrames = getVideoFrames();
+        //終了時は映像側で読み込み済みの位置まで読み込めばよい
+        const int nTargetFrames = (state == AVDEMUX_STREAM_THREAD_DRAIN) ? nVideoFrames : nVideoFrames + nLeadFrames;
+        if ((int)m_Demux.video.nSampleGetCount >= nTargetFrames) {
+            if (state == AVDEMUX_STREAM_THREAD_DRAIN) {
+                break;
+            }
+            //映像側の読み込みが進むか、スレッドの終了が指示されるまで待機する
+            pWaitVideoFrames->wait([&]() {
+                return getVideoFrames() + nLeadFrames > (int)m_Demux.video.nSampleGetCount
+                    || m_Demux.thread.nStreamThreadState != AVDEMUX_STREAM_THREAD_RUN;
+            }, INFINITE);
+            continue;
+        }
+        GetAudioDataPacketsWhenNoVideoRead();
+    }
+    return AMF_OK;
 }
 
 vector<AVPacket> CAvcodecReader::GetStreamDataPackets() {
@@ -1587,10 +1737,17 @@ vector<AVPacket> CAvcodecReader::GetStreamDataPackets() {
     }
 
     //出力するパケットを選択する
-    vector<AVPacket> packets;
-    AVPacket pkt;
-    while (m_Demux.qStreamPktL2.front_copy_and_pop_no_lock(&pkt, (m_Demux.thread.pQueueInfo) ? &m_Demux.thread.pQueueInfo->usage_aud_in : nullptr)) {
-        packets.push_back(pkt);
+    //キューにあるパケットをまとめて取り出す
+    return PopStreamPacketList((m_Demux.thread.pQueueInfo) ? &m_Demux.thread.pQueueInfo->usage_aud_in : nullptr);
+}
+
+vector<AVPacket> CAvcodecReader::PopStreamPacketList(size_t *pnSize) {
+    vector<std::unique_ptr<AVPacket, av_packet_deleter>> pktPtrs(m_Demux.qStreamPktL2.size());
+    pktPtrs.resize(m_Demux.qStreamPktL2.pop_n(pktPtrs.data(), pktPtrs.size(), pnSize));
+    //中身のデータの参照はWriter側に渡すAVPacketに移し、AVPacket自体はunique_ptrの破棄で開放する
+    vector<AVPacket> packets(pktPtrs.size());
+    for (size_t i = 0; i < pktPtrs.size(); i++) {
+        av_packet_move_ref(&packets[i], pktPtrs[i].get());
     }
     return std::move(packets);
 }
@@ -1695,13 +1852,23 @@ HANDLE CAvcodecReader::getThreadHandleInput() {
 #endif //#if defined(WIN32) || defined(WIN64)
 }
 
+void CAvcodecReader::pushVideoPacketNoThread(AVPacket *pkt) {
+    if (!m_Demux.qVideoPkt.reserve(m_Demux.qVideoPkt.size() + 1)
+        || !m_Demux.qVideoPkt.push(*pkt)) {
+        AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for video packet queue.\n"));
+        av_packet_unref(pkt);
+    }
+}
+
 AMF_RESULT CAvcodecReader::ThreadFuncRead() {
     while (!m_Demux.thread.bAbortInput) {
         AVPacket pkt;
         if (getSample(&pkt)) {
             break;
         }
-        m_Demux.qVideoPkt.push(pkt);
+        if (!m_Demux.qVideoPkt.push(pkt)) {
+            av_packet_unref(&pkt);
+        }
     }
     return AMF_OK;
 }
@@ -99,6 +99,13 @@ static const TCHAR *AVVCE_CODEC_COPY = _T("copy");
 
 static const int AVQSV_DEFAULT_AUDIO_BITRATE = 192;
 
+//AVPacketを所有権ごとunique_ptrで受け渡す際 (CQueueSPSPMoveなど) に使用する
+struct av_packet_deleter {
+    void operator()(AVPacket *pkt) const {
+        av_packet_free(&pkt);
+    }
+};
+
 static inline bool av_isvalid_q(AVRational q) {
     return q.den * q.num != 0;
 }
@@ -198,44 +198,23 @@ void CAvcodecWriter::CloseQueues() {
 
 void CAvcodecWriter::CloseThread() {
 #if ENABLE_AVCODEC_OUT_THREAD
+    //停止フラグを立ててから通知すれば、待機中のスレッドは必ず起床してフラグを確認する
     m_Mux.thread.bThAudEncodeAbort = true;
     if (m_Mux.thread.thAudEncode.joinable()) {
-        //下記同様に、m_Mux.thread.heEventThOutputClosingがセットされるまで、
-        //SetEvent(m_Mux.thread.heEventThOutputPktAdded)を実行し続ける必要がある。
-        while (WAIT_TIMEOUT == WaitForSingleObject(m_Mux.thread.heEventClosingAudEncode, 100)) {
-            SetEvent(m_Mux.thread.heEventPktAddedAudEncode);
-        }
+        m_Mux.thread.waitAudEncode.notify();
         m_Mux.thread.thAudEncode.join();
-        CloseEvent(m_Mux.thread.heEventPktAddedAudEncode);
-        CloseEvent(m_Mux.thread.heEventClosingAudEncode);
         AddMessage(VCE_LOG_DEBUG, _T("closed audio encode thread...\n"));
     }
     m_Mux.thread.bThAudProcessAbort = true;
     if (m_Mux.thread.thAudProcess.joinable()) {
-        //下記同様に、m_Mux.thread.heEventThOutputClosingがセットされるまで、
-        //SetEvent(m_Mux.thread.heEventThOutputPktAdded)を実行し続ける必要がある。
-        while (WAIT_TIMEOUT == WaitForSingleObject(m_Mux.thread.heEventClosingAudProcess, 100)) {
-            SetEvent(m_Mux.thread.heEventPktAddedAudProcess);
-        }
+        m_Mux.thread.waitAudProcess.notify();
         m_Mux.thread.thAudProcess.join();
-        CloseEvent(m_Mux.thread.heEventPktAddedAudProcess);
-        CloseEvent(m_Mux.thread.heEventClosingAudProcess);
         AddMessage(VCE_LOG_DEBUG, _T("closed audio process thread...\n"));
     }
     m_Mux.thread.bAbortOutput = true;
     if (m_Mux.thread.thOutput.joinable()) {
-        //ここに来た時に、まだメインスレッドがループ中の可能性がある
-        //その場合、SetEvent(m_Mux.thread.heEventPktAddedOutput)を一度やるだけだと、
-        //そのあとにResetEvent(m_Mux.thread.heEventPktAddedOutput)が発生してしまい、
-        //ここでスレッドが停止してしまう。
-        //これを回避するため、m_Mux.thread.heEventClosingOutputがセットされるまで、
-        //SetEvent(m_Mux.thread.heEventPktAddedOutput)を実行し続ける必要がある。
-        while (WAIT_TIMEOUT == WaitForSingleObject(m_Mux.thread.heEventClosingOutput, 100)) {
-            SetEvent(m_Mux.thread.heEventPktAddedOutput);
-        }
+        m_Mux.thread.waitOutput.notify();
         m_Mux.thread.thOutput.join();
-        CloseEvent(m_Mux.thread.heEventPktAddedOutput);
-        CloseEvent(m_Mux.thread.heEventClosingOutput);
         AddMessage(VCE_LOG_DEBUG, _T("closed output thread...\n"));
     }
     CloseQueues();
@@ -1487,21 +1466,26 @@ AMF_RESULT CAvcodecWriter::Init(const tstring& dstFile, const void *pOption, sha
         m_Mux.thread.qVideobitstream.init(4096, (std::max)(64, (m_Mux.video.nFPS.den) ? m_Mux.video.nFPS.num * 4 / m_Mux.video.nFPS.den : 0));
         m_Mux.thread.qVideobitstreamFreeI.init(256);
         m_Mux.thread.qVideobitstreamFreePB.init(3840);
-        m_Mux.thread.heEventPktAddedOutput = CreateEvent(NULL, TRUE, FALSE, NULL);
-        m_Mux.thread.heEventClosingOutput  = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (m_Mux.thread.pQueueInfo) {
+            m_Mux.thread.qAudioPacketOut.set_stats(&m_Mux.thread.pQueueInfo->stats[PERF_QUEUE_AUD_OUT]);
+            m_Mux.thread.qVideobitstream.set_stats(&m_Mux.thread.pQueueInfo->stats[PERF_QUEUE_VID_OUT]);
+        }
+        //出力スレッドは映像・音声のどちらのキューへの追加でも起床する
+        m_Mux.thread.qAudioPacketOut.set_push_waiter(&m_Mux.thread.waitOutput);
+        m_Mux.thread.qVideobitstream.set_push_waiter(&m_Mux.thread.waitOutput);
         m_Mux.thread.thOutput = std::thread(&CAvcodecWriter::WriteThreadFunc, this);
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
         if (m_Mux.thread.bEnableAudProcessThread) {
             AddMessage(VCE_LOG_DEBUG, _T("starting audio process thread...\n"));
             m_Mux.thread.qAudioPacketProcess.init(8192, 512, 4);
-            m_Mux.thread.heEventPktAddedAudProcess = CreateEvent(NULL, TRUE, FALSE, NULL);
-            m_Mux.thread.heEventClosingAudProcess  = CreateEvent(NULL, TRUE, FALSE, NULL);
+            m_Mux.thread.qAudioPacketProcess.set_stats((m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->stats[PERF_QUEUE_AUD_PROC] : nullptr);
+            m_Mux.thread.qAudioPacketProcess.set_push_waiter(&m_Mux.thread.waitAudProcess);
             m_Mux.thread.thAudProcess = std::thread(&CAvcodecWriter::ThreadFuncAudThread, this);
             if (m_Mux.thread.bEnableAudEncodeThread) {
                 AddMessage(VCE_LOG_DEBUG, _T("starting audio encode thread...\n"));
-                m_Mux.thread.qAudioFrameEncode.init(8192, 512, 4);
-                m_Mux.thread.heEventPktAddedAudEncode = CreateEvent(NULL, TRUE, FALSE, NULL);
-                m_Mux.thread.heEventClosingAudEncode  = CreateEvent(NULL, TRUE, FALSE, NULL);
+                m_Mux.thread.qAudioFrameEncode.init(32768, 512, 4);
+                m_Mux.thread.qAudioFrameEncode.set_stats((m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->stats[PERF_QUEUE_AUD_ENC] : nullptr);
+                m_Mux.thread.qAudioFrameEncode.set_push_waiter(&m_Mux.thread.waitAudEncode);
                 m_Mux.thread.thAudEncode = std::thread(&CAvcodecWriter::ThreadFuncAudEncodeThread, this);
             }
         }
@@ -1864,7 +1848,6 @@ AMF_RESULT CAvcodecWriter::WriteNextFrame(amf::AMFData *pData) {
             AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for video bitstream queue.\n"));
             m_Mux.format.bStreamError = true;
         }
-        SetEvent(m_Mux.thread.heEventPktAddedOutput);
         return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
     }
 #endif
@@ -2006,8 +1989,11 @@ AMF_RESULT CAvcodecWriter::WriteNextFrameInternal(sBitstream *pBitstream, int64_
     //最初のヘッダーを書いたパケットはコピーではないので、キューに入れない
     if (m_Mux.thread.thOutput.joinable() && m_Mux.format.bFileHeaderWritten) {
         //確保したメモリ領域を使いまわすためにスタックに格納
+        //キューのリングが満杯なら使いまわさずに開放する
         auto& qVideoQueueFree = (pBitstream->DataLength > 10 * 1024) ? m_Mux.thread.qVideobitstreamFreeI : m_Mux.thread.qVideobitstreamFreePB;
-        qVideoQueueFree.push(*pBitstream);
+        if (!qVideoQueueFree.push(*pBitstream)) {
+            bitstreamClear(pBitstream);
+        }
     } else {
 #endif
         pBitstream->DataLength = 0;
@@ -2017,7 +2003,15 @@ AMF_RESULT CAvcodecWriter::WriteNextFrameInternal(sBitstream *pBitstream, int64_
 #endif
     //最初のヘッダーを書いたパケットが書き終わってからフラグを立てる
     //このタイミングで立てないと出力スレッドが先に動作してしまうことがある
-    m_Mux.format.bFileHeaderWritten = true;
+    if (!m_Mux.format.bFileHeaderWritten) {
+        m_Mux.format.bFileHeaderWritten = true;
+#if ENABLE_AVCODEC_OUT_THREAD
+        //ヘッダーの出力を待っている各スレッドを起こす
+        m_Mux.thread.waitOutput.notify();
+        m_Mux.thread.waitAudProcess.notify();
+        m_Mux.thread.waitAudEncode.notify();
+#endif
+    }
     return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
 }
 
@@ -2546,21 +2540,54 @@ AMF_RESULT CAvcodecWriter::WriteNextPacket(AVPacket *pkt) {
     AVPktMuxData pktData = pktMuxData(pkt);
 #if ENABLE_AVCODEC_OUT_THREAD
     if (m_Mux.thread.thOutput.joinable()) {
-        auto& audioQueue   = (m_Mux.thread.thAudProcess.joinable()) ? m_Mux.thread.qAudioPacketProcess : m_Mux.thread.qAudioPacketOut;
-        auto heEventPktAdd = (m_Mux.thread.thAudProcess.joinable()) ? m_Mux.thread.heEventPktAddedAudProcess : m_Mux.thread.heEventPktAddedOutput;
+        auto& audioQueue = (m_Mux.thread.thAudProcess.joinable()) ? m_Mux.thread.qAudioPacketProcess : m_Mux.thread.qAudioPacketOut;
         //pkt = nullptrの代理として、pkt.buf == nullptrなパケットを投入
         AVPktMuxData zeroFilled = { 0 };
         if (!audioQueue.push((pkt == nullptr) ? zeroFilled : pktData)) {
             AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for audio packet queue.\n"));
             m_Mux.format.bStreamError = true;
         }
-        SetEvent(heEventPktAdd);
         return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
     }
 #endif
     return WriteNextPacketInternal(&pktData);
 }
 
+AMF_RESULT CAvcodecWriter::WriteNextPackets(AVPacket *pkts, size_t nCount) {
+#if ENABLE_AVCODEC_OUT_THREAD
+    if (m_Mux.thread.thOutput.joinable()) {
+        auto& audioQueue = (m_Mux.thread.thAudProcess.joinable()) ? m_Mux.thread.qAudioPacketProcess : m_Mux.thread.qAudioPacketOut;
+        vector<AVPktMuxData> pktDataList;
+        pktDataList.reserve(nCount);
+        for (size_t i = 0; i < nCount; i++) {
+            pktDataList.push_back(pktMuxData(&pkts[i]));
+        }
+        //キューへの追加と通知はまとめて行う
+        if (!audioQueue.push_n(pktDataList.data(), pktDataList.size())) {
+            AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for audio packet queue.\n"));
+            m_Mux.format.bStreamError = true;
+        }
+        return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
+    }
+#endif
+    for (size_t i = 0; i < nCount; i++) {
+        AMF_RESULT sts = WriteNextPacket(&pkts[i]);
+        if (sts != AMF_OK) {
+            return sts;
+        }
+    }
+    return AMF_OK;
+}
+
+bool CAvcodecWriter::AcceptsConcurrentPackets() {
+#if ENABLE_AVCODEC_OUT_THREAD
+    //出力スレッドがあれば、WriteNextPacketsはキューへの追加のみとなる
+    return m_Mux.thread.thOutput.joinable();
+#else
+    return false;
+#endif
+}
+
 #pragma warning(push)
 #pragma warning(disable: 4100)
 //指定された音声キューに追加する
@@ -2568,13 +2595,11 @@ AMF_RESULT CAvcodecWriter::AddAudQueue(AVPktMuxData *pktData, int type) {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
     if (m_Mux.thread.thAudProcess.joinable()) {
         //出力キューに追加する
-        auto& qAudio       = (type == AUD_QUEUE_OUT) ? m_Mux.thread.qAudioPacketOut       : ((type == AUD_QUEUE_PROCESS) ? m_Mux.thread.qAudioPacketProcess       : m_Mux.thread.qAudioFrameEncode);
-        auto& heEventAdded = (type == AUD_QUEUE_OUT) ? m_Mux.thread.heEventPktAddedOutput : ((type == AUD_QUEUE_PROCESS) ? m_Mux.thread.heEventPktAddedAudProcess : m_Mux.thread.heEventPktAddedAudEncode);
+        auto& qAudio = (type == AUD_QUEUE_OUT) ? m_Mux.thread.qAudioPacketOut : ((type == AUD_QUEUE_PROCESS) ? m_Mux.thread.qAudioPacketProcess : m_Mux.thread.qAudioFrameEncode);
         if (!qAudio.push(*pktData)) {
             AddMessage(VCE_LOG_ERROR, _T("Failed to allocate memory for audio queue.\n"));
             m_Mux.format.bStreamError = true;
         }
-        SetEvent(heEventAdded);
         return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
     } else
 #endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
@@ -2886,19 +2911,23 @@ AMF_RESULT CAvcodecWriter::WriteNextAudioFrame(AVPktMuxData *pktData) {
 
 AMF_RESULT CAvcodecWriter::ThreadFuncAudEncodeThread() {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
-    WaitForSingleObject(m_Mux.thread.heEventPktAddedAudEncode, INFINITE);
     while (!m_Mux.thread.bThAudEncodeAbort) {
-        if (!m_Mux.format.bFileHeaderWritten) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        } else {
-            AVPktMuxData pktData = { 0 };
-            while (m_Mux.thread.qAudioFrameEncode.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->usage_aud_enc : nullptr)) {
-                //音声エンコードを実行、出力キューに追加する
-                WriteNextAudioFrame(&pktData);
+        if (m_Mux.format.bFileHeaderWritten) {
+            //キューからまとめて取り出して処理する
+            AVPktMuxData pktDataList[32];
+            size_t nCount = 0;
+            while (0 < (nCount = m_Mux.thread.qAudioFrameEncode.pop_n(pktDataList, _countof(pktDataList), (m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->usage_aud_enc : nullptr))) {
+                for (size_t i = 0; i < nCount; i++) {
+                    //音声エンコードを実行、出力キューに追加する
+                    WriteNextAudioFrame(&pktDataList[i]);
+                }
             }
         }
-        ResetEvent(m_Mux.thread.heEventPktAddedAudEncode);
-        WaitForSingleObject(m_Mux.thread.heEventPktAddedAudEncode, 16);
+        //ヘッダーが出力され、キューにデータが追加されるまで待機する
+        m_Mux.thread.waitAudEncode.wait([this]() {
+            return m_Mux.thread.bThAudEncodeAbort
+                || (m_Mux.format.bFileHeaderWritten && !m_Mux.thread.qAudioFrameEncode.empty());
+        }, INFINITE);
     }
     {   //音声をすべてエンコード
         AVPktMuxData pktData = { 0 };
@@ -2906,26 +2935,29 @@ AMF_RESULT CAvcodecWriter::ThreadFuncAudEncodeThread() {
             WriteNextAudioFrame(&pktData);
         }
     }
-    SetEvent(m_Mux.thread.heEventClosingAudEncode);
 #endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
     return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
 }
 
 AMF_RESULT CAvcodecWriter::ThreadFuncAudThread() {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
-    WaitForSingleObject(m_Mux.thread.heEventPktAddedAudProcess, INFINITE);
     while (!m_Mux.thread.bThAudProcessAbort) {
-        if (!m_Mux.format.bFileHeaderWritten) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        } else {
-            AVPktMuxData pktData = { 0 };
-            while (m_Mux.thread.qAudioPacketProcess.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->usage_aud_proc : nullptr)) {
+        //キューからまとめて取り出して処理する
+        //ヘッダーの出力前もキューを空けておかないと、キューに追加する読み込みスレッド (映像も読み込んでいる) が止まり、
+        //ヘッダーが出力されなくなってしまう
+        //ヘッダーの出力前のパケットは、WriteNextPacketInternalでキャッシュ(m_AudPktBufFileHead)に移される
+        AVPktMuxData pktDataList[32];
+        size_t nCount = 0;
+        while (0 < (nCount = m_Mux.thread.qAudioPacketProcess.pop_n(pktDataList, _countof(pktDataList), (m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->usage_aud_proc : nullptr))) {
+            for (size_t i = 0; i < nCount; i++) {
                 //音声処理を実行、出力キューに追加する
-                WriteNextPacketInternal(&pktData);
+                WriteNextPacketInternal(&pktDataList[i]);
             }
         }
-        ResetEvent(m_Mux.thread.heEventPktAddedAudProcess);
-        WaitForSingleObject(m_Mux.thread.heEventPktAddedAudProcess, 16);
+        //キューにデータが追加されるまで待機する
+        m_Mux.thread.waitAudProcess.wait([this]() {
+            return m_Mux.thread.bThAudProcessAbort || !m_Mux.thread.qAudioPacketProcess.empty();
+        }, INFINITE);
     }
     {   //音声をすべて書き出す
         AVPktMuxData pktData = { 0 };
@@ -2934,7 +2966,6 @@ AMF_RESULT CAvcodecWriter::ThreadFuncAudThread() {
             WriteNextPacketInternal(&pktData);
         }
     }
-    SetEvent(m_Mux.thread.heEventClosingAudProcess);
 #endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
     return (m_Mux.format.bStreamError) ? AMF_UNEXPECTED : AMF_OK;
 }
@@ -2953,7 +2984,11 @@ AMF_RESULT CAvcodecWriter::WriteThreadFunc() {
     bool bVideoExists = false;
     const auto fpsTimebase = av_inv_q(m_Mux.video.nFPS);
     const auto dtsThreshold = std::max<int64_t>(av_rescale_q(4, fpsTimebase, VCE_NATIVE_TIMEBASE), VCE_TIMEBASE / 4);
-    WaitForSingleObject(m_Mux.thread.heEventPktAddedOutput, INFINITE);
+    //ヘッダーの出力かキューへの追加を待ってから開始する
+    m_Mux.thread.waitOutput.wait([this]() {
+        return m_Mux.thread.bAbortOutput || m_Mux.format.bFileHeaderWritten
+            || !m_Mux.thread.qVideobitstream.empty() || !m_Mux.thread.qAudioPacketOut.empty();
+    }, INFINITE);
     //bThAudProcessは出力開始した後で取得する(この前だとまだ起動していないことがある)
     const bool bThAudProcess = m_Mux.thread.thAudProcess.joinable();
     auto writeProcessedPacket = [this](AVPktMuxData *pktData) {
@@ -2968,16 +3003,17 @@ AMF_RESULT CAvcodecWriter::WriteThreadFunc() {
     int nWaitAudio = 0;
     int nWaitVideo = 0;
     while (!m_Mux.thread.bAbortOutput) {
+        const bool bFileHeaderWritten = m_Mux.format.bFileHeaderWritten;
         do {
-            if (!m_Mux.format.bFileHeaderWritten) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (!bFileHeaderWritten) {
                 //ヘッダー取得前に音声キューのサイズが足りず、エンコードが進まなくなってしまうことがある
-                //キューのcapcityを増やすことでこれを回避する
-                auto type = (m_Mux.thread.thAudEncode.joinable()) ? AUD_QUEUE_ENCODE : AUD_QUEUE_OUT;
-                auto& qAudio = (type == AUD_QUEUE_OUT) ? m_Mux.thread.qAudioPacketOut : m_Mux.thread.qAudioFrameEncode;
-                const auto nQueueCapacity = qAudio.capacity();
-                if (qAudio.size() >= nQueueCapacity) {
-                    qAudio.set_capacity(nQueueCapacity * 3 / 2);
+                //キューはリングのサイズより大きくできないので、パケットはWriteNextPacketInternalでキャッシュ(m_AudPktBufFileHead)に移しておく
+                //音声処理スレッドがある場合は、音声処理スレッドがキャッシュに移すので、ここに音声パケットは来ない
+                if (!bThAudProcess) {
+                    AVPktMuxData pktData = { 0 };
+                    while (m_Mux.thread.qAudioPacketOut.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.pQueueInfo) ? &m_Mux.thread.pQueueInfo->usage_aud_out : nullptr)) {
+                        WriteNextPacketInternal(&pktData);
+                    }
                 }
                 break;
             }
@@ -3031,18 +3067,24 @@ AMF_RESULT CAvcodecWriter::WriteThreadFunc() {
             }
         } while (bAudioExists || bVideoExists); //両方のキューがひとまず空になるか、映像・音声の同期待ちが必要になるまで回す
                                                 //次のフレーム・パケットが送られてくるまで待機する
-        //キューの容量が両方とも半分以下なら、すこし待ってみる
+        //キューの容量が両方とも半分以下なら、次のフレーム・パケットが追加されるまで待機する
         //一方、どちらかのキューが半分以上使われていれば、なるべく早く処理する必要がある
-        if (   m_Mux.thread.qVideobitstream.size() / (double)m_Mux.thread.qVideobitstream.capacity() < 0.5
-            && m_Mux.thread.qAudioPacketOut.size() / (double)m_Mux.thread.qAudioPacketOut.capacity() < 0.5) {
-            ResetEvent(m_Mux.thread.heEventPktAddedOutput);
-            WaitForSingleObject(m_Mux.thread.heEventPktAddedOutput, 16);
+        const size_t nVideoRemain = m_Mux.thread.qVideobitstream.size();
+        const size_t nAudioRemain = m_Mux.thread.qAudioPacketOut.size();
+        if (   nVideoRemain / (double)m_Mux.thread.qVideobitstream.capacity() < 0.5
+            && nAudioRemain / (double)m_Mux.thread.qAudioPacketOut.capacity() < 0.5) {
+            //キューに残っているデータは同期待ちで処理できないものなので、
+            //いずれかのキューに追加されるか、ヘッダーが出力されるまで待機する
+            m_Mux.thread.waitOutput.wait([&]() {
+                return m_Mux.thread.bAbortOutput
+                    || m_Mux.format.bFileHeaderWritten != bFileHeaderWritten
+                    || m_Mux.thread.qVideobitstream.size() > nVideoRemain
+                    || m_Mux.thread.qAudioPacketOut.size() > nAudioRemain;
+            }, INFINITE);
         } else {
             std::this_thread::yield();
         }
     }
-    //メインループを抜けたことを通知する
-    SetEvent(m_Mux.thread.heEventClosingOutput);
     m_Mux.thread.qAudioPacketOut.set_keep_length(0);
     m_Mux.thread.qVideobitstream.set_keep_length(0);
     bAudioExists = !m_Mux.thread.qAudioPacketOut.empty();
@@ -182,18 +182,15 @@ typedef struct AVMuxThread {
     std::thread                  thAudProcess;              //音声処理スレッド(デコード/thAudEncodeがなければエンコードも担当)
     std::atomic<bool>            bThAudEncodeAbort;         //音声エンコードスレッドに停止を通知する
     std::thread                  thAudEncode;               //音声エンコードスレッド(エンコードを担当)
-    HANDLE                       heEventPktAddedOutput;     //キューのいずれかにデータが追加されたことを通知する
-    HANDLE                       heEventClosingOutput;      //出力スレッドが停止処理を開始したことを通知する
-    HANDLE                       heEventPktAddedAudProcess; //キューのいずれかにデータが追加されたことを通知する
-    HANDLE                       heEventClosingAudProcess;  //音声処理スレッドが停止処理を開始したことを通知する
-    HANDLE                       heEventPktAddedAudEncode;  //キューのいずれかにデータが追加されたことを通知する
-    HANDLE                       heEventClosingAudEncode;   //音声処理スレッドが停止処理を開始したことを通知する
+    CQueueWaiter                 waitOutput;                //出力スレッドの待機用 (qVideobitstream・qAudioPacketOutへの追加、ヘッダーの出力、停止を通知する)
+    CQueueWaiter                 waitAudProcess;            //音声処理スレッドの待機用 (qAudioPacketProcessへの追加、ヘッダーの出力、停止を通知する)
+    CQueueWaiter                 waitAudEncode;             //音声エンコードスレッドの待機用 (qAudioFrameEncodeへの追加、ヘッダーの出力、停止を通知する)
     CQueueSPSP<sBitstream, 64> qVideobitstreamFreeI;      //映像 Iフレーム用に空いているデータ領域を格納する
     CQueueSPSP<sBitstream, 64> qVideobitstreamFreePB;     //映像 P/Bフレーム用に空いているデータ領域を格納する
-    CQueueSPSP<sBitstream, 64> qVideobitstream;           //映像パケットを出力スレッドに渡すためのキュー
-    CQueueSPSP<AVPktMuxData, 64> qAudioPacketProcess;       //処理前音声パケットをデコード/エンコードスレッドに渡すためのキュー
-    CQueueSPSP<AVPktMuxData, 64> qAudioFrameEncode;         //デコード済み音声フレームをエンコードスレッドに渡すためのキュー
-    CQueueSPSP<AVPktMuxData, 64> qAudioPacketOut;           //音声パケットを出力スレッドに渡すためのキュー
+    CQueueSPSPRing<sBitstream, 64> qVideobitstream;         //映像パケットを出力スレッドに渡すためのキュー
+    CQueueMPMC<AVPktMuxData, 64> qAudioPacketProcess;       //処理前音声パケットをデコード/エンコードスレッドに渡すためのキュー
+    CQueueMPMC<AVPktMuxData, 64> qAudioFrameEncode;         //デコード済み音声フレームをエンコードスレッドに渡すためのキュー
+    CQueueMPMC<AVPktMuxData, 64> qAudioPacketOut;           //音声パケットを出力スレッドに渡すためのキュー (複数の読み込みスレッドから追加される)
     PerfQueueInfo               *pQueueInfo;                //キューの情報を格納する構造体
 } AVMuxThread;
 #endif
@@ -290,6 +287,12 @@ public:
 
     virtual AMF_RESULT WriteNextPacket(AVPacket *pkt);
 
+    //複数のパケットをまとめて書き出す (出力スレッドがある場合はまとめてキューに追加する)
+    virtual AMF_RESULT WriteNextPackets(AVPacket *pkts, size_t nCount);
+
+    //WriteNextPacketsを複数のスレッドから同時に呼んでよいかを返す (出力スレッドがある場合のみ可能)
+    bool AcceptsConcurrentPackets();
+
     virtual vector<int> GetStreamTrackIdList();
 
     virtual void Close();
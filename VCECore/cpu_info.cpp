@@ -25,13 +25,19 @@
 //
 // ------------------------------------------------------------------------------------------
 
-#include <Windows.h>
 #include <vector>
 #include <string>
 #include <vector>
 #include <algorithm>
-#include <intrin.h>
-#include <tchar.h>
+#include "qsv_osdep.h"
+#if defined(_WIN32) || defined(_WIN64)
+#include <process.h>
+#else
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#endif //#if defined(_WIN32) || defined(_WIN64)
 #include "cpu_info.h"
 
 static int getCPUName(char *buffer, size_t nSize) {
@@ -85,10 +91,11 @@ static int getCPUName(char *buffer, size_t nSize) {
     if (0 < strlen(buffer)) {
         char *last_ptr = buffer + strlen(buffer) - 1;
         if (' ' == *last_ptr)
-            last_ptr = '\0';
+            *last_ptr = '\0';
     }
     return 0;
 }
+#if defined(_WIN32) || defined(_WIN64)
 static int getCPUName(wchar_t *buffer, size_t nSize) {
     int ret = 0;
     char *buf = (char *)calloc(nSize, sizeof(char));
@@ -102,6 +109,7 @@ static int getCPUName(wchar_t *buffer, size_t nSize) {
     }
     return ret;
 }
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
 double getCPUDefaultClockFromCPUName() {
     double defaultClock = 0.0;
@@ -117,9 +125,7 @@ double getCPUDefaultClockFromCPUName() {
     return 0.0;
 }
 
-#include <Windows.h>
-#include <process.h>
-
+#if defined(_WIN32) || defined(_WIN64)
 typedef BOOL (WINAPI *LPFN_GLPI)(PSYSTEM_LOGICAL_PROCESSOR_INFORMATION, PDWORD);
 
 static DWORD CountSetBits(ULONG_PTR bitMask) {
@@ -178,7 +184,7 @@ bool get_cpu_info(cpu_info_t *cpu_info) {
                 cache->linesize = Cache->LineSize;
                 cache->size += Cache->Size;
                 cache->associativity = Cache->Associativity;
-                cpu_info->max_cache_level = max(cpu_info->max_cache_level, cache->level);
+                cpu_info->max_cache_level = (std::max)(cpu_info->max_cache_level, (uint32_t)cache->level);
             }
             break;
         }
@@ -198,6 +204,84 @@ bool get_cpu_info(cpu_info_t *cpu_info) {
 
     return true;
 }
+#else //#if defined(_WIN32) || defined(_WIN64)
+static std::string read_sysfs(const std::string& path) {
+    std::ifstream ifs(path);
+    std::string str;
+    std::getline(ifs, str);
+    return str;
+}
+
+static uint32_t read_sysfs_uint(const std::string& path) {
+    std::string str = read_sysfs(path);
+    if (str.length() == 0) {
+        return 0;
+    }
+    char *end = nullptr;
+    uint32_t value = (uint32_t)strtoul(str.c_str(), &end, 10);
+    //cacheのsizeは"32K"のように単位付きで記載されている
+    if (end && (*end == 'K' || *end == 'k')) {
+        value <<= 10;
+    } else if (end && (*end == 'M' || *end == 'm')) {
+        value <<= 20;
+    }
+    return value;
+}
+
+//sysfsからトポロジとキャッシュの情報を取得する
+bool get_cpu_info(cpu_info_t *cpu_info) {
+    if (nullptr == cpu_info)
+        return false;
+
+    memset(cpu_info, 0, sizeof(cpu_info[0]));
+
+    const int logical_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (logical_cores <= 0)
+        return false;
+
+    std::set<std::pair<uint32_t, uint32_t>> cores;
+    std::set<std::string> caches;
+    for (int icpu = 0; icpu < logical_cores; icpu++) {
+        const std::string cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(icpu);
+        const std::string core_id = read_sysfs(cpu_dir + "/topology/core_id");
+        if (core_id.length() == 0) {
+            continue;
+        }
+        cpu_info->logical_cores++;
+        cores.insert(std::make_pair(read_sysfs_uint(cpu_dir + "/topology/physical_package_id"), read_sysfs_uint(cpu_dir + "/topology/core_id")));
+        for (int index = 0; ; index++) {
+            const std::string cache_dir = cpu_dir + "/cache/index" + std::to_string(index);
+            const uint32_t level = read_sysfs_uint(cache_dir + "/level");
+            if (0 == level) {
+                break;
+            }
+            //複数のコアで共有されているキャッシュは1つとして数える
+            const std::string cache_key = std::to_string(level) + read_sysfs(cache_dir + "/type") + read_sysfs(cache_dir + "/shared_cpu_list");
+            if (1 <= level && level <= _countof(cpu_info->caches) && caches.insert(cache_key).second) {
+                cache_info_t *cache = &cpu_info->caches[level-1];
+                cache->count++;
+                cache->level = (uint8_t)level;
+                cache->linesize = (uint16_t)read_sysfs_uint(cache_dir + "/coherency_line_size");
+                cache->size += read_sysfs_uint(cache_dir + "/size");
+                cache->associativity = (uint8_t)read_sysfs_uint(cache_dir + "/ways_of_associativity");
+                cpu_info->max_cache_level = (std::max)(cpu_info->max_cache_level, level);
+            }
+        }
+    }
+    if (0 == cpu_info->logical_cores) {
+        //sysfsが読めない場合は論理コア数のみ設定する
+        cpu_info->logical_cores = logical_cores;
+        cpu_info->physical_cores = logical_cores;
+    } else {
+        cpu_info->physical_cores = (uint32_t)cores.size();
+    }
+    for (int inode = 0; !read_sysfs("/sys/devices/system/node/node" + std::to_string(inode) + "/cpulist").empty(); inode++) {
+        cpu_info->nodes++;
+    }
+    cpu_info->nodes = (std::max)(cpu_info->nodes, 1u);
+    return true;
+}
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
 const int LOOP_COUNT = 5000;
 const int CLOCKS_FOR_2_INSTRUCTION = 2;
@@ -230,7 +314,7 @@ static UINT64 __fastcall repeatFunc(int *test) {
     //計算結果を強引に使うことで最適化による計算の削除を抑止する
     x0 = _mm_add_epi32(x0, x1);
     x0 = _mm_add_epi32(x0, x2);
-    *test = x0.m128i_i32[0];
+    *test = _mm_cvtsi128_si32(x0);
 
     return fin - start;
 }
@@ -239,9 +323,16 @@ static unsigned int __stdcall getCPUClockMaxSubFunc(void *arg) {
     UINT64 *prm = (UINT64 *)arg;
     //渡されたスレッドIDからスレッドAffinityを決定
     //特定のコアにスレッドを縛り付ける
+#if defined(_WIN32) || defined(_WIN64)
     SetThreadAffinityMask(GetCurrentThread(), (size_t)1 << (int)*prm);
     //高優先度で実行
     SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#else
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET((int)*prm, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#endif
 
     int test = 0;
     UINT64 result = MAXUINT64;
@@ -250,7 +341,7 @@ static unsigned int __stdcall getCPUClockMaxSubFunc(void *arg) {
         for (int i = 0; i < 800; i++) {
             //連続で大量に行うことでTurboBoostを働かせる
             //何回か行って最速値を使用する
-            result = min(result, repeatFunc(&test));
+            result = (std::min)(result, repeatFunc(&test));
         }
         Sleep(1); //一度スレッドを休ませて、仕切りなおす (Sleep(0)でもいいかも)
     }
@@ -289,8 +380,9 @@ double getCPUMaxTurboClock(unsigned int num_thread) {
     //ハーパースレッディングを考慮してスレッドIDを渡す
     int thread_id_multi = (cpu_info.logical_cores > cpu_info.physical_cores) ? cpu_info.logical_cores / cpu_info.physical_cores : 1;
     //上限は物理プロセッサ数、0なら自動的に物理プロセッサ数に設定
-    num_thread = (0 == num_thread) ? max(1, cpu_info.physical_cores - (cpu_info.logical_cores == cpu_info.physical_cores)) : min(num_thread, cpu_info.physical_cores);
+    num_thread = (0 == num_thread) ? (std::max)(1u, cpu_info.physical_cores - (cpu_info.logical_cores == cpu_info.physical_cores)) : (std::min)(num_thread, cpu_info.physical_cores);
 
+#if defined(_WIN32) || defined(_WIN64)
     std::vector<HANDLE> list_of_threads(num_thread, NULL);
     std::vector<UINT64> list_of_result(num_thread, 0);
     DWORD thread_loaded = 0;
@@ -309,19 +401,34 @@ double getCPUMaxTurboClock(unsigned int num_thread) {
         WaitForMultipleObjects(thread_loaded, &list_of_threads[0], TRUE, INFINITE);
     }
 
+#else
+    std::vector<std::thread> list_of_threads;
+    std::vector<UINT64> list_of_result(num_thread, 0);
+    DWORD thread_loaded = 0;
+    for ( ; thread_loaded < num_thread; thread_loaded++) {
+        list_of_result[thread_loaded] = thread_loaded * thread_id_multi; //スレッドIDを渡す
+        list_of_threads.push_back(std::thread(getCPUClockMaxSubFunc, &list_of_result[thread_loaded]));
+    }
+    for (auto& thread : list_of_threads) {
+        thread.join();
+    }
+#endif //#if defined(_WIN32) || defined(_WIN64)
+
     if (thread_loaded < num_thread) {
         resultClock = defaultClock;
     } else {
         UINT64 min_result = *std::min_element(list_of_result.begin(), list_of_result.end());
         resultClock = (min_result) ? defaultClock * (double)(LOOP_COUNT * COUNT_OF_REPEAT * COUNT_OF_REPEAT * 2) / (double)min_result : defaultClock;
-        resultClock = max(resultClock, defaultClock);
+        resultClock = (std::max)(resultClock, defaultClock);
     }
 
+#if defined(_WIN32) || defined(_WIN64)
     for (auto thread : list_of_threads) {
         if (NULL != thread) {
             CloseHandle(thread);
         }
     }
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
     return resultClock;
 }
@@ -396,6 +503,7 @@ int getCPUInfo(TCHAR *buffer, size_t nSize) {
     return ret;
 }
 
+#if defined(_WIN32) || defined(_WIN64)
 BOOL GetProcessTime(HANDLE hProcess, PROCESS_TIME *time) {
     SYSTEMTIME systime;
     GetSystemTime(&systime);
@@ -403,13 +511,31 @@ BOOL GetProcessTime(HANDLE hProcess, PROCESS_TIME *time) {
         && GetProcessTimes(hProcess, (FILETIME *)&time->creation, (FILETIME *)&time->exit, (FILETIME *)&time->kernel, (FILETIME *)&time->user)
         && (WAIT_OBJECT_0 == WaitForSingleObject(hProcess, 0) || SystemTimeToFileTime(&systime, (FILETIME *)&time->exit)));
 }
+#else
+static const auto g_process_start = std::chrono::system_clock::now();
+
+//自プロセスのみ対応する、FILETIMEと同じく100ns単位で返す
+BOOL GetProcessTime(HANDLE hProcess, PROCESS_TIME *time) {
+    struct rusage usage;
+    if (NULL == hProcess || getrusage(RUSAGE_SELF, &usage)) {
+        return FALSE;
+    }
+    auto timeval_to_100ns = [](const timeval& tv) {
+        return (UINT64)tv.tv_sec * 10000000 + (UINT64)tv.tv_usec * 10;
+    };
+    auto time_point_to_100ns = [](std::chrono::system_clock::time_point tp) {
+        return (UINT64)(std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count() / 100);
+    };
+    time->kernel = timeval_to_100ns(usage.ru_stime);
+    time->user = timeval_to_100ns(usage.ru_utime);
+    time->creation = time_point_to_100ns(g_process_start);
+    time->exit = time_point_to_100ns(std::chrono::system_clock::now());
+    return TRUE;
+}
+#endif //#if defined(_WIN32) || defined(_WIN64)
 
 BOOL GetProcessTime(PROCESS_TIME *time) {
-#if defined(_WIN32) || defined(_WIN64)
     return GetProcessTime(GetCurrentProcess(), time);
-#else
-    return GetProcessTime(NULL, time);
-#endif
 }
 
 double GetProcessAvgCPUUsage(HANDLE hProcess, PROCESS_TIME *start) {
@@ -427,9 +553,5 @@ double GetProcessAvgCPUUsage(HANDLE hProcess, PROCESS_TIME *start) {
 }
 
 double GetProcessAvgCPUUsage(PROCESS_TIME *start) {
-#if defined(_WIN32) || defined(_WIN64)
     return GetProcessAvgCPUUsage(GetCurrentProcess(), start);
-#else
-    return GetProcessAvgCPUUsage(NULL, start);
-#endif
 }
@@ -29,7 +29,7 @@
 #define _CPU_INFO_H_
 
 #include <stdint.h>
-#include <tchar.h>
+#include "qsv_osdep.h"
 
 typedef struct cache_info_t {
     uint16_t count;
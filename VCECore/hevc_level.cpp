@@ -27,12 +27,9 @@
 
 #include <cstdint>
 #include <algorithm>
+#include "qsv_osdep.h"
 #include "hevc_level.h"
 
-#ifndef NULL
-#define NULL 0
-#endif
-
 const int MAX_REF_FRAMES = 16;
 const int LEVEL_COLUMNS  = 5;
 const int COLUMN_MAX_BITRATE_MAIN = 2;
@@ -57,21 +54,21 @@ const int HEVC_LEVEL_INDEX[] = {
 
 static const uint32_t HEVC_LEVEL_LIMITS[_countof(HEVC_LEVEL_INDEX)+1][LEVEL_COLUMNS] =
 {   //Sample/s,   Samples,  MaxBitrate(Main), MaxBitrate(High), end,  level
-    {          0,          0,              0,                0, NULL}, // auto
-    {     552960,      36864,            128,                1, NULL}, // 1
-    {    3686400,     122880,           1500,                1, NULL}, // 2
-    {    7372800,     245760,           3000,                1, NULL}, // 2.1
-    {   16588800,     552960,           6000,                1, NULL}, // 3
-    {   33177600,     983040,          10000,                1, NULL}, // 3.1
-    {   66846720,    2228224,          12000,            30000, NULL}, // 4
-    {  133693440,    2228224,          20000,            50000, NULL}, // 4.1
-    {  267386880,    8912896,          25000,           100000, NULL}, // 5
-    {  534773760,    8912896,          40000,           160000, NULL}, // 5.1
-    { 1069547520,    8912896,          60000,           240000, NULL}, // 5.2
-    { 1069547520,   35651584,          60000,           240000, NULL}, // 6
-    { 2139095040,   35651584,         120000,           480000, NULL}, // 6.1
-    { 4278190080,   35651584,         240000,           800000, NULL}, // 6.2
-    {       NULL,       NULL,           NULL,             NULL, NULL}, // end
+    {          0,          0,              0,                0,    0}, // auto
+    {     552960,      36864,            128,                1,    0}, // 1
+    {    3686400,     122880,           1500,                1,    0}, // 2
+    {    7372800,     245760,           3000,                1,    0}, // 2.1
+    {   16588800,     552960,           6000,                1,    0}, // 3
+    {   33177600,     983040,          10000,                1,    0}, // 3.1
+    {   66846720,    2228224,          12000,            30000,    0}, // 4
+    {  133693440,    2228224,          20000,            50000,    0}, // 4.1
+    {  267386880,    8912896,          25000,           100000,    0}, // 5
+    {  534773760,    8912896,          40000,           160000,    0}, // 5.1
+    { 1069547520,    8912896,          60000,           240000,    0}, // 5.2
+    { 1069547520,   35651584,          60000,           240000,    0}, // 6
+    { 2139095040,   35651584,         120000,           480000,    0}, // 6.1
+    { 4278190080,   35651584,         240000,           800000,    0}, // 6.2
+    {          0,          0,              0,                0,    0}, // end
 };
 
 //必要なLevelを計算する, 適合するLevelがなければ 0 を返す
@@ -81,7 +78,7 @@ int calc_hevc_auto_level(int width, int height, int fps_num, int fps_den, bool h
         (uint32_t)width * height,
         (high_tier) ? 0 : (uint32_t)max_bitrate,
         (high_tier) ? (uint32_t)max_bitrate : 0,
-        NULL
+        0
     };
 
     //あとはひたすら比較
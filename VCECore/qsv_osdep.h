@@ -0,0 +1,389 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#ifndef _QSV_OSDEP_H_
+#define _QSV_OSDEP_H_
+
+//Windows以外の環境でも、GPUを使用しない部分(色空間変換、キュー、レベル判定など)をビルドできるようにするための定義
+//Windowsでは従来どおりWindows.h等をincludeするだけ
+
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <tchar.h>
+#include <intrin.h>
+
+#else //#if defined(_WIN32) || defined(_WIN64)
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdarg>
+#include <cwchar>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <cpuid.h>
+#include <x86intrin.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define __stdcall
+#define __fastcall
+#define WINAPI
+#define __forceinline inline __attribute__((always_inline))
+#define _declspec(x) __declspec(x)
+#define __declspec(x) __declspec_##x
+#define __declspec_align(x) __attribute__((aligned(x)))
+#define __declspec_noinline __attribute__((noinline))
+
+typedef void *HANDLE;
+typedef void *HMODULE;
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t UINT;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef size_t ULONG_PTR;
+typedef wchar_t WCHAR;
+#define TRUE  1
+#define FALSE 0
+#define MAXUINT64 UINT64_MAX
+#define CP_ACP        0
+#define CP_THREAD_ACP 3
+#define CP_UTF8       65001
+
+#define INFINITE       0xFFFFFFFF
+#define WAIT_OBJECT_0  0x00000000L
+#define WAIT_TIMEOUT   0x00000102L
+#define WAIT_FAILED    0xFFFFFFFF
+
+#define _countof(x) (sizeof(x) / sizeof(x[0]))
+
+//TCHARはcharのみ対応する
+typedef char TCHAR;
+#define _T(x) x
+#define _tcslen     strlen
+#define _tcscmp     strcmp
+#define _tcsncmp    strncmp
+#define _tcsicmp    strcasecmp
+#define _tcsnicmp   strncasecmp
+#define _tcschr     strchr
+#define _tcsrchr    strrchr
+#define _tcsstr     strstr
+#define _tcstol     strtol
+#define _tcstod     strtod
+#define _tcstoul    strtoul
+#define _tfopen     fopen
+#define _fgetts     fgets
+#define _ftprintf   fprintf
+#define _stscanf    sscanf
+#define _stscanf_s  sscanf
+#define _stprintf_s snprintf
+#define sprintf_s   snprintf
+#define _vsctprintf _vscprintf
+#define _vstprintf_s vsnprintf
+#define vsprintf_s  vsnprintf
+#define _fseeki64   fseeko
+#define _ftelli64   ftello
+
+static inline int _vscprintf(const char *format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    const int len = vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    return len;
+}
+
+static inline char *strcpy_s(char *dst, size_t size, const char *src) {
+    if (size) {
+        strncpy(dst, src, size - 1);
+        dst[size - 1] = '\0';
+    }
+    return dst;
+}
+static inline char *strcat_s(char *dst, size_t size, const char *src) {
+    const size_t len = strnlen(dst, size);
+    return (len < size) ? strcpy_s(dst + len, size - len, src) : dst;
+}
+static inline int fopen_s(FILE **fp, const char *filename, const char *mode) {
+    *fp = fopen(filename, mode);
+    return (*fp == nullptr) ? 1 : 0;
+}
+#define _tfopen_s fopen_s
+#define _tcscpy_s strcpy_s
+
+static inline int _vscwprintf(const wchar_t *format, va_list args) {
+    //vswprintfは必要な長さを返さないので、バッファを拡大しながら試す
+    for (size_t size = 256; size <= (1 << 24); size <<= 1) {
+        wchar_t *buffer = (wchar_t *)malloc(size * sizeof(wchar_t));
+        if (buffer == nullptr) {
+            break;
+        }
+        va_list copy;
+        va_copy(copy, args);
+        const int len = vswprintf(buffer, size, format, copy);
+        va_end(copy);
+        free(buffer);
+        if (len >= 0) {
+            return len;
+        }
+    }
+    return -1;
+}
+#define vswprintf_s vswprintf
+
+static inline char *_fullpath(char *absPath, const char *relPath, size_t maxLength) {
+    char *path = realpath(relPath, nullptr);
+    if (path == nullptr) {
+        return nullptr;
+    }
+    strcpy_s(absPath, maxLength, path);
+    free(path);
+    return absPath;
+}
+
+static inline const char *PathFindFileNameA(const char *path) {
+    const char *ptr = strrchr(path, '/');
+    return (ptr) ? ptr + 1 : path;
+}
+
+static inline const char *PathFindExtensionA(const char *path) {
+    const char *filename = PathFindFileNameA(path);
+    const char *ptr = strrchr(filename, '.');
+    return (ptr) ? ptr : filename + strlen(filename);
+}
+#define PathFindExtension PathFindExtensionA
+
+static inline BOOL PathIsDirectoryA(const char *dir) {
+    struct stat st;
+    return (0 == stat(dir, &st) && S_ISDIR(st.st_mode)) ? TRUE : FALSE;
+}
+
+static inline BOOL CreateDirectoryA(const char *dir, void *securityAttributes) {
+    return (0 == mkdir(dir, 0755)) ? TRUE : FALSE;
+}
+#define _tcscat_s strcat_s
+
+static inline void *_aligned_malloc(size_t size, size_t alignment) {
+    void *ptr = nullptr;
+    return (0 == posix_memalign(&ptr, (alignment < sizeof(void *)) ? sizeof(void *) : alignment, size)) ? ptr : nullptr;
+}
+#define _aligned_free free
+
+//Windowsと同じく、自プロセスを示す疑似ハンドルを返す
+static inline HANDLE GetCurrentProcess() {
+    return (HANDLE)(intptr_t)-1;
+}
+
+static inline void Sleep(DWORD ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+//cpuid.hの__cpuidはマクロなので、MSVCと同じ形式の関数に置き換える
+#undef __cpuid
+//新しいgccのcpuid.hは__cpuidexを定義するので、名前を変えて定義しておく
+static inline void qsv_cpuidex(int cpuInfo[4], int function_id, int subfunction_id) {
+    __cpuid_count(function_id, subfunction_id, cpuInfo[0], cpuInfo[1], cpuInfo[2], cpuInfo[3]);
+}
+static inline void qsv_cpuid(int cpuInfo[4], int function_id) {
+    qsv_cpuidex(cpuInfo, function_id, 0);
+}
+#define __cpuidex qsv_cpuidex
+#define __cpuid qsv_cpuid
+static inline uint64_t qsv_xgetbv(uint32_t index) {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((uint64_t)edx << 32) | eax;
+}
+#define _xgetbv qsv_xgetbv
+
+//Win32のイベントを条件変数で置き換えたもの
+struct qsv_event {
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool manual_reset;
+    bool signaled;
+};
+
+static inline HANDLE CreateEvent(void *attributes, BOOL bManualReset, BOOL bInitialState, void *name) {
+    qsv_event *event = new qsv_event();
+    event->manual_reset = !!bManualReset;
+    event->signaled = !!bInitialState;
+    return event;
+}
+
+static inline BOOL SetEvent(HANDLE hEvent) {
+    qsv_event *event = (qsv_event *)hEvent;
+    {
+        std::lock_guard<std::mutex> lock(event->mtx);
+        event->signaled = true;
+    }
+    if (event->manual_reset) {
+        event->cond.notify_all();
+    } else {
+        event->cond.notify_one();
+    }
+    return TRUE;
+}
+
+static inline BOOL ResetEvent(HANDLE hEvent) {
+    qsv_event *event = (qsv_event *)hEvent;
+    std::lock_guard<std::mutex> lock(event->mtx);
+    event->signaled = false;
+    return TRUE;
+}
+
+static inline DWORD WaitForSingleObject(HANDLE hEvent, DWORD dwMilliseconds) {
+    qsv_event *event = (qsv_event *)hEvent;
+    std::unique_lock<std::mutex> lock(event->mtx);
+    if (dwMilliseconds == INFINITE) {
+        event->cond.wait(lock, [event] { return event->signaled; });
+    } else if (!event->cond.wait_for(lock, std::chrono::milliseconds(dwMilliseconds), [event] { return event->signaled; })) {
+        return WAIT_TIMEOUT;
+    }
+    if (!event->manual_reset) {
+        event->signaled = false;
+    }
+    return WAIT_OBJECT_0;
+}
+
+//bWaitAllがFALSEの場合はポーリングで待機する
+static inline DWORD WaitForMultipleObjects(DWORD nCount, const HANDLE *lpHandles, BOOL bWaitAll, DWORD dwMilliseconds) {
+    const auto start = std::chrono::steady_clock::now();
+    auto remaining = [&]() {
+        if (dwMilliseconds == INFINITE) {
+            return (DWORD)INFINITE;
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        return (DWORD)((elapsed >= dwMilliseconds) ? 0 : dwMilliseconds - elapsed);
+    };
+    if (bWaitAll) {
+        for (DWORD i = 0; i < nCount; i++) {
+            if (WAIT_OBJECT_0 != WaitForSingleObject(lpHandles[i], remaining())) {
+                return WAIT_TIMEOUT;
+            }
+        }
+        return WAIT_OBJECT_0;
+    }
+    for (;;) {
+        for (DWORD i = 0; i < nCount; i++) {
+            if (WAIT_OBJECT_0 == WaitForSingleObject(lpHandles[i], 0)) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+        if (0 == remaining()) {
+            return WAIT_TIMEOUT;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+//CreateEventで作成したハンドルのみ対応する
+static inline BOOL CloseHandle(HANDLE hEvent) {
+    delete (qsv_event *)hEvent;
+    return TRUE;
+}
+#define CloseEvent CloseHandle
+
+#endif //#if defined(_WIN32) || defined(_WIN64)
+
+#include <atomic>
+#if defined(_WIN32) || defined(_WIN64)
+//WaitOnAddressはWindows 8以降のみなので、動的にロードする
+typedef BOOL (WINAPI *func_WaitOnAddress)(volatile VOID *Address, PVOID CompareAddress, SIZE_T AddressSize, DWORD dwMilliseconds);
+typedef VOID (WINAPI *func_WakeByAddressAll)(PVOID Address);
+
+struct qsv_wait_on_address_func {
+    func_WaitOnAddress    wait;
+    func_WakeByAddressAll wake_all;
+    qsv_wait_on_address_func() : wait(nullptr), wake_all(nullptr) {
+        HMODULE hModule = LoadLibraryW(L"api-ms-win-core-synch-l1-2-0.dll");
+        if (hModule) {
+            wait     = (func_WaitOnAddress)GetProcAddress(hModule, "WaitOnAddress");
+            wake_all = (func_WakeByAddressAll)GetProcAddress(hModule, "WakeByAddressAll");
+            if (wait == nullptr || wake_all == nullptr) {
+                wait = nullptr;
+                wake_all = nullptr;
+            }
+        }
+    }
+};
+
+static inline const qsv_wait_on_address_func *qsv_get_wait_on_address_func() {
+    static const qsv_wait_on_address_func func;
+    return &func;
+}
+
+//*addrがexpectedと異なる値になり起床されるか、タイムアウトするまで待機する
+//WaitOnAddressが使用できない場合は1ms待機するだけなので、呼び出し側で必ず条件を再確認すること
+static inline void qsv_wait_on_address(std::atomic<uint32_t> *addr, uint32_t expected, DWORD dwMilliseconds) {
+    const auto func = qsv_get_wait_on_address_func();
+    if (func->wait) {
+        func->wait((volatile VOID *)addr, &expected, sizeof(expected), dwMilliseconds);
+    } else if (addr->load() == expected && dwMilliseconds > 0) {
+        Sleep(1);
+    }
+}
+
+//qsv_wait_on_addressで待機しているスレッドをすべて起床させる
+static inline void qsv_wake_by_address_all(std::atomic<uint32_t> *addr) {
+    const auto func = qsv_get_wait_on_address_func();
+    if (func->wake_all) {
+        func->wake_all((PVOID)addr);
+    }
+}
+#else //#if defined(_WIN32) || defined(_WIN64)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+//*addrがexpectedと異なる値になり起床されるか、タイムアウトするまで待機する
+static inline void qsv_wait_on_address(std::atomic<uint32_t> *addr, uint32_t expected, DWORD dwMilliseconds) {
+    struct timespec timeout;
+    timeout.tv_sec  = dwMilliseconds / 1000;
+    timeout.tv_nsec = (dwMilliseconds % 1000) * 1000000;
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT_PRIVATE, expected, (dwMilliseconds == INFINITE) ? nullptr : &timeout, nullptr, 0);
+}
+
+//qsv_wait_on_addressで待機しているスレッドをすべて起床させる
+static inline void qsv_wake_by_address_all(std::atomic<uint32_t> *addr) {
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif //#if defined(_WIN32) || defined(_WIN64)
+
+#endif //_QSV_OSDEP_H_
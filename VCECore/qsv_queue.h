@@ -31,11 +31,14 @@
 #include <cstdint>
 #include <cstring>
 #include <atomic>
+#include <chrono>
 #include <climits>
 #include <memory>
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <Windows.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "qsv_osdep.h"
+#include "VCEUtil.h"
 
 #ifndef clamp
 #define clamp(x, low, high) (((x) <= (high)) ? (((x) >= (low)) ? (x) : (low)) : (high))
@@ -45,25 +48,182 @@
 #define CloseEvent CloseHandle
 #endif
 
+//キャッシュラインのサイズ
+static const size_t QUEUE_CACHE_LINE_SIZE = 64;
+
+//待機しているスレッドがある場合のみ起床を行う通知用のクラス
+//Win32のイベントと異なり、待機しているスレッドがいなければ通知はatomic変数の確認のみで済む
+class CQueueWaiter {
+public:
+    CQueueWaiter() : m_nSeq(0), m_nWaiters(0) {};
+    //ready()がfalseなら、通知されるかタイムアウトするまで待機する
+    //ready()は待機するスレッドの登録後に再度確認されるので、通知の取りこぼしはない
+    template<typename Pred>
+    void wait(Pred ready, DWORD dwMilliseconds) {
+        const uint32_t seq = m_nSeq.load(std::memory_order_acquire);
+        m_nWaiters.fetch_add(1, std::memory_order_seq_cst);
+        if (!ready()) {
+            qsv_wait_on_address(&m_nSeq, seq, dwMilliseconds);
+        }
+        m_nWaiters.fetch_sub(1, std::memory_order_release);
+    }
+    //待機しているスレッドがあれば起床させる
+    //通知する条件の変更 (キューの位置の更新など) を行ってから呼ぶこと
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_nWaiters.load(std::memory_order_relaxed) > 0) {
+            m_nSeq.fetch_add(1, std::memory_order_release);
+            qsv_wake_by_address_all(&m_nSeq);
+        }
+    }
+private:
+    std::atomic<uint32_t> m_nSeq;     //通知ごとに変化する値 (この値のアドレスで待機する)
+    std::atomic<int>      m_nWaiters; //待機中のスレッドの数
+};
+
+//キューの統計情報
+//set_statsで設定したキューが押し込み・取り出しのたびに記録する
+//各メンバは押し込み側か取り出し側のどちらか一方のスレッドのみが更新し、表示用のスレッドから読み取る
+struct CQueueStats {
+    //待機時間のヒストグラムのビン数 (i番目のビンは2^i us以上2^(i+1) us未満、最後のビンはそれ以上すべて)
+    static const int HIST_BINS = 24;
+
+    std::atomic<uint64_t> nPushCount;        //押し込んだデータ数
+    std::atomic<uint64_t> nPopCount;         //取り出したデータ数
+    std::atomic<uint64_t> nMaxDepth;         //キューにたまったデータ数の最大値
+    std::atomic<uint64_t> nPushBlockedCount; //キューが満杯で押し込み側が待機した回数
+    std::atomic<uint64_t> nPushBlockedUs;    //キューが満杯で押し込み側が待機した時間の合計
+    std::atomic<uint64_t> nPopBlockedCount;  //キューが空で取り出し側が取り出せなかった回数
+    std::atomic<uint64_t> nPopBlockedUs;     //キューが空で取り出し側が取り出せなかった時間の合計
+    std::atomic<uint32_t> nPushBlockedHist[HIST_BINS];
+    std::atomic<uint32_t> nPopBlockedHist[HIST_BINS];
+
+    CQueueStats() {
+        reset();
+    }
+    void reset() {
+        nPushCount = 0;
+        nPopCount = 0;
+        nMaxDepth = 0;
+        nPushBlockedCount = 0;
+        nPushBlockedUs = 0;
+        nPopBlockedCount = 0;
+        nPopBlockedUs = 0;
+        for (int i = 0; i < HIST_BINS; i++) {
+            nPushBlockedHist[i] = 0;
+            nPopBlockedHist[i] = 0;
+        }
+    }
+    //現在時刻 (us)
+    static uint64_t now_us() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    //更新するスレッドは1つなので、fetch_addではなくload/storeで済ませる
+    static void add(std::atomic<uint64_t>& value, uint64_t n) {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static void add_blocked(std::atomic<uint64_t>& count, std::atomic<uint64_t>& total, std::atomic<uint32_t> *hist, uint64_t us, bool bMultiThread = false) {
+        int bin = 0;
+        for (uint64_t t = us >> 1; t && bin < HIST_BINS - 1; t >>= 1) {
+            bin++;
+        }
+        if (bMultiThread) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(us, std::memory_order_relaxed);
+            hist[bin].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            add(count, 1);
+            add(total, us);
+            hist[bin].store(hist[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+    // !! 押し込み側のスレッドから呼ぶ !!
+    void push_done(size_t n, size_t depth) {
+        add(nPushCount, n);
+        if (depth > nMaxDepth.load(std::memory_order_relaxed)) {
+            nMaxDepth.store(depth, std::memory_order_relaxed);
+        }
+    }
+    void push_blocked(uint64_t us) {
+        add_blocked(nPushBlockedCount, nPushBlockedUs, nPushBlockedHist, us);
+    }
+    //押し込み側が複数のスレッドの場合 (CQueueMPMC) に使用する
+    void push_done_mt(size_t n, size_t depth) {
+        nPushCount.fetch_add(n, std::memory_order_relaxed);
+        uint64_t maxDepth = nMaxDepth.load(std::memory_order_relaxed);
+        while (depth > maxDepth && !nMaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {
+        }
+    }
+    void push_blocked_mt(uint64_t us) {
+        add_blocked(nPushBlockedCount, nPushBlockedUs, nPushBlockedHist, us, true);
+    }
+    // !! 取り出し側のスレッドから呼ぶ !!
+    void pop_done(size_t n) {
+        add(nPopCount, n);
+    }
+    void pop_blocked(uint64_t us) {
+        add_blocked(nPopBlockedCount, nPopBlockedUs, nPopBlockedHist, us);
+    }
+    //取り出しの結果を記録する
+    //取り出せなかった時点 (*pBlockedSince) から、次に取り出せるようになるまでをキューが空で待たされた時間とする
+    void pop_result(uint64_t *pBlockedSince, bool bAvailable, size_t nPop) {
+        if (!bAvailable) {
+            if (*pBlockedSince == 0) {
+                *pBlockedSince = now_us();
+            }
+            return;
+        }
+        if (*pBlockedSince) {
+            pop_blocked(now_us() - *pBlockedSince);
+            *pBlockedSince = 0;
+        }
+        if (nPop) {
+            pop_done(nPop);
+        }
+    }
+    //ヒストグラムからパーセンタイル値 (ms) を求める
+    //ビンの上端の値を返すので、最大で2倍程度大きめの値となる
+    static double percentile_ms(const std::atomic<uint32_t> *hist, double percent) {
+        uint64_t total = 0;
+        for (int i = 0; i < HIST_BINS; i++) {
+            total += hist[i].load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return 0.0;
+        }
+        const double target = total * percent * 0.01;
+        uint64_t sum = 0;
+        for (int i = 0; i < HIST_BINS; i++) {
+            sum += hist[i].load(std::memory_order_relaxed);
+            if (sum >= target) {
+                return (double)((uint64_t)2 << i) * 1e-3;
+            }
+        }
+        return (double)((uint64_t)1 << HIST_BINS) * 1e-3;
+    }
+    double push_blocked_percentile_ms(double percent) const {
+        return percentile_ms(nPushBlockedHist, percent);
+    }
+    double pop_blocked_percentile_ms(double percent) const {
+        return percentile_ms(nPopBlockedHist, percent);
+    }
+};
+
+//並列で1つの押し込みと、それと並列に1つの参照・取り出しが可能な可変長の配列
+//データは常に連続した領域に格納されるので、押し込み側は配列として直接参照・並べ替えができる (FramePosListで使用)
+//領域が足りなくなると押し込み側で再確保を行い、参照中の取り出し側の終了を待ってから古い領域を破棄する
+//キューとして使う場合は、リングバッファによるCQueueSPSPを使用すること
 template<typename Type, size_t align_byte = sizeof(Type)>
-class CQueueSPSP {
+class CArraySPSP {
     union queueData {
         Type data;
         char pad[((sizeof(Type) + (align_byte-1)) & (~(align_byte-1)))];
     };
 public:
-    //並列で1つの押し込みと1つの取り出しが可能なキューを作成する
-    //スレッド並列対応のため、データにはパディングをつけてアライメントをとることが可能 (align_byte)
-    //どこまで効果があるかは不明だが、align_byte=64としてfalse sharingを回避できる
-    CQueueSPSP() :
-        m_nPushRestartExtra(0),
-        m_heEventPoped(NULL),
-        m_heEventPushed(NULL),
+    CArraySPSP() :
         m_nMallocAlign(32),
-        m_nMaxCapacity(SIZE_MAX),
-        m_nKeepLength(0),
-        m_pBufStart(), m_pBufFin(nullptr), m_pBufIn(nullptr), m_pBufOut(nullptr), m_bUsingData(false) {
-        static_assert(std::is_pod<Type>::value == true, "CQueueSPSP is only for POD type.");
+        m_pBufStart(), m_pBufFin(nullptr), m_pBufIn(nullptr), m_pBufOut(nullptr), m_bUsingData(0) {
+        static_assert(std::is_pod<Type>::value == true, "CArraySPSP is only for POD type.");
         //実際のメモリのアライメントに適切な2の倍数であるか確認する
         //そうでない場合は32をデフォルトとして使用
         for (uint32_t i = 4; i < sizeof(i) * 8; i++) {
@@ -74,9 +234,11 @@ public:
             }
         }
     }
-    ~CQueueSPSP() {
+    ~CArraySPSP() {
         close();
     }
+    CArraySPSP(const CArraySPSP&) = delete;
+    CArraySPSP& operator=(const CArraySPSP&) = delete;
     //indexの位置への参照を返す
     // !! push側のスレッドからのみ有効 !!
     queueData& operator[](uint32_t index) {
@@ -92,52 +254,250 @@ public:
     queueData *get(uint32_t index) {
         return m_pBufOut + index;
     }
+    //配列を初期化する
+    //bufSizeは内部データバッファの初期サイズで、足りなくなれば押し込み時に拡張する
+    void init(size_t bufSize = 1024) {
+        close();
+        alloc(bufSize);
+    }
+    //配列のデータをクリアし、リソースを破棄する
+    void close() {
+        m_pBufStart.reset();
+        m_pBufFin = nullptr;
+        m_pBufIn = nullptr;
+        m_pBufOut = nullptr;
+        m_bUsingData = 0;
+    }
+    //データを配列の末尾にコピーする
+    bool push(const Type& in) {
+        if (!expand(1)) {
+            return false;
+        }
+        queueData *pBufIn = m_pBufIn.load(std::memory_order_relaxed);
+        memcpy(pBufIn, &in, sizeof(Type));
+        m_pBufIn.store(pBufIn + 1, std::memory_order_release);
+        return true;
+    }
+    //配列のsizeを取得する
+    size_t size() const {
+        if (!m_pBufStart)
+            return 0;
+        //バッファはあるが、m_pBufInがnullptrの場合は、
+        //押し込み処理で書き換え中なので待機する
+        queueData *ptr = nullptr;
+        while ((ptr = m_pBufIn.load(std::memory_order_acquire)) == nullptr) {
+            _mm_pause();
+        }
+        return ptr - m_pBufOut.load(std::memory_order_acquire);
+    }
+    //配列が空ならtrueを返す
+    bool empty() const {
+        return size() == 0;
+    }
+    //indexの位置のコピーを取得する (どのスレッドからでも可)
+    bool copy(Type *out, uint32_t index, size_t *pnSize = nullptr) {
+        m_bUsingData++;
+        auto nSize = size();
+        bool bCopy = index < nSize;
+        if (bCopy) {
+            memcpy(out, m_pBufOut + index, sizeof(Type));
+        }
+        m_bUsingData--;
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return bCopy;
+    }
+    //先頭のデータを取り除く
+    //配列が空ならfalseを返す
+    bool pop() {
+        m_bUsingData++;
+        bool bPop = size() > 0;
+        if (bPop) {
+            m_pBufOut++;
+        }
+        m_bUsingData--;
+        return bPop;
+    }
+protected:
+    //nAdd個のデータを押し込めるよう、必要に応じて内部領域を再確保する
+    // !! push側のスレッドからのみ呼ぶこと !!
+    bool expand(size_t nAdd) {
+        if ((size_t)(m_pBufFin - m_pBufIn.load(std::memory_order_relaxed)) >= nAdd) {
+            return true;
+        }
+        //現時点でのm_pBufOut (この後別スレッドによって書き換わるかもしれない)
+        queueData *pBufOutOld = m_pBufOut.load();
+        //現在配列にあるデータサイズ
+        const size_t dataSize = m_pBufIn.load(std::memory_order_relaxed) - pBufOutOld;
+        //新たに確保するバッファのデータサイズ
+        const size_t bufSize = (std::max)((std::max)((size_t)(m_pBufFin - m_pBufStart.get()), dataSize * 2), dataSize + nAdd);
+        //新たなバッファ
+        auto newBuf = std::unique_ptr<queueData, aligned_malloc_deleter>(
+            (queueData *)_aligned_malloc(sizeof(queueData) * bufSize, m_nMallocAlign), aligned_malloc_deleter());
+        if (!newBuf) {
+            return false;
+        }
+        memcpy(newBuf.get(), pBufOutOld, sizeof(queueData) * dataSize);
+        queueData *pBufOutNew = newBuf.get();
+        queueData *pBufOutExpected = pBufOutOld;
+        //更新前にnullptrをセット
+        m_pBufIn = nullptr;
+        //m_pBufOutが変更されていなければ、pBufOutNewをm_pBufOutに代入
+        //変更されていれば、pBufOutNewを修正して再度代入
+        while (!std::atomic_compare_exchange_weak(&m_pBufOut, &pBufOutExpected, pBufOutNew)) {
+            pBufOutNew += (pBufOutExpected - pBufOutOld);
+            pBufOutOld = pBufOutExpected;
+        }
+        //新しいバッファ用にデータを書き換え
+        m_pBufIn  = newBuf.get() + dataSize;
+        m_pBufFin = newBuf.get() + bufSize;
+        //取り出し側のコピー終了を待機
+        //一度falseになったことが確認できれば、
+        //その次の取り出しは新しいバッファから行われていることになるので、
+        //古いバッファは破棄してよい
+        //(ここでm_bUsingDataを0に戻すと、直後に読み出しを始めた取り出し側のカウントを消してしまうので行わない)
+        while (m_bUsingData.load()) {
+            _mm_pause();
+        }
+        //古いバッファを破棄
+        m_pBufStart = std::move(newBuf);
+        return true;
+    }
+    //bufSize分の内部領域を確保する
+    void alloc(size_t bufSize) {
+        m_pBufStart = std::unique_ptr<queueData, aligned_malloc_deleter>(
+            (queueData *)_aligned_malloc(sizeof(queueData) * bufSize, (std::max)(16, m_nMallocAlign)), aligned_malloc_deleter());
+        m_pBufFin = m_pBufStart.get() + bufSize;
+        m_pBufIn  = m_pBufStart.get();
+        m_pBufOut = m_pBufStart.get();
+    }
+
+    int m_nMallocAlign; //メモリのアライメント
+    std::unique_ptr<queueData, aligned_malloc_deleter> m_pBufStart; //確保しているメモリ領域の先頭へのポインタ
+    queueData *m_pBufFin; //確保しているメモリ領域の終端
+    //押し込み側と取り出し側で更新する位置は、false sharingを避けるため別のキャッシュラインに置く
+    alignas(QUEUE_CACHE_LINE_SIZE) std::atomic<queueData*> m_pBufIn; //データを格納する位置へのポインタ
+    alignas(QUEUE_CACHE_LINE_SIZE) std::atomic<queueData*> m_pBufOut; //先頭のデータへのポインタ
+    std::atomic<int> m_bUsingData; //読み出し中のスレッドの数
+};
+
+//並列で1つの押し込みと1つの取り出しが可能なキュー
+//データは2のべき乗のサイズのリングバッファに格納し、押し込み・取り出しではデータの移動やバッファの再確保を行わない
+//容量(capacity)はリングのサイズまでで、容量に達した場合は押し込み側が空きができるまで待機する
+//容量が無制限(SIZE_MAX)の場合は、押し込み側がreserveでリングを拡張してから押し込むこと (リングが満杯ならpushはfalseを返す)
+//リングは常に1つなので、CQueueSPSPRingと異なり押し込み側からindexによる参照 (operator[]) ができる
+//スレッド並列対応のため、データにはパディングをつけてアライメントをとることが可能 (align_byte)
+//どこまで効果があるかは不明だが、align_byte=64としてfalse sharingを回避できる
+template<typename Type, size_t align_byte = sizeof(Type)>
+class CQueueSPSP {
+    union queueData {
+        Type data;
+        char pad[((sizeof(Type) + (align_byte-1)) & (~(align_byte-1)))];
+    };
+    struct ringBuffer {
+        std::unique_ptr<queueData, aligned_malloc_deleter> buf;
+        size_t mask; //リングのサイズ - 1
+    };
+public:
+    CQueueSPSP() :
+        m_nPushRestartExtra(0),
+        m_waitPoped(),
+        m_waitPushed(),
+        m_pWaitPushed(&m_waitPushed),
+        m_nMallocAlign(32),
+        m_nMaxCapacity(SIZE_MAX),
+        m_nKeepLength(0),
+        m_pStats(nullptr),
+        m_nPopBlockedSince(0),
+        m_pRing(nullptr),
+        m_nRingSize(0),
+        m_nUsingData(0),
+        m_nIn(0),
+        m_nOut(0) {
+        static_assert(std::is_pod<Type>::value == true, "CQueueSPSP is only for POD type.");
+        //実際のメモリのアライメントに適切な2の倍数であるか確認する
+        //そうでない場合は32をデフォルトとして使用
+        for (uint32_t i = 4; i < sizeof(i) * 8; i++) {
+            int test = 1 << i;
+            if (test == align_byte) {
+                m_nMallocAlign = test;
+                break;
+            }
+        }
+    }
+    ~CQueueSPSP() {
+        close();
+    }
+    CQueueSPSP(const CQueueSPSP&) = delete;
+    CQueueSPSP& operator=(const CQueueSPSP&) = delete;
+    //先頭からindex番目のデータへの参照を返す
+    // !! push側のスレッドからのみ有効 !!
+    queueData& operator[](size_t index) {
+        const ringBuffer *pRing = m_pRing.load(std::memory_order_relaxed);
+        return pRing->buf.get()[(m_nOut.load(std::memory_order_acquire) + index) & pRing->mask];
+    }
     //キューが一定の長さに達しないとfront_copy/popできないように設定する
     void set_keep_length(size_t keepLength) {
         m_nKeepLength = keepLength;
+        //keepLengthが小さくなると取り出せるようになるので、待機中のスレッドを起こす
+        m_pWaitPushed->notify();
     }
     size_t get_keep_length() {
         return m_nKeepLength;
     }
+    //統計情報を記録する構造体を設定する (nullptrなら記録しない)
+    //1つのCQueueStatsを複数のキューで共有してはならない
+    void set_stats(CQueueStats *pStats) {
+        m_pStats = pStats;
+        m_nPopBlockedSince = 0;
+    }
+    //押し込んだときに通知するCQueueWaiterを設定する (nullptrならキュー自身のものを使用する)
+    //複数のキューに同じものを設定すると、取り出し側はいずれかのキューへの押し込みをまとめて待機できる
+    void set_push_waiter(CQueueWaiter *pWaiter) {
+        m_pWaitPushed = (pWaiter) ? pWaiter : &m_waitPushed;
+    }
     //キューを初期化する
-    //bufSizeはキューの内部データバッファサイズ maxCapacityを超えてもかまわない
-    //maxCapacityはキューに格納できる最大のデータ数
-    void init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX, int nPushRestart = 1) {
+    //リングのサイズはbufSizeとmaxCapacityの大きいほうを2のべき乗に切り上げたものとなる
+    //maxCapacityが無制限(SIZE_MAX)の場合は、リングが足りなくなる前に押し込み側がreserveで拡張する
+    bool init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX, int nPushRestart = 1) {
         close();
-        alloc(bufSize);
-        m_heEventPoped = CreateEvent(NULL, TRUE, TRUE, NULL);
-        m_heEventPushed = CreateEvent(NULL, TRUE, TRUE, NULL);
+        ringBuffer *pRing = alloc_ring((std::max)(bufSize, (maxCapacity != SIZE_MAX) ? maxCapacity : 0));
+        if (pRing == nullptr) {
+            return false;
+        }
+        m_pRing = pRing;
+        m_nRingSize = pRing->mask + 1;
+        m_nIn = 0;
+        m_nOut = 0;
         m_nMaxCapacity = maxCapacity;
         m_nKeepLength = 0;
         m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (int)std::min<size_t>(INT_MAX, maxCapacity) - 4);
+        return true;
     }
     //キューのデータをクリアする
+    // !! 押し込み側・取り出し側のスレッドが停止している状態で使用すること !!
     void clear() {
-        const auto bufSize = m_pBufFin - m_pBufStart.get();
-        m_pBufFin = m_pBufStart.get() + bufSize;
-        m_pBufIn  = m_pBufStart.get();
-        m_pBufOut = m_pBufStart.get();
+        m_nOut = m_nIn.load();
     }
     //キューのデータをクリアする際に、指定した関数で内部データを開放してから、データをクリアする
     template<typename Func>
     void clear(Func deleter) {
-        queueData *ptrFin = m_pBufIn;
-        for (queueData *ptr = m_pBufOut; ptr < ptrFin; ptr++) {
-            deleter(&ptr->data);
+        const ringBuffer *pRing = m_pRing.load();
+        if (pRing) {
+            for (size_t i = m_nOut.load(), nIn = m_nIn.load(); i < nIn; i++) {
+                deleter(&pRing->buf.get()[i & pRing->mask].data);
+            }
         }
         clear();
     }
     //キューのデータをクリアし、リソースを破棄する
     void close() {
-        if (m_heEventPoped) {
-            CloseEvent(m_heEventPoped);
-            m_heEventPoped = NULL;
-        }
-        m_pBufStart.reset();
-        m_pBufFin = nullptr;
-        m_pBufIn = nullptr;
-        m_pBufOut = nullptr;
-        m_bUsingData = false;
+        delete m_pRing.exchange(nullptr);
+        m_nRingSize = 0;
+        m_nUsingData = 0;
+        m_nIn = 0;
+        m_nOut = 0;
     }
     //キューのデータをクリアする際に、指定した関数で内部データを開放してから、リソースを破棄する
     template<typename Func>
@@ -148,65 +508,57 @@ public:
     //データをキューにコピーし押し込む
     //キューのデータ量があらかじめ設定した上限に達した場合は、キューに空きができるまで待機する
     bool push(const Type& in) {
-        //最初に決めた容量分までキューにデータがたまっていたら、キューに空きができるまで待機する
-        while (size() >= m_nMaxCapacity) {
-            ResetEvent(m_heEventPoped);
-            WaitForSingleObject(m_heEventPoped, 16);
-        }
-        if (m_pBufIn >= m_pBufFin) {
-            //現時点でのm_pBufOut (この後別スレッドによって書き換わるかもしれない)
-            queueData *pBufOutOld = m_pBufOut.load();
-            //現在キューにあるデータサイズ
-            const size_t dataSize = m_pBufFin - pBufOutOld;
-            //新たに確保するバッファのデータサイズ
-            const size_t bufSize = (std::max)((size_t)(m_pBufFin - m_pBufStart.get()), dataSize * 2);
-            //新たなバッファ
-            auto newBuf = std::unique_ptr<queueData, aligned_malloc_deleter>(
-                (queueData *)_aligned_malloc(sizeof(queueData) * bufSize, m_nMallocAlign), aligned_malloc_deleter());
-            if (!newBuf) {
+        return push_n(&in, 1);
+    }
+    //n個のデータをまとめてキューにコピーし押し込む
+    //押し込み位置の更新と通知はまとめて行うので、1つずつpushするより取り出し側とのやり取りが少なくて済む
+    //キューのデータ量があらかじめ設定した上限に達した場合は、キューに空きができるまで待機する
+    //リングの拡張は行わないので、容量が無制限(SIZE_MAX)でリングが満杯の場合はfalseを返す (あらかじめreserveしておくこと)
+    bool push_n(const Type *in, size_t n) {
+        const ringBuffer *pRing = m_pRing.load(std::memory_order_relaxed);
+        if (pRing == nullptr) {
+            return false;
+        }
+        while (n > 0) {
+            //設定した容量分までキューにデータがたまっていたら、キューに空きができるまで待機する
+            size_t nSize = 0;
+            if ((nSize = size()) >= m_nMaxCapacity.load(std::memory_order_acquire)) {
+                const uint64_t tmBlocked = (m_pStats) ? CQueueStats::now_us() : 0;
+                while ((nSize = size()) >= m_nMaxCapacity.load(std::memory_order_acquire)) {
+                    m_waitPoped.wait([this]() { return size() < m_nMaxCapacity.load(std::memory_order_relaxed); }, INFINITE);
+                }
+                if (m_pStats) {
+                    m_pStats->push_blocked(CQueueStats::now_us() - tmBlocked);
+                }
+            }
+            const size_t nFree = pRing->mask + 1 - nSize;
+            if (nFree == 0) {
                 return false;
             }
-            memcpy(newBuf.get(), pBufOutOld, sizeof(queueData) * dataSize);
-            queueData *pBufOutNew = newBuf.get();
-            queueData *pBufOutExpected = pBufOutOld;
-            //更新前にnullptrをセット
-            m_pBufIn = nullptr;
-            //m_pBufOutが変更されていなければ、pBufOutNewをm_pBufOutに代入
-            //変更されていれば、pBufOutNewを修正して再度代入
-            while (!std::atomic_compare_exchange_weak(&m_pBufOut, &pBufOutExpected, pBufOutNew)) {
-                pBufOutNew += (pBufOutExpected - pBufOutOld);
-                pBufOutOld = pBufOutExpected;
-            }
-            //新しいバッファ用にデータを書き換え
-            m_pBufIn  = newBuf.get() + dataSize;
-            m_pBufFin = newBuf.get() + bufSize;
-            //取り出し側のコピー終了を待機
-            //一度falseになったことが確認できれば、
-            //その次の取り出しは新しいバッファから行われていることになるので、
-            //古いバッファは破棄してよい
-            while (m_bUsingData.load()) {
-                _mm_pause();
-            }
-            //古いバッファを破棄
-            m_pBufStart = std::move(newBuf);
-            m_bUsingData = 0;
-        }
-        memcpy(m_pBufIn.load(), &in, sizeof(Type));
-        m_pBufIn++;
-        SetEvent(m_heEventPushed);
+            const size_t nPush = (std::min)((std::min)(n, m_nMaxCapacity.load(std::memory_order_relaxed) - nSize), nFree);
+            const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < nPush; ) {
+                //リングの終端で折り返すので、連続した領域ごとにコピーする
+                const size_t pos = (nIn + i) & pRing->mask;
+                const size_t nCopy = (std::min)(nPush - i, pRing->mask + 1 - pos);
+                copy_data(pRing->buf.get() + pos, in + i, nCopy);
+                i += nCopy;
+            }
+            m_nIn.store(nIn + nPush, std::memory_order_release);
+            m_pWaitPushed->notify();
+            if (m_pStats) {
+                m_pStats->push_done(nPush, nSize + nPush);
+            }
+            in += nPush;
+            n -= nPush;
+        }
         return true;
     }
     //キューのsizeを取得する
     size_t size() const {
-        if (!m_pBufStart)
-            return 0;
-        //バッファはあるが、m_pBufInがnullptrの場合は、
-        //押し込み処理で書き換え中なので待機する
-        queueData *ptr = nullptr;
-        while ((ptr = m_pBufIn.load()) == nullptr) {
-            _mm_pause();
-        }
-        return ptr - m_pBufOut;
+        //取り出し位置を先に読むことで、押し込み位置より大きくならないようにする
+        const size_t nOut = m_nOut.load(std::memory_order_acquire);
+        return m_nIn.load(std::memory_order_acquire) - nOut;
     }
     //キューが空ならtrueを返す
     bool empty() const {
@@ -214,43 +566,76 @@ public:
     }
     //キューの最大サイズを取得する
     size_t capacity() const {
-        return m_nMaxCapacity;
+        return m_nMaxCapacity.load(std::memory_order_relaxed);
     }
-    //キューの最大サイズを設定する
+    //キューの最大サイズを設定する (リングのサイズまで、SIZE_MAXなら無制限)
     void set_capacity(size_t capacity) {
-        m_nMaxCapacity = capacity;
-        m_nPushRestartExtra = (std::min)(m_nPushRestartExtra, (int)std::min<size_t>(INT_MAX, m_nMaxCapacity) - 1);
+        if (capacity != SIZE_MAX) {
+            capacity = (std::min)(capacity, m_nRingSize.load(std::memory_order_acquire));
+        }
+        m_nMaxCapacity.store(capacity, std::memory_order_release);
+        m_nPushRestartExtra = (std::min)(m_nPushRestartExtra, (int)std::min<size_t>(INT_MAX, capacity) - 1);
+        //容量が増えると押し込めるようになるので、待機中のスレッドを起こす
+        m_waitPoped.notify();
+    }
+    //キューにnSize個のデータを格納できるよう、必要ならリングを拡張する
+    //拡張時はデータを新しいリングにコピーし、参照中の取り出し側の終了を待ってから古いリングを破棄する
+    // !! 押し込み側のスレッドからのみ呼ぶこと !!
+    bool reserve(size_t nSize) {
+        ringBuffer *pRing = m_pRing.load(std::memory_order_relaxed);
+        if (pRing == nullptr) {
+            return false;
+        }
+        if (nSize <= pRing->mask + 1) {
+            return true;
+        }
+        ringBuffer *pRingNew = alloc_ring((std::max)((pRing->mask + 1) * 2, nSize));
+        if (pRingNew == nullptr) {
+            return false;
+        }
+        //コピー中に取り出し側が取り出しを進めても、まだ取り出されていないデータはすべてコピーされる
+        const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+        for (size_t i = m_nOut.load(std::memory_order_acquire); i < nIn; i++) {
+            memcpy(pRingNew->buf.get() + (i & pRingNew->mask), pRing->buf.get() + (i & pRing->mask), sizeof(queueData));
+        }
+        m_pRing.store(pRingNew);
+        m_nRingSize.store(pRingNew->mask + 1, std::memory_order_release);
+        //取り出し側の読み出し終了を待機
+        //一度0になったことが確認できれば、その次の読み出しは新しいリングから行われていることになるので、
+        //古いリングは破棄してよい
+        while (m_nUsingData.load()) {
+            _mm_pause();
+        }
+        delete pRing;
+        return true;
     }
     //indexの位置のコピーを取得する
-    bool copy(Type *out, uint32_t index, size_t *pnSize = nullptr) {
-        m_bUsingData++;
+    bool copy(Type *out, size_t index, size_t *pnSize = nullptr) {
+        m_nUsingData++;
+        const ringBuffer *pRing = m_pRing.load();
         auto nSize = size();
         bool bCopy = index < nSize;
         if (bCopy) {
-            memcpy(out, m_pBufOut + index, sizeof(Type));
-        }
-        m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
+            memcpy(out, pRing->buf.get() + ((m_nOut.load(std::memory_order_relaxed) + index) & pRing->mask), sizeof(Type));
         }
+        m_nUsingData--;
         if (pnSize) {
             *pnSize = nSize;
         }
         return bCopy;
     }
-    //キューの先頭のデータを取り出す (outにコピーする)
+    //キューの先頭のデータをoutにコピーする (キューからは取り除かない)
     //キューが空ならなにもせずfalseを返す
     bool front_copy_no_lock(Type *out, size_t *pnSize = nullptr) {
-        m_bUsingData++;
+        m_nUsingData++;
+        const ringBuffer *pRing = m_pRing.load();
         auto nSize = size();
         bool bCopy = nSize > m_nKeepLength;
         if (bCopy) {
-            memcpy(out, m_pBufOut.load(), sizeof(Type));
-        }
-        m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
+            memcpy(out, pRing->buf.get() + (m_nOut.load(std::memory_order_relaxed) & pRing->mask), sizeof(Type));
         }
+        m_nUsingData--;
+        stat_pop(bCopy, 0);
         if (pnSize) {
             *pnSize = nSize;
         }
@@ -259,73 +644,1158 @@ public:
     //キューの先頭のデータを取り出しながら(outにコピーする)、キューから取り除く
     //キューが空ならなにもせずfalseを返す
     bool front_copy_and_pop_no_lock(Type *out, size_t *pnSize = nullptr) {
-        m_bUsingData++;
+        return pop_n(out, 1, pnSize) > 0;
+    }
+    //キューの先頭から最大maxCount個のデータをまとめて取り出し(outにコピーする)、キューから取り除く
+    //取り出し位置の更新と通知はまとめて行う
+    //取り出したデータ数を返す (キューが空なら0)
+    size_t pop_n(Type *out, size_t maxCount, size_t *pnSize = nullptr) {
+        m_nUsingData++;
+        const ringBuffer *pRing = m_pRing.load();
         auto nSize = size();
-        bool bCopy = nSize > m_nKeepLength;
-        if (bCopy) {
-            memcpy(out, m_pBufOut++, sizeof(Type));
-            if (nSize <= m_nMaxCapacity - m_nPushRestartExtra) {
-                SetEvent(m_heEventPoped);
+        const size_t nPop = (nSize > m_nKeepLength) ? (std::min)(maxCount, nSize - m_nKeepLength) : 0;
+        if (nPop) {
+            const size_t nOut = m_nOut.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < nPop; ) {
+                const size_t pos = (nOut + i) & pRing->mask;
+                const size_t nCopy = (std::min)(nPop - i, pRing->mask + 1 - pos);
+                copy_data(out + i, pRing->buf.get() + pos, nCopy);
+                i += nCopy;
             }
+            m_nOut.store(nOut + nPop, std::memory_order_release);
         }
-        m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
+        m_nUsingData--;
+        if (nPop && need_notify_poped(nSize - nPop)) {
+            m_waitPoped.notify();
         }
+        stat_pop(nPop > 0, nPop);
         if (pnSize) {
             *pnSize = nSize;
         }
-        return bCopy;
+        return nPop;
+    }
+    //キューの先頭のデータへのポインタを返し、pnCountに連続して参照可能なデータ数を格納する (コピーは行わない)
+    //リングの終端で折り返す場合は、終端までのデータ数となる
+    //参照し終わったら、必ずcommit()で取り除くデータ数 (0でもよい) を指定すること
+    //peekからcommitまでの間は押し込み側のリングの拡張が待たされるので、短時間で済ませること
+    const queueData *peek(size_t *pnCount) {
+        m_nUsingData++;
+        const ringBuffer *pRing = m_pRing.load();
+        auto nSize = size();
+        *pnCount = 0;
+        const queueData *ptr = nullptr;
+        if (nSize > m_nKeepLength) {
+            const size_t pos = m_nOut.load(std::memory_order_relaxed) & pRing->mask;
+            ptr = pRing->buf.get() + pos;
+            *pnCount = (std::min)(nSize - m_nKeepLength, pRing->mask + 1 - pos);
+        }
+        stat_pop(*pnCount > 0, 0);
+        return ptr;
+    }
+    //peekで参照したデータのうち、先頭からnCount個をキューから取り除く
+    void commit(size_t nCount) {
+        if (nCount) {
+            auto nSize = size();
+            m_nOut.store(m_nOut.load(std::memory_order_relaxed) + nCount, std::memory_order_release);
+            if (need_notify_poped(nSize - nCount)) {
+                m_waitPoped.notify();
+            }
+            stat_pop(true, nCount);
+        }
+        m_nUsingData--;
     }
     //キューの先頭のデータを取り除く
     //キューが空ならfalseを返す
     bool pop() {
-        m_bUsingData++;
         auto nSize = size();
-        bool bCopy = nSize > m_nKeepLength;
-        if (bCopy) {
-            m_pBufOut++;
-            if (nSize <= m_nMaxCapacity - m_nPushRestartExtra) {
-                SetEvent(m_heEventPoped);
+        bool bPop = nSize > m_nKeepLength;
+        if (bPop) {
+            m_nOut.store(m_nOut.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            if (need_notify_poped(nSize - 1)) {
+                m_waitPoped.notify();
             }
         }
-        m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
+        stat_pop(bPop, (bPop) ? 1 : 0);
+        return bPop;
+    }
+    //要素が取り出せるようになるまで待機する
+    void wait_for_push(DWORD dwMilliseconds = INFINITE) {
+        m_pWaitPushed->wait([this]() { return size() > m_nKeepLength; }, dwMilliseconds);
+    }
+protected:
+    //取り出し側の統計情報を記録する
+    void stat_pop(bool bAvailable, size_t nPop) {
+        if (m_pStats) {
+            m_pStats->pop_result(&m_nPopBlockedSince, bAvailable, nPop);
         }
-        return bCopy;
     }
-    //要素が追加されるまで待機する
-    void wait_for_push() {
-        WaitForSingleObject(m_heEventPushed, 16);
+    //取り出し後のデータ数がnSizeAfterのとき、押し込み側に空きを通知するか
+    //空き通知はm_nPushRestartExtraぶんの余裕ができるまで行わないが、keep_lengthまで取り出すと
+    //取り出し側はそれ以上取り出さないので、押し込み側が待機したままにならないよう通知する
+    bool need_notify_poped(size_t nSizeAfter) const {
+        return nSizeAfter < m_nMaxCapacity.load(std::memory_order_relaxed) - m_nPushRestartExtra
+            || nSizeAfter <= m_nKeepLength;
     }
-    //要素が追加されるまで待機するイベントを取得
-    HANDLE get_push_event() {
-        return m_heEventPushed;
+    static void copy_data(queueData *dst, const Type *src, size_t n) {
+        if (sizeof(queueData) == sizeof(Type)) {
+            memcpy(dst, src, sizeof(Type) * n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                memcpy(dst + i, src + i, sizeof(Type));
+            }
+        }
     }
-protected:
-    //bufSize分の内部領域を確保する
-    //m_nMaxCapacity以上確保してもかまわない
-    //基本的には大きいほうがパフォーマンスは向上する
-    void alloc(size_t bufSize) {
-        m_pBufStart = std::unique_ptr<queueData, aligned_malloc_deleter>(
+    static void copy_data(Type *dst, const queueData *src, size_t n) {
+        if (sizeof(queueData) == sizeof(Type)) {
+            memcpy(dst, src, sizeof(Type) * n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                memcpy(dst + i, src + i, sizeof(Type));
+            }
+        }
+    }
+    //nMinSize以上の2のべき乗のサイズのリングを確保する
+    ringBuffer *alloc_ring(size_t nMinSize) {
+        if (nMinSize > SIZE_MAX / 2 / sizeof(queueData)) {
+            return nullptr;
+        }
+        size_t bufSize = 2;
+        while (bufSize < nMinSize) {
+            bufSize <<= 1;
+        }
+        std::unique_ptr<ringBuffer> ring(new ringBuffer());
+        ring->buf = std::unique_ptr<queueData, aligned_malloc_deleter>(
             (queueData *)_aligned_malloc(sizeof(queueData) * bufSize, (std::max)(16, m_nMallocAlign)), aligned_malloc_deleter());
-        m_pBufFin = m_pBufStart.get() + bufSize;
-        m_pBufIn  = m_pBufStart.get();
-        m_pBufOut = m_pBufStart.get();
+        if (!ring->buf) {
+            return nullptr;
+        }
+        ring->mask = bufSize - 1;
+        return ring.release();
     }
 
     int m_nPushRestartExtra; //キューに空きがこのぶんだけ余剰にないと空き通知を行わない (0 = ひとつあけば通知を行う)
-    HANDLE m_heEventPoped; //キューからデータを取り出したときセットする
-    HANDLE m_heEventPushed; //キューにデータが追加されたときセットする
+    CQueueWaiter m_waitPoped; //キューからデータを取り出したとき通知する
+    CQueueWaiter m_waitPushed; //キューにデータが追加されたとき通知する
+    CQueueWaiter *m_pWaitPushed; //押し込み時に実際に通知する先 (set_push_waiterで変更しなければm_waitPushed)
     int m_nMallocAlign; //メモリのアライメント
-    size_t m_nMaxCapacity; //キューに詰められる有効なデータの最大数
+    std::atomic<size_t> m_nMaxCapacity; //キューに詰められる有効なデータの最大数
     size_t m_nKeepLength; //ある一定の長さを常にキュー内に保持するようにする
-    std::unique_ptr<queueData, aligned_malloc_deleter> m_pBufStart; //確保しているメモリ領域の先頭へのポインタ
-    queueData *m_pBufFin; //確保しているメモリ領域の終端
-    std::atomic<queueData*> m_pBufIn; //キューにデータを格納する位置へのポインタ
-    std::atomic<queueData*> m_pBufOut; //キューから取り出すべき先頭のデータへのポインタ
-    std::atomic<int> m_bUsingData; //キューから読み出し中のスレッドの数
+    CQueueStats *m_pStats; //統計情報の記録先 (nullptrなら記録しない)
+    uint64_t m_nPopBlockedSince; //取り出し側がキューが空で取り出せなくなった時刻 (us, 0なら取り出し可能)
+    std::atomic<ringBuffer*> m_pRing; //リングバッファ (reserveで拡張するときのみ押し込み側が置き換える)
+    std::atomic<size_t> m_nRingSize; //リングのサイズ (set_capacityで参照する)
+    std::atomic<int> m_nUsingData; //リングから読み出し中のスレッドの数
+    //押し込み側と取り出し側で更新する位置は、false sharingを避けるため別のキャッシュラインに置く
+    alignas(QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_nIn; //これまでに押し込んだデータ数
+    alignas(QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_nOut; //これまでに取り出したデータ数
 };
 
+//CQueueSPSPと同じインターフェースを持つ、リングバッファによるキュー
+//容量は初期化時に2のべき乗に切り上げて固定し、押し込み・取り出しではデータの移動やバッファの再確保を行わない
+//CQueueSPSPと異なり、押し込み側からのindexによる参照 (operator[]) はできない
+//
+//set_capacityで容量をリングのサイズより大きくした場合は、set_capacityを呼んだスレッドでより大きなリングを確保して押し込み側に渡し、
+//押し込み側は次の押し込み時にそちらに切り替える (古いリングは取り出し側が読み終えた時点で破棄する)
+//これにより、容量の変更はどのスレッドから行ってもよく、押し込み側でメモリ確保を行うことも、取り出し側を待たせることもない
+//容量が無制限(SIZE_MAX)の場合は、押し込み側がreserveで必要な分のリングを確保してから押し込むこと
+template<typename Type, size_t align_byte = sizeof(Type)>
+class CQueueSPSPRing {
+    union queueData {
+        Type data;
+        char pad[((sizeof(Type) + (align_byte-1)) & (~(align_byte-1)))];
+    };
+    //リング1つ分のデータ
+    struct ringSegment {
+        std::unique_ptr<queueData, aligned_malloc_deleter> buf;
+        size_t mask;                     //リングのサイズ - 1
+        std::atomic<size_t> nEnd;        //この位置以降のデータは次のリングにある (SIZE_MAXなら押し込み中)
+        std::atomic<ringSegment*> pNext; //次のリング
+    };
+public:
+    CQueueSPSPRing() :
+        m_nPushRestartExtra(0),
+        m_waitPoped(),
+        m_waitPushed(),
+        m_pWaitPushed(&m_waitPushed),
+        m_nMallocAlign(32),
+        m_nMaxCapacity(SIZE_MAX),
+        m_nKeepLength(0),
+        m_pStats(nullptr),
+        m_nPopBlockedSince(0),
+        m_pSegPending(nullptr),
+        m_nRingSize(0),
+        m_pSegIn(nullptr),
+        m_nSegInStart(0),
+        m_nIn(0),
+        m_pSegOut(nullptr),
+        m_nOut(0) {
+        static_assert(std::is_pod<Type>::value == true, "CQueueSPSPRing is only for POD type.");
+        for (uint32_t i = 4; i < sizeof(i) * 8; i++) {
+            int test = 1 << i;
+            if (test == align_byte) {
+                m_nMallocAlign = test;
+                break;
+            }
+        }
+    }
+    ~CQueueSPSPRing() {
+        close();
+    }
+    CQueueSPSPRing(const CQueueSPSPRing&) = delete;
+    CQueueSPSPRing& operator=(const CQueueSPSPRing&) = delete;
+    //キューが一定の長さに達しないとfront_copy/popできないように設定する
+    void set_keep_length(size_t keepLength) {
+        m_nKeepLength = keepLength;
+        m_pWaitPushed->notify();
+    }
+    size_t get_keep_length() {
+        return m_nKeepLength;
+    }
+    //統計情報を記録する構造体を設定する (nullptrなら記録しない)
+    void set_stats(CQueueStats *pStats) {
+        m_pStats = pStats;
+        m_nPopBlockedSince = 0;
+    }
+    //押し込んだときに通知するCQueueWaiterを設定する (nullptrならキュー自身のものを使用する)
+    void set_push_waiter(CQueueWaiter *pWaiter) {
+        m_pWaitPushed = (pWaiter) ? pWaiter : &m_waitPushed;
+    }
+    //キューを初期化する
+    //maxCapacityはキューに格納できる最大のデータ数で、リングのサイズはこれを2のべき乗に切り上げたものとなる
+    //maxCapacityが無制限(SIZE_MAX)の場合は、bufSizeをリングの初期サイズとし、足りなくなる場合はreserveでリングを追加する
+    bool init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX, int nPushRestart = 1) {
+        close();
+        m_pSegIn = alloc_segment((maxCapacity != SIZE_MAX) ? maxCapacity : bufSize);
+        if (m_pSegIn == nullptr) {
+            return false;
+        }
+        m_nRingSize = m_pSegIn->mask + 1;
+        m_pSegOut = m_pSegIn;
+        m_nSegInStart = 0;
+        m_nIn = 0;
+        m_nOut = 0;
+        m_nMaxCapacity = maxCapacity;
+        m_nKeepLength = 0;
+        m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (int)std::min<size_t>(INT_MAX, maxCapacity) - 4);
+        return true;
+    }
+    //キューのデータをクリアする
+    // !! 押し込み側・取り出し側のスレッドが停止している状態で使用すること !!
+    void clear() {
+        if (m_pSegIn == nullptr) {
+            return;
+        }
+        free_segments(m_pSegIn);
+        m_pSegOut = m_pSegIn;
+        m_pSegIn->nEnd = SIZE_MAX;
+        m_nSegInStart = m_nIn.load();
+        m_nOut = m_nIn.load();
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、データをクリアする
+    template<typename Func>
+    void clear(Func deleter) {
+        const size_t nKeepLength = m_nKeepLength;
+        m_nKeepLength = 0;
+        Type data;
+        while (front_copy_and_pop_no_lock(&data)) {
+            deleter(&data);
+        }
+        m_nKeepLength = nKeepLength;
+        clear();
+    }
+    //キューのデータをクリアし、リソースを破棄する
+    void close() {
+        free_segments(nullptr);
+        delete m_pSegPending.exchange(nullptr);
+        m_nRingSize = 0;
+        m_pSegIn = nullptr;
+        m_pSegOut = nullptr;
+        m_nSegInStart = 0;
+        m_nIn = 0;
+        m_nOut = 0;
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、リソースを破棄する
+    template<typename Func>
+    void close(Func deleter) {
+        if (m_pSegIn) {
+            clear(deleter);
+        }
+        close();
+    }
+    //データをキューにコピーし押し込む
+    //キューのデータ量があらかじめ設定した上限に達した場合は、キューに空きができるまで待機する
+    bool push(const Type& in) {
+        return push_n(&in, 1);
+    }
+    //n個のデータをまとめてキューにコピーし押し込む
+    //リングの確保は行わないので、容量が無制限(SIZE_MAX)でリングが満杯の場合はfalseを返す (あらかじめreserveしておくこと)
+    bool push_n(const Type *in, size_t n) {
+        if (m_pSegIn == nullptr) {
+            return false;
+        }
+        while (n > 0) {
+            //set_capacityで確保されたリングがあれば、以降の押し込みはそちらに行う
+            if (m_pSegPending.load(std::memory_order_relaxed) != nullptr) {
+                switch_segment(m_pSegPending.exchange(nullptr, std::memory_order_acquire));
+            }
+            size_t nSize = 0;
+            if ((nSize = size()) >= m_nMaxCapacity.load(std::memory_order_acquire)) {
+                const uint64_t tmBlocked = (m_pStats) ? CQueueStats::now_us() : 0;
+                while ((nSize = size()) >= m_nMaxCapacity.load(std::memory_order_acquire)) {
+                    m_waitPoped.wait([this]() { return size() < m_nMaxCapacity.load(std::memory_order_relaxed); }, INFINITE);
+                }
+                if (m_pStats) {
+                    m_pStats->push_blocked(CQueueStats::now_us() - tmBlocked);
+                }
+            }
+            const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+            //現在のリング内に残っているデータ数 (前のリングに残っているデータは含まない)
+            const size_t nSegUsed = nIn - (std::max)(m_nOut.load(std::memory_order_acquire), m_nSegInStart);
+            const size_t nSegFree = m_pSegIn->mask + 1 - nSegUsed;
+            if (nSegFree == 0) {
+                //容量を大きくしたset_capacityのリングは容量より先に設定されるので、ここで確認できる
+                ringSegment *pSeg = m_pSegPending.exchange(nullptr, std::memory_order_acquire);
+                if (pSeg == nullptr) {
+                    return false;
+                }
+                switch_segment(pSeg);
+                continue;
+            }
+            const size_t nPush = (std::min)((std::min)(n, m_nMaxCapacity.load(std::memory_order_relaxed) - nSize), nSegFree);
+            queueData *pBuf = m_pSegIn->buf.get();
+            const size_t mask = m_pSegIn->mask;
+            for (size_t i = 0; i < nPush; ) {
+                //リングの終端で折り返すので、連続した領域ごとにコピーする
+                const size_t pos = (nIn + i) & mask;
+                const size_t nCopy = (std::min)(nPush - i, mask + 1 - pos);
+                copy_data(pBuf + pos, in + i, nCopy);
+                i += nCopy;
+            }
+            m_nIn.store(nIn + nPush, std::memory_order_release);
+            m_pWaitPushed->notify();
+            if (m_pStats) {
+                m_pStats->push_done(nPush, nSize + nPush);
+            }
+            in += nPush;
+            n -= nPush;
+        }
+        return true;
+    }
+    //キューのsizeを取得する
+    size_t size() const {
+        //取り出し位置を先に読むことで、押し込み位置より大きくならないようにする
+        const size_t nOut = m_nOut.load(std::memory_order_acquire);
+        return m_nIn.load(std::memory_order_acquire) - nOut;
+    }
+    //キューが空ならtrueを返す
+    bool empty() const {
+        return size() == 0;
+    }
+    //キューの最大サイズを取得する
+    size_t capacity() const {
+        return m_nMaxCapacity.load(std::memory_order_relaxed);
+    }
+    //キューの最大サイズを設定する (どのスレッドからでも可)
+    //リングのサイズを超える場合は、ここで新しいリングを確保して押し込み側に渡す
+    //無制限(SIZE_MAX)の場合は今のリングの2倍のリングを渡し、それ以上必要な分は押し込み側がreserveで確保する
+    void set_capacity(size_t capacity) {
+        const size_t nRingSize = m_nRingSize.load(std::memory_order_acquire);
+        if (nRingSize > 0 && capacity > nRingSize) {
+            ringSegment *pSeg = alloc_segment((capacity != SIZE_MAX) ? capacity : nRingSize * 2);
+            if (pSeg) {
+                //押し込み側がまだ受け取っていないリングがあれば、新しいものに置き換える
+                delete m_pSegPending.exchange(pSeg, std::memory_order_acq_rel);
+            }
+        }
+        m_nMaxCapacity.store(capacity, std::memory_order_release);
+        m_nPushRestartExtra = (std::min)(m_nPushRestartExtra, (int)std::min<size_t>(INT_MAX, capacity) - 1);
+        m_waitPoped.notify();
+    }
+    //キューにnSize個のデータを格納できるよう、必要ならより大きなリングを確保し、以降の押し込みはそちらに行う
+    //リングが足りていれば確保は行わない
+    // !! 押し込み側のスレッドからのみ呼ぶこと !!
+    bool reserve(size_t nSize) {
+        if (m_pSegIn == nullptr) {
+            return false;
+        }
+        if (m_pSegPending.load(std::memory_order_relaxed) != nullptr) {
+            switch_segment(m_pSegPending.exchange(nullptr, std::memory_order_acquire));
+        }
+        const size_t nOut = m_nOut.load(std::memory_order_acquire);
+        const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+        if (nSize <= nIn - nOut) {
+            return true;
+        }
+        //これから押し込むデータは、現在のリングに入る必要がある
+        const size_t nSegUsed = nIn - (std::max)(nOut, m_nSegInStart);
+        if (nSegUsed + (nSize - (nIn - nOut)) <= m_pSegIn->mask + 1) {
+            return true;
+        }
+        ringSegment *pSeg = alloc_segment((std::max)((m_pSegIn->mask + 1) * 2, nSize));
+        if (pSeg == nullptr) {
+            return false;
+        }
+        switch_segment(pSeg);
+        return true;
+    }
+    //キューの先頭のデータをoutにコピーする (キューからは取り除かない)
+    //キューが空ならなにもせずfalseを返す
+    bool front_copy_no_lock(Type *out, size_t *pnSize = nullptr) {
+        auto nSize = size();
+        bool bCopy = nSize > m_nKeepLength;
+        if (bCopy) {
+            size_t nContinuous = 0;
+            memcpy(out, front_ptr(&nContinuous), sizeof(Type));
+        }
+        stat_pop(bCopy, 0);
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return bCopy;
+    }
+    //キューの先頭のデータを取り出しながら(outにコピーする)、キューから取り除く
+    //キューが空ならなにもせずfalseを返す
+    bool front_copy_and_pop_no_lock(Type *out, size_t *pnSize = nullptr) {
+        size_t nSize = 0;
+        const bool bCopy = pop_n(out, 1, &nSize) > 0;
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return bCopy;
+    }
+    //キューの先頭から最大maxCount個のデータをまとめて取り出し(outにコピーする)、キューから取り除く
+    //取り出したデータ数を返す (キューが空なら0)
+    size_t pop_n(Type *out, size_t maxCount, size_t *pnSize = nullptr) {
+        auto nSize = size();
+        const size_t nPop = (nSize > m_nKeepLength) ? (std::min)(maxCount, nSize - m_nKeepLength) : 0;
+        for (size_t i = 0; i < nPop; ) {
+            size_t nContinuous = 0;
+            const queueData *ptr = front_ptr(&nContinuous, i);
+            const size_t nCopy = (std::min)(nPop - i, nContinuous);
+            copy_data(out + i, ptr, nCopy);
+            i += nCopy;
+        }
+        if (nPop) {
+            m_nOut.store(m_nOut.load(std::memory_order_relaxed) + nPop, std::memory_order_release);
+            if (need_notify_poped(nSize - nPop)) {
+                m_waitPoped.notify();
+            }
+        }
+        stat_pop(nPop > 0, nPop);
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return nPop;
+    }
+    //キューの先頭のデータへのポインタを返し、pnCountに連続して参照可能なデータ数を格納する (コピーは行わない)
+    //リングの終端で折り返す場合は、終端までのデータ数となる
+    //参照し終わったら、必ずcommit()で取り除くデータ数 (0でもよい) を指定すること
+    const queueData *peek(size_t *pnCount) {
+        auto nSize = size();
+        *pnCount = 0;
+        const queueData *ptr = nullptr;
+        if (nSize > m_nKeepLength) {
+            size_t nContinuous = 0;
+            ptr = front_ptr(&nContinuous);
+            *pnCount = (std::min)(nSize - m_nKeepLength, nContinuous);
+        }
+        stat_pop(*pnCount > 0, 0);
+        return ptr;
+    }
+    //peekで参照したデータのうち、先頭からnCount個をキューから取り除く
+    void commit(size_t nCount) {
+        if (nCount) {
+            auto nSize = size();
+            m_nOut.store(m_nOut.load(std::memory_order_relaxed) + nCount, std::memory_order_release);
+            if (need_notify_poped(nSize - nCount)) {
+                m_waitPoped.notify();
+            }
+            stat_pop(true, nCount);
+        }
+    }
+    //キューの先頭のデータを取り除く
+    //キューが空ならfalseを返す
+    bool pop() {
+        auto nSize = size();
+        bool bPop = nSize > m_nKeepLength;
+        if (bPop) {
+            size_t nContinuous = 0;
+            front_ptr(&nContinuous); //必要ならリングを切り替える
+            m_nOut.store(m_nOut.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            if (need_notify_poped(nSize - 1)) {
+                m_waitPoped.notify();
+            }
+        }
+        stat_pop(bPop, (bPop) ? 1 : 0);
+        return bPop;
+    }
+    //要素が取り出せるようになるまで待機する
+    void wait_for_push(DWORD dwMilliseconds = INFINITE) {
+        m_pWaitPushed->wait([this]() { return size() > m_nKeepLength; }, dwMilliseconds);
+    }
+protected:
+    void stat_pop(bool bAvailable, size_t nPop) {
+        if (m_pStats) {
+            m_pStats->pop_result(&m_nPopBlockedSince, bAvailable, nPop);
+        }
+    }
+    //取り出し後のデータ数がnSizeAfterのとき、押し込み側に空きを通知するか (CQueueSPSPと同じ)
+    bool need_notify_poped(size_t nSizeAfter) const {
+        return nSizeAfter < m_nMaxCapacity.load(std::memory_order_relaxed) - m_nPushRestartExtra
+            || nSizeAfter <= m_nKeepLength;
+    }
+    static void copy_data(queueData *dst, const Type *src, size_t n) {
+        if (sizeof(queueData) == sizeof(Type)) {
+            memcpy(dst, src, sizeof(Type) * n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                memcpy(dst + i, src + i, sizeof(Type));
+            }
+        }
+    }
+    static void copy_data(Type *dst, const queueData *src, size_t n) {
+        if (sizeof(queueData) == sizeof(Type)) {
+            memcpy(dst, src, sizeof(Type) * n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                memcpy(dst + i, src + i, sizeof(Type));
+            }
+        }
+    }
+    //取り出し位置からoffset先のデータへのポインタを返し、pnContinuousにそこから連続して参照できるデータ数を格納する
+    //読み終えたリングはここで破棄する
+    // !! 取り出し側のスレッドからのみ呼ぶこと、offset先のデータが存在することを確認してから呼ぶこと !!
+    const queueData *front_ptr(size_t *pnContinuous, size_t offset = 0) {
+        const size_t nOut = m_nOut.load(std::memory_order_relaxed);
+        const size_t nPos = nOut + offset;
+        //nEndは次のリングを設定してから書き込まれるので、nEndが一致すればpNextも有効
+        size_t nEnd = 0;
+        while (nPos >= (nEnd = m_pSegOut->nEnd.load(std::memory_order_acquire))) {
+            ringSegment *pNext = m_pSegOut->pNext.load(std::memory_order_acquire);
+            if (nOut < nEnd) {
+                //先頭のデータはまだこのリングにあるので、破棄せずに先をたどる
+                return segment_ptr(pNext, nPos, pnContinuous);
+            }
+            delete m_pSegOut;
+            m_pSegOut = pNext;
+        }
+        *pnContinuous = (std::min)(nEnd - nPos, m_pSegOut->mask + 1 - (nPos & m_pSegOut->mask));
+        return m_pSegOut->buf.get() + (nPos & m_pSegOut->mask);
+    }
+    //pSeg以降のリングから、nPosのデータを探す
+    static const queueData *segment_ptr(ringSegment *pSeg, size_t nPos, size_t *pnContinuous) {
+        size_t nEnd = 0;
+        while (nPos >= (nEnd = pSeg->nEnd.load(std::memory_order_acquire))) {
+            pSeg = pSeg->pNext.load(std::memory_order_acquire);
+        }
+        *pnContinuous = (std::min)(nEnd - nPos, pSeg->mask + 1 - (nPos & pSeg->mask));
+        return pSeg->buf.get() + (nPos & pSeg->mask);
+    }
+    //nMinSize以上の2のべき乗のサイズのリングを確保する
+    ringSegment *alloc_segment(size_t nMinSize) {
+        if (nMinSize > SIZE_MAX / 2 / sizeof(queueData)) {
+            return nullptr;
+        }
+        size_t bufSize = 2;
+        while (bufSize < nMinSize) {
+            bufSize <<= 1;
+        }
+        std::unique_ptr<ringSegment> seg(new ringSegment());
+        seg->buf = std::unique_ptr<queueData, aligned_malloc_deleter>(
+            (queueData *)_aligned_malloc(sizeof(queueData) * bufSize, (std::max)(16, m_nMallocAlign)), aligned_malloc_deleter());
+        if (!seg->buf) {
+            return nullptr;
+        }
+        seg->mask = bufSize - 1;
+        seg->nEnd = SIZE_MAX;
+        seg->pNext = nullptr;
+        return seg.release();
+    }
+    //確保済みのリングpSegに切り替え、以降の押し込みはそちらに行う (今のリング以下のサイズなら破棄する)
+    // !! 押し込み側のスレッドからのみ呼ぶこと !!
+    void switch_segment(ringSegment *pSeg) {
+        if (pSeg->mask <= m_pSegIn->mask) {
+            delete pSeg;
+            return;
+        }
+        const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+        //取り出し側はnEndを見て次のリングに移るので、pNextを先に設定する
+        m_pSegIn->pNext.store(pSeg, std::memory_order_release);
+        m_pSegIn->nEnd.store(nIn, std::memory_order_release);
+        m_pSegIn = pSeg;
+        m_nSegInStart = nIn;
+        m_nRingSize.store(pSeg->mask + 1, std::memory_order_release);
+    }
+    //pKeep以外のリングをすべて破棄する
+    void free_segments(ringSegment *pKeep) {
+        for (ringSegment *pSeg = m_pSegOut; pSeg != nullptr; ) {
+            ringSegment *pNext = pSeg->pNext.load();
+            if (pSeg != pKeep) {
+                delete pSeg;
+            } else {
+                pSeg->pNext = nullptr;
+            }
+            pSeg = pNext;
+        }
+    }
+
+    int m_nPushRestartExtra; //キューに空きがこのぶんだけ余剰にないと空き通知を行わない (0 = ひとつあけば通知を行う)
+    CQueueWaiter m_waitPoped; //キューからデータを取り出したとき通知する
+    CQueueWaiter m_waitPushed; //キューにデータが追加されたとき通知する
+    CQueueWaiter *m_pWaitPushed; //押し込み時に実際に通知する先 (set_push_waiterで変更しなければm_waitPushed)
+    int m_nMallocAlign; //メモリのアライメント
+    std::atomic<size_t> m_nMaxCapacity; //キューに詰められる有効なデータの最大数
+    size_t m_nKeepLength; //ある一定の長さを常にキュー内に保持するようにする
+    CQueueStats *m_pStats; //統計情報の記録先 (nullptrなら記録しない)
+    uint64_t m_nPopBlockedSince; //取り出し側がキューが空で取り出せなくなった時刻 (us, 0なら取り出し可能)
+    std::atomic<ringSegment*> m_pSegPending; //set_capacityで確保し、押し込み側がまだ切り替えていないリング
+    std::atomic<size_t> m_nRingSize; //押し込み先のリングのサイズ (set_capacityで参照する)
+    //押し込み側と取り出し側で更新する位置は、false sharingを避けるため別のキャッシュラインに置く
+    alignas(QUEUE_CACHE_LINE_SIZE) ringSegment *m_pSegIn; //押し込み先のリング (押し込み側のみが使用)
+    size_t m_nSegInStart; //押し込み先のリングの最初のデータの位置
+    std::atomic<size_t> m_nIn; //これまでに押し込んだデータ数
+    alignas(QUEUE_CACHE_LINE_SIZE) ringSegment *m_pSegOut; //取り出し元のリング (取り出し側のみが使用)
+    std::atomic<size_t> m_nOut; //これまでに取り出したデータ数
+};
+
+//複数のスレッドから押し込み・取り出しが可能な、容量固定のキュー
+//各要素に通し番号 (seq) を持たせ、押し込み位置・取り出し位置をCASで確保する方式 (Dmitry Vyukovのbounded MPMC queue)
+//リングのサイズは初期化時に2のべき乗に切り上げて固定する
+//set_capacityで押し込みを待機させる容量を設定できるが、リングのサイズを超えて大きくすることはできない
+//統計情報のうち、取り出し側の待機時間は取り出し側が1スレッドの場合のみ正しく記録される
+template<typename Type, size_t align_byte = sizeof(Type)>
+class CQueueMPMC {
+    struct queueCell {
+        std::atomic<size_t> seq; //押し込み可能ならindex、取り出し可能ならindex+1
+        Type data;
+    };
+    union queueData {
+        queueCell cell;
+        char pad[((sizeof(queueCell) + (align_byte-1)) & (~(align_byte-1)))];
+    };
+public:
+    CQueueMPMC() :
+        m_pBuf(),
+        m_nMask(0),
+        m_nPushRestartExtra(0),
+        m_waitPoped(),
+        m_waitPushed(),
+        m_pWaitPushed(&m_waitPushed),
+        m_nMallocAlign(32),
+        m_nMaxCapacity(0),
+        m_nKeepLength(0),
+        m_pStats(nullptr),
+        m_nPopBlockedSince(0),
+        m_nIn(0),
+        m_nOut(0) {
+        static_assert(std::is_pod<Type>::value == true, "CQueueMPMC is only for POD type.");
+        for (uint32_t i = 4; i < sizeof(i) * 8; i++) {
+            int test = 1 << i;
+            if (test == align_byte) {
+                m_nMallocAlign = test;
+                break;
+            }
+        }
+    }
+    ~CQueueMPMC() {
+        close();
+    }
+    CQueueMPMC(const CQueueMPMC&) = delete;
+    CQueueMPMC& operator=(const CQueueMPMC&) = delete;
+    //キューを初期化する
+    //リングのサイズはbufSizeとmaxCapacityの大きいほうを2のべき乗に切り上げたものとなる
+    bool init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX, int nPushRestart = 1) {
+        close();
+        size_t ringSize = 2;
+        while (ringSize < (std::max)(bufSize, (maxCapacity != SIZE_MAX) ? maxCapacity : 0)) {
+            ringSize <<= 1;
+        }
+        m_pBuf = std::unique_ptr<queueData, aligned_malloc_deleter>(
+            (queueData *)_aligned_malloc(sizeof(queueData) * ringSize, (std::max)(16, m_nMallocAlign)), aligned_malloc_deleter());
+        if (!m_pBuf) {
+            return false;
+        }
+        for (size_t i = 0; i < ringSize; i++) {
+            new (&m_pBuf.get()[i].cell.seq) std::atomic<size_t>(i);
+        }
+        m_nMask = ringSize - 1;
+        m_nIn = 0;
+        m_nOut = 0;
+        m_nMaxCapacity = (std::min)(maxCapacity, ringSize);
+        m_nKeepLength = 0;
+        m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (int)std::min<size_t>(INT_MAX, m_nMaxCapacity) - 4);
+        return true;
+    }
+    //キューのデータをクリアし、リソースを破棄する
+    // !! 押し込み側・取り出し側のスレッドが停止している状態で使用すること !!
+    void close() {
+        m_pBuf.reset();
+        m_nMask = 0;
+        m_nIn = 0;
+        m_nOut = 0;
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、リソースを破棄する
+    template<typename Func>
+    void close(Func deleter) {
+        if (m_pBuf) {
+            m_nKeepLength = 0;
+            Type data;
+            while (try_pop(&data)) {
+                deleter(&data);
+            }
+        }
+        close();
+    }
+    //キューが一定の長さに達しないとfront_copy/popできないように設定する
+    void set_keep_length(size_t keepLength) {
+        m_nKeepLength = keepLength;
+        m_pWaitPushed->notify();
+    }
+    size_t get_keep_length() {
+        return m_nKeepLength;
+    }
+    //統計情報を記録する構造体を設定する (nullptrなら記録しない)
+    void set_stats(CQueueStats *pStats) {
+        m_pStats = pStats;
+        m_nPopBlockedSince = 0;
+    }
+    //押し込んだときに通知するCQueueWaiterを設定する (nullptrならキュー自身のものを使用する)
+    void set_push_waiter(CQueueWaiter *pWaiter) {
+        m_pWaitPushed = (pWaiter) ? pWaiter : &m_waitPushed;
+    }
+    //キューのsizeを取得する (並列に押し込み・取り出しが行われている場合は概算値)
+    size_t size() const {
+        const size_t nOut = m_nOut.load(std::memory_order_acquire);
+        const size_t nIn = m_nIn.load(std::memory_order_acquire);
+        return (nIn > nOut) ? nIn - nOut : 0;
+    }
+    //キューが空ならtrueを返す
+    bool empty() const {
+        return size() == 0;
+    }
+    //キューの最大サイズを取得する
+    size_t capacity() const {
+        return m_nMaxCapacity.load(std::memory_order_relaxed);
+    }
+    //キューの最大サイズを設定する (リングのサイズまで)
+    void set_capacity(size_t capacity) {
+        capacity = (std::min)(capacity, m_nMask + 1);
+        m_nMaxCapacity.store(capacity, std::memory_order_relaxed);
+        m_nPushRestartExtra = (std::min)(m_nPushRestartExtra.load(std::memory_order_relaxed), (int)std::min<size_t>(INT_MAX, capacity) - 1);
+        m_waitPoped.notify();
+    }
+    //データをキューにコピーし押し込む (どのスレッドからでも可)
+    //キューのデータ量が設定した上限に達した場合は、キューに空きができるまで待機する
+    bool push(const Type& in) {
+        return push_n(&in, 1);
+    }
+    //n個のデータを順にキューに押し込む (どのスレッドからでも可)
+    //他のスレッドの押し込みと混ざることはあるが、このn個の順序は保たれる
+    bool push_n(const Type *in, size_t n) {
+        if (!m_pBuf) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (!try_push_internal(in[i])) {
+                const uint64_t tmBlocked = (m_pStats) ? CQueueStats::now_us() : 0;
+                //待機する前に、ここまで押し込んだデータを取り出し側に通知する
+                m_pWaitPushed->notify();
+                while (!try_push_internal(in[i])) {
+                    m_waitPoped.wait([this]() { return size() < m_nMaxCapacity.load(std::memory_order_relaxed); }, INFINITE);
+                }
+                if (m_pStats) {
+                    m_pStats->push_blocked_mt(CQueueStats::now_us() - tmBlocked);
+                }
+            }
+        }
+        m_pWaitPushed->notify();
+        if (m_pStats) {
+            m_pStats->push_done_mt(n, size());
+        }
+        return true;
+    }
+    //キューに空きがあればデータを押し込み、trueを返す (待機しない)
+    bool try_push(const Type& in) {
+        if (!m_pBuf || !try_push_internal(in)) {
+            return false;
+        }
+        m_pWaitPushed->notify();
+        if (m_pStats) {
+            m_pStats->push_done_mt(1, size());
+        }
+        return true;
+    }
+    //キューの先頭のデータを取り出し(outにコピーする)、キューから取り除く
+    //キューが空ならなにもせずfalseを返す
+    bool try_pop(Type *out) {
+        return pop_n(out, 1) > 0;
+    }
+    //CQueueSPSPと同じ名前の取り出し関数
+    bool front_copy_and_pop_no_lock(Type *out, size_t *pnSize = nullptr) {
+        return pop_n(out, 1, pnSize) > 0;
+    }
+    //キューの先頭から最大maxCount個のデータを取り出し(outにコピーする)、キューから取り除く
+    //取り出したデータ数を返す (キューが空なら0)
+    size_t pop_n(Type *out, size_t maxCount, size_t *pnSize = nullptr) {
+        const size_t nSize = size();
+        size_t nPop = 0;
+        if (m_pBuf && nSize > m_nKeepLength) {
+            const size_t nMaxPop = (std::min)(maxCount, nSize - m_nKeepLength);
+            while (nPop < nMaxPop && try_pop_internal(out + nPop)) {
+                nPop++;
+            }
+            if (nPop && need_notify_poped(nSize - nPop)) {
+                m_waitPoped.notify();
+            }
+        }
+        if (m_pStats) {
+            m_pStats->pop_result(&m_nPopBlockedSince, nPop > 0, nPop);
+        }
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return nPop;
+    }
+    //要素が取り出せるようになるまで待機する
+    void wait_for_push(DWORD dwMilliseconds = INFINITE) {
+        m_pWaitPushed->wait([this]() { return size() > m_nKeepLength; }, dwMilliseconds);
+    }
+protected:
+    //取り出し後のデータ数がnSizeAfterのとき、押し込み側に空きを通知するか (CQueueSPSPと同じ)
+    bool need_notify_poped(size_t nSizeAfter) const {
+        return nSizeAfter < m_nMaxCapacity.load(std::memory_order_relaxed) - m_nPushRestartExtra.load(std::memory_order_relaxed)
+            || nSizeAfter <= m_nKeepLength;
+    }
+    bool try_push_internal(const Type& in) {
+        //設定された容量に達していれば押し込まない
+        if (size() >= m_nMaxCapacity.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        queueCell *cell = nullptr;
+        size_t pos = m_nIn.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_pBuf.get()[pos & m_nMask].cell;
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (m_nIn.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false; //リングが満杯
+            } else {
+                pos = m_nIn.load(std::memory_order_relaxed);
+            }
+        }
+        memcpy(&cell->data, &in, sizeof(Type));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    bool try_pop_internal(Type *out) {
+        queueCell *cell = nullptr;
+        size_t pos = m_nOut.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_pBuf.get()[pos & m_nMask].cell;
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (m_nOut.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false; //キューが空 (または押し込み中)
+            } else {
+                pos = m_nOut.load(std::memory_order_relaxed);
+            }
+        }
+        memcpy(out, &cell->data, sizeof(Type));
+        cell->seq.store(pos + m_nMask + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::unique_ptr<queueData, aligned_malloc_deleter> m_pBuf; //リングバッファ
+    size_t m_nMask; //リングのサイズ - 1
+    std::atomic<int> m_nPushRestartExtra; //キューに空きがこのぶんだけ余剰にないと空き通知を行わない (0 = ひとつあけば通知を行う)
+    CQueueWaiter m_waitPoped; //キューからデータを取り出したとき通知する
+    CQueueWaiter m_waitPushed; //キューにデータが追加されたとき通知する
+    CQueueWaiter *m_pWaitPushed; //押し込み時に実際に通知する先 (set_push_waiterで変更しなければm_waitPushed)
+    int m_nMallocAlign; //メモリのアライメント
+    std::atomic<size_t> m_nMaxCapacity; //キューに詰められる有効なデータの最大数
+    size_t m_nKeepLength; //ある一定の長さを常にキュー内に保持するようにする
+    CQueueStats *m_pStats; //統計情報の記録先 (nullptrなら記録しない)
+    uint64_t m_nPopBlockedSince; //取り出し側がキューが空で取り出せなくなった時刻 (us, 0なら取り出し可能)
+    //押し込み側と取り出し側で更新する位置は、false sharingを避けるため別のキャッシュラインに置く
+    alignas(QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_nIn; //次に押し込む位置
+    alignas(QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_nOut; //次に取り出す位置
+};
+//ムーブのみ可能な型 (unique_ptrで包んだパケットなど) やPODでない型を格納できる、
+//並列で1つの押し込みと1つの取り出しが可能なキュー
+//要素は押し込み時にplacement newで構築し、取り出し・clear・close時に破棄する
+//キューに残った要素はclear/closeで破棄されるので、要素が所有するリソースも確実に開放される
+//
+//リングのサイズは2のべき乗で、容量が無制限(SIZE_MAX)の場合はCQueueSPSPRingと同様に、
+//押し込み側がreserveで次のリングを確保してつなげる (既存の要素は移動しない)
+template<typename Type>
+class CQueueSPSPMove {
+    typedef typename std::aligned_storage<sizeof(Type), alignof(Type)>::type slotData;
+    //リング1つ分のデータ
+    struct ringSegment {
+        std::unique_ptr<slotData, aligned_malloc_deleter> buf;
+        size_t mask;                     //リングのサイズ - 1
+        std::atomic<size_t> nEnd;        //この位置以降のデータは次のリングにある (SIZE_MAXなら押し込み中)
+        std::atomic<ringSegment*> pNext; //次のリング
+    };
+public:
+    CQueueSPSPMove() :
+        m_waitPoped(),
+        m_waitPushed(),
+        m_nMaxCapacity(SIZE_MAX),
+        m_pStats(nullptr),
+        m_nPopBlockedSince(0),
+        m_pSegIn(nullptr),
+        m_nSegInStart(0),
+        m_nIn(0),
+        m_pSegOut(nullptr),
+        m_nOut(0) {
+        static_assert(std::is_move_constructible<Type>::value, "CQueueSPSPMove requires move constructible type.");
+    }
+    ~CQueueSPSPMove() {
+        close();
+    }
+    CQueueSPSPMove(const CQueueSPSPMove&) = delete;
+    CQueueSPSPMove& operator=(const CQueueSPSPMove&) = delete;
+    //統計情報を記録する構造体を設定する (nullptrなら記録しない)
+    void set_stats(CQueueStats *pStats) {
+        m_pStats = pStats;
+        m_nPopBlockedSince = 0;
+    }
+    //キューを初期化する
+    //maxCapacityが無制限(SIZE_MAX)でなければ、リングのサイズはmaxCapacityを2のべき乗に切り上げたもので固定となり、
+    //満杯の場合は押し込み側が空きができるまで待機する
+    //maxCapacityが無制限の場合は、bufSizeをリングの初期サイズとし、足りなくなる場合はreserveでリングを追加する
+    bool init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX) {
+        close();
+        m_pSegIn = alloc_segment((maxCapacity != SIZE_MAX) ? maxCapacity : bufSize);
+        if (m_pSegIn == nullptr) {
+            return false;
+        }
+        m_pSegOut = m_pSegIn;
+        m_nSegInStart = 0;
+        m_nIn = 0;
+        m_nOut = 0;
+        m_nMaxCapacity = maxCapacity;
+        return true;
+    }
+    //キューに残っている要素を破棄する
+    // !! 押し込み側のスレッドが停止している状態で使用すること !!
+    void clear() {
+        while (pop()) {
+        }
+    }
+    //キューに残っている要素を破棄し、リソースを開放する
+    // !! 押し込み側・取り出し側のスレッドが停止している状態で使用すること !!
+    void close() {
+        if (m_pSegOut) {
+            clear();
+        }
+        for (ringSegment *pSeg = m_pSegOut; pSeg != nullptr; ) {
+            ringSegment *pNext = pSeg->pNext.load();
+            delete pSeg;
+            pSeg = pNext;
+        }
+        m_pSegIn = nullptr;
+        m_pSegOut = nullptr;
+        m_nSegInStart = 0;
+        m_nIn = 0;
+        m_nOut = 0;
+    }
+    //要素をキュー内で直接構築して押し込む
+    //容量に達している場合は、空きができるまで待機する
+    //リングの確保は行わないので、容量が無制限(SIZE_MAX)でリングが満杯の場合はfalseを返す (あらかじめreserveしておくこと)
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        if (m_pSegIn == nullptr) {
+            return false;
+        }
+        size_t nSize = 0;
+        if ((nSize = size()) >= m_nMaxCapacity) {
+            const uint64_t tmBlocked = (m_pStats) ? CQueueStats::now_us() : 0;
+            while ((nSize = size()) >= m_nMaxCapacity) {
+                m_waitPoped.wait([this]() { return size() < m_nMaxCapacity; }, INFINITE);
+            }
+            if (m_pStats) {
+                m_pStats->push_blocked(CQueueStats::now_us() - tmBlocked);
+            }
+        }
+        const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+        //現在のリング内に残っているデータ数 (前のリングに残っているデータは含まない)
+        const size_t nSegUsed = nIn - (std::max)(m_nOut.load(std::memory_order_acquire), m_nSegInStart);
+        if (nSegUsed > m_pSegIn->mask) {
+            return false;
+        }
+        new (slot(m_pSegIn, nIn)) Type(std::forward<Args>(args)...);
+        m_nIn.store(nIn + 1, std::memory_order_release);
+        m_waitPushed.notify();
+        if (m_pStats) {
+            m_pStats->push_done(1, nSize + 1);
+        }
+        return true;
+    }
+    //要素をムーブして押し込む
+    bool push(Type&& in) {
+        return emplace(std::move(in));
+    }
+    //キューにnSize個のデータを格納できるよう、必要ならより大きなリングを確保し、以降の押し込みはそちらに行う
+    //リングが足りていれば確保は行わない
+    // !! 押し込み側のスレッドからのみ呼ぶこと !!
+    bool reserve(size_t nSize) {
+        if (m_pSegIn == nullptr) {
+            return false;
+        }
+        const size_t nOut = m_nOut.load(std::memory_order_acquire);
+        const size_t nIn = m_nIn.load(std::memory_order_relaxed);
+        if (nSize <= nIn - nOut) {
+            return true;
+        }
+        //これから押し込むデータは、現在のリングに入る必要がある
+        const size_t nSegUsed = nIn - (std::max)(nOut, m_nSegInStart);
+        if (nSegUsed + (nSize - (nIn - nOut)) <= m_pSegIn->mask + 1) {
+            return true;
+        }
+        ringSegment *pSeg = alloc_segment((std::max)((m_pSegIn->mask + 1) * 2, nSize));
+        if (pSeg == nullptr) {
+            return false;
+        }
+        //取り出し側はnEndを見て次のリングに移るので、pNextを先に設定する
+        m_pSegIn->pNext.store(pSeg, std::memory_order_release);
+        m_pSegIn->nEnd.store(nIn, std::memory_order_release);
+        m_pSegIn = pSeg;
+        m_nSegInStart = nIn;
+        return true;
+    }
+    //先頭の要素へのポインタを返す (キューが空ならnullptr)
+    //返したポインタはpop/front_popするまで有効
+    // !! 取り出し側のスレッドからのみ有効 !!
+    Type *front() {
+        if (empty()) {
+            return nullptr;
+        }
+        return front_slot();
+    }
+    //先頭の要素をoutにムーブし、キューから取り除く
+    //キューが空ならなにもせずfalseを返す
+    bool front_pop(Type *out, size_t *pnSize = nullptr) {
+        return pop_n(out, 1, pnSize) > 0;
+    }
+    //キューの先頭から最大maxCount個の要素をまとめてoutにムーブし、キューから取り除く
+    //取り出し位置は要素ごとに更新し、通知はまとめて行う
+    //取り出した要素数を返す (キューが空なら0)
+    size_t pop_n(Type *out, size_t maxCount, size_t *pnSize = nullptr) {
+        const size_t nSize = size();
+        const size_t nPop = (std::min)(maxCount, nSize);
+        for (size_t i = 0; i < nPop; i++) {
+            Type *ptr = front_slot();
+            out[i] = std::move(*ptr);
+            ptr->~Type();
+            m_nOut.store(m_nOut.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+        if (nPop) {
+            m_waitPoped.notify();
+        }
+        stat_pop(nPop > 0, nPop);
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return nPop;
+    }
+    //先頭の要素を破棄し、キューから取り除く
+    //キューが空ならfalseを返す
+    bool pop() {
+        if (empty()) {
+            return false;
+        }
+        front_slot()->~Type();
+        m_nOut.store(m_nOut.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        m_waitPoped.notify();
+        return true;
+    }
+    //キューのsizeを取得する
+    size_t size() const {
+        //取り出し位置を先に読むことで、押し込み位置より大きくならないようにする
+        const size_t nOut = m_nOut.load(std::memory_order_acquire);
+        return m_nIn.load(std::memory_order_acquire) - nOut;
+    }
+    //キューが空ならtrueを返す
+    bool empty() const {
+        return size() == 0;
+    }
+    //キューの最大サイズを取得する
+    size_t capacity() const {
+        return m_nMaxCapacity;
+    }
+    //要素が追加されるまで待機する
+    void wait_for_push(DWORD dwMilliseconds = INFINITE) {
+        m_waitPushed.wait([this]() { return !empty(); }, dwMilliseconds);
+    }
+protected:
+    void stat_pop(bool bAvailable, size_t nPop) {
+        if (m_pStats) {
+            m_pStats->pop_result(&m_nPopBlockedSince, bAvailable, nPop);
+        }
+    }
+    static Type *slot(ringSegment *pSeg, size_t nPos) {
+        return (Type *)(pSeg->buf.get() + (nPos & pSeg->mask));
+    }
+    //取り出し位置の要素へのポインタを返す (読み終えたリングはここで破棄する)
+    // !! 取り出し側のスレッドからのみ呼ぶこと、要素が存在することを確認してから呼ぶこと !!
+    Type *front_slot() {
+        const size_t nOut = m_nOut.load(std::memory_order_relaxed);
+        //nEndは次のリングを設定してから書き込まれるので、nEndが一致すればpNextも有効
+        while (nOut >= m_pSegOut->nEnd.load(std::memory_order_acquire)) {
+            ringSegment *pNext = m_pSegOut->pNext.load(std::memory_order_acquire);
+            delete m_pSegOut;
+            m_pSegOut = pNext;
+        }
+        return slot(m_pSegOut, nOut);
+    }
+    //nMinSize以上の2のべき乗のサイズのリングを確保する
+    static ringSegment *alloc_segment(size_t nMinSize) {
+        if (nMinSize > SIZE_MAX / 2 / sizeof(slotData)) {
+            return nullptr;
+        }
+        size_t bufSize = 2;
+        while (bufSize < nMinSize) {
+            bufSize <<= 1;
+        }
+        std::unique_ptr<ringSegment> seg(new ringSegment());
+        seg->buf = std::unique_ptr<slotData, aligned_malloc_deleter>(
+            (slotData *)_aligned_malloc(sizeof(slotData) * bufSize, (std::max<size_t>)(16, alignof(slotData))), aligned_malloc_deleter());
+        if (!seg->buf) {
+            return nullptr;
+        }
+        seg->mask = bufSize - 1;
+        seg->nEnd = SIZE_MAX;
+        seg->pNext = nullptr;
+        return seg.release();
+    }
+
+    CQueueWaiter m_waitPoped; //キューからデータを取り出したとき通知する
+    CQueueWaiter m_waitPushed; //キューにデータが追加されたとき通知する
+    size_t m_nMaxCapacity; //キューに詰められる有効なデータの最大数
+    CQueueStats *m_pStats; //統計情報の記録先 (nullptrなら記録しない)
+    uint64_t m_nPopBlockedSince; //取り出し側がキューが空で取り出せなくなった時刻 (us, 0なら取り出し可能)
+    //押し込み側と取り出し側で更新する位置は、false sharingを避けるため別のキャッシュラインに置く
+    alignas(QUEUE_CACHE_LINE_SIZE) ringSegment *m_pSegIn; //押し込み先のリング (押し込み側のみが使用)
+    size_t m_nSegInStart; //押し込み先のリングの最初のデータの位置
+    std::atomic<size_t> m_nIn; //これまでに押し込んだデータ数
+    alignas(QUEUE_CACHE_LINE_SIZE) ringSegment *m_pSegOut; //取り出し元のリング (取り出し側のみが使用)
+    std::atomic<size_t> m_nOut; //これまでに取り出したデータ数
+};
+
+
+//CArraySPSP/CQueueSPSP/CQueueSPSPRing/CQueueMPMC/CQueueSPSPMoveについて、各操作を単一スレッドで確認し、
+//複数スレッドでの押し込み・取り出しでデータの欠落・重複・順序の入れ替わりがないかを確認する
+//結果をstrに格納し、問題のあった確認の数を返す
+int qsv_queue_check(tstring& str, int iterations);
+
 #endif //_QSV_QUEUE_H_
@@ -0,0 +1,509 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <thread>
+#include <vector>
+#include <random>
+#include <memory>
+#include "qsv_queue.h"
+
+static const uint32_t QUEUE_CHECK_SEED = 0x56434532;
+
+//確認用のデータ
+struct QueueCheckData {
+    uint32_t producer; //押し込んだスレッドの番号
+    uint32_t index;    //スレッドごとの通し番号
+};
+
+static void queue_check_fill(QueueCheckData *buf, size_t n, uint32_t producer, uint32_t index) {
+    for (size_t i = 0; i < n; i++) {
+        buf[i].producer = producer;
+        buf[i].index = index + (uint32_t)i;
+    }
+}
+
+//CQueueSPSP/CQueueSPSPRingの各操作を単一スレッドで確認する
+template<typename Queue>
+static tstring queue_check_spsp_basic() {
+    Queue q;
+    q.init(4, 16);
+    QueueCheckData buf[32];
+    queue_check_fill(buf, 10, 0, 0);
+    if (!q.push_n(buf, 10) || q.size() != 10 || q.capacity() != 16) {
+        return _T("push_n failed.");
+    }
+    QueueCheckData data = { 0, 0 };
+    if (!q.front_copy_no_lock(&data) || data.index != 0 || q.size() != 10) {
+        return _T("front_copy_no_lock failed.");
+    }
+    //keep_lengthの分は取り出せない
+    q.set_keep_length(8);
+    if (q.pop_n(buf, 32) != 2 || buf[0].index != 0 || buf[1].index != 1 || q.pop_n(buf, 32) != 0) {
+        return _T("pop_n with keep_length failed.");
+    }
+    q.set_keep_length(0);
+    size_t nCount = 0;
+    auto ptr = q.peek(&nCount);
+    if (nCount == 0 || ptr == nullptr || ptr->data.index != 2) {
+        q.commit(0);
+        return _T("peek failed.");
+    }
+    q.commit(1);
+    if (!q.pop() || !q.front_copy_and_pop_no_lock(&data) || data.index != 4) {
+        return _T("pop failed.");
+    }
+    if (q.pop_n(buf, 32) != 5 || buf[0].index != 5 || buf[4].index != 9 || !q.empty()) {
+        return _T("pop_n failed.");
+    }
+    //リングの終端をまたいで押し込み・取り出しを繰り返す
+    for (uint32_t i = 0; i < 64; i++) {
+        queue_check_fill(buf, 3, 0, i * 3);
+        q.push_n(buf, 3);
+        if (q.pop_n(buf, 3) != 3 || buf[0].index != i * 3 || buf[2].index != i * 3 + 2) {
+            return _T("wrap around failed.");
+        }
+    }
+    queue_check_fill(buf, 5, 0, 0);
+    q.push_n(buf, 5);
+    int nDeleted = 0;
+    q.close([&nDeleted](QueueCheckData *) { nDeleted++; });
+    if (nDeleted != 5) {
+        return _T("close with deleter failed.");
+    }
+    return _T("");
+}
+
+//押し込み側のスレッドから連番のデータを押し込み、取り出し側で欠落・重複・順序の入れ替わりがないか確認する
+//キューの容量を小さくして、満杯・空の両方の待機と通知を発生させる
+//bResizeなら、途中で取り出し側から容量を大きくする
+//bReserveなら、容量を無制限とし、押し込み側がreserveでリングを拡張しながら押し込む
+template<typename Queue>
+static tstring queue_check_spsp_thread(int iterations, bool bResize, bool bReserve = false) {
+    const uint32_t total = (uint32_t)iterations * 5000;
+    Queue q;
+    if (bReserve) {
+        q.init(16);
+    } else {
+        q.init(16, 64, 8);
+    }
+    std::atomic<bool> bProducerFin(false);
+    std::thread producer([&]() {
+        std::mt19937 mt(QUEUE_CHECK_SEED);
+        QueueCheckData buf[32];
+        for (uint32_t i = 0; i < total; ) {
+            const uint32_t n = (std::min)(total - i, 1 + (uint32_t)(mt() % 32));
+            queue_check_fill(buf, n, 0, i);
+            if (bReserve) {
+                q.reserve(q.size() + n);
+            }
+            q.push_n(buf, n);
+            i += n;
+        }
+        bProducerFin = true;
+    });
+    tstring error;
+    std::mt19937 mt(QUEUE_CHECK_SEED + 1);
+    QueueCheckData buf[48];
+    for (uint32_t i = 0; i < total; ) {
+        if (bResize && i >= total / 2 && q.capacity() < 1024) {
+            q.set_capacity(1024);
+        }
+        const size_t n = q.pop_n(buf, 1 + mt() % 48);
+        if (n == 0) {
+            if (bProducerFin && q.empty()) {
+                error = strsprintf(_T("data lost (%u / %u)."), i, total);
+                break;
+            }
+            q.wait_for_push(100);
+            continue;
+        }
+        for (size_t j = 0; j < n && error.length() == 0; j++) {
+            if (buf[j].index != i + j) {
+                error = strsprintf(_T("order mismatch at %u (got %u)."), i + (uint32_t)j, buf[j].index);
+            }
+        }
+        i += (uint32_t)n;
+    }
+    producer.join();
+    if (error.length() == 0 && !q.empty()) {
+        error = _T("extra data in queue.");
+    }
+    q.close();
+    return error;
+}
+
+//容量が無制限のキューで、push_nはリングの確保を行わず、reserveで拡張したリングに押し込めるか確認する
+//bSetCapacityGrowsなら (CQueueSPSPRing)、set_capacityで確保したリングにも押し込めるか確認する
+//そうでなければ (CQueueSPSP)、set_capacityがリングのサイズまでに制限されるか確認する
+template<typename Queue>
+static tstring queue_check_reserve(bool bSetCapacityGrows) {
+    Queue q;
+    q.init(4);
+    QueueCheckData buf[64];
+    queue_check_fill(buf, 64, 0, 0);
+    if (!q.push_n(buf, 4) || q.push_n(buf + 4, 1) || q.size() != 4) {
+        return _T("push_n allocated a new ring.");
+    }
+    //取り出し途中のリングを残したまま拡張する
+    if (q.pop_n(buf, 2) != 2 || buf[1].index != 1) {
+        return _T("pop_n failed.");
+    }
+    if (!q.reserve(20) || !q.push_n(buf + 4, 18) || q.size() != 20) {
+        return _T("reserve failed.");
+    }
+    if (bSetCapacityGrows) {
+        //set_capacityで確保したリングには、reserveしなくても押し込める
+        q.set_capacity(64);
+        if (!q.push_n(buf + 22, 30) || q.size() != 50) {
+            return _T("set_capacity did not grow the ring.");
+        }
+    } else {
+        q.set_capacity(1024);
+        if (q.capacity() >= 1024) {
+            return _T("set_capacity is not clamped to the ring size.");
+        }
+        q.set_capacity(SIZE_MAX);
+        if (!q.reserve(50) || !q.push_n(buf + 22, 30) || q.size() != 50) {
+            return _T("reserve failed.");
+        }
+    }
+    if (q.pop_n(buf, 64) != 50) {
+        return _T("pop_n failed.");
+    }
+    for (uint32_t i = 0; i < 50; i++) {
+        if (buf[i].index != i + 2) {
+            return strsprintf(_T("order mismatch at %u (got %u)."), i + 2, buf[i].index);
+        }
+    }
+    return _T("");
+}
+
+//CArraySPSPの押し込みで領域を拡張しても、データが連続した配列として参照できるか確認する
+template<typename Array>
+static tstring queue_check_array_basic() {
+    Array a;
+    a.init(2);
+    QueueCheckData buf[16];
+    queue_check_fill(buf, 16, 0, 0);
+    for (int i = 0; i < 16; i++) {
+        if (!a.push(buf[i])) {
+            return _T("push failed.");
+        }
+    }
+    if (a.size() != 16 || !a.pop() || a.size() != 15) {
+        return _T("pop failed.");
+    }
+    const auto ptr = a.get();
+    for (uint32_t i = 0; i < 15; i++) {
+        if (ptr[i].data.index != i + 1 || a[i].data.index != i + 1) {
+            return strsprintf(_T("data mismatch at %u."), i);
+        }
+    }
+    QueueCheckData data = { 0, 0 };
+    if (!a.copy(&data, 14) || data.index != 15 || a.copy(&data, 15)) {
+        return _T("copy failed.");
+    }
+    a.close();
+    return _T("");
+}
+
+//CQueueMPMCの各操作を単一スレッドで確認する
+template<typename Queue>
+static tstring queue_check_mpmc_basic() {
+    Queue q;
+    q.init(8, 8);
+    //容量はリングのサイズを超えない
+    q.set_capacity(100);
+    if (q.capacity() != 8) {
+        return _T("set_capacity is not clamped to the ring size.");
+    }
+    QueueCheckData buf[16];
+    queue_check_fill(buf, 9, 0, 0);
+    for (int i = 0; i < 8; i++) {
+        if (!q.try_push(buf[i])) {
+            return _T("try_push failed.");
+        }
+    }
+    if (q.try_push(buf[8]) || q.size() != 8) {
+        return _T("try_push succeeded on a full queue.");
+    }
+    q.set_keep_length(6);
+    if (q.pop_n(buf, 16) != 2 || buf[0].index != 0 || buf[1].index != 1 || q.pop_n(buf, 16) != 0) {
+        return _T("pop_n with keep_length failed.");
+    }
+    q.set_keep_length(0);
+    QueueCheckData data = { 0, 0 };
+    if (!q.front_copy_and_pop_no_lock(&data) || data.index != 2 || q.pop_n(buf, 16) != 5 || buf[4].index != 7 || !q.empty()) {
+        return _T("pop_n failed.");
+    }
+    queue_check_fill(buf, 5, 0, 0);
+    q.push_n(buf, 5);
+    int nDeleted = 0;
+    q.close([&nDeleted](QueueCheckData *) { nDeleted++; });
+    if (nDeleted != 5) {
+        return _T("close with deleter failed.");
+    }
+    return _T("");
+}
+
+//複数の押し込み側・取り出し側のスレッドで、データの欠落・重複がなく、
+//押し込み側のスレッドごとの順序が取り出し側のスレッドごとに保たれているかを確認する
+template<typename Queue>
+static tstring queue_check_mpmc_thread(int iterations) {
+    const int nProducers = 4;
+    const int nConsumers = 2;
+    const uint32_t count = (uint32_t)iterations * 2000; //押し込み側のスレッドごとのデータ数
+    Queue q;
+    q.init(64, 64, 8);
+    std::atomic<int> nProducerFin(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < nProducers; p++) {
+        threads.push_back(std::thread([&, p]() {
+            std::mt19937 mt(QUEUE_CHECK_SEED + p);
+            QueueCheckData buf[16];
+            for (uint32_t i = 0; i < count; ) {
+                const uint32_t n = (std::min)(count - i, 1 + (uint32_t)(mt() % 16));
+                queue_check_fill(buf, n, p, i);
+                q.push_n(buf, n);
+                i += n;
+            }
+            nProducerFin++;
+        }));
+    }
+    //取り出し側のスレッドごとに、取り出したデータを押し込み側のスレッド別に記録する
+    std::vector<std::vector<std::vector<uint32_t>>> received(nConsumers, std::vector<std::vector<uint32_t>>(nProducers));
+    for (int c = 0; c < nConsumers; c++) {
+        threads.push_back(std::thread([&, c]() {
+            std::mt19937 mt(QUEUE_CHECK_SEED + 16 + c);
+            QueueCheckData buf[16];
+            for (;;) {
+                const size_t n = q.pop_n(buf, 1 + mt() % 16);
+                if (n == 0) {
+                    //押し込み側がすべて終了した後にキューが空なら、すべて取り出し済み
+                    if (nProducerFin == nProducers && q.empty()) {
+                        break;
+                    }
+                    q.wait_for_push(16);
+                    continue;
+                }
+                for (size_t j = 0; j < n; j++) {
+                    if (buf[j].producer < (uint32_t)nProducers) {
+                        received[c][buf[j].producer].push_back(buf[j].index);
+                    }
+                }
+            }
+        }));
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (int p = 0; p < nProducers; p++) {
+        std::vector<uint8_t> hit(count, 0);
+        for (int c = 0; c < nConsumers; c++) {
+            const auto& list = received[c][p];
+            for (size_t j = 0; j < list.size(); j++) {
+                if (list[j] >= count || (j > 0 && list[j] <= list[j-1])) {
+                    return strsprintf(_T("order mismatch (producer %d, consumer %d)."), p, c);
+                }
+                hit[list[j]]++;
+            }
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (hit[i] != 1) {
+                return strsprintf(_T("data %s (producer %d, index %u)."), (hit[i]) ? _T("duplicated") : _T("lost"), p, i);
+            }
+        }
+    }
+    return _T("");
+}
+
+//CQueueSPSPMoveの確認用の、開放された数を数えるunique_ptr
+struct QueueCheckDeleter {
+    int *pCount;
+    void operator()(QueueCheckData *ptr) const {
+        (*pCount)++;
+        delete ptr;
+    }
+};
+typedef std::unique_ptr<QueueCheckData, QueueCheckDeleter> QueueCheckPtr;
+
+static QueueCheckPtr queue_check_make_ptr(uint32_t index, int *pCount) {
+    QueueCheckPtr ptr(new QueueCheckData(), QueueCheckDeleter{ pCount });
+    ptr->producer = 0;
+    ptr->index = index;
+    return ptr;
+}
+
+//CQueueSPSPMoveの各操作を単一スレッドで確認する
+//要素の所有権がキューに移り、取り出し・pop・closeのいずれでもちょうど1回ずつ開放されるか確認する
+static tstring queue_check_move_basic() {
+    int nFreed = 0;
+    {
+        CQueueSPSPMove<QueueCheckPtr> q;
+        q.init(4);
+        for (uint32_t i = 0; i < 4; i++) {
+            if (!q.push(queue_check_make_ptr(i, &nFreed))) {
+                return _T("push failed.");
+            }
+        }
+        //容量が無制限でリングが満杯なら、リングの確保は行わず要素も受け取らない
+        auto ptr = queue_check_make_ptr(4, &nFreed);
+        if (q.push(std::move(ptr)) || !ptr || q.size() != 4) {
+            return _T("push allocated a new ring.");
+        }
+        QueueCheckPtr out[32];
+        if (q.pop_n(out, 2) != 2 || out[0]->index != 0 || out[1]->index != 1 || nFreed != 0) {
+            return _T("pop_n failed.");
+        }
+        //取り出し途中のリングを残したまま拡張する
+        if (!q.reserve(20) || !q.push(std::move(ptr)) || ptr) {
+            return _T("reserve failed.");
+        }
+        for (uint32_t i = 5; i < 21; i++) {
+            q.emplace(queue_check_make_ptr(i, &nFreed));
+        }
+        if (q.size() != 19 || q.front() == nullptr || (*q.front())->index != 2) {
+            return _T("front failed.");
+        }
+        if (!q.pop() || nFreed != 1) {
+            return _T("pop did not free the element.");
+        }
+        if (!q.front_pop(&out[2]) || out[2]->index != 3 || q.pop_n(out + 3, 8) != 8) {
+            return _T("front_pop failed.");
+        }
+        for (uint32_t i = 3; i < 11; i++) {
+            if (out[i]->index != i + 1) {
+                return strsprintf(_T("order mismatch at %u (got %u)."), i + 1, out[i]->index);
+            }
+        }
+        //残りの9個はcloseで開放される
+        q.close();
+        if (nFreed != 10 || !q.empty()) {
+            return strsprintf(_T("close freed %d elements (expected 10)."), nFreed);
+        }
+    }
+    //取り出した11個はoutの破棄で開放される
+    if (nFreed != 21) {
+        return strsprintf(_T("%d elements freed (expected 21)."), nFreed);
+    }
+    return _T("");
+}
+
+//CQueueSPSPMoveに押し込み・取り出しを別スレッドで行い、要素の欠落・重複・順序の入れ替わりがないか確認する
+//bReserveなら容量を無制限とし押し込み側がreserveで拡張しながら、そうでなければ小さな容量で待機を発生させながら押し込む
+static tstring queue_check_move_thread(int iterations, bool bReserve) {
+    const uint32_t total = (uint32_t)iterations * 5000;
+    std::atomic<int> nFreed(0);
+    tstring error;
+    {
+        CQueueSPSPMove<std::unique_ptr<QueueCheckData>> q;
+        if (bReserve) {
+            q.init(16);
+        } else {
+            q.init(16, 64);
+        }
+        std::atomic<bool> bProducerFin(false);
+        std::thread producer([&]() {
+            for (uint32_t i = 0; i < total; i++) {
+                std::unique_ptr<QueueCheckData> ptr(new QueueCheckData());
+                ptr->producer = 0;
+                ptr->index = i;
+                if (bReserve) {
+                    q.reserve(q.size() + 1);
+                }
+                q.push(std::move(ptr));
+            }
+            bProducerFin = true;
+        });
+        std::mt19937 mt(QUEUE_CHECK_SEED + 2);
+        std::unique_ptr<QueueCheckData> buf[48];
+        for (uint32_t i = 0; i < total; ) {
+            const size_t n = q.pop_n(buf, 1 + mt() % 48);
+            if (n == 0) {
+                if (bProducerFin && q.empty()) {
+                    error = strsprintf(_T("data lost (%u / %u)."), i, total);
+                    break;
+                }
+                q.wait_for_push(100);
+                continue;
+            }
+            for (size_t j = 0; j < n; j++) {
+                if (error.length() == 0 && (!buf[j] || buf[j]->index != i + j)) {
+                    error = strsprintf(_T("order mismatch at %u."), i + (uint32_t)j);
+                }
+                buf[j].reset();
+                nFreed++;
+            }
+            i += (uint32_t)n;
+        }
+        producer.join();
+        if (error.length() == 0 && !q.empty()) {
+            error = _T("extra data in queue.");
+        }
+    }
+    if (error.length() == 0 && nFreed != (int)total) {
+        error = strsprintf(_T("%d elements freed (expected %u)."), (int)nFreed, total);
+    }
+    return error;
+}
+
+int qsv_queue_check(tstring& str, int iterations) {
+    iterations = (std::max)(iterations, 1);
+    struct QueueCheckResult {
+        const TCHAR *queue;
+        const TCHAR *test;
+        tstring error;
+    };
+    std::vector<QueueCheckResult> results = {
+        { _T("CQueueSPSP"),             _T("basic"),          queue_check_spsp_basic<CQueueSPSP<QueueCheckData>>() },
+        { _T("CQueueSPSP<64>"),         _T("basic"),          queue_check_spsp_basic<CQueueSPSP<QueueCheckData, 64>>() },
+        { _T("CQueueSPSP"),             _T("thread"),         queue_check_spsp_thread<CQueueSPSP<QueueCheckData>>(iterations, false) },
+        { _T("CQueueSPSP"),             _T("reserve"),        queue_check_reserve<CQueueSPSP<QueueCheckData>>(false) },
+        { _T("CQueueSPSP"),             _T("thread+reserve"), queue_check_spsp_thread<CQueueSPSP<QueueCheckData>>(iterations, false, true) },
+        { _T("CQueueSPSPRing"),         _T("basic"),          queue_check_spsp_basic<CQueueSPSPRing<QueueCheckData>>() },
+        { _T("CQueueSPSPRing<64>"),     _T("basic"),          queue_check_spsp_basic<CQueueSPSPRing<QueueCheckData, 64>>() },
+        { _T("CQueueSPSPRing"),         _T("reserve"),        queue_check_reserve<CQueueSPSPRing<QueueCheckData>>(true) },
+        { _T("CQueueSPSPRing"),         _T("thread"),         queue_check_spsp_thread<CQueueSPSPRing<QueueCheckData>>(iterations, false) },
+        { _T("CQueueSPSPRing"),         _T("thread+resize"),  queue_check_spsp_thread<CQueueSPSPRing<QueueCheckData>>(iterations, true) },
+        { _T("CArraySPSP"),             _T("basic"),          queue_check_array_basic<CArraySPSP<QueueCheckData>>() },
+        { _T("CQueueMPMC"),             _T("basic"),          queue_check_mpmc_basic<CQueueMPMC<QueueCheckData>>() },
+        { _T("CQueueMPMC<64>"),         _T("basic"),          queue_check_mpmc_basic<CQueueMPMC<QueueCheckData, 64>>() },
+        { _T("CQueueMPMC"),             _T("thread"),         queue_check_mpmc_thread<CQueueMPMC<QueueCheckData>>(iterations) },
+        { _T("CQueueMPMC<64>"),         _T("thread"),         queue_check_mpmc_thread<CQueueMPMC<QueueCheckData, 64>>(iterations) },
+        { _T("CQueueSPSPMove"),         _T("basic"),          queue_check_move_basic() },
+        { _T("CQueueSPSPMove"),         _T("thread"),         queue_check_move_thread(iterations, false) },
+        { _T("CQueueSPSPMove"),         _T("thread+reserve"), queue_check_move_thread(iterations, true) },
+    };
+    str = strsprintf(_T("%-20s %-14s %s\n"), _T("queue"), _T("test"), _T("result"));
+    int failed = 0;
+    for (const auto& r : results) {
+        str += strsprintf(_T("%-20s %-14s %s\n"), r.queue, r.test, (r.error.length()) ? r.error.c_str() : _T("ok"));
+        failed += (r.error.length()) ? 1 : 0;
+    }
+    str += strsprintf(_T("%d tests checked, %d failed.\n"), (int)results.size(), failed);
+    return failed;
+}
@@ -36,7 +36,7 @@
 #include "output.h"
 #include "auo.h"
 #include "auo_version.h"
-#include "convert.h"
+#include "convert_audio.h"
 #include "auo_frm.h"
 #include "auo_pipe.h"
 #include "auo_error.h"
@@ -56,6 +56,37 @@ const int WAVE_HEADER_SIZE = 44;
 const int RIFF_SIZE_POS    = 4;
 const int WAVE_SIZE_POS    = WAVE_HEADER_SIZE - 4;
 
+const short WAVE_FORMAT_ID_PCM   = 1;
+const short WAVE_FORMAT_ID_FLOAT = 3;
+
+//出力するwavの形式
+typedef struct {
+    int wav_8bit;    //8bit出力 (2なら上位8bit/下位8bitの2つのwavに分離)
+    int wav_format;  //AUDIO_WAV_FORMAT_xxx
+    short fmt_id;    //wavヘッダのフォーマットID
+    int sample_size; //1チャンネル1サンプルあたりのbyte数
+    int audio_ch;    //1つのwavあたりのチャンネル数
+    int wav_count;   //出力するwavの数
+} wav_format_t;
+
+static wav_format_t get_wav_format(const AUDIO_ENC_MODE *aud_mode, const OUTPUT_INFO *oip) {
+    wav_format_t fmt = { 0 };
+    fmt.wav_8bit = aud_mode->use_8bit;
+    fmt.wav_format = (aud_mode->use_8bit) ? AUDIO_WAV_FORMAT_16BIT : aud_mode->wav_format;
+    //L/Rの分離は2chの場合のみ
+    if (fmt.wav_format == AUDIO_WAV_FORMAT_SPLIT_CH && oip->audio_ch != 2)
+        fmt.wav_format = AUDIO_WAV_FORMAT_16BIT;
+    fmt.fmt_id = (fmt.wav_format == AUDIO_WAV_FORMAT_FLOAT) ? WAVE_FORMAT_ID_FLOAT : WAVE_FORMAT_ID_PCM;
+    switch (fmt.wav_format) {
+        case AUDIO_WAV_FORMAT_24BIT: fmt.sample_size = 3; break;
+        case AUDIO_WAV_FORMAT_FLOAT: fmt.sample_size = sizeof(float); break;
+        default:                     fmt.sample_size = (fmt.wav_8bit) ? sizeof(BYTE) : sizeof(short); break;
+    }
+    fmt.audio_ch  = (fmt.wav_format == AUDIO_WAV_FORMAT_SPLIT_CH) ? 1 : oip->audio_ch;
+    fmt.wav_count = (fmt.wav_8bit == 2 || fmt.wav_format == AUDIO_WAV_FORMAT_SPLIT_CH) ? 2 : 1;
+    return fmt;
+}
+
 inline void *get_audio_data(const OUTPUT_INFO *oip, PRM_ENC *pe, int start, int length, int *readed) {
     if (pe->aud_parallel.th_aud) {
         pe->aud_parallel.start = start;
@@ -109,28 +140,29 @@ static AUO_RESULT check_audio_length(const OUTPUT_INFO *oip) {
     return (check_range(audio_length / video_length, 0.5, 1.5)) ? AUO_RESULT_SUCCESS : AUO_RESULT_ERROR;
 }
 
-static void build_wave_header(BYTE *head, const OUTPUT_INFO *oip, BOOL use_8bit, int sample_n) {
+static void build_wave_header(BYTE *head, const OUTPUT_INFO *oip, const wav_format_t *fmt, int sample_n) {
     static const char * const RIFF_HEADER = "RIFF";
     static const char * const WAVE_HEADER = "WAVE";
     static const char * const FMT_CHUNK   = "fmt ";
     static const char * const DATA_CHUNK  = "data";
     const DWORD FMT_SIZE    = 16;
-    const short FMT_ID      = 1;
-    const int   size        = (use_8bit) ? sizeof(BYTE) : sizeof(short);
+    const short FMT_ID      = fmt->fmt_id;
+    const int   size        = fmt->sample_size;
+    const int   audio_ch    = fmt->audio_ch;
 
     memcpy(   head +  0, RIFF_HEADER, strlen(RIFF_HEADER));
-    *(DWORD*)(head +  4) = sample_n * (size * oip->audio_ch) + WAVE_HEADER_SIZE - 8;
+    *(DWORD*)(head +  4) = sample_n * (size * audio_ch) + WAVE_HEADER_SIZE - 8;
     memcpy(   head +  8, WAVE_HEADER, strlen(WAVE_HEADER));
     memcpy(   head + 12, FMT_CHUNK, strlen(FMT_CHUNK));
     *(DWORD*)(head + 16) = FMT_SIZE;
     *(short*)(head + 20) = FMT_ID;
-    *(short*)(head + 22) = (short)oip->audio_ch;
+    *(short*)(head + 22) = (short)audio_ch;
     *(DWORD*)(head + 24) = oip->audio_rate;
-    *(DWORD*)(head + 28) = oip->audio_rate * oip->audio_ch * size;
-    *(short*)(head + 32) = (short)(size * oip->audio_ch);
+    *(DWORD*)(head + 28) = oip->audio_rate * audio_ch * size;
+    *(short*)(head + 32) = (short)(size * audio_ch);
     *(short*)(head + 34) = (short)(size * 8);
     memcpy(   head + 36, DATA_CHUNK, strlen(DATA_CHUNK));
-    *(DWORD*)(head + 40) = sample_n * (size * oip->audio_ch);
+    *(DWORD*)(head + 40) = sample_n * (size * audio_ch);
     //計44byte(WAVE_HEADER_SIZE)
 }
 
@@ -143,9 +175,9 @@ static void correct_header(FILE *f_out, int data_size) {
     fwrite(&data_size, sizeof(int), 1, f_out);
 }
 
-static void write_wav_header(FILE *f_out, const OUTPUT_INFO *oip, BOOL use_8bit) {
+static void write_wav_header(FILE *f_out, const OUTPUT_INFO *oip, const wav_format_t *fmt) {
     BYTE head[WAVE_HEADER_SIZE];
-    build_wave_header(head, oip, use_8bit, oip->audio_n);
+    build_wave_header(head, oip, fmt, oip->audio_n);
     _fwrite_nolock(&head, sizeof(head), 1, f_out);
 }
 
@@ -264,19 +296,19 @@ static void recalculate_audio_delay_cut_for_afs(const CONF_GUIEX *conf, const OU
     }
 }
 
-static AUO_RESULT silent_wav_output(FILE *fp, int samples, int wav_8bit, int audio_ch) {
+static AUO_RESULT silent_wav_output(FILE *fp, int samples, const wav_format_t *fmt) {
     if (NULL == fp)
         return AUO_RESULT_ERROR;
 
     if (0 >= samples)
         return AUO_RESULT_SUCCESS;
 
-    int silent_bytes = samples * (2 - !!wav_8bit) * audio_ch;
+    int silent_bytes = samples * fmt->sample_size * fmt->audio_ch;
     BYTE *buffer = (BYTE *)calloc(silent_bytes, 1);
     if (NULL == buffer)
         return AUO_RESULT_ERROR;
 
-    if (wav_8bit)
+    if (fmt->wav_8bit)
         for (int i = 0; i < silent_bytes; i++)
             buffer[i] = 128;
 
@@ -285,7 +317,7 @@ static AUO_RESULT silent_wav_output(FILE *fp, int samples, int wav_8bit, int aud
     return AUO_RESULT_SUCCESS;
 }
 
-static AUO_RESULT wav_file_open(aud_data_t *aud_dat, const OUTPUT_INFO *oip, BOOL use_pipe, BOOL wav_8bit, int bufsize,
+static AUO_RESULT wav_file_open(aud_data_t *aud_dat, const OUTPUT_INFO *oip, BOOL use_pipe, const wav_format_t *fmt, int bufsize,
                                 const char *auddispname, const char *auddir, DWORD encoder_priority, DWORD disable_log) {
     AUO_RESULT ret = AUO_RESULT_SUCCESS;
     if (use_pipe) {
@@ -310,7 +342,7 @@ static AUO_RESULT wav_file_open(aud_data_t *aud_dat, const OUTPUT_INFO *oip, BOO
     }
     //wavヘッダ出力
     if (!ret)
-        write_wav_header(aud_dat->fp_out, oip, wav_8bit);
+        write_wav_header(aud_dat->fp_out, oip, fmt);
     return ret;
 }
 
@@ -330,12 +362,14 @@ static AUO_RESULT wav_file_close(aud_data_t *aud_dat, const OUTPUT_INFO *oip, in
     return ret;
 }
 
-static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_ENC *pe, int wav_8bit, int bufsize,
+static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_ENC *pe, const wav_format_t *fmt, int bufsize,
                         const char *auddispname, const char *auddir, DWORD encoder_priority, DWORD disable_log) 
 {
     AUO_RESULT ret = AUO_RESULT_SUCCESS;
-    BYTE *buf8bit = NULL;
-    const func_audio_16to8 audio_16to8 = get_audio_16to8_func(wav_8bit == 2);
+    BYTE *buf_conv = NULL;
+    const AUDIO_CONVERT_FUNC *audio_func = get_audio_convert_func();
+    const func_audio_16to8 audio_16to8 = (fmt->wav_8bit == 2) ? audio_func->split_audio_16to8x2 : audio_func->audio_16to8;
+    const BOOL need_convert = fmt->wav_8bit || fmt->wav_format != AUDIO_WAV_FORMAT_16BIT;
     const BOOL use_pipe = (strcmp(aud_dat->wavfile, PIPE_FN) == NULL);
     
     //並列時は8フレーム分
@@ -345,8 +379,8 @@ static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_EN
         if (!use_pipe && str_has_char(auddir))
             bufsize *= 2;
     }
-    //8bitを使用する場合のメモリ確保
-    if (wav_8bit && NULL == (buf8bit = (BYTE *)_aligned_malloc(bufsize * oip->audio_ch * sizeof(BYTE) * wav_8bit, 32))) {
+    //変換を行う場合のメモリ確保
+    if (need_convert && NULL == (buf_conv = (BYTE *)_aligned_malloc(bufsize * oip->audio_ch * fmt->sample_size * ((fmt->wav_8bit == 2) ? 2 : 1), 32))) {
         ret |= AUO_RESULT_ERROR; error_malloc_8bit();
         return ret;
     }
@@ -356,7 +390,7 @@ static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_EN
     if_valid_wait_for_single_object(pe->aud_parallel.he_aud_start, INFINITE);
     //パイプ or ファイルオープン
     for (int i_aud = 0; !ret && i_aud < pe->aud_count; i_aud++)
-        ret |= wav_file_open(&aud_dat[i_aud], oip, use_pipe, wav_8bit, bufsize, auddispname, auddir, encoder_priority, disable_log);
+        ret |= wav_file_open(&aud_dat[i_aud], oip, use_pipe, fmt, bufsize, auddispname, auddir, encoder_priority, disable_log);
 
     if (!ret) {
         //メッセージ
@@ -364,9 +398,9 @@ static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_EN
 
         //wav出力
         for (int i_aud = 0; i_aud < pe->aud_count; i_aud++)
-            silent_wav_output(aud_dat[i_aud].fp_out, pe->delay_cut_additional_aframe, wav_8bit, oip->audio_ch);
+            silent_wav_output(aud_dat[i_aud].fp_out, pe->delay_cut_additional_aframe, fmt);
 
-        const int wav_sample_size = oip->audio_ch * ((wav_8bit) ? sizeof(BYTE) : sizeof(short));
+        const int wav_sample_size = fmt->audio_ch * fmt->sample_size;
         void *audio_dat = NULL;
         int samples_read = (pe->delay_cut_additional_aframe < 0) ? -1 * pe->delay_cut_additional_aframe : 0;
         int samples_get = bufsize;
@@ -383,12 +417,30 @@ static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_EN
 
             while (0 < ReadLogExe(&aud_dat->pipes, nullptr, &aud_dat->log_line_cache));
 
-            if (wav_8bit)
-                audio_16to8(buf8bit, (short*)audio_dat, samples_get * oip->audio_ch);
+            const short *src = (const short *)audio_dat;
+            //L/R分離時は、buf_convにLとRを続けて並べ、それぞれのwavに出力する
+            short *dst_ch[2] = { (short *)buf_conv, (short *)buf_conv + samples_get };
+            if (fmt->wav_8bit) {
+                audio_16to8(buf_conv, src, samples_get * oip->audio_ch);
+            } else {
+                switch (fmt->wav_format) {
+                    case AUDIO_WAV_FORMAT_24BIT:
+                        audio_func->audio_16to24(buf_conv, src, samples_get * oip->audio_ch);
+                        break;
+                    case AUDIO_WAV_FORMAT_FLOAT:
+                        audio_func->audio_16tofloat((float *)buf_conv, src, samples_get * oip->audio_ch);
+                        break;
+                    case AUDIO_WAV_FORMAT_SPLIT_CH:
+                        audio_func->split_audio_ch(dst_ch, src, samples_get, oip->audio_ch);
+                        break;
+                    default:
+                        break;
+                }
+            }
 
             const int write_bytes = samples_get * wav_sample_size;
             for (int i_aud = 0; i_aud < pe->aud_count; i_aud++)
-                _fwrite_nolock((wav_8bit) ? buf8bit + i_aud * write_bytes : audio_dat, write_bytes, 1, aud_dat[i_aud].fp_out);
+                _fwrite_nolock((need_convert) ? buf_conv + i_aud * write_bytes : audio_dat, write_bytes, 1, aud_dat[i_aud].fp_out);
         }
 
         //動画との音声との同時処理が終了
@@ -398,7 +450,7 @@ static AUO_RESULT wav_output(aud_data_t *aud_dat, const OUTPUT_INFO *oip, PRM_EN
         for (int i_aud = 0; i_aud < pe->aud_count; i_aud++)
             ret |= wav_file_close(&aud_dat[i_aud], oip, samples_read, wav_sample_size, use_pipe);
     }
-    if (buf8bit) _aligned_free(buf8bit);
+    if (buf_conv) _aligned_free(buf_conv);
 
     return ret;
 }
@@ -481,7 +533,8 @@ AUO_RESULT audio_output(CONF_GUIEX *conf, const OUTPUT_INFO *oip, PRM_ENC *pe, c
 
     //使用するエンコーダの設定を選択
     const AUDIO_SETTINGS *aud_stg = &sys_dat->exstg->s_aud[conf->aud.encoder];
-    pe->aud_count = (aud_stg->mode[conf->aud.enc_mode].use_8bit == 2) ? 2 : 1;
+    const wav_format_t wav_fmt = get_wav_format(&aud_stg->mode[conf->aud.enc_mode], oip);
+    pe->aud_count = wav_fmt.wav_count;
 
     //もし必要なら、オーディオディレイカット用の追加sample数を再計算する
     recalculate_audio_delay_cut_for_afs(conf, oip, pe, aud_stg);
@@ -517,7 +570,7 @@ AUO_RESULT audio_output(CONF_GUIEX *conf, const OUTPUT_INFO *oip, PRM_ENC *pe, c
     PathGetDirectory(auddir, _countof(auddir), aud_stg->fullpath);
 
     //wav出力
-    ret |= wav_output(aud_dat, oip, pe, aud_stg->mode[conf->aud.enc_mode].use_8bit, sys_dat->exstg->s_local.audio_buffer_size, aud_stg->dispname, auddir, encoder_priority, aud_stg->disable_log);
+    ret |= wav_output(aud_dat, oip, pe, &wav_fmt, sys_dat->exstg->s_local.audio_buffer_size, aud_stg->dispname, auddir, encoder_priority, aud_stg->disable_log);
     
     //音声エンコード前バッチ処理
     ret |= run_bat_file(conf, oip, pe, sys_dat, RUN_BAT_BEFORE_AUDIO);
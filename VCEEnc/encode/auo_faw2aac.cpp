@@ -28,7 +28,6 @@
 #include <Windows.h>
 #include <shlwapi.h>
 #pragma comment(lib, "shlwapi.lib")
-#include <emmintrin.h>
 
 #include "output.h"
 #include "auo.h"
@@ -43,6 +42,7 @@
 #include "auo_audio.h"
 #include "auo_audio_parallel.h"
 #include "auo_faw2aac.h"
+#include "convert_audio.h"
 
 typedef OUTPUT_PLUGIN_TABLE* (*func_get_auo_table)(void);
 
@@ -78,114 +78,24 @@ static BOOL auo_rest_time_disp(int now, int total) {
     return TRUE;
 };
 
-static void __forceinline audio_pass_upper8bit(short *data, int length) {
-    for (int i = 0; i < length; i++)
-        data[i] &= 0xff00;
-}
-static void __forceinline audio_pass_lower8bit(short *data, int length) {
-    for (int i = 0; i < length; i++)
-        data[i] <<= 8;
-}
-static void __forceinline audio_pass_upper8bit_sse2(short *data, int length) {
-    short *data_fin = (short *)(((size_t)data + 15) & ~15);
-    length -= (data_fin - data);
-    for ( ; data < data_fin; data++)
-        *data &= 0xff00;
-    //メインループ
-    data_fin = data + (length & ~15);
-    __m128i x0, x1;
-    __m128i xMask = _mm_slli_epi16(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()), 8); //0xff00
-    for ( ; data < data_fin; data += 16) {
-        x0 = _mm_load_si128((__m128i*)(data + 0));
-        x1 = _mm_load_si128((__m128i*)(data + 8));
-        x0 = _mm_and_si128(x0, xMask);
-        x1 = _mm_and_si128(x1, xMask);
-        _mm_store_si128((__m128i*)(data + 0), x0);
-        _mm_store_si128((__m128i*)(data + 8), x1);
-    }
-    data = data_fin + (length & 15) - 16;
-    x0 = _mm_loadu_si128((__m128i*)(data + 0));
-    x1 = _mm_loadu_si128((__m128i*)(data + 8));
-    x0 = _mm_and_si128(x0, xMask);
-    x1 = _mm_and_si128(x1, xMask);
-    _mm_storeu_si128((__m128i*)(data + 0), x0);
-    _mm_storeu_si128((__m128i*)(data + 8), x1);
-}
-static void __forceinline audio_pass_lower8bit_sse2(short *data, int length) {
-    short *data_fin = (short *)(((size_t)data + 15) & ~15);
-    length -= (data_fin - data);
-    for ( ; data < data_fin; data++)
-        *data <<= 8;
-    //メインループ
-    data_fin = data + (length & ~15);
-    __m128i x0, x1;
-    for ( ; data < data_fin; data += 16) {
-        x0 = _mm_load_si128((__m128i*)(data + 0));
-        x1 = _mm_load_si128((__m128i*)(data + 8));
-        x0 = _mm_slli_epi16(x0, 8);
-        x1 = _mm_slli_epi16(x1, 8);
-        _mm_store_si128((__m128i*)(data + 0), x0);
-        _mm_store_si128((__m128i*)(data + 8), x1);
-    }
-    data_fin += (length & 15);
-    for ( ; data < data_fin; data++)
-        *data <<= 8;
-}
+//上位8bit/下位8bitのみを残す関数 (トラックごとに設定する)
+static func_audio_pass8bit g_audio_pass8bit = NULL;
 
 //音声通常処理用
-static void *auo_get_audio_normal_upper8bit(int start, int length, int *readed) {
-    short *dat = (short *)g_oip->func_get_audio(start, length, readed);
-    audio_pass_upper8bit(dat, *readed * g_oip->audio_ch);
-    return dat;
-}
-static void *auo_get_audio_normal_lower8bit(int start, int length, int *readed) {
+static void *auo_get_audio_normal_pass8bit(int start, int length, int *readed) {
     short *dat = (short *)g_oip->func_get_audio(start, length, readed);
-    audio_pass_lower8bit(dat, *readed * g_oip->audio_ch);
-    return dat;
-}
-static void *auo_get_audio_normal_upper8bit_sse2(int start, int length, int *readed) {
-    short *dat = (short *)g_oip->func_get_audio(start, length, readed);
-    audio_pass_upper8bit_sse2(dat, *readed * g_oip->audio_ch);
-    return dat;
-}
-static void *auo_get_audio_normal_lower8bit_sse2(int start, int length, int *readed) {
-    short *dat = (short *)g_oip->func_get_audio(start, length, readed);
-    audio_pass_lower8bit_sse2(dat, *readed * g_oip->audio_ch);
+    g_audio_pass8bit(dat, *readed * g_oip->audio_ch);
     return dat;
 }
 //音声並列処理用
 static void *auo_get_audio_parallel(int start, int length, int *readed) {
     return get_audio_data(g_oip, g_pe, start, length, readed);
 }
-static void *auo_get_audio_parallel_upper8bit(int start, int length, int *readed) {
-    short *dat = (short *)get_audio_data(g_oip, g_pe, start, length, readed);
-    audio_pass_upper8bit(dat, *readed * g_oip->audio_ch);
-    return dat;
-}
-static void *auo_get_audio_parallel_lower8bit(int start, int length, int *readed) {
-    short *dat = (short *)get_audio_data(g_oip, g_pe, start, length, readed);
-    audio_pass_lower8bit(dat, *readed * g_oip->audio_ch);
-    return dat;
-}
-static void *auo_get_audio_parallel_upper8bit_sse2(int start, int length, int *readed) {
+static void *auo_get_audio_parallel_pass8bit(int start, int length, int *readed) {
     short *dat = (short *)get_audio_data(g_oip, g_pe, start, length, readed);
-    audio_pass_upper8bit_sse2(dat, *readed * g_oip->audio_ch);
+    g_audio_pass8bit(dat, *readed * g_oip->audio_ch);
     return dat;
 }
-static void *auo_get_audio_parallel_lower8bit_sse2(int start, int length, int *readed) {
-    short *dat = (short *)get_audio_data(g_oip, g_pe, start, length, readed);
-    audio_pass_lower8bit_sse2(dat, *readed * g_oip->audio_ch);
-    return dat;
-}
-static const auo_func_get_audio FAW2AAC_AUDIO_NORMAL[][2] = {
-    { auo_get_audio_normal_upper8bit, auo_get_audio_normal_upper8bit_sse2 },
-    { auo_get_audio_normal_lower8bit, auo_get_audio_normal_lower8bit_sse2 },
-};
-static const auo_func_get_audio FAW2AAC_AUDIO_PARALLEL[][2] = {
-    { auo_get_audio_parallel_upper8bit, auo_get_audio_parallel_upper8bit_sse2 },
-    { auo_get_audio_parallel_lower8bit, auo_get_audio_parallel_lower8bit_sse2 },
-};
-
 
 static BOOL auo_get_if_abort() {
     return (g_pe) ? g_pe->aud_parallel.abort : FALSE;
@@ -244,14 +154,17 @@ AUO_RESULT audio_faw2aac(CONF_GUIEX *conf, const OUTPUT_INFO *oip, PRM_ENC *pe,
             g_oip = oip;
             g_pe = pe;
             oip_faw2aac.func_rest_time_disp = auo_rest_time_disp;
+            //1トラック目は上位8bit、2トラック目は下位8bitを使用する
+            const AUDIO_CONVERT_FUNC *audio_func = get_audio_convert_func();
+            g_audio_pass8bit = (i_aud) ? audio_func->audio_pass_lower8bit : audio_func->audio_pass_upper8bit;
             //並列処理制御用
             if (pe->aud_parallel.th_aud) {
-                oip_faw2aac.func_get_audio = (pe->aud_count > 1) ? FAW2AAC_AUDIO_PARALLEL[!!i_aud][!!check_sse2()] : auo_get_audio_parallel;
+                oip_faw2aac.func_get_audio = (pe->aud_count > 1) ? auo_get_audio_parallel_pass8bit : auo_get_audio_parallel;
                 oip_faw2aac.func_is_abort = auo_get_if_abort;
                 oip_faw2aac.func_update_preview = auo_kill_update_preview;
             //通常処理用
             } else if (pe->aud_count > 1)
-                oip_faw2aac.func_get_audio = FAW2AAC_AUDIO_NORMAL[!!i_aud][!!check_sse2()];
+                oip_faw2aac.func_get_audio = auo_get_audio_normal_pass8bit;
 
             //開始
             if (opt->func_init && !opt->func_init()) {
@@ -205,8 +205,7 @@ AMF_RESULT VCEInputAuo::QueryOutput(amf::AMFData** ppData) {
     AMF_RESULT res = AMF_OK;
     amf::AMFSurfacePtr pSurface;
     res = m_pContext->AllocSurface(amf::AMF_MEMORY_HOST, m_inputFrameInfo.format,
-        m_inputFrameInfo.srcWidth - m_inputFrameInfo.crop.left - m_inputFrameInfo.crop.right,
-        m_inputFrameInfo.srcHeight - m_inputFrameInfo.crop.bottom - m_inputFrameInfo.crop.up,
+        getSurfaceWidth(), getSurfaceHeight(),
         &pSurface);
     if (res != AMF_OK) {
         AddMessage(VCE_LOG_ERROR, _T("AMFContext::AllocSurface(amf::AMF_MEMORY_HOST) failed.\n"));
@@ -251,13 +250,14 @@ AMF_RESULT VCEInputAuo::QueryOutput(amf::AMFData** ppData) {
     int dst_stride = plane->GetHPitch();
     int dst_height = plane->GetVPitch();
 
-    void *dst_ptr[2];
+    void *dst_ptr[3];
     dst_ptr[0] = (uint8_t *)plane->GetNative();
     dst_ptr[1] = (uint8_t *)dst_ptr[0] + dst_height * dst_stride;
+    dst_ptr[2] = (uint8_t *)dst_ptr[1] + dst_height * dst_stride;
     int crop[4] = { 0 };
-    m_sConvert->func[is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0](dst_ptr, &frame, m_inputFrameInfo.srcWidth, m_inputFrameInfo.srcWidth * 2, 0, dst_stride, m_inputFrameInfo.srcHeight, dst_height, crop);
+    convertCsp(is_interlaced(m_inputFrameInfo.nPicStruct) ? 1 : 0, dst_ptr, &frame, m_inputFrameInfo.srcWidth, m_inputFrameInfo.srcWidth * 2, 0, dst_stride, m_inputFrameInfo.srcHeight, dst_height, crop);
 
-    m_pEncSatusInfo->m_nInputFrames++;
+    m_pEncSatusInfo->AddInputFrame();
     if (!(m_pEncSatusInfo->m_nInputFrames & 7))
         aud_parallel_task(m_param.oip, m_param.pe);
 
@@ -43,22 +43,6 @@ typedef struct {
     int   total_size;  //全planarのサイズの総和
 } CONVERT_CF_DATA;
 
-//音声16bit->8bit変換
-typedef void (*func_audio_16to8) (BYTE *dst, short *src, int n);
-
-func_audio_16to8 get_audio_16to8_func(BOOL split); //使用する音声16bit->8bit関数の選択
-
-void convert_audio_16to8(BYTE *dst, short *src, int n);
-void convert_audio_16to8_sse2(BYTE *dst, short *src, int n);
-
-void split_audio_16to8x2(BYTE *dst, short *src, int n);
-void split_audio_16to8x2_sse2(BYTE *dst, short *src, int n);
-
-#if (_MSC_VER >= 1700)
-void convert_audio_16to8_avx2(BYTE *dst, short *src, int n);
-void split_audio_16to8x2_avx2(BYTE *dst, short *src, int n);
-#endif
-
 typedef void (*func_convert_frame) (void *frame, BYTE *dst_Y, BYTE *dst_C, const int width, const int height, const int pitch);
 
 void copy_yuy2(void *frame, BYTE *dst_Y, BYTE *dst_C, const int width, const int height, const int pitch);
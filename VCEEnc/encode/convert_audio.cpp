@@ -0,0 +1,300 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <string.h>
+#include <emmintrin.h> //イントリンシック命令 SSE2
+
+#include "convert_audio.h"
+#include "auo.h"
+#include "auo_util.h"
+
+static const AUDIO_CONVERT_FUNC FUNC_AUDIO_CONVERT[] = {
+#if (_MSC_VER >= 1911)
+    { AUO_SIMD_AVX512 | AUO_SIMD_AVX2 | AUO_SIMD_AVX | AUO_SIMD_SSE2,
+      convert_audio_16to8_avx512, split_audio_16to8x2_avx512, convert_audio_16tofloat_avx512, convert_audio_floatto16_avx512,
+      split_audio_ch_avx512, convert_audio_16to24_avx2, audio_pass_upper8bit_avx512, audio_pass_lower8bit_avx512 },
+#endif
+#if (_MSC_VER >= 1700)
+    { AUO_SIMD_AVX2 | AUO_SIMD_AVX | AUO_SIMD_SSE2,
+      convert_audio_16to8_avx2, split_audio_16to8x2_avx2, convert_audio_16tofloat_avx2, convert_audio_floatto16_avx2,
+      split_audio_ch_avx2, convert_audio_16to24_avx2, audio_pass_upper8bit_avx2, audio_pass_lower8bit_avx2 },
+#endif
+    { AUO_SIMD_SSE2,
+      convert_audio_16to8_sse2, split_audio_16to8x2_sse2, convert_audio_16tofloat_sse2, convert_audio_floatto16_sse2,
+      split_audio_ch_sse2, convert_audio_16to24_sse2, audio_pass_upper8bit_sse2, audio_pass_lower8bit_sse2 },
+    { AUO_SIMD_NONE,
+      convert_audio_16to8, split_audio_16to8x2, convert_audio_16tofloat, convert_audio_floatto16,
+      split_audio_ch, convert_audio_16to24, audio_pass_upper8bit, audio_pass_lower8bit },
+};
+
+//音声変換関数の選択
+const AUDIO_CONVERT_FUNC *get_audio_convert_func(DWORD simd) {
+    for (int i = 0; i < _countof(FUNC_AUDIO_CONVERT); i++) {
+        if ((FUNC_AUDIO_CONVERT[i].simd & simd) == FUNC_AUDIO_CONVERT[i].simd) {
+            return &FUNC_AUDIO_CONVERT[i];
+        }
+    }
+    return &FUNC_AUDIO_CONVERT[_countof(FUNC_AUDIO_CONVERT) - 1];
+}
+
+const AUDIO_CONVERT_FUNC *get_audio_convert_func() {
+    return get_audio_convert_func(get_availableSIMD());
+}
+
+//16bit音声 -> 8bit音声
+void convert_audio_16to8(BYTE *dst, const short *src, int n) {
+    BYTE *byte = dst;
+    const BYTE *fin = byte + n;
+    const short *sh = src;
+    while (byte < fin) {
+        *byte = (*sh >> 8) + 128;
+        byte++;
+        sh++;
+    }
+}
+
+//上のSSE2版
+void convert_audio_16to8_sse2(BYTE *dst, const short *src, int n) {
+    const __m128i xConst = _mm_set1_epi16(128);
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m128i xSA = _mm_loadu_si128((const __m128i *)(src + i + 0));
+        __m128i xSB = _mm_loadu_si128((const __m128i *)(src + i + 8));
+        xSA = _mm_add_epi16(_mm_srai_epi16(xSA, 8), xConst);
+        xSB = _mm_add_epi16(_mm_srai_epi16(xSB, 8), xConst);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(xSA, xSB));
+    }
+    convert_audio_16to8(dst + i, src + i, n - i);
+}
+
+//16bit音声 -> 上位8bit(dst)と下位8bit(dst+n)に分離
+void split_audio_16to8x2(BYTE *dst, const short *src, int n) {
+    BYTE *byte0 = dst;
+    BYTE *byte1 = dst + n;
+    const short *sh = src;
+    const short *sh_fin = src + n;
+    for ( ; sh < sh_fin; sh++, byte0++, byte1++) {
+        *byte0 = (*sh >> 8)   + 128;
+        *byte1 = (*sh & 0xff) + 128;
+    }
+}
+
+void split_audio_16to8x2_sse2(BYTE *dst, const short *src, int n) {
+    BYTE *byte0 = dst;
+    BYTE *byte1 = dst + n;
+    const short *sh = src;
+    const short *sh_fin = src + (n & ~15);
+    __m128i x0, x1, x2, x3;
+    __m128i xMask = _mm_srli_epi16(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()), 8);
+    __m128i xConst = _mm_set1_epi8(-128);
+    for ( ; sh < sh_fin; sh += 16, byte0 += 16, byte1 += 16) {
+        x0 = _mm_loadu_si128((const __m128i*)(sh + 0));
+        x1 = _mm_loadu_si128((const __m128i*)(sh + 8));
+        x2 = _mm_and_si128(x0, xMask); //Lower8bit
+        x3 = _mm_and_si128(x1, xMask); //Lower8bit
+        x0 = _mm_srli_epi16(x0, 8);    //Upper8bit
+        x1 = _mm_srli_epi16(x1, 8);    //Upper8bit
+        x2 = _mm_packus_epi16(x2, x3);
+        x0 = _mm_packus_epi16(x0, x1);
+        x2 = _mm_add_epi8(x2, xConst);
+        x0 = _mm_add_epi8(x0, xConst);
+        _mm_storeu_si128((__m128i*)byte0, x0);
+        _mm_storeu_si128((__m128i*)byte1, x2);
+    }
+    sh_fin = sh + (n & 15);
+    for ( ; sh < sh_fin; sh++, byte0++, byte1++) {
+        *byte0 = (*sh >> 8)   + 128;
+        *byte1 = (*sh & 0xff) + 128;
+    }
+}
+
+//16bit音声 -> float音声
+void convert_audio_16tofloat(float *dst, const short *src, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = (float)src[i] * AUDIO_16_TO_FLOAT_MUL;
+    }
+}
+
+void convert_audio_16tofloat_sse2(float *dst, const short *src, int n) {
+    const __m128 xMul = _mm_set1_ps(AUDIO_16_TO_FLOAT_MUL);
+    int i = 0;
+    for ( ; i < (n & ~7); i += 8) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i x1 = _mm_srai_epi32(_mm_unpacklo_epi16(x0, x0), 16);
+        __m128i x2 = _mm_srai_epi32(_mm_unpackhi_epi16(x0, x0), 16);
+        _mm_storeu_ps(dst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(x1), xMul));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(x2), xMul));
+    }
+    convert_audio_16tofloat(dst + i, src + i, n - i);
+}
+
+//float音声 -> 16bit音声 (TPDFディザ付き)
+void convert_audio_floatto16(short *dst, const float *src, int n, uint32_t *dither) {
+    uint32_t state = *dither;
+    for (int i = 0; i < n; i++, state += AUDIO_DITHER_STEP) {
+        dst[i] = audio_floatto16_sample(src[i], state);
+    }
+    *dither = state;
+}
+
+static __forceinline __m128i audio_dither_hash_sse2(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    return x;
+}
+
+static __forceinline __m128i audio_floatto16_sse2(__m128 xSrc, __m128i xState) {
+    const __m128i xMask = _mm_set1_epi32(0xffff);
+    __m128i xRand = audio_dither_hash_sse2(xState);
+    __m128i xDither = _mm_sub_epi32(_mm_and_si128(xRand, xMask), _mm_srli_epi32(xRand, 16));
+    __m128 x0 = _mm_mul_ps(xSrc, _mm_set1_ps(AUDIO_FLOAT_TO_16_MUL));
+    x0 = _mm_add_ps(x0, _mm_mul_ps(_mm_cvtepi32_ps(xDither), _mm_set1_ps(AUDIO_DITHER_MUL)));
+    x0 = _mm_min_ps(x0, _mm_set1_ps(32767.0f));
+    x0 = _mm_max_ps(x0, _mm_set1_ps(-32768.0f));
+    return _mm_cvtps_epi32(x0);
+}
+
+void convert_audio_floatto16_sse2(short *dst, const float *src, int n, uint32_t *dither) {
+    const uint32_t state = *dither;
+    __m128i xState = _mm_add_epi32(_mm_set1_epi32(state), _mm_setr_epi32(0, AUDIO_DITHER_STEP, AUDIO_DITHER_STEP * 2, AUDIO_DITHER_STEP * 3));
+    const __m128i xStep = _mm_set1_epi32(AUDIO_DITHER_STEP * 4);
+    int i = 0;
+    for ( ; i < (n & ~7); i += 8) {
+        __m128i x0 = audio_floatto16_sse2(_mm_loadu_ps(src + i + 0), xState);
+        xState = _mm_add_epi32(xState, xStep);
+        __m128i x1 = audio_floatto16_sse2(_mm_loadu_ps(src + i + 4), xState);
+        xState = _mm_add_epi32(xState, xStep);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(x0, x1));
+    }
+    *dither = state + AUDIO_DITHER_STEP * (uint32_t)i;
+    convert_audio_floatto16(dst + i, src + i, n - i, dither);
+}
+
+//インタリーブされた音声 -> チャンネルごとの音声
+void split_audio_ch(short **dst, const short *src, int n, int ch) {
+    for (int i = 0; i < n; i++, src += ch) {
+        for (int j = 0; j < ch; j++) {
+            dst[j][i] = src[j];
+        }
+    }
+}
+
+//SIMD版は1ch/2chのみ、それ以外はC版で処理する
+void split_audio_ch_sse2(short **dst, const short *src, int n, int ch) {
+    if (ch == 1) {
+        memcpy(dst[0], src, sizeof(short) * n);
+        return;
+    }
+    if (ch != 2) {
+        split_audio_ch(dst, src, n, ch);
+        return;
+    }
+    int i = 0;
+    for ( ; i < (n & ~7); i += 8) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i * 2 + 0));
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(src + i * 2 + 8));
+        __m128i xL = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(x0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(x1, 16), 16));
+        __m128i xR = _mm_packs_epi32(_mm_srai_epi32(x0, 16), _mm_srai_epi32(x1, 16));
+        _mm_storeu_si128((__m128i *)(dst[0] + i), xL);
+        _mm_storeu_si128((__m128i *)(dst[1] + i), xR);
+    }
+    short *dst_remain[2] = { dst[0] + i, dst[1] + i };
+    split_audio_ch(dst_remain, src + i * 2, n - i, ch);
+}
+
+//16bit音声 -> 24bit音声
+void convert_audio_16to24(BYTE *dst, const short *src, int n) {
+    for (int i = 0; i < n; i++, dst += 3) {
+        dst[0] = 0;
+        dst[1] = (BYTE)(src[i] & 0xff);
+        dst[2] = (BYTE)((src[i] >> 8) & 0xff);
+    }
+}
+
+//下位3byteを持つ4つのdwordを12byteに詰める
+static __forceinline __m128i pack_dword_24bit_sse2(__m128i x) {
+    __m128i x0 = _mm_and_si128(x, _mm_setr_epi32(-1, 0, 0, 0));
+    __m128i x1 = _mm_srli_si128(_mm_and_si128(x, _mm_setr_epi32(0, -1, 0, 0)), 1);
+    __m128i x2 = _mm_srli_si128(_mm_and_si128(x, _mm_setr_epi32(0, 0, -1, 0)), 2);
+    __m128i x3 = _mm_srli_si128(_mm_and_si128(x, _mm_setr_epi32(0, 0, 0, -1)), 3);
+    return _mm_or_si128(_mm_or_si128(x0, x1), _mm_or_si128(x2, x3));
+}
+
+void convert_audio_16to24_sse2(BYTE *dst, const short *src, int n) {
+    int i = 0;
+    for ( ; i < (n & ~7); i += 8, dst += 24) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i));
+        //(uint16_t)src << 8 をdwordで作る
+        __m128i x1 = _mm_srli_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), x0), 8);
+        __m128i x2 = _mm_srli_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), x0), 8);
+        x1 = pack_dword_24bit_sse2(x1);
+        x2 = pack_dword_24bit_sse2(x2);
+        _mm_storeu_si128((__m128i *)(dst + 0), _mm_or_si128(x1, _mm_slli_si128(x2, 12)));
+        _mm_storel_epi64((__m128i *)(dst + 16), _mm_srli_si128(x2, 4));
+    }
+    convert_audio_16to24(dst, src + i, n - i);
+}
+
+//FAW用 上位8bitのみを残す
+void audio_pass_upper8bit(short *data, int n) {
+    for (int i = 0; i < n; i++)
+        data[i] &= 0xff00;
+}
+
+void audio_pass_upper8bit_sse2(short *data, int n) {
+    const __m128i xMask = _mm_set1_epi16((short)0xff00);
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m128i x0 = _mm_loadu_si128((__m128i *)(data + i + 0));
+        __m128i x1 = _mm_loadu_si128((__m128i *)(data + i + 8));
+        _mm_storeu_si128((__m128i *)(data + i + 0), _mm_and_si128(x0, xMask));
+        _mm_storeu_si128((__m128i *)(data + i + 8), _mm_and_si128(x1, xMask));
+    }
+    audio_pass_upper8bit(data + i, n - i);
+}
+
+//FAW用 下位8bitを上位8bitに移す
+void audio_pass_lower8bit(short *data, int n) {
+    for (int i = 0; i < n; i++)
+        data[i] <<= 8;
+}
+
+void audio_pass_lower8bit_sse2(short *data, int n) {
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m128i x0 = _mm_loadu_si128((__m128i *)(data + i + 0));
+        __m128i x1 = _mm_loadu_si128((__m128i *)(data + i + 8));
+        _mm_storeu_si128((__m128i *)(data + i + 0), _mm_slli_epi16(x0, 8));
+        _mm_storeu_si128((__m128i *)(data + i + 8), _mm_slli_epi16(x1, 8));
+    }
+    audio_pass_lower8bit(data + i, n - i);
+}
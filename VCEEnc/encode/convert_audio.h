@@ -0,0 +1,136 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#ifndef _CONVERT_AUDIO_H_
+#define _CONVERT_AUDIO_H_
+
+#include <Windows.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+//音声16bit->8bit変換 (nはサンプル数xチャンネル数)
+typedef void (*func_audio_16to8) (BYTE *dst, const short *src, int n);
+//音声16bit->float変換 ([-1.0, 1.0)に正規化)
+typedef void (*func_audio_16tofloat) (float *dst, const short *src, int n);
+//音声float->16bit変換 (TPDFディザ付き)
+//ditherはディザの乱数の状態で、呼び出すごとにnだけ進む
+typedef void (*func_audio_floatto16) (short *dst, const float *src, int n, uint32_t *dither);
+//インタリーブされた音声をチャンネルごとに分離 (nはチャンネルあたりのサンプル数)
+typedef void (*func_audio_split_ch) (short **dst, const short *src, int n, int ch);
+//音声16bit->24bit変換 (リトルエンディアンで3byteずつ詰める)
+typedef void (*func_audio_16to24) (BYTE *dst, const short *src, int n);
+//FAW用に上位8bit/下位8bitのみを残す (インプレース)
+typedef void (*func_audio_pass8bit) (short *data, int n);
+
+typedef struct {
+    DWORD simd; //必要なSIMD (AUO_SIMD_xxx)
+    func_audio_16to8     audio_16to8;
+    func_audio_16to8     split_audio_16to8x2; //上位8bitをdst、下位8bitをdst+nに出力
+    func_audio_16tofloat audio_16tofloat;
+    func_audio_floatto16 audio_floatto16;
+    func_audio_split_ch  split_audio_ch;
+    func_audio_16to24    audio_16to24;
+    func_audio_pass8bit  audio_pass_upper8bit;
+    func_audio_pass8bit  audio_pass_lower8bit;
+} AUDIO_CONVERT_FUNC;
+
+//使用する音声変換関数の選択
+const AUDIO_CONVERT_FUNC *get_audio_convert_func();
+//指定したSIMDのみを使う音声変換関数の選択 (動作確認用)
+const AUDIO_CONVERT_FUNC *get_audio_convert_func(DWORD simd);
+
+//TPDFディザの乱数の初期値
+static const uint32_t AUDIO_DITHER_SEED = 0x2545F491;
+
+void convert_audio_16to8(BYTE *dst, const short *src, int n);
+void convert_audio_16to8_sse2(BYTE *dst, const short *src, int n);
+void convert_audio_16to8_avx2(BYTE *dst, const short *src, int n);
+void convert_audio_16to8_avx512(BYTE *dst, const short *src, int n);
+
+void split_audio_16to8x2(BYTE *dst, const short *src, int n);
+void split_audio_16to8x2_sse2(BYTE *dst, const short *src, int n);
+void split_audio_16to8x2_avx2(BYTE *dst, const short *src, int n);
+void split_audio_16to8x2_avx512(BYTE *dst, const short *src, int n);
+
+void convert_audio_16tofloat(float *dst, const short *src, int n);
+void convert_audio_16tofloat_sse2(float *dst, const short *src, int n);
+void convert_audio_16tofloat_avx2(float *dst, const short *src, int n);
+void convert_audio_16tofloat_avx512(float *dst, const short *src, int n);
+
+void convert_audio_floatto16(short *dst, const float *src, int n, uint32_t *dither);
+void convert_audio_floatto16_sse2(short *dst, const float *src, int n, uint32_t *dither);
+void convert_audio_floatto16_avx2(short *dst, const float *src, int n, uint32_t *dither);
+void convert_audio_floatto16_avx512(short *dst, const float *src, int n, uint32_t *dither);
+
+void split_audio_ch(short **dst, const short *src, int n, int ch);
+void split_audio_ch_sse2(short **dst, const short *src, int n, int ch);
+void split_audio_ch_avx2(short **dst, const short *src, int n, int ch);
+void split_audio_ch_avx512(short **dst, const short *src, int n, int ch);
+
+void convert_audio_16to24(BYTE *dst, const short *src, int n);
+void convert_audio_16to24_sse2(BYTE *dst, const short *src, int n);
+void convert_audio_16to24_avx2(BYTE *dst, const short *src, int n);
+
+void audio_pass_upper8bit(short *data, int n);
+void audio_pass_upper8bit_sse2(short *data, int n);
+void audio_pass_upper8bit_avx2(short *data, int n);
+void audio_pass_upper8bit_avx512(short *data, int n);
+
+void audio_pass_lower8bit(short *data, int n);
+void audio_pass_lower8bit_sse2(short *data, int n);
+void audio_pass_lower8bit_avx2(short *data, int n);
+void audio_pass_lower8bit_avx512(short *data, int n);
+
+//TPDFディザ用の乱数
+//サンプルの位置から計算するので、SIMDの幅によらず同じ結果となる
+static __forceinline uint32_t audio_dither_hash(uint32_t x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+static const uint32_t AUDIO_DITHER_STEP = 0x9E3779B9;
+static const float AUDIO_FLOAT_TO_16_MUL = 32768.0f;
+static const float AUDIO_16_TO_FLOAT_MUL = 1.0f / 32768.0f;
+static const float AUDIO_DITHER_MUL      = 1.0f / 65536.0f;
+
+//float->16bit変換の1サンプル分 (SIMD版と同じ演算順序とすること)
+static __forceinline short audio_floatto16_sample(float src, uint32_t state) {
+    const uint32_t r = audio_dither_hash(state);
+    //2つの一様乱数の差で、[-1, 1) LSBの三角分布とする
+    const float dither = (float)((int)(r & 0xffff) - (int)(r >> 16)) * AUDIO_DITHER_MUL;
+    float f = src * AUDIO_FLOAT_TO_16_MUL;
+    f = f + dither;
+    f = (f < 32767.0f) ? f : 32767.0f;
+    f = (f > -32768.0f) ? f : -32768.0f;
+    return (short)_mm_cvtss_si32(_mm_set_ss(f));
+}
+
+#endif //_CONVERT_AUDIO_H_
@@ -0,0 +1,181 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <string.h>
+#include <immintrin.h>
+#include "convert_audio.h"
+
+#if (_MSC_VER >= 1700)
+
+//packで生じるレーンごとの並びを元に戻す
+#define PERMUTE_LANE(y) _mm256_permute4x64_epi64((y), _MM_SHUFFLE(3,1,2,0))
+
+void convert_audio_16to8_avx2(BYTE *dst, const short *src, int n) {
+    const __m256i yConst = _mm256_set1_epi16(128);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m256i ySA = _mm256_loadu_si256((const __m256i *)(src + i +  0));
+        __m256i ySB = _mm256_loadu_si256((const __m256i *)(src + i + 16));
+        ySA = _mm256_add_epi16(_mm256_srai_epi16(ySA, 8), yConst);
+        ySB = _mm256_add_epi16(_mm256_srai_epi16(ySB, 8), yConst);
+        _mm256_storeu_si256((__m256i *)(dst + i), PERMUTE_LANE(_mm256_packus_epi16(ySA, ySB)));
+    }
+    convert_audio_16to8(dst + i, src + i, n - i);
+}
+
+void split_audio_16to8x2_avx2(BYTE *dst, const short *src, int n) {
+    const __m256i yMask = _mm256_set1_epi16(0xff);
+    const __m256i yConst = _mm256_set1_epi8(-128);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m256i y0 = _mm256_loadu_si256((const __m256i *)(src + i +  0));
+        __m256i y1 = _mm256_loadu_si256((const __m256i *)(src + i + 16));
+        __m256i y2 = _mm256_packus_epi16(_mm256_and_si256(y0, yMask), _mm256_and_si256(y1, yMask)); //Lower8bit
+        __m256i y3 = _mm256_packus_epi16(_mm256_srli_epi16(y0, 8), _mm256_srli_epi16(y1, 8));       //Upper8bit
+        _mm256_storeu_si256((__m256i *)(dst + i),     _mm256_add_epi8(PERMUTE_LANE(y3), yConst));
+        _mm256_storeu_si256((__m256i *)(dst + n + i), _mm256_add_epi8(PERMUTE_LANE(y2), yConst));
+    }
+    for ( ; i < n; i++) {
+        dst[i]     = (src[i] >> 8)   + 128;
+        dst[n + i] = (src[i] & 0xff) + 128;
+    }
+}
+
+void convert_audio_16tofloat_avx2(float *dst, const short *src, int n) {
+    const __m256 yMul = _mm256_set1_ps(AUDIO_16_TO_FLOAT_MUL);
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m256i y0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i + 0)));
+        __m256i y1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i + 8)));
+        _mm256_storeu_ps(dst + i + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(y0), yMul));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(y1), yMul));
+    }
+    convert_audio_16tofloat(dst + i, src + i, n - i);
+}
+
+static __forceinline __m256i audio_dither_hash_avx2(__m256i y) {
+    y = _mm256_xor_si256(y, _mm256_slli_epi32(y, 13));
+    y = _mm256_xor_si256(y, _mm256_srli_epi32(y, 17));
+    y = _mm256_xor_si256(y, _mm256_slli_epi32(y, 5));
+    y = _mm256_xor_si256(y, _mm256_slli_epi32(y, 13));
+    y = _mm256_xor_si256(y, _mm256_srli_epi32(y, 17));
+    y = _mm256_xor_si256(y, _mm256_slli_epi32(y, 5));
+    return y;
+}
+
+static __forceinline __m256i audio_floatto16_avx2(__m256 ySrc, __m256i yState) {
+    const __m256i yMask = _mm256_set1_epi32(0xffff);
+    __m256i yRand = audio_dither_hash_avx2(yState);
+    __m256i yDither = _mm256_sub_epi32(_mm256_and_si256(yRand, yMask), _mm256_srli_epi32(yRand, 16));
+    //C版と結果を一致させるため、FMAは使用しない
+    __m256 y0 = _mm256_mul_ps(ySrc, _mm256_set1_ps(AUDIO_FLOAT_TO_16_MUL));
+    y0 = _mm256_add_ps(y0, _mm256_mul_ps(_mm256_cvtepi32_ps(yDither), _mm256_set1_ps(AUDIO_DITHER_MUL)));
+    y0 = _mm256_min_ps(y0, _mm256_set1_ps(32767.0f));
+    y0 = _mm256_max_ps(y0, _mm256_set1_ps(-32768.0f));
+    return _mm256_cvtps_epi32(y0);
+}
+
+void convert_audio_floatto16_avx2(short *dst, const float *src, int n, uint32_t *dither) {
+    const uint32_t state = *dither;
+    __m256i yState = _mm256_add_epi32(_mm256_set1_epi32(state), _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(AUDIO_DITHER_STEP)));
+    const __m256i yStep = _mm256_set1_epi32(AUDIO_DITHER_STEP * 8);
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m256i y0 = audio_floatto16_avx2(_mm256_loadu_ps(src + i + 0), yState);
+        yState = _mm256_add_epi32(yState, yStep);
+        __m256i y1 = audio_floatto16_avx2(_mm256_loadu_ps(src + i + 8), yState);
+        yState = _mm256_add_epi32(yState, yStep);
+        _mm256_storeu_si256((__m256i *)(dst + i), PERMUTE_LANE(_mm256_packs_epi32(y0, y1)));
+    }
+    *dither = state + AUDIO_DITHER_STEP * (uint32_t)i;
+    convert_audio_floatto16(dst + i, src + i, n - i, dither);
+}
+
+void split_audio_ch_avx2(short **dst, const short *src, int n, int ch) {
+    if (ch == 1) {
+        memcpy(dst[0], src, sizeof(short) * n);
+        return;
+    }
+    if (ch != 2) {
+        split_audio_ch(dst, src, n, ch);
+        return;
+    }
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m256i y0 = _mm256_loadu_si256((const __m256i *)(src + i * 2 +  0));
+        __m256i y1 = _mm256_loadu_si256((const __m256i *)(src + i * 2 + 16));
+        __m256i yL = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(y0, 16), 16), _mm256_srai_epi32(_mm256_slli_epi32(y1, 16), 16));
+        __m256i yR = _mm256_packs_epi32(_mm256_srai_epi32(y0, 16), _mm256_srai_epi32(y1, 16));
+        _mm256_storeu_si256((__m256i *)(dst[0] + i), PERMUTE_LANE(yL));
+        _mm256_storeu_si256((__m256i *)(dst[1] + i), PERMUTE_LANE(yR));
+    }
+    short *dst_remain[2] = { dst[0] + i, dst[1] + i };
+    split_audio_ch(dst_remain, src + i * 2, n - i, ch);
+}
+
+//8サンプル(16byte)を24byteに並べ替える
+//レーンをまたぐ並べ替えができないので、128bitで処理する
+void convert_audio_16to24_avx2(BYTE *dst, const short *src, int n) {
+    const __m128i xShuffle0 = _mm_setr_epi8(-1, 0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1);
+    const __m128i xShuffle1 = _mm_setr_epi8(10, 11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16, dst += 48) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i + 0));
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(src + i + 8));
+        _mm_storeu_si128((__m128i *)(dst +  0), _mm_shuffle_epi8(x0, xShuffle0));
+        _mm_storel_epi64((__m128i *)(dst + 16), _mm_shuffle_epi8(x0, xShuffle1));
+        _mm_storeu_si128((__m128i *)(dst + 24), _mm_shuffle_epi8(x1, xShuffle0));
+        _mm_storel_epi64((__m128i *)(dst + 40), _mm_shuffle_epi8(x1, xShuffle1));
+    }
+    convert_audio_16to24(dst, src + i, n - i);
+}
+
+void audio_pass_upper8bit_avx2(short *data, int n) {
+    const __m256i yMask = _mm256_set1_epi16((short)0xff00);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m256i y0 = _mm256_loadu_si256((__m256i *)(data + i +  0));
+        __m256i y1 = _mm256_loadu_si256((__m256i *)(data + i + 16));
+        _mm256_storeu_si256((__m256i *)(data + i +  0), _mm256_and_si256(y0, yMask));
+        _mm256_storeu_si256((__m256i *)(data + i + 16), _mm256_and_si256(y1, yMask));
+    }
+    audio_pass_upper8bit(data + i, n - i);
+}
+
+void audio_pass_lower8bit_avx2(short *data, int n) {
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m256i y0 = _mm256_loadu_si256((__m256i *)(data + i +  0));
+        __m256i y1 = _mm256_loadu_si256((__m256i *)(data + i + 16));
+        _mm256_storeu_si256((__m256i *)(data + i +  0), _mm256_slli_epi16(y0, 8));
+        _mm256_storeu_si256((__m256i *)(data + i + 16), _mm256_slli_epi16(y1, 8));
+    }
+    audio_pass_lower8bit(data + i, n - i);
+}
+
+#endif //(_MSC_VER >= 1700)
@@ -0,0 +1,149 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2014-2017 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// IABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <string.h>
+#include <immintrin.h>
+#include "convert_audio.h"
+
+#if (_MSC_VER >= 1911)
+
+void convert_audio_16to8_avx512(BYTE *dst, const short *src, int n) {
+    const __m256i yConst = _mm256_set1_epi8(-128);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m512i z0 = _mm512_srai_epi16(_mm512_loadu_si512((const __m512i *)(src + i)), 8);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(_mm512_cvtepi16_epi8(z0), yConst));
+    }
+    convert_audio_16to8(dst + i, src + i, n - i);
+}
+
+void split_audio_16to8x2_avx512(BYTE *dst, const short *src, int n) {
+    const __m256i yConst = _mm256_set1_epi8(-128);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m512i z0 = _mm512_loadu_si512((const __m512i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i),     _mm256_xor_si256(_mm512_cvtepi16_epi8(_mm512_srli_epi16(z0, 8)), yConst)); //Upper8bit
+        _mm256_storeu_si256((__m256i *)(dst + n + i), _mm256_xor_si256(_mm512_cvtepi16_epi8(z0), yConst));                     //Lower8bit
+    }
+    for ( ; i < n; i++) {
+        dst[i]     = (src[i] >> 8)   + 128;
+        dst[n + i] = (src[i] & 0xff) + 128;
+    }
+}
+
+void convert_audio_16tofloat_avx512(float *dst, const short *src, int n) {
+    const __m512 zMul = _mm512_set1_ps(AUDIO_16_TO_FLOAT_MUL);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m512i z0 = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(src + i +  0)));
+        __m512i z1 = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(src + i + 16)));
+        _mm512_storeu_ps(dst + i +  0, _mm512_mul_ps(_mm512_cvtepi32_ps(z0), zMul));
+        _mm512_storeu_ps(dst + i + 16, _mm512_mul_ps(_mm512_cvtepi32_ps(z1), zMul));
+    }
+    convert_audio_16tofloat(dst + i, src + i, n - i);
+}
+
+static __forceinline __m512i audio_dither_hash_avx512(__m512i z) {
+    z = _mm512_xor_si512(z, _mm512_slli_epi32(z, 13));
+    z = _mm512_xor_si512(z, _mm512_srli_epi32(z, 17));
+    z = _mm512_xor_si512(z, _mm512_slli_epi32(z, 5));
+    z = _mm512_xor_si512(z, _mm512_slli_epi32(z, 13));
+    z = _mm512_xor_si512(z, _mm512_srli_epi32(z, 17));
+    z = _mm512_xor_si512(z, _mm512_slli_epi32(z, 5));
+    return z;
+}
+
+static __forceinline __m256i audio_floatto16_avx512(__m512 zSrc, __m512i zState) {
+    const __m512i zMask = _mm512_set1_epi32(0xffff);
+    __m512i zRand = audio_dither_hash_avx512(zState);
+    __m512i zDither = _mm512_sub_epi32(_mm512_and_si512(zRand, zMask), _mm512_srli_epi32(zRand, 16));
+    //C版と結果を一致させるため、FMAは使用しない
+    __m512 z0 = _mm512_mul_ps(zSrc, _mm512_set1_ps(AUDIO_FLOAT_TO_16_MUL));
+    z0 = _mm512_add_ps(z0, _mm512_mul_ps(_mm512_cvtepi32_ps(zDither), _mm512_set1_ps(AUDIO_DITHER_MUL)));
+    z0 = _mm512_min_ps(z0, _mm512_set1_ps(32767.0f));
+    z0 = _mm512_max_ps(z0, _mm512_set1_ps(-32768.0f));
+    return _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(z0));
+}
+
+void convert_audio_floatto16_avx512(short *dst, const float *src, int n, uint32_t *dither) {
+    const uint32_t state = *dither;
+    __m512i zState = _mm512_add_epi32(_mm512_set1_epi32(state),
+        _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(AUDIO_DITHER_STEP)));
+    const __m512i zStep = _mm512_set1_epi32(AUDIO_DITHER_STEP * 16);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m256i y0 = audio_floatto16_avx512(_mm512_loadu_ps(src + i +  0), zState);
+        zState = _mm512_add_epi32(zState, zStep);
+        __m256i y1 = audio_floatto16_avx512(_mm512_loadu_ps(src + i + 16), zState);
+        zState = _mm512_add_epi32(zState, zStep);
+        _mm256_storeu_si256((__m256i *)(dst + i +  0), y0);
+        _mm256_storeu_si256((__m256i *)(dst + i + 16), y1);
+    }
+    *dither = state + AUDIO_DITHER_STEP * (uint32_t)i;
+    convert_audio_floatto16(dst + i, src + i, n - i, dither);
+}
+
+void split_audio_ch_avx512(short **dst, const short *src, int n, int ch) {
+    if (ch == 1) {
+        memcpy(dst[0], src, sizeof(short) * n);
+        return;
+    }
+    if (ch != 2) {
+        split_audio_ch(dst, src, n, ch);
+        return;
+    }
+    int i = 0;
+    for ( ; i < (n & ~15); i += 16) {
+        __m512i z0 = _mm512_loadu_si512((const __m512i *)(src + i * 2));
+        _mm256_storeu_si256((__m256i *)(dst[0] + i), _mm512_cvtepi32_epi16(z0));
+        _mm256_storeu_si256((__m256i *)(dst[1] + i), _mm512_cvtepi32_epi16(_mm512_srli_epi32(z0, 16)));
+    }
+    short *dst_remain[2] = { dst[0] + i, dst[1] + i };
+    split_audio_ch(dst_remain, src + i * 2, n - i, ch);
+}
+
+void audio_pass_upper8bit_avx512(short *data, int n) {
+    const __m512i zMask = _mm512_set1_epi16((short)0xff00);
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m512i z0 = _mm512_loadu_si512((__m512i *)(data + i));
+        _mm512_storeu_si512((__m512i *)(data + i), _mm512_and_si512(z0, zMask));
+    }
+    audio_pass_upper8bit(data + i, n - i);
+}
+
+void audio_pass_lower8bit_avx512(short *data, int n) {
+    int i = 0;
+    for ( ; i < (n & ~31); i += 32) {
+        __m512i z0 = _mm512_loadu_si512((__m512i *)(data + i));
+        _mm512_storeu_si512((__m512i *)(data + i), _mm512_slli_epi16(z0, 8));
+    }
+    audio_pass_lower8bit(data + i, n - i);
+}
+
+#endif //(_MSC_VER >= 1911)
@@ -284,71 +284,6 @@ void convert_yuy2_to_nv12_i_avx(void *frame, BYTE *dst_Y, BYTE *dst_C, const int
 #define xC_INTERLACE_WEIGHT(i) _mm256_load_si256((__m256i*)Array_INTERLACE_WEIGHT[i])
 
 
-void convert_audio_16to8_avx2(BYTE *dst, short *src, int n) {
-    BYTE *byte = dst;
-    short *sh = src;
-    BYTE * const loop_start = (BYTE *)(((size_t)dst + 31) & ~31);
-    BYTE * const loop_fin   = (BYTE *)(((size_t)dst + n) & ~31);
-    BYTE * const fin = dst + n;
-    __m256i ySA, ySB;
-    static const __m256i yConst = _mm256_set1_epi16(-128);
-    //アライメント調整
-    while (byte < loop_start) {
-        *byte = (*sh >> 8) + 128;
-        byte++;
-        sh++;
-    }
-    //メインループ
-    while (byte < loop_fin) {
-        ySA = _mm256_loadu_si256((const __m256i *)sh);
-        sh += 16;
-        ySA = _mm256_srai_epi16(ySA, 8);
-        ySA = _mm256_add_epi16(ySA, yConst);
-        ySB = _mm256_loadu_si256((const __m256i *)sh);
-        sh += 16;
-        ySB = _mm256_srai_epi16(ySB, 8);
-        ySB = _mm256_add_epi16(ySB, yConst);
-        ySA = _mm256_packus_epi16(ySA, ySB);
-        _mm256_stream_si256((__m256i *)byte, ySA);
-        byte += 32;
-    }
-    //残り
-    while (byte < fin) {
-        *byte = (*sh >> 8) + 128;
-        byte++;
-        sh++;
-    }
-}
-
-void split_audio_16to8x2_avx2(BYTE *dst, short *src, int n) {
-    BYTE *byte0 = dst;
-    BYTE *byte1 = dst + n;
-    short *sh = src;
-    short *sh_fin = src + (n & ~15);
-    __m256i y0, y1, y2, y3;
-    __m256i xMask = _mm256_srli_epi16(_mm256_cmpeq_epi8(_mm256_setzero_si256(), _mm256_setzero_si256()), 8);
-    __m256i xConst = _mm256_set1_epi8(-128);
-    for ( ; sh < sh_fin; sh += 16, byte0 += 16, byte1 += 16) {
-        y0 = _mm256_loadu_si256((__m256i*)(sh + 0));
-        y1 = _mm256_loadu_si256((__m256i*)(sh + 8));
-        y2 = _mm256_and_si256(y0, xMask); //Lower8bit
-        y3 = _mm256_and_si256(y1, xMask); //Lower8bit
-        y0 = _mm256_srli_epi16(y0, 8);    //Upper8bit
-        y1 = _mm256_srli_epi16(y1, 8);    //Upper8bit
-        y2 = _mm256_packus_epi16(y2, y3);
-        y0 = _mm256_packus_epi16(y0, y1);
-        y2 = _mm256_add_epi8(y2, xConst);
-        y0 = _mm256_add_epi8(y0, xConst);
-        _mm256_storeu_si256((__m256i*)byte0, y0);
-        _mm256_storeu_si256((__m256i*)byte1, y2);
-    }
-    sh_fin = sh + (n & 15);
-    for ( ; sh < sh_fin; sh++, byte0++, byte1++) {
-        *byte0 = (*sh >> 8)   + 128;
-        *byte1 = (*sh & 0xff) + 128;
-    }
-}
-
 void convert_yuy2_to_nv12_avx2_aligned(void *frame, BYTE *dst_Y, BYTE *dst_C, const int width, const int height, const int pitch) {
     int x, y;
     BYTE *p, *pw, *Y, *C;
@@ -26,9 +26,10 @@
 // ------------------------------------------------------------------------------------------
 
 #include <Windows.h>
+#include <intrin.h>
+#include <emmintrin.h>
 #include <limits.h>
 #include <Math.h>
-#include <vector>
 
 #include "fawcheck.h"
 #include "auo_util.h"
@@ -41,66 +42,206 @@ const int    ZERO_BLOCK_COUNT_THRESHOLD = 16; //ゼロブロックが最低秒
 const double ZERO_SUM_RATIO_MIN[3]      = { 768.0 / 1536.0, 256.0 / 1536.0, 256.0 / 1536.0 }; //全体に対するゼロの数下限(フルサイズ, ハーフサイズ)
 const double ZERO_SUM_RATIO_MAX         = 0.99479; //全体に対するゼロの数上限
 const double ZERO_SD_RATIO              = 0.25; //ゼロブロック内のゼロの平均数に対する標準偏差
+const int    FAW_CHECK_BLOCK            = 16;  //SIMDで一度に判定するサンプル数
+const double FAW_CHECK_SEGMENT_SEC      = 0.5; //間引き判定時の区間の長さ(秒)
+const int    FAW_ZERO_BLOCK_PARTIAL     = INT_MIN / 2; //区間先頭の途中からのゼロの連続を示す
 
 //int        audio_rate;        //    音声サンプリングレート
 //int        audio_ch;        //    音声チャンネル数
 //int        audio_n;        //    音声サンプリング数
 //int        audio_size;        //    音声１サンプルのバイト数
 
-//音声データは16bitのみということで
-int FAWCheck(short *audio_dat, int audio_n, int audio_rate, int audio_size) {
-    std::vector<int> zero_blocks[3];
-    int current_zero_blocks[3] = { 0, 0, 0 };
+//ゼロブロックの長さの統計 (ゼロブロックを保存せず逐次計算する)
+typedef struct {
+    int    current; //現在のゼロの連続数 (負なら区間先頭の途中からのゼロとして無視する)
+    UINT64 excluded; //途中で切れたゼロの連続のため、判定から除外したサンプル数
+    int    count;   //ゼロブロックの数
+    UINT64 sum;     //ゼロブロック内のゼロの合計
+    double mean;    //ゼロブロックの長さの平均
+    double m2;      //ゼロブロックの長さの偏差平方和
+} FAW_ZERO_BLOCK_STAT;
 
-    short *data = NULL;
-    const int step = audio_size / sizeof(short);
-    const short * const fin = audio_dat + audio_n * step;
+static __forceinline void faw_zero_block_end(FAW_ZERO_BLOCK_STAT *stat, int zero_block_threshold) {
+    if (stat->current < 0) {
+        stat->excluded += stat->current - FAW_ZERO_BLOCK_PARTIAL;
+    } else if (stat->current >= zero_block_threshold) {
+        stat->count++;
+        stat->sum += stat->current;
+        const double delta = stat->current - stat->mean;
+        stat->mean += delta / stat->count;
+        stat->m2 += delta * (stat->current - stat->mean);
+    }
+    stat->current = 0;
+}
 
-    const int zero_block_threshold = (int)(audio_rate * ZERO_BLOCK_THRESHOLD_RATIO);
+//区間の途中で判定を打ち切る場合、末尾のゼロの連続は長さが分からないので除外する
+static void faw_zero_block_discard(FAW_ZERO_BLOCK_STAT *stat) {
+    stat->excluded += (stat->current < 0) ? stat->current - FAW_ZERO_BLOCK_PARTIAL : stat->current;
+    stat->current = FAW_ZERO_BLOCK_PARTIAL;
+}
 
-    //十分な音声があるかチェック
-    if (audio_n < audio_rate * FAW_ERROR_TOO_SHORT_RATIO)
-        return FAWCHECK_ERROR_TOO_SHORT;
+//maskの下位nbitを順に処理する (ビットが立っている = ゼロ)
+static __forceinline void faw_zero_block_scan(FAW_ZERO_BLOCK_STAT *stat, DWORD mask, int nbit, int zero_block_threshold) {
+    const DWORD mask_all = (1u << nbit) - 1;
+    mask &= mask_all;
+    if (mask == mask_all) {
+        stat->current += nbit;
+        return;
+    }
+    for (int pos = 0; pos < nbit; ) {
+        const DWORD m = mask >> pos;
+        DWORD len = nbit - pos;
+        if (m & 1) {
+            //nbit以上のビットは0なので、~mは必ずどこかにビットが立っている
+            _BitScanForward(&len, ~m);
+            stat->current += len;
+        } else {
+            if (m)
+                _BitScanForward(&len, m);
+            faw_zero_block_end(stat, zero_block_threshold);
+        }
+        pos += len;
+    }
+}
 
-    //ゼロブロックを数える
-    for (data = audio_dat; data < fin; data += step) {
-        short check[3] = { *data, (BYTE)((*data >> 8) + 128), (BYTE)((*data & 0xff) + 128) };
-
-        for (int i = 0; i < 3; i++) {
-            if (check[i] == 0) {
-                current_zero_blocks[i]++;
-            } else {
-                if (current_zero_blocks[i] >= zero_block_threshold)
-                    zero_blocks[i].push_back(current_zero_blocks[i]);
-                current_zero_blocks[i] = 0;
-            }
+static __forceinline DWORD faw_check_movemask_sse2(__m128i x0, __m128i x1) {
+    return _mm_movemask_epi8(_mm_packs_epi16(x0, x1));
+}
+
+//先頭のチャンネルの16サンプル分について、3種類のゼロ判定の結果をビットマスクで返す
+static __forceinline void faw_check_mask_sse2(DWORD mask[3], const short *ptr, int step) {
+    __m128i x0, x1;
+    if (step == 1) {
+        x0 = _mm_loadu_si128((const __m128i *)(ptr + 0));
+        x1 = _mm_loadu_si128((const __m128i *)(ptr + 8));
+    } else if (step == 2) {
+        //偶数番目(先頭のチャンネル)のみを取り出す
+        __m128i x2, x3;
+        x0 = _mm_loadu_si128((const __m128i *)(ptr +  0));
+        x1 = _mm_loadu_si128((const __m128i *)(ptr +  8));
+        x2 = _mm_loadu_si128((const __m128i *)(ptr + 16));
+        x3 = _mm_loadu_si128((const __m128i *)(ptr + 24));
+        x0 = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(x0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(x1, 16), 16));
+        x1 = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(x2, 16), 16), _mm_srai_epi32(_mm_slli_epi32(x3, 16), 16));
+    } else {
+        alignas(16) short buf[FAW_CHECK_BLOCK];
+        for (int i = 0; i < FAW_CHECK_BLOCK; i++)
+            buf[i] = ptr[i * step];
+        x0 = _mm_load_si128((const __m128i *)(buf + 0));
+        x1 = _mm_load_si128((const __m128i *)(buf + 8));
+    }
+    const __m128i xZero  = _mm_setzero_si128();
+    const __m128i xMaskH = _mm_set1_epi16((short)0xff00);
+    const __m128i xMaskL = _mm_set1_epi16((short)0x00ff);
+    const __m128i xHalfH = _mm_set1_epi16((short)0x8000);
+    const __m128i xHalfL = _mm_set1_epi16((short)0x0080);
+    //check[0] : *data == 0
+    mask[0] = faw_check_movemask_sse2(_mm_cmpeq_epi16(x0, xZero), _mm_cmpeq_epi16(x1, xZero));
+    //check[1] : (BYTE)((*data >> 8) + 128) == 0 ⇔ 上位8bitが0x80
+    mask[1] = faw_check_movemask_sse2(_mm_cmpeq_epi16(_mm_and_si128(x0, xMaskH), xHalfH), _mm_cmpeq_epi16(_mm_and_si128(x1, xMaskH), xHalfH));
+    //check[2] : (BYTE)((*data & 0xff) + 128) == 0 ⇔ 下位8bitが0x80
+    mask[2] = faw_check_movemask_sse2(_mm_cmpeq_epi16(_mm_and_si128(x0, xMaskL), xHalfL), _mm_cmpeq_epi16(_mm_and_si128(x1, xMaskL), xHalfL));
+}
+
+//[start, end)の範囲のゼロブロックを数える
+static void faw_check_range(FAW_ZERO_BLOCK_STAT stat[3], const short *audio_dat, int start, int end, int step, int zero_block_threshold) {
+    const short *ptr = audio_dat + (size_t)start * step;
+    int i = start;
+    DWORD mask[3];
+    for (; i + FAW_CHECK_BLOCK <= end; i += FAW_CHECK_BLOCK, ptr += FAW_CHECK_BLOCK * step) {
+        faw_check_mask_sse2(mask, ptr, step);
+        for (int j = 0; j < 3; j++)
+            faw_zero_block_scan(&stat[j], mask[j], FAW_CHECK_BLOCK, zero_block_threshold);
+    }
+    //残りはスカラーで判定
+    const int remain = end - i;
+    if (remain > 0) {
+        mask[0] = mask[1] = mask[2] = 0;
+        for (int k = 0; k < remain; k++, ptr += step) {
+            const short data = *ptr;
+            mask[0] |= (DWORD)(data == 0) << k;
+            mask[1] |= (DWORD)((data & 0xff00) == 0x8000) << k;
+            mask[2] |= (DWORD)((data & 0x00ff) == 0x0080) << k;
         }
+        for (int j = 0; j < 3; j++)
+            faw_zero_block_scan(&stat[j], mask[j], remain, zero_block_threshold);
     }
+}
 
-    //ゼロブロックをチェック
+//ゼロブロックをチェック
+//confidenceには判定したFAWの種類のゼロブロック長の平均の信頼度 (1 - 相対標準誤差) を返す
+static int faw_check_result(const FAW_ZERO_BLOCK_STAT stat[3], UINT64 checked_n, int audio_rate, double *confidence) {
     BOOL check_result[3] = { FALSE, FALSE, FALSE };
+    double check_confidence[3] = { 0.0, 0.0, 0.0 };
     int i = 0;
     for (; i < 3; i++) {
-        if (zero_blocks[i].size() < (size_t)(audio_n * ZERO_BLOCK_COUNT_THRESHOLD / audio_rate))
+        const UINT64 n = checked_n - stat[i].excluded;
+        if ((UINT64)stat[i].count < n * ZERO_BLOCK_COUNT_THRESHOLD / audio_rate)
             continue;
-        int zero_sum = 0;
-        for (auto zero_len : zero_blocks[i])
-            zero_sum += zero_len;
-        if (zero_sum < audio_n * ZERO_SUM_RATIO_MIN[i] || zero_sum > audio_n * ZERO_SUM_RATIO_MAX)
+        if (stat[i].sum < n * ZERO_SUM_RATIO_MIN[i] || stat[i].sum > n * ZERO_SUM_RATIO_MAX)
             continue;
-        double zero_avg = zero_sum / (double)(zero_blocks[i].size());
-        double zero_sd = 0;
-        for (auto zero_len : zero_blocks[i])
-            zero_sd += pow2(zero_len - zero_avg);
-        zero_sd = sqrt(zero_sd / (zero_blocks[i].size() - 1));
+        const double zero_avg = stat[i].mean;
+        const double zero_sd = sqrt(stat[i].m2 / (stat[i].count - 1));
         if (zero_sd > zero_avg * ZERO_SD_RATIO)
             continue;
         //ここまで来たらFAW
         check_result[i] = TRUE;
+        check_confidence[i] = 1.0 - zero_sd / (zero_avg * sqrt((double)stat[i].count));
     }
     check_result[2] &= check_result[1];
     for (i = 2; i >= 0; i--)
         if (check_result[i])
             break;
+    if (confidence)
+        *confidence = (i >= 0) ? check_confidence[i] : 0.0;
     return i + FAW_FULL;
 }
+
+//音声データは16bitのみということで
+int FAWCheck(const short *audio_dat, int audio_n, int audio_rate, int audio_size, double sample_ratio, double confidence) {
+    FAW_ZERO_BLOCK_STAT stat[3] = { 0 };
+
+    const int step = audio_size / sizeof(short);
+
+    //ゼロブロックとみなす長さ (0サンプルのゼロブロックは意味がないので最低1)
+    const int zero_block_threshold = (std::max)(1, (int)(audio_rate * ZERO_BLOCK_THRESHOLD_RATIO));
+
+    //十分な音声があるかチェック
+    if (audio_n < audio_rate * FAW_ERROR_TOO_SHORT_RATIO)
+        return FAWCHECK_ERROR_TOO_SHORT;
+
+    //区間ごとに判定し、sample_ratioに応じて均等に間引く
+    sample_ratio = (std::min)(1.0, (std::max)(0.0, sample_ratio));
+    const int segment_len = (std::max)(FAW_CHECK_BLOCK, (int)(audio_rate * FAW_CHECK_SEGMENT_SEC));
+    const int segment_count = (audio_n + segment_len - 1) / segment_len;
+    UINT64 checked_n = 0;
+    bool prev_checked = true;
+    for (int i_seg = 0; i_seg < segment_count; i_seg++) {
+        if (ceil((i_seg + 1) * sample_ratio) <= ceil(i_seg * sample_ratio)) {
+            //区間を飛ばす場合、前後のゼロの連続は途中で切れるので数えない
+            if (prev_checked) {
+                for (int j = 0; j < 3; j++)
+                    faw_zero_block_discard(&stat[j]);
+            }
+            prev_checked = false;
+            continue;
+        }
+        prev_checked = true;
+        const int start = i_seg * segment_len;
+        const int end = (std::min)(audio_n, start + segment_len);
+        faw_check_range(stat, audio_dat, start, end, step, zero_block_threshold);
+        checked_n += end - start;
+
+        //十分な信頼度でFAWと判定できたら打ち切る
+        if (confidence > 0.0 && checked_n >= audio_rate * FAW_ERROR_TOO_SHORT_RATIO) {
+            double result_confidence = 0.0;
+            const int result = faw_check_result(stat, checked_n, audio_rate, &result_confidence);
+            if (result != NON_FAW && result_confidence >= confidence)
+                return result;
+        }
+    }
+    if (checked_n < audio_rate * FAW_ERROR_TOO_SHORT_RATIO)
+        return FAWCHECK_ERROR_TOO_SHORT;
+
+    return faw_check_result(stat, checked_n, audio_rate, nullptr);
+}
@@ -39,6 +39,9 @@ enum {
 
 static const char *const FAW_TYPE_NAME[] = { "non-FAW", "full size", "half size", "half size mix" };
 
-int FAWCheck(short *audio_dat, int audio_n, int audio_rate, int audio_size); //FAWCheckを行い、判定結果を返す
+//FAWCheckを行い、判定結果を返す
+//sample_ratio : 判定に使用する音声の割合 (区間ごとに均等に間引く、1.0で全体)
+//confidence   : この信頼度 (0～1) でFAWと判定できた時点で打ち切る (0で打ち切らない)
+int FAWCheck(const short *audio_dat, int audio_n, int audio_rate, int audio_size, double sample_ratio = 1.0, double confidence = 0.0);
 
 #endif //_FAWCHECK_H_
\ No newline at end of file
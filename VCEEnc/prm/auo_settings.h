@@ -90,6 +90,14 @@ enum {
     DISABLE_LOG_ALL        = DISABLE_LOG_PIPE_INPUT | DISABLE_LOG_NORMAL,
 };
 
+//音声エンコーダに渡すwavの形式 (use_8bitが指定されている場合はそちらを優先)
+enum {
+    AUDIO_WAV_FORMAT_16BIT    = 0, //16bit PCM
+    AUDIO_WAV_FORMAT_24BIT    = 1, //24bit PCM
+    AUDIO_WAV_FORMAT_FLOAT    = 2, //32bit float
+    AUDIO_WAV_FORMAT_SPLIT_CH = 3, //2chの場合、L/Rをそれぞれモノラルのwavとして2つのエンコーダに渡す
+};
+
 //メモリーを切り刻みます。
 class mem_cutter {
 private:
@@ -161,6 +169,7 @@ typedef struct {
     int delay;           //エンコード遅延 (音声が映像に対し遅れるsample数)
     int enc_2pass;       //2passエンコを行う
     int use_8bit;        //8bitwavを入力する
+    int wav_format;      //入力するwavの形式 (AUDIO_WAV_FORMAT_xxx)
     int use_remuxer;     //remuxerが必要
     char *disp_list;     //表示名のリスト
     char *cmd_list;      //コマンドラインのリスト
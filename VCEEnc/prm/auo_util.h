@@ -74,7 +74,8 @@ enum {
     AUO_SIMD_SSE41 = 0x0008,
     AUO_SIMD_SSE42 = 0x0010, //使用していない
     AUO_SIMD_AVX   = 0x0020,
-    AUO_SIMD_AVX2  = 0x0040, //使用していない
+    AUO_SIMD_AVX2  = 0x0040,
+    AUO_SIMD_AVX512 = 0x0080, //AVX512F + AVX512BW
 };
 
 //関数マクロ
@@ -404,6 +405,9 @@ static DWORD get_availableSIMD() {
     __cpuid(CPUInfo, 7);
     if ((simd & AUO_SIMD_AVX) && (CPUInfo[1] & 0x00000020))
         simd |= AUO_SIMD_AVX2;
+    //avx512f cpuid_7 CPUInfo[1] & 0x00010000, avx512bw cpuid_7 CPUInfo[1] & 0x40000000 + OSチェック(zmm)
+    if ((simd & AUO_SIMD_AVX2) && (XGETBV & 0xe6) == 0xe6 && (CPUInfo[1] & 0x40010000) == 0x40010000)
+        simd |= AUO_SIMD_AVX512;
     return simd;
 }
 
@@ -34,6 +34,7 @@
 #include "VCEVersion.h"
 #include "VCEParam.h"
 #include "VCECore.h"
+#include "ConvertCspBench.h"
 #include "avcodec_vce.h"
 
 static tstring GetVCEEncVersion() {
@@ -206,6 +207,13 @@ static tstring help() {
         _T("                                 as an option, you can specify device id to check.\n")
         _T("   --check-features [<int>]     check features of vce support for default device.\n")
         _T("                                 as an option, you can specify device id to check.\n")
+        _T("   --check-csp [<int>]          check colorspace conversion functions against\n")
+        _T("                                 plain C reference with random frame sizes and crops,\n")
+        _T("                                 with guard pages to detect out of bounds access.\n")
+        _T("                                 as an option, you can specify number of iterations.\n")
+        _T("   --check-csp-bench [json]     measure speed of colorspace conversion functions.\n")
+        _T("                                 speed ratio is against plain C reference.\n")
+        _T("                                 if \"json\" is set, output results in json.\n")
 #if ENABLE_AVCODEC_VCE_READER
         _T("   --check-avversion            show dll version\n")
         _T("   --check-codecs               show codecs available\n")
@@ -222,6 +230,8 @@ static tstring help() {
         _T(" Input formats (will be estimated from extension if not set.)\n")
         _T("   --raw                        set input as raw format\n")
         _T("   --y4m                        set input as y4m format\n")
+        _T("   --input-csp <string>         set colorspace of raw input\n")
+        _T("                                 yv12(default), nv12\n")
 #if ENABLE_AVISYNTH_READER
         _T("   --avs                        set input as avs format\n")
 #endif
@@ -353,6 +363,23 @@ static tstring help() {
         _T("   --fps <int>/<int>            set input framerate\n")
         _T("   --crop <int>,<int>,<int>,<int>\n")
         _T("                                set crop pixels of left, up, right, bottom.\n")
+        _T("   --convert-thread <int>       set threads for colorspace conversion on CPU\n")
+        _T("                                 0 = auto (default), max %d.\n")
+        _T("   --dither <string>            set dither for high bit depth to 8bit conversion\n")
+        _T("                                 none(default), bayer, errdiff\n")
+        _T("                                 errdiff is not split across conversion threads.\n")
+        _T("   --vpp-resize <string>        set resize algorithm used with --output-res\n")
+        _T("                                 amf(default) ... resize by AMF converter\n")
+        _T("                                 bilinear, bicubic, lanczos3\n")
+        _T("                                  ... resize on CPU while reading frames\n")
+        _T("   --convert-kernel <string>    select functions used for colorspace conversion\n")
+        _T("                                 auto(default) ... measure and use the fastest\n")
+        _T("                                 first ... use the first available one\n")
+        _T("                                 avx512, avx2, avx, ssse3, sse2, c\n")
+        _T("                                  ... limit simd to the specified one\n")
+        _T("                                 can be also set by VCEENC_CONVERT_KERNEL.\n")
+        _T("   --convert-profile <string>   load/save results of convert-kernel=auto\n")
+        _T("                                 to the specified file.\n")
         _T("\n")
         _T("-u,--quality <string>           set quality preset\n")
         _T("                                 balanced(default), fast, slow\n")
@@ -383,6 +410,7 @@ static tstring help() {
         _T("   --gop-len <int>              set length of gop (default: auto)\n")
         _T("   --tff                        set input as interlaced (tff)\n")
         _T("   --bff                        set input as interlaced (bff)\n"),
+        VCE_CONVERT_THREAD_MAX,
         VCE_DEFAULT_QPI, VCE_DEFAULT_QPP, VCE_DEFAULT_QPB, VCE_DEFAULT_BFRAMES,
         VCE_DEFAULT_REF_FRAMES, VCE_DEFAULT_LTR_FRAMES,
         VCE_DEFAULT_MAX_BITRATE, VCE_DEFAULT_VBV_BUFSIZE, VCE_DEFAULT_SLICES
@@ -420,6 +448,10 @@ static tstring help() {
         _T("   --log-level <int>            set log level\n")
         _T("                                 error, warn, info(default), debug\n")
         _T("   --log-framelist <string>     output frame info for avvce/avsw reader (for debug)\n")
+        _T("   --log-queue <string>         record queue statistics (max depth, blocked time,\n")
+        _T("                                 throughput), show them at the end of encode and\n")
+        _T("                                 write them periodically to the file.\n")
+        _T("                                 csv, or json lines if the extension is .json\n")
         );
     return str;
 }
@@ -488,6 +520,16 @@ int ParseOneOption(const TCHAR *option_name, const TCHAR* strInput[], int& i, in
         pParams->nInputType = VCE_INPUT_Y4M;
         return 0;
     }
+    if (IS_OPTION("input-csp")) {
+        i++;
+        int value = 0;
+        if (PARSE_ERROR_FLAG == (value = get_value_from_chr(list_input_csp, strInput[i]))) {
+            PrintHelp(strInput[0], _T("Unknown value"), option_name, strInput[i]);
+            return -1;
+        }
+        pParams->nInputCsp = value;
+        return 0;
+    }
     if (IS_OPTION("avs")) {
         pParams->nInputType = VCE_INPUT_AVS;
         return 0;
@@ -587,6 +629,54 @@ int ParseOneOption(const TCHAR *option_name, const TCHAR* strInput[], int& i, in
         memcpy(pInputInfo->crop.c, crop, sizeof(crop));
         return 0;
     }
+    if (IS_OPTION("convert-thread")) {
+        i++;
+        int value = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &value)) {
+            PrintHelp(strInput[0], _T("Unknown value"), option_name, strInput[i]);
+            return -1;
+        } else if (value < 0 || VCE_CONVERT_THREAD_MAX < value) {
+            PrintHelp(strInput[0], _T("Invalid value"), option_name, strInput[i]);
+            return -1;
+        }
+        pParams->nConvertThread = (value == 0) ? VCE_CONVERT_THREAD_AUTO : value;
+        return 0;
+    }
+    if (IS_OPTION("dither")) {
+        i++;
+        int value = 0;
+        if (PARSE_ERROR_FLAG == (value = get_value_from_chr(list_dither, strInput[i]))) {
+            PrintHelp(strInput[0], _T("Unknown value"), option_name, strInput[i]);
+            return -1;
+        }
+        pParams->nConvertDither = value;
+        return 0;
+    }
+    if (IS_OPTION("vpp-resize")) {
+        i++;
+        int value = 0;
+        if (PARSE_ERROR_FLAG == (value = get_value_from_chr(list_resize_algo, strInput[i]))) {
+            PrintHelp(strInput[0], _T("Unknown value"), option_name, strInput[i]);
+            return -1;
+        }
+        pParams->nResizeAlgo = value;
+        return 0;
+    }
+    if (IS_OPTION("convert-kernel")) {
+        i++;
+        int value = 0;
+        if (PARSE_ERROR_FLAG == (value = get_value_from_chr(list_convert_kernel, strInput[i]))) {
+            PrintHelp(strInput[0], _T("Unknown value"), option_name, strInput[i]);
+            return -1;
+        }
+        pParams->nConvertKernel = value;
+        return 0;
+    }
+    if (IS_OPTION("convert-profile")) {
+        i++;
+        pParams->pConvertProfile = _tcsdup(strInput[i]);
+        return 0;
+    }
 #if 0
     if (IS_OPTION("trim")) {
         i++;
@@ -1540,6 +1630,11 @@ int ParseOneOption(const TCHAR *option_name, const TCHAR* strInput[], int& i, in
         pParams->pFramePosListLog = _tcsdup(strInput[i]);
         return 0;
     }
+    if (IS_OPTION("log-queue")) {
+        i++;
+        pParams->pQueueLog = _tcsdup(strInput[i]);
+        return 0;
+    }
     if (IS_OPTION("log-level")) {
         i++;
         int value = VCE_LOG_INFO;
@@ -1621,6 +1716,22 @@ int parse_args(VCEParam *pParams, VCEInputInfo *pInputInfo, int nArgNum, const T
             _ftprintf(stdout, _T("\n"));
             exit(0);
         }
+        if (IS_OPTION("check-csp")) {
+            int iterations = 50;
+            int value = 0;
+            if (i + 1 < nArgNum && 1 == _stscanf_s(strInput[i+1], _T("%d"), &value)) {
+                iterations = value;
+            }
+            tstring str;
+            const int failed = convert_csp_check(str, iterations);
+            _ftprintf(stdout, _T("%s"), str.c_str());
+            exit((failed) ? 1 : 0);
+        }
+        if (IS_OPTION("check-csp-bench")) {
+            const bool bJson = (i + 1 < nArgNum && 0 == _tcsicmp(strInput[i+1], _T("json")));
+            _ftprintf(stdout, _T("%s"), convert_csp_benchmark(bJson).c_str());
+            exit(0);
+        }
 #if ENABLE_AVCODEC_VCE_READER
         if (IS_OPTION("check-avversion")) {
             _ftprintf(stdout, _T("%s\n"), getAVVersions().c_str());